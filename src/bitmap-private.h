@@ -48,6 +48,8 @@
 #define GBD_WRITE_OK			(1<<9)
 #define GBD_LOCKED			(1<<10)
 #define GBD_TRUE24BPP			(1<<11)
+#define GBD_DIRECT_WRITE		(1<<12)	/* a Graphics draws into scan0, clones can't share it */
+#define GBD_SHARED_SCAN0		(1<<13)	/* scan0 is shared with clones (copy-on-write), see gdip_bitmapdata_clone */
 
 #ifdef WORDS_BIGENDIAN
 #define set_pixel_bgra(pixel,index,b,g,r,a) do { \
@@ -71,6 +73,12 @@
 		b = (color & 0x000000ff); \
 	} while(0)
 
+/* Pixels shared by clones (copy-on-write), see gdip_bitmapdata_clone */
+typedef struct {
+	volatile gint	count;			/* number of BitmapData using scan0 */
+	BYTE		*scan0;
+} SharedScan0;
+
 /* This structure is mirrored in System.Drawing.Imaging.BitmapData.
    Any changes here must also be made to BitmapData.cs */
 typedef struct {
@@ -95,6 +103,9 @@ typedef struct {
 	unsigned int	y;			/* LockBits: top coordinate of locked rectangle */
 
 	int		transparent;		/* Index of transparent color (<24bit only) */
+
+	/* not mirrored, only set (with GBD_SHARED_SCAN0) on the frames of a GpBitmap, never on LockBits data */
+	SharedScan0	*shared;
 } BitmapData;
 
 typedef struct {
@@ -103,6 +114,17 @@ typedef struct {
 	GUID		frame_dimension;	/* GUID describing the frame type */
 } FrameData;
 
+/*
+ * Images a codec keeps encoded, outside of the frames, so they are neither listed as frame dimensions nor
+ * saved as pages (e.g. the other sizes of an icon). They can still be selected, that's when they get decoded.
+ */
+typedef struct {
+	FrameData	frame;			/* Size of the images, scan0 is only set once decoded */
+	BYTE		**raw;			/* Encoded images, NULL once decoded */
+	unsigned int	*raw_length;
+	GpStatus	(*load) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length);
+} EncodedFrames;
+
 typedef struct _Image {
 	/* Image Description */
 	ImageType     	type;			/* Undefined, Bitmap, MetaFile */
@@ -110,6 +132,7 @@ typedef struct _Image {
 	/* Image Data */
 	int		num_of_frames;		/* Number of frames */
 	FrameData	*frames;		/* Array of frames (Page, Time, Resolution) for the image */
+	EncodedFrames	*encoded_frames;	/* Images decoded when selected, active_frame is -1 for them */
 	/* Tracking of active image */
 	int		active_frame;		/* Index of frame currently used */
 	int		active_bitmap_no;	/* Index of active bitmap in current frame */
@@ -130,6 +153,8 @@ GpStatus gdip_bitmap_dispose (GpBitmap *bitmap) GDIP_INTERNAL;
 GpStatus gdip_bitmap_clone (GpBitmap *bitmap, GpBitmap **clonedbitmap) GDIP_INTERNAL;
 GpStatus gdip_bitmap_setactive (GpBitmap *bitmap, const GUID *dimension, int index) GDIP_INTERNAL;
 GpStatus gdip_bitmapdata_clone (BitmapData *src, BitmapData **dest, int count) GDIP_INTERNAL;
+void gdip_bitmapdata_release_scan0 (BitmapData *data) GDIP_INTERNAL;
+GpStatus gdip_bitmap_ensure_writable (GpBitmap *bitmap) GDIP_INTERNAL;
 ColorPalette *gdip_palette_clone(ColorPalette *original) GDIP_INTERNAL;
 GpStatus gdip_property_get_short (int offset, void *value, unsigned short *result) GDIP_INTERNAL;
 GpStatus gdip_property_get_long (int offset, void *value, guint32 *result) GDIP_INTERNAL;
@@ -145,6 +170,11 @@ GpStatus gdip_bitmapdata_property_add_srational (BitmapData *bitmap_data, PROPID
 GpStatus gdip_bitmapdata_property_remove_id (BitmapData *bitmap_data, PROPID id) GDIP_INTERNAL;
 GpStatus gdip_bitmapdata_property_remove_index (BitmapData *bitmap_data, int index) GDIP_INTERNAL;
 GpStatus gdip_bitmapdata_property_find_id (BitmapData *bitmap_data, PROPID id, int *index) GDIP_INTERNAL;
+GpStatus gdip_bitmapdata_property_set_raw (BitmapData *bitmap_data, const BYTE *raw, unsigned int length,
+	void (*load) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length)) GDIP_INTERNAL;
+void gdip_bitmapdata_property_ensure_loaded (BitmapData *bitmap_data) GDIP_INTERNAL;
+BitmapData *gdip_bitmap_add_encoded_frame (GpBitmap *bitmap, const GUID *dimension, const BYTE *raw, unsigned int length,
+	GpStatus (*load) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length)) GDIP_INTERNAL;
 
 cairo_surface_t* gdip_bitmap_ensure_surface (GpBitmap *bitmap) GDIP_INTERNAL;
 GpBitmap* gdip_convert_indexed_to_rgb (GpBitmap *bitmap) GDIP_INTERNAL;
@@ -114,6 +114,45 @@ gdip_bitmap_init (GpBitmap *bitmap)
 	bitmap->image_format = INVALID;
 }
 
+/*
+ * libgdiplus only state of the properties of a BitmapData. Since that structure is mirrored in managed code
+ * it can't grow, so this header is allocated along with, right before, the PropertyItem array.
+ */
+typedef struct {
+	int		capacity;		/* Number of PropertyItem allocated after the header */
+	GHashTable	*index;			/* id -> index + 1, built by find_id for long lists */
+	BYTE		*raw;			/* Metadata block not decoded into PropertyItems yet */
+	unsigned int	raw_length;
+	void		(*load_raw) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length);
+} PropertyList;
+
+/* rounded up so the PropertyItem array stays aligned */
+#define PROPERTY_LIST_HEADER_SIZE	((sizeof (PropertyList) + 15) & ~15)
+#define PROPERTY_LIST(property)		((PropertyList *) ((BYTE *) (property) - PROPERTY_LIST_HEADER_SIZE))
+
+/* Allocates, or grows, a PropertyItem array able to hold capacity items */
+static PropertyItem *
+gdip_propertyitems_alloc (PropertyItem *property, int capacity)
+{
+	PropertyList	*list;
+
+	if (property == NULL) {
+		list = GdipAlloc (PROPERTY_LIST_HEADER_SIZE + sizeof (PropertyItem) * capacity);
+		if (list == NULL) {
+			return NULL;
+		}
+		memset (list, 0, sizeof (PropertyList));
+	} else {
+		list = gdip_realloc (PROPERTY_LIST (property), PROPERTY_LIST_HEADER_SIZE + sizeof (PropertyItem) * capacity);
+		if (list == NULL) {
+			return NULL;
+		}
+	}
+
+	list->capacity = capacity;
+	return (PropertyItem *) ((BYTE *) list + PROPERTY_LIST_HEADER_SIZE);
+}
+
 static GpStatus
 gdip_propertyitems_clone(PropertyItem *src, PropertyItem **dest, int count)
 {
@@ -129,7 +168,7 @@ gdip_propertyitems_clone(PropertyItem *src, PropertyItem **dest, int count)
 		*dest = NULL;
 		return Ok;
 	}
-	result = GdipAlloc(sizeof(PropertyItem) * count);
+	result = gdip_propertyitems_alloc (NULL, count);
 	if (result == NULL) {
 		return OutOfMemory;
 	}
@@ -146,7 +185,7 @@ gdip_propertyitems_clone(PropertyItem *src, PropertyItem **dest, int count)
 						GdipFree(result[j].value);
 					}
 				}
-				GdipFree (result);
+				GdipFree (PROPERTY_LIST (result));
 				return OutOfMemory;
 			}
 			memcpy(result[i].value, src[i].value, src[i].length);	
@@ -162,7 +201,8 @@ gdip_propertyitems_clone(PropertyItem *src, PropertyItem **dest, int count)
 static GpStatus
 gdip_propertyitems_dispose(PropertyItem *property, int count)
 {
-	int i;
+	PropertyList	*list;
+	int		i;
 
 	if (property == NULL) {
 		return Ok;
@@ -172,7 +212,15 @@ gdip_propertyitems_dispose(PropertyItem *property, int count)
 			GdipFree(property[i].value);
 		}
 	}
-	GdipFree(property);
+
+	list = PROPERTY_LIST (property);
+	if (list->index != NULL) {
+		g_hash_table_destroy (list->index);
+	}
+	if (list->raw != NULL) {
+		GdipFree (list->raw);
+	}
+	GdipFree(list);
 
 	return Ok;
 }
@@ -300,22 +348,31 @@ gdip_bitmapdata_property_add_srational(BitmapData *bitmap_data, PROPID id, unsig
 GpStatus
 gdip_bitmapdata_property_add(BitmapData *bitmap_data, PROPID id, ULONG length, WORD type, VOID *value)
 {
-	int	property_count;
+	int		property_count;
+	PropertyList	*list;
 
 	if (bitmap_data == NULL) {
 		return InvalidParameter;
 	}
 
+	/* keep the decoded metadata ahead of the properties added after it */
+	gdip_bitmapdata_property_ensure_loaded (bitmap_data);
+
 	property_count = bitmap_data->property_count;
+	list = (bitmap_data->property == NULL) ? NULL : PROPERTY_LIST (bitmap_data->property);
 
-	if (bitmap_data->property == NULL) {
-		bitmap_data->property = GdipAlloc(sizeof(PropertyItem));
-	} else {
-		bitmap_data->property = gdip_realloc (bitmap_data->property, sizeof(PropertyItem) * (property_count + 1));
-	}
-	if (bitmap_data->property == NULL) {
-		bitmap_data->property_count = 0;
-		return OutOfMemory;
+	/* codecs add properties one at a time, so grow the array geometrically */
+	if ((list == NULL) || (property_count >= list->capacity)) {
+		int		capacity = ((list == NULL) || (list->capacity < 8)) ? 8 : list->capacity * 2;
+		PropertyItem	*property;
+
+		property = gdip_propertyitems_alloc (bitmap_data->property, capacity);
+		if (property == NULL) {
+			return OutOfMemory;
+		}
+
+		bitmap_data->property = property;
+		list = PROPERTY_LIST (property);
 	}
 
 	if ((value != NULL) && (length > 0)) {
@@ -332,18 +389,21 @@ gdip_bitmapdata_property_add(BitmapData *bitmap_data, PROPID id, ULONG length, W
 	bitmap_data->property[property_count].length = length;
 	bitmap_data->property[property_count].type = type;
 	bitmap_data->property_count++;
+
+	/* like the linear search, the index returns the first item with a given id */
+	if ((list->index != NULL) && !g_hash_table_lookup (list->index, GUINT_TO_POINTER (id))) {
+		g_hash_table_insert (list->index, GUINT_TO_POINTER (id), GINT_TO_POINTER (property_count + 1));
+	}
 	return Ok;
 }
 
 GpStatus
 gdip_bitmapdata_property_remove_id(BitmapData *bitmap_data, PROPID id)
 {
-	int	i;
+	int	index;
 
-	for (i = 0; i < bitmap_data->property_count; i++) {
-		if (bitmap_data->property[i].id == id) {
-			return gdip_bitmapdata_property_remove_index(bitmap_data, i);
-		}
+	if (gdip_bitmapdata_property_find_id (bitmap_data, id, &index) == Ok) {
+		return gdip_bitmapdata_property_remove_index(bitmap_data, index);
 	}
 
 	return GenericError;
@@ -352,31 +412,67 @@ gdip_bitmapdata_property_remove_id(BitmapData *bitmap_data, PROPID id)
 GpStatus
 gdip_bitmapdata_property_remove_index(BitmapData *bitmap_data, int index)
 {
+	PropertyList	*list;
+
+	gdip_bitmapdata_property_ensure_loaded (bitmap_data);
+
 	if (index >= bitmap_data->property_count) {
 		return PropertyNotFound;
 	}
 
+	if (bitmap_data->property[index].value != NULL) {
+		GdipFree(bitmap_data->property[index].value);
+	}
+
 	/* We don't realloc the array, more overhead than savings */
 	if ((index + 1) < bitmap_data->property_count) {
-		if (bitmap_data->property[index].value != NULL) {
-			GdipFree(bitmap_data->property[index].value);
-		}
 		memmove(&bitmap_data->property[index], &bitmap_data->property[index + 1], (bitmap_data->property_count - index - 1) * sizeof(PropertyItem));
 	}
 	bitmap_data->property_count--;
 
+	/* the following items moved, find_id will rebuild the index when needed */
+	list = PROPERTY_LIST (bitmap_data->property);
+	if (list->index != NULL) {
+		g_hash_table_destroy (list->index);
+		list->index = NULL;
+	}
+
 	return Ok;
 }
 
+/* lists shorter than this are searched linearly */
+#define PROPERTY_INDEX_MIN_COUNT	16
+
 GpStatus
 gdip_bitmapdata_property_find_id(BitmapData *bitmap_data, PROPID id, int *index)
 {
-	int	i;
+	PropertyList	*list;
+	int		i;
 
 	if (index == NULL) {
 		return InvalidParameter;
 	}
 
+	gdip_bitmapdata_property_ensure_loaded (bitmap_data);
+
+	list = (bitmap_data->property == NULL) ? NULL : PROPERTY_LIST (bitmap_data->property);
+	if ((list != NULL) && (list->index == NULL) && (bitmap_data->property_count >= PROPERTY_INDEX_MIN_COUNT)) {
+		list->index = g_hash_table_new (g_direct_hash, g_direct_equal);
+		/* walk backwards so that the first of duplicated ids wins */
+		for (i = bitmap_data->property_count - 1; i >= 0; i--) {
+			g_hash_table_insert (list->index, GUINT_TO_POINTER (bitmap_data->property[i].id), GINT_TO_POINTER (i + 1));
+		}
+	}
+
+	if ((list != NULL) && (list->index != NULL)) {
+		i = GPOINTER_TO_INT (g_hash_table_lookup (list->index, GUINT_TO_POINTER (id)));
+		if (i == 0) {
+			return PropertyNotFound;
+		}
+		*index = i - 1;
+		return Ok;
+	}
+
 	for (i = 0; i < bitmap_data->property_count; i++) {
 		if (bitmap_data->property[i].id == id) {
 			*index = i;
@@ -387,6 +483,111 @@ gdip_bitmapdata_property_find_id(BitmapData *bitmap_data, PROPID id, int *index)
 	return PropertyNotFound;
 }
 
+/*
+ * Keeps a copy of a metadata block (e.g. EXIF) whose entries are only turned into PropertyItems, by the
+ * codec supplied load function, the first time the properties of the bitmap are looked at.
+ */
+GpStatus
+gdip_bitmapdata_property_set_raw (BitmapData *bitmap_data, const BYTE *raw, unsigned int length,
+	void (*load) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length))
+{
+	PropertyList	*list;
+	BYTE		*copy;
+
+	if ((bitmap_data == NULL) || (raw == NULL) || (load == NULL)) {
+		return InvalidParameter;
+	}
+
+	gdip_bitmapdata_property_ensure_loaded (bitmap_data);
+
+	copy = GdipAlloc (length);
+	if (copy == NULL) {
+		return OutOfMemory;
+	}
+	memcpy (copy, raw, length);
+
+	if (bitmap_data->property == NULL) {
+		bitmap_data->property = gdip_propertyitems_alloc (NULL, 0);
+		if (bitmap_data->property == NULL) {
+			GdipFree (copy);
+			return OutOfMemory;
+		}
+	}
+
+	list = PROPERTY_LIST (bitmap_data->property);
+	list->raw = copy;
+	list->raw_length = length;
+	list->load_raw = load;
+	return Ok;
+}
+
+void
+gdip_bitmapdata_property_ensure_loaded (BitmapData *bitmap_data)
+{
+	PropertyList	*list;
+	BYTE		*raw;
+	unsigned int	length;
+	void		(*load) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length);
+
+	if (bitmap_data->property == NULL) {
+		return;
+	}
+
+	list = PROPERTY_LIST (bitmap_data->property);
+	raw = list->raw;
+	if (raw == NULL) {
+		return;
+	}
+
+	/* cleared first, the load function adds the properties through gdip_bitmapdata_property_add (which moves the list) */
+	length = list->raw_length;
+	load = list->load_raw;
+	list->raw = NULL;
+	list->raw_length = 0;
+	list->load_raw = NULL;
+
+	load (bitmap_data, raw, length);
+	GdipFree (raw);
+}
+
+/* Counts one more user of the pixels of data, which becomes shared if it wasn't already */
+static BOOL
+gdip_scan0_share (BitmapData *data)
+{
+	if (data->shared == NULL) {
+		data->shared = GdipAlloc (sizeof (SharedScan0));
+		if (data->shared == NULL) {
+			return FALSE;
+		}
+
+		data->shared->count = 1;
+		data->shared->scan0 = data->scan0;
+		data->reserved |= GBD_SHARED_SCAN0;
+	}
+
+	g_atomic_int_inc (&data->shared->count);
+	return TRUE;
+}
+
+/* Drops one user of the shared pixels of data, returns TRUE if it was the last one */
+static BOOL
+gdip_scan0_unshare (BitmapData *data)
+{
+	SharedScan0	*shared = data->shared;
+
+	data->shared = NULL;
+	data->reserved &= ~GBD_SHARED_SCAN0;
+
+	if (!g_atomic_int_dec_and_test (&shared->count)) {
+		return FALSE;
+	}
+
+	GdipFree (shared);
+	return TRUE;
+}
+
+static GpStatus gdip_bitmapdata_dispose (BitmapData *bitmap, int count);
+
 GpStatus
 gdip_bitmapdata_clone(BitmapData *src, BitmapData **dest, int count)
 {
@@ -423,11 +624,26 @@ gdip_bitmapdata_clone(BitmapData *src, BitmapData **dest, int count)
 		result[i].y = src[i].y;
 		result[i].transparent = src[i].transparent;
 
-		if (src[i].scan0 != NULL) {
+		result[i].palette = NULL;
+		result[i].property_count = 0;
+		result[i].property = NULL;
+		result[i].shared = NULL;
+
+		/*
+		 * Pixels we own are shared with the clone and only copied by gdip_bitmap_ensure_writable
+		 * when either bitmap is modified. Pixels provided by the caller, locked or drawn into by a
+		 * Graphics can change behind our back, so they are copied right away.
+		 */
+		if ((src[i].scan0 != NULL) && ((src[i].reserved & (GBD_OWN_SCAN0 | GBD_LOCKED | GBD_DIRECT_WRITE)) == GBD_OWN_SCAN0) &&
+			gdip_scan0_share (&src[i])) {
+			result[i].scan0 = src[i].shared->scan0;
+			result[i].shared = src[i].shared;
+			result[i].reserved |= GBD_SHARED_SCAN0;
+		} else if (src[i].scan0 != NULL) {
 			result[i].scan0 = GdipAlloc(src[i].stride * src[i].height);
 			if (result[i].scan0 == NULL) {
-				GdipFree(result);
-				return OutOfMemory;
+				status = OutOfMemory;
+				goto fail;
 			}
 			memcpy(result[i].scan0, src[i].scan0, src[i].stride * src[i].height);
 		} else {
@@ -436,27 +652,85 @@ gdip_bitmapdata_clone(BitmapData *src, BitmapData **dest, int count)
 
 		result[i].palette = gdip_palette_clone (src[i].palette);
 
-		result[i].property_count = src[i].property_count;
 		status = gdip_propertyitems_clone(src[i].property, &result[i].property, src[i].property_count);
 		if (status != Ok) {
-			int j;
+			result[i].property = NULL;
+			goto fail;
+		}
+		result[i].property_count = src[i].property_count;
 
-			for (j = 0; j < i; j++) {
-				if (result[j].scan0 != NULL) {
-					GdipFree(result[j].scan0);
-				}
-				if (result[j].property != NULL) {
-					gdip_propertyitems_dispose(result[j].property, result[j].property_count);
-				}
-			}
+		/* metadata that wasn't looked at yet stays undecoded in the clone */
+		if ((src[i].property != NULL) && (PROPERTY_LIST (src[i].property)->raw != NULL)) {
+			PropertyList *list = PROPERTY_LIST (src[i].property);
 
-			GdipFree(result);
-			return status;
+			status = gdip_bitmapdata_property_set_raw (&result[i], list->raw, list->raw_length, list->load_raw);
+			if (status != Ok)
+				goto fail;
 		}
 	}
 
 	*dest = result;
 	return Ok;
+
+fail:
+	/* the failing entry is cleaned up along with the previous ones */
+	gdip_bitmapdata_dispose (result, i + 1);
+	return status;
+}
+
+/* Frees the pixels we own, or drops our reference if they are still shared with a clone */
+void
+gdip_bitmapdata_release_scan0 (BitmapData *data)
+{
+	if ((data->scan0 == NULL) || ((data->reserved & GBD_OWN_SCAN0) == 0)) {
+		return;
+	}
+
+	if (((data->reserved & GBD_SHARED_SCAN0) != 0) && !gdip_scan0_unshare (data)) {
+		data->scan0 = NULL;
+		return;
+	}
+
+	GdipFree (data->scan0);
+	data->scan0 = NULL;
+}
+
+/* Gives the active bitmap its own copy of the pixels before they get modified */
+GpStatus
+gdip_bitmap_ensure_writable (GpBitmap *bitmap)
+{
+	BitmapData	*data = bitmap->active_bitmap;
+	BYTE		*scan0;
+
+	if ((data == NULL) || ((data->reserved & GBD_SHARED_SCAN0) == 0)) {
+		return Ok;
+	}
+
+	/* All the clones are gone, the pixels are ours again */
+	if (g_atomic_int_get (&data->shared->count) == 1) {
+		GdipFree (data->shared);
+		data->shared = NULL;
+		data->reserved &= ~GBD_SHARED_SCAN0;
+		return Ok;
+	}
+
+	scan0 = GdipAlloc (data->stride * data->height);
+	if (scan0 == NULL) {
+		return OutOfMemory;
+	}
+	memcpy (scan0, data->scan0, data->stride * data->height);
+
+	gdip_bitmapdata_release_scan0 (data);
+	data->scan0 = scan0;
+	data->reserved |= GBD_OWN_SCAN0;
+
+	/* The cached surface still points to the shared pixels */
+	if (bitmap->surface != NULL) {
+		cairo_surface_destroy (bitmap->surface);
+		bitmap->surface = NULL;
+	}
+
+	return Ok;
 }
 
 static GpStatus
@@ -469,9 +743,7 @@ gdip_bitmapdata_dispose(BitmapData *bitmap, int count)
 	}
 
 	for (index = 0; index < count; index++) {
-		if ((bitmap[index].scan0 != NULL) && ((bitmap[index].reserved & GBD_OWN_SCAN0) != 0)) {
-			GdipFree(bitmap[index].scan0);
-		}
+		gdip_bitmapdata_release_scan0 (&bitmap[index]);
 
 		if (bitmap[index].palette != NULL) {
 			GdipFree(bitmap[index].palette);
@@ -614,12 +886,174 @@ gdip_bitmap_setactive(GpBitmap *bitmap, const GUID *dimension, int index)
 		}
 	}
 
+	if ((bitmap->encoded_frames != NULL) && (memcmp (&bitmap->encoded_frames->frame.frame_dimension, dimension, sizeof (GUID)) == 0)) {
+		EncodedFrames	*encoded = bitmap->encoded_frames;
+		GpStatus	status;
+
+		if (encoded->frame.count <= index) {
+			return Win32Error;
+		}
+
+		/* the encoded image is kept if it can't be decoded, so a later selection fails the same way */
+		if (encoded->raw[index] != NULL) {
+			status = encoded->load (&encoded->frame.bitmap[index], encoded->raw[index], encoded->raw_length[index]);
+			if (status != Ok) {
+				return status;
+			}
+			GdipFree (encoded->raw[index]);
+			encoded->raw[index] = NULL;
+			encoded->raw_length[index] = 0;
+		}
+
+		bitmap->active_frame = -1;
+		bitmap->active_bitmap_no = index;
+		bitmap->active_bitmap = &encoded->frame.bitmap[index];
+		return Ok;
+	}
+
 	bitmap->active_frame = 0;
 	bitmap->active_bitmap_no = 0;
 	bitmap->active_bitmap = NULL;
 	return InvalidParameter;
 }
 
+/*
+ * Keeps a copy of an image (e.g. one of the sizes of an icon) that is only decoded into scan0, by the codec
+ * supplied load function, when it's selected. Until then only the size set on the returned BitmapData is known.
+ * All the encoded images of a bitmap share the same dimension.
+ */
+BitmapData *
+gdip_bitmap_add_encoded_frame (GpBitmap *bitmap, const GUID *dimension, const BYTE *raw, unsigned int length,
+	GpStatus (*load) (BitmapData *bitmap_data, const BYTE *raw, unsigned int length))
+{
+	EncodedFrames	*encoded;
+	BYTE		*copy;
+	BYTE		**raws;
+	unsigned int	*lengths;
+	int		count;
+
+	if ((bitmap == NULL) || (dimension == NULL) || (raw == NULL) || (load == NULL)) {
+		return NULL;
+	}
+
+	if (bitmap->encoded_frames == NULL) {
+		bitmap->encoded_frames = GdipAlloc (sizeof (EncodedFrames));
+		if (bitmap->encoded_frames == NULL) {
+			return NULL;
+		}
+		memset (bitmap->encoded_frames, 0, sizeof (EncodedFrames));
+		bitmap->encoded_frames->frame.frame_dimension = *dimension;
+		bitmap->encoded_frames->load = load;
+	}
+
+	encoded = bitmap->encoded_frames;
+	count = encoded->frame.count;
+
+	raws = gdip_realloc (encoded->raw, sizeof (BYTE *) * (count + 1));
+	if (raws == NULL) {
+		return NULL;
+	}
+	encoded->raw = raws;
+
+	lengths = gdip_realloc (encoded->raw_length, sizeof (unsigned int) * (count + 1));
+	if (lengths == NULL) {
+		return NULL;
+	}
+	encoded->raw_length = lengths;
+
+	copy = GdipAlloc (length);
+	if (copy == NULL) {
+		return NULL;
+	}
+	memcpy (copy, raw, length);
+
+	if (gdip_frame_add_bitmapdata (&encoded->frame) == NULL) {
+		GdipFree (copy);
+		return NULL;
+	}
+
+	encoded->raw[count] = copy;
+	encoded->raw_length[count] = length;
+	return &encoded->frame.bitmap[count];
+}
+
+static void
+gdip_encoded_frames_dispose (EncodedFrames *encoded)
+{
+	int	i;
+
+	if (encoded == NULL) {
+		return;
+	}
+
+	gdip_bitmapdata_dispose (encoded->frame.bitmap, encoded->frame.count);
+	if (encoded->raw != NULL) {
+		for (i = 0; i < encoded->frame.count; i++) {
+			if (encoded->raw[i] != NULL) {
+				GdipFree (encoded->raw[i]);
+			}
+		}
+		GdipFree (encoded->raw);
+	}
+	if (encoded->raw_length != NULL) {
+		GdipFree (encoded->raw_length);
+	}
+	GdipFree (encoded);
+}
+
+/* images that weren't selected yet stay encoded in the clone */
+static GpStatus
+gdip_encoded_frames_clone (EncodedFrames *src, EncodedFrames **dest)
+{
+	EncodedFrames	*result;
+	GpStatus	status;
+	int		count = src->frame.count;
+	int		i;
+
+	result = GdipAlloc (sizeof (EncodedFrames));
+	if (result == NULL) {
+		return OutOfMemory;
+	}
+	memset (result, 0, sizeof (EncodedFrames));
+	result->frame.frame_dimension = src->frame.frame_dimension;
+	result->load = src->load;
+
+	result->raw = GdipAlloc (sizeof (BYTE *) * count);
+	result->raw_length = GdipAlloc (sizeof (unsigned int) * count);
+	if ((result->raw == NULL) || (result->raw_length == NULL)) {
+		status = OutOfMemory;
+		goto fail;
+	}
+	memset (result->raw, 0, sizeof (BYTE *) * count);
+
+	status = gdip_bitmapdata_clone (src->frame.bitmap, &result->frame.bitmap, count);
+	if (status != Ok) {
+		goto fail;
+	}
+	result->frame.count = count;
+
+	for (i = 0; i < count; i++) {
+		result->raw_length[i] = src->raw_length[i];
+		if (src->raw[i] == NULL) {
+			continue;
+		}
+
+		result->raw[i] = GdipAlloc (src->raw_length[i]);
+		if (result->raw[i] == NULL) {
+			status = OutOfMemory;
+			goto fail;
+		}
+		memcpy (result->raw[i], src->raw[i], src->raw_length[i]);
+	}
+
+	*dest = result;
+	return Ok;
+
+fail:
+	gdip_encoded_frames_dispose (result);
+	return status;
+}
+
 GpStatus
 gdip_bitmap_clone (GpBitmap *bitmap, GpBitmap **clonedbitmap)
 {
@@ -639,6 +1073,7 @@ gdip_bitmap_clone (GpBitmap *bitmap, GpBitmap **clonedbitmap)
 	result->active_frame = bitmap->active_frame;
 	result->active_bitmap_no = bitmap->active_bitmap_no;
 	result->active_bitmap = NULL;
+	result->encoded_frames = NULL;
 	result->cairo_format = bitmap->cairo_format;
 	result->surface = NULL;
 
@@ -659,9 +1094,18 @@ gdip_bitmap_clone (GpBitmap *bitmap, GpBitmap **clonedbitmap)
 			if (status != Ok)
 				goto fail;
 		}
-		result->active_bitmap = &result->frames[result->active_frame].bitmap[result->active_bitmap_no];
+		if (result->active_frame >= 0)
+			result->active_bitmap = &result->frames[result->active_frame].bitmap[result->active_bitmap_no];
 	} else {
-		bitmap->frames = NULL;
+		result->frames = NULL;
+	}
+
+	if (bitmap->encoded_frames != NULL) {
+		status = gdip_encoded_frames_clone (bitmap->encoded_frames, &result->encoded_frames);
+		if (status != Ok)
+			goto fail;
+		if (result->active_frame < 0)
+			result->active_bitmap = &result->encoded_frames->frame.bitmap[result->active_bitmap_no];
 	}
 
 	*clonedbitmap = result;
@@ -727,6 +1171,8 @@ gdip_bitmap_dispose (GpBitmap *bitmap)
 		GdipFree (bitmap->frames);
 	}
 
+	gdip_encoded_frames_dispose (bitmap->encoded_frames);
+
 	if (bitmap->surface)
 		cairo_surface_destroy (bitmap->surface);
 
@@ -1936,7 +2382,10 @@ GdipBitmapUnlockBits (GpBitmap *bitmap, BitmapData *locked_data)
 		Rect srcRect = { 0, 0, locked_data->width, locked_data->height };
 		Rect destRect = { locked_data->x, locked_data->y, locked_data->width, locked_data->height };
 
-		status = gdip_bitmap_change_rect_pixel_format (locked_data, &srcRect, root_data, &destRect);
+		/* Done here rather than in LockBits since the bitmap can be cloned while it's locked */
+		status = gdip_bitmap_ensure_writable (bitmap);
+		if (status == Ok)
+			status = gdip_bitmap_change_rect_pixel_format (locked_data, &srcRect, root_data, &destRect);
 	} else {
 		status = Ok;
 	}
@@ -1977,6 +2426,9 @@ GdipBitmapSetPixel (GpBitmap *bitmap, INT x, INT y, ARGB color)
 	if (gdip_is_an_indexed_pixelformat (data->pixel_format))
 		return InvalidParameter;
 
+	if (gdip_bitmap_ensure_writable (bitmap) != Ok)
+		return OutOfMemory;
+
 	v = (BYTE*)(data->scan0) + y * data->stride;
 	switch (data->pixel_format) {
 	case PixelFormat24bppRGB:
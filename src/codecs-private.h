@@ -49,12 +49,15 @@ typedef struct {
 	int pos;
 } MemorySource;
 
+int gdip_memory_source_read (MemorySource *ms, BYTE *buffer, int size) GDIP_INTERNAL;
+
 
 static const CLSID gdip_image_frameDimension_page_guid = {0x7462dc86U, 0x6180U, 0x4c7eU, {0x8e, 0x3f, 0xee, 0x73, 0x33, 0xa7, 0xa4, 0x83}};
 static const CLSID gdip_image_frameDimension_time_guid = {0x6aedbd6dU, 0x3fb5U, 0x418aU, {0x83, 0xa6, 0x7f, 0x45, 0x22, 0x9d, 0xc8, 0x72}};
 static const CLSID gdip_image_frameDimension_resolution_guid = {0x84236f7bU, 0x3bd3U, 0x428fU, {0x8d, 0xab, 0x4e, 0xa1, 0x43, 0x9c, 0xa3, 0x15}};
 
 const EncoderParameter *gdip_find_encoder_parameter (GDIPCONST EncoderParameters *eps, const GUID *guid) GDIP_INTERNAL;
+BOOL gdip_get_encoder_parameter_long (GDIPCONST EncoderParameters *eps, const GUID *guid, LONG *value) GDIP_INTERNAL;
 
 GpStatus initCodecList (void) GDIP_INTERNAL;
 void releaseCodecList (void) GDIP_INTERNAL;
@@ -68,5 +71,14 @@ extern GUID GdipEncoderTransformation;
 extern GUID GdipEncoderQuality;
 extern GUID GdipEncoderLuminanceTable;
 extern GUID GdipEncoderChrominanceTable;
+extern GUID GdipEncoderScanMethod;
+extern GUID GdipEncoderRenderMethod;
+extern GUID GdipEncoderChromaSubsampling;
+extern GUID GdipEncoderOptimizeCoding;
+extern GUID GdipEncoderDctMethod;
+extern GUID GdipEncoderCompressionLevel;
+extern GUID GdipEncoderCompressionStrategy;
+extern GUID GdipEncoderPngFilters;
+extern GUID GdipEncoderPngThreads;
 
 #endif
@@ -0,0 +1,688 @@
+/*
+ * codecs.c
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Codec registry
+ *
+ *	Each codec registers an ImageCodec entry (see image-private.h) describing how to load and save
+ *	its format. The decoder signatures are kept in a table indexed by the first byte of the data,
+ *	so sniffing a header only compares the few signatures that can possibly match it. Inside each
+ *	slot the signatures are reordered by the number of times they matched, so the formats an
+ *	application really uses are tried first.
+ *
+ *	The order in which the codecs are registered is the order reported by GdipGetImageDecoders and
+ *	GdipGetImageEncoders.
+ */
+
+#include "gdiplus-private.h"
+#include "image-private.h"
+#include "dstream.h"
+
+#include "bmpcodec.h"
+#include "pngcodec.h"
+#include "jpegcodec.h"
+#include "gifcodec.h"
+#include "tiffcodec.h"
+#include "icocodec.h"
+#include "emfcodec.h"
+#include "wmfcodec.h"
+#include "rawcodec.h"
+
+#define MAX_CODECS_SUPPORTED		16
+#define MAX_SIGNATURES_SUPPORTED	32
+#define MAX_SIGNATURES_PER_BYTE		8
+
+typedef struct {
+	const ImageCodec	*codec;
+	const BYTE		*pattern;
+	const BYTE		*mask;
+	int			size;
+	ImageFormat		public_format;
+	/* fallback signatures are only tried once no codec signature matched */
+	BOOL			fallback;
+} CodecSignature;
+
+typedef struct {
+	int		count;
+	CodecSignature	*signatures[MAX_SIGNATURES_PER_BYTE];
+} SignatureSlot;
+
+static ImageCodecInfo g_decoder_list[MAX_CODECS_SUPPORTED];
+static int g_decoders = 0;
+static ImageCodecInfo g_encoder_list[MAX_CODECS_SUPPORTED];
+static const ImageCodec *g_encoder_codecs[MAX_CODECS_SUPPORTED];
+static int g_encoders = 0;
+
+static CodecSignature g_signatures[MAX_SIGNATURES_SUPPORTED];
+static int g_signature_count = 0;
+/* only written while the codecs are registered, so sniffing needs no lock */
+static SignatureSlot g_sniff_table[256];
+
+/*
+ * Built-in codecs
+ */
+
+/* the delegates read the data from memory when it was already loaded, see gdip_load_image_from_memory */
+static dstream_t *
+delegates_input_new (const ImageDelegates *delegates)
+{
+	if (delegates->memory)
+		return dstream_memory_new (delegates->memory);
+
+	return dstream_input_new (delegates->getBytes, delegates->seek);
+}
+
+static GpStatus
+bmp_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_bmp_image_from_file (fp, image);
+}
+
+static GpStatus
+bmp_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	GpStatus status;
+	dstream_t *loader = delegates_input_new (delegates);
+
+	status = gdip_load_bmp_image_from_stream_delegate (loader, image);
+	dstream_free (loader);
+	return status;
+}
+
+static GpStatus
+bmp_save_to_file (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	GpStatus status;
+	FILE *fp;
+
+	if ((fp = fopen (file_name, "wb")) == NULL)
+		return GenericError;
+
+	status = gdip_save_bmp_image_to_file (fp, image);
+	fclose (fp);
+	return status;
+}
+
+static GpStatus
+bmp_save_to_delegates (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	return gdip_save_bmp_image_to_stream_delegate (delegates->putBytes, image);
+}
+
+static GpStatus
+jpeg_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_jpeg_image_from_file (fp, file_name, image);
+}
+
+static GpStatus
+jpeg_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	GpStatus status;
+	dstream_t *loader = delegates_input_new (delegates);
+
+	status = gdip_load_jpeg_image_from_stream_delegate (loader, image);
+	dstream_free (loader);
+	return status;
+}
+
+static GpStatus
+jpeg_save_to_file (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	GpStatus status;
+	FILE *fp;
+
+	if ((fp = fopen (file_name, "wb")) == NULL)
+		return GenericError;
+
+	status = gdip_save_jpeg_image_to_file (fp, image, params);
+	fclose (fp);
+	return status;
+}
+
+static GpStatus
+jpeg_save_to_delegates (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	return gdip_save_jpeg_image_to_stream_delegate (delegates->putBytes, image, params);
+}
+
+static GpStatus
+gif_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_gif_image_from_file (fp, image);
+}
+
+static GpStatus
+gif_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	if (delegates->memory)
+		return gdip_load_gif_image_from_memory (delegates->memory, image);
+
+	return gdip_load_gif_image_from_stream_delegate (delegates->getBytes, delegates->seek, image);
+}
+
+static GpStatus
+gif_save_to_file (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	/* gif library has to open the file itself */
+	return gdip_save_gif_image_to_file ((BYTE *) file_name, image);
+}
+
+static GpStatus
+gif_save_to_delegates (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	return gdip_save_gif_image_to_stream_delegate (delegates->putBytes, image, params);
+}
+
+static GpStatus
+emf_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_emf_image_from_file (fp, image);
+}
+
+static GpStatus
+emf_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	GpStatus status;
+	dstream_t *loader = delegates_input_new (delegates);
+
+	status = gdip_load_emf_image_from_stream_delegate (loader, image);
+	dstream_free (loader);
+	return status;
+}
+
+static GpStatus
+wmf_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_wmf_image_from_file (fp, image);
+}
+
+static GpStatus
+wmf_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	GpStatus status;
+	dstream_t *loader = delegates_input_new (delegates);
+
+	status = gdip_load_wmf_image_from_stream_delegate (loader, image);
+	dstream_free (loader);
+	return status;
+}
+
+static GpStatus
+tiff_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_tiff_image_from_file (fp, image);
+}
+
+static GpStatus
+tiff_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	if (delegates->memory)
+		return gdip_load_tiff_image_from_memory (delegates->memory, image);
+
+	return gdip_load_tiff_image_from_stream_delegate (delegates->getBytes, delegates->putBytes,
+		delegates->seek, delegates->close, delegates->size, image);
+}
+
+static GpStatus
+tiff_save_to_file (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	/* tif library has to open the file itself or seeking will fail when saving multi-page images */
+	return gdip_save_tiff_image_to_file ((BYTE *) file_name, image, params);
+}
+
+static GpStatus
+tiff_save_to_delegates (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	return gdip_save_tiff_image_to_stream_delegate (delegates->getBytes, delegates->putBytes,
+		delegates->seek, delegates->close, delegates->size, image, params);
+}
+
+static GpStatus
+png_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_png_image_from_file (fp, image);
+}
+
+static GpStatus
+png_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	if (delegates->memory)
+		return gdip_load_png_image_from_memory (delegates->memory->ptr, delegates->memory->size, image);
+
+	return gdip_load_png_image_from_stream_delegate (delegates->getBytes, delegates->seek, image);
+}
+
+static GpStatus
+png_save_to_file (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	GpStatus status;
+	FILE *fp;
+
+	if ((fp = fopen (file_name, "wb")) == NULL)
+		return GenericError;
+
+	status = gdip_save_png_image_to_file (fp, image, params);
+	fclose (fp);
+	return status;
+}
+
+static GpStatus
+png_save_to_delegates (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	return gdip_save_png_image_to_stream_delegate (delegates->putBytes, image, params);
+}
+
+static GpStatus
+ico_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_ico_image_from_file (fp, image);
+}
+
+static GpStatus
+ico_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	GpStatus status;
+	dstream_t *loader = delegates_input_new (delegates);
+
+	status = gdip_load_ico_image_from_stream_delegate (loader, image);
+	dstream_free (loader);
+	return status;
+}
+
+static const ImageCodec bmp_image_codec = {
+	BMP, gdip_getcodecinfo_bmp,
+	bmp_load_from_file, bmp_load_from_delegates,
+	bmp_save_to_file, bmp_save_to_delegates,
+	NULL, 0
+};
+
+static const ImageCodec jpeg_image_codec = {
+	JPEG, gdip_getcodecinfo_jpeg,
+	jpeg_load_from_file, jpeg_load_from_delegates,
+	jpeg_save_to_file, jpeg_save_to_delegates,
+	gdip_fill_encoder_parameter_list_jpeg, sizeof (JpegEncoderParameters)
+};
+
+static const ImageCodec gif_image_codec = {
+	GIF, gdip_getcodecinfo_gif,
+	gif_load_from_file, gif_load_from_delegates,
+	gif_save_to_file, gif_save_to_delegates,
+	gdip_fill_encoder_parameter_list_gif, sizeof (GifEncoderParameters)
+};
+
+static const ImageCodec emf_image_codec = {
+	EMF, gdip_getcodecinfo_emf,
+	emf_load_from_file, emf_load_from_delegates,
+	NULL, NULL,
+	NULL, 0
+};
+
+static const ImageCodec wmf_image_codec = {
+	WMF, gdip_getcodecinfo_wmf,
+	wmf_load_from_file, wmf_load_from_delegates,
+	NULL, NULL,
+	NULL, 0
+};
+
+static const ImageCodec tiff_image_codec = {
+	TIF, gdip_getcodecinfo_tiff,
+	tiff_load_from_file, tiff_load_from_delegates,
+	tiff_save_to_file, tiff_save_to_delegates,
+	gdip_fill_encoder_parameter_list_tiff, sizeof (TiffEncoderParameters)
+};
+
+static const ImageCodec png_image_codec = {
+	PNG, gdip_getcodecinfo_png,
+	png_load_from_file, png_load_from_delegates,
+	png_save_to_file, png_save_to_delegates,
+	gdip_fill_encoder_parameter_list_png, sizeof (PngEncoderParameters)
+};
+
+static GpStatus
+raw_load_from_file (FILE *fp, const char *file_name, GpImage **image)
+{
+	return gdip_load_raw_image_from_file (fp, image);
+}
+
+static GpStatus
+raw_load_from_delegates (const ImageDelegates *delegates, GpImage **image)
+{
+	GpStatus status;
+	dstream_t *loader = delegates_input_new (delegates);
+
+	status = gdip_load_raw_image_from_stream_delegate (loader, image);
+	dstream_free (loader);
+	return status;
+}
+
+static GpStatus
+raw_save_to_file (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	GpStatus status;
+	FILE *fp;
+
+	if ((fp = fopen (file_name, "wb")) == NULL)
+		return GenericError;
+
+	status = gdip_save_raw_image_to_file (fp, image);
+	if (fclose (fp) != 0 && status == Ok)
+		status = GenericError;
+	return status;
+}
+
+static GpStatus
+raw_save_to_delegates (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params)
+{
+	return gdip_save_raw_image_to_stream_delegate (delegates->putBytes, image);
+}
+
+static const ImageCodec ico_image_codec = {
+	ICON, gdip_getcodecinfo_ico,
+	ico_load_from_file, ico_load_from_delegates,
+	NULL, NULL,
+	NULL, 0
+};
+
+static const ImageCodec raw_image_codec = {
+	RAW, gdip_getcodecinfo_raw,
+	raw_load_from_file, raw_load_from_delegates,
+	raw_save_to_file, raw_save_to_delegates,
+	NULL, 0
+};
+
+/* registration order, this is the order GDI+ reports its codecs (libgdiplus-only codecs come last) */
+static const ImageCodec *builtin_codecs[] = {
+	&bmp_image_codec,
+	&jpeg_image_codec,
+	&gif_image_codec,
+	&emf_image_codec,
+	&wmf_image_codec,
+	&tiff_image_codec,
+	&png_image_codec,
+	&ico_image_codec,
+	&raw_image_codec
+};
+
+/* hack #1 - nonplaceable WMF metafiles are supported by no signature match them in the codecs */
+static const BYTE nonplaceable_wmf_sig_pattern[] = { 0x01, 0x00, 0x09, 0x00, 0x00, 0x03 };
+static const BYTE nonplaceable_wmf_sig_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+/* hack #2 - cursors share the icon format, only the resource type differs, and are reported as icons */
+static const BYTE cur_sig_pattern[] = { 0x00, 0x00, 0x02, 0x00 };
+static const BYTE cur_sig_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF };
+
+/*
+ * Registry
+ */
+
+static GpStatus
+add_signature (const ImageCodec *codec, const BYTE *pattern, const BYTE *mask, int size, ImageFormat public_format,
+	BOOL fallback)
+{
+	CodecSignature *signature;
+	int b, i;
+
+	/* we never read more than MAX_CODEC_SIG_LENGTH bytes to detect the format */
+	if (!pattern || !mask || (size < 1) || (size > MAX_CODEC_SIG_LENGTH))
+		return InvalidParameter;
+
+	if (g_signature_count == MAX_SIGNATURES_SUPPORTED)
+		return OutOfMemory;
+
+	for (b = 0; b < 256; b++) {
+		if (((b & mask[0]) == pattern[0]) && (g_sniff_table[b].count == MAX_SIGNATURES_PER_BYTE))
+			return OutOfMemory;
+	}
+
+	signature = &g_signatures[g_signature_count++];
+	signature->codec = codec;
+	signature->pattern = pattern;
+	signature->mask = mask;
+	signature->size = size;
+	signature->public_format = public_format;
+	signature->fallback = fallback;
+
+	/* a signature that doesn't fix its first byte is added to every slot it can match */
+	for (b = 0; b < 256; b++) {
+		SignatureSlot *slot = &g_sniff_table[b];
+
+		if ((b & mask[0]) != pattern[0])
+			continue;
+
+		/* codec signatures are always tried before the fallback ones */
+		i = slot->count;
+		if (!fallback) {
+			while ((i > 0) && slot->signatures[i - 1]->fallback) {
+				slot->signatures[i] = slot->signatures[i - 1];
+				i--;
+			}
+		}
+		slot->signatures[i] = signature;
+		slot->count++;
+	}
+
+	return Ok;
+}
+
+GpStatus
+gdip_register_codec (const ImageCodec *codec)
+{
+	ImageCodecInfo *info;
+	GpStatus status;
+	int sig;
+
+	if (!codec || !codec->get_codec_info)
+		return InvalidParameter;
+
+	/* the codec info is NULL when libgdiplus was built without the codec's library */
+	info = codec->get_codec_info ();
+	if (!info)
+		return Ok;
+
+	if ((g_decoders == MAX_CODECS_SUPPORTED) || (g_encoders == MAX_CODECS_SUPPORTED))
+		return OutOfMemory;
+
+	if (codec->load_from_file) {
+		for (sig = 0; sig < info->SigCount; sig++) {
+			status = add_signature (codec, info->SigPattern + sig * info->SigSize, info->SigMask + sig * info->SigSize,
+				info->SigSize, codec->format, FALSE);
+			if (status != Ok)
+				return status;
+		}
+
+		memcpy (&g_decoder_list[g_decoders], info, sizeof (ImageCodecInfo));
+		g_decoders++;
+	}
+
+	if (codec->save_to_file) {
+		memcpy (&g_encoder_list[g_encoders], info, sizeof (ImageCodecInfo));
+		g_encoder_codecs[g_encoders] = codec;
+		g_encoders++;
+	}
+
+	return Ok;
+}
+
+/* extra signatures for a registered decoder, only tried when no codec signature matched the data */
+GpStatus
+gdip_register_codec_signature (const ImageCodec *codec, const BYTE *pattern, const BYTE *mask, int size,
+	ImageFormat public_format)
+{
+	if (!codec || !codec->load_from_file)
+		return InvalidParameter;
+
+	return add_signature (codec, pattern, mask, size, public_format, TRUE);
+}
+
+/* reads up to size bytes, or skips them if buffer is NULL, returns the number of bytes read */
+int
+gdip_memory_source_read (MemorySource *ms, BYTE *buffer, int size)
+{
+	int left = ms->size - ms->pos;
+
+	if (size > left)
+		size = left;
+	if (size <= 0)
+		return 0;
+
+	if (buffer != NULL)
+		memcpy (buffer, ms->ptr + ms->pos, size);
+	ms->pos += size;
+	return size;
+}
+
+static BOOL
+signature_match (const CodecSignature *signature, const BYTE *data, size_t size)
+{
+	int p;
+
+	if (size < signature->size)
+		return FALSE;
+
+	/* the first byte was matched by the sniff table */
+	for (p = 1; p < signature->size; p++) {
+		if ((data [p] & signature->mask [p]) != signature->pattern [p])
+			return FALSE;
+	}
+	return TRUE;
+}
+
+const ImageCodec *
+gdip_codec_from_signature (const BYTE *data, size_t size, ImageFormat *public_format)
+{
+	SignatureSlot *slot;
+	int i;
+
+	if (!data || (size == 0))
+		return NULL;
+
+	/* a slot keeps at most MAX_SIGNATURES_PER_BYTE signatures, codec ones first */
+	slot = &g_sniff_table[data[0]];
+	for (i = 0; i < slot->count; i++) {
+		CodecSignature *signature = slot->signatures[i];
+
+		if (signature_match (signature, data, size)) {
+			*public_format = signature->public_format;
+			return signature->codec;
+		}
+	}
+
+	return NULL;
+}
+
+const ImageCodec *
+gdip_codec_from_encoder_clsid (GDIPCONST CLSID *encoderCLSID)
+{
+	int i;
+
+	for (i = 0; i < g_encoders; i++) {
+		if (memcmp (&g_encoder_list[i].Clsid, encoderCLSID, sizeof (CLSID)) == 0)
+			return g_encoder_codecs[i];
+	}
+	return NULL;
+}
+
+GpStatus
+initCodecList (void)
+{
+	GpStatus status;
+	int i;
+
+	for (i = 0; i < sizeof (builtin_codecs) / sizeof (builtin_codecs[0]); i++) {
+		status = gdip_register_codec (builtin_codecs[i]);
+		if (status != Ok) {
+			releaseCodecList ();
+			return status;
+		}
+	}
+
+	/* GDI+ still detects some files even if they don't match the codec signatures */
+	/* [mis-]handle non-placeable metafiles are WMF but reported as EMF (see #81178 for a test case) */
+	if (gdip_getcodecinfo_wmf ()) {
+		status = gdip_register_codec_signature (&wmf_image_codec, nonplaceable_wmf_sig_pattern, nonplaceable_wmf_sig_mask,
+			sizeof (nonplaceable_wmf_sig_pattern), EMF);
+		if (status != Ok) {
+			releaseCodecList ();
+			return status;
+		}
+	}
+
+	status = gdip_register_codec_signature (&ico_image_codec, cur_sig_pattern, cur_sig_mask, sizeof (cur_sig_pattern), ICON);
+	if (status != Ok) {
+		releaseCodecList ();
+		return status;
+	}
+
+	return Ok;
+}
+
+void
+releaseCodecList (void)
+{
+	memset (g_decoder_list, 0, sizeof (g_decoder_list));
+	g_decoders = 0;
+	memset (g_encoder_list, 0, sizeof (g_encoder_list));
+	memset (g_encoder_codecs, 0, sizeof (g_encoder_codecs));
+	g_encoders = 0;
+
+	memset (g_signatures, 0, sizeof (g_signatures));
+	g_signature_count = 0;
+	memset (g_sniff_table, 0, sizeof (g_sniff_table));
+}
+
+GpStatus WINGDIPAPI
+GdipGetImageDecodersSize (UINT *numDecoders, UINT *size)
+{
+	if (!numDecoders || !size)
+		return InvalidParameter;
+
+	*numDecoders = g_decoders;
+	*size = sizeof (ImageCodecInfo) * g_decoders;
+	return Ok;
+}
+
+GpStatus WINGDIPAPI
+GdipGetImageDecoders (UINT numDecoders, UINT size, ImageCodecInfo *decoders)
+{
+	if (!decoders || (numDecoders != g_decoders) || (size != sizeof (ImageCodecInfo) * g_decoders))
+		return GenericError;
+
+	memcpy (decoders, g_decoder_list, size);
+	return Ok;
+}
+
+GpStatus WINGDIPAPI
+GdipGetImageEncodersSize (UINT *numEncoders, UINT *size)
+{
+	if (!numEncoders || !size)
+		return InvalidParameter;
+
+	*numEncoders = g_encoders;
+	*size = sizeof (ImageCodecInfo) * g_encoders;
+	return Ok;
+}
+
+GpStatus WINGDIPAPI
+GdipGetImageEncoders (UINT numEncoders, UINT size, ImageCodecInfo *encoders)
+{
+	if (!encoders || (numEncoders != g_encoders) || (size != sizeof (ImageCodecInfo) * g_encoders))
+		return GenericError;
+
+	memcpy (encoders, g_encoder_list, size);
+	return Ok;
+}
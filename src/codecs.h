@@ -64,6 +64,76 @@ typedef struct {
 	const BYTE* SigMask;
 } ImageCodecInfo;
 
+/*
+ * libgdiplus-specific codecs. They are reported after the GDI+ codecs by GdipGetImageDecoders
+ * and GdipGetImageEncoders.
+ *
+ * RAW	Clsid {D528DAE9-5F17-4B1E-AF8C-59986ABCE94D}, FormatID {FFF1322B-9C89-4CE1-86CF-799C5F82F0BB}
+ *	Uncompressed dump of the active frame (pixel format, stride, resolution, palette, properties
+ *	and scanlines), saved and loaded without any pixel conversion. It is meant for temporary files
+ *	read back by libgdiplus on a machine with the same byte order, not for interchange.
+ */
+
+/*
+ * libgdiplus-specific encoder parameters. They are accepted by the encoders but are not
+ * reported by GdipGetEncoderParameterList, which keeps the advertised lists identical to GDI+.
+ *
+ * JPEG
+ *	{9890C06D-0D9E-4EA3-BA0C-EE457E45C7F9}	Chroma subsampling, Long, one of JpegChromaSubsampling
+ *	{48B857B1-D6DC-4CD7-9F82-52798F6C1A9B}	Optimized Huffman tables, Long, 0 or 1
+ *	{FF09D8F9-1A2C-449F-8B77-2C44D4E8C1F8}	DCT method, Long, one of JpegDctMethod
+ *	EncoderRenderMethod			EncoderValueRenderProgressive / EncoderValueRenderNonProgressive
+ *
+ * PNG
+ *	{8F4FF533-F92F-41BD-B40C-E029017117D0}	zlib compression level, Long, PngCompressionLevelDefault or 0 to 9
+ *	{0A973E15-10DF-4D31-A692-E2363BB8668C}	zlib strategy, Long, one of PngCompressionStrategy
+ *	{0FC82FFA-7FB0-49F1-8F10-476D4C3B62CE}	Row filters, Long, a combination of PngFilter (default PngFilterNone)
+ *	{DB0B2E30-528D-461E-9F0B-6FBDAB106BA9}	Deflate threads, Long, PngThreadsAuto or a thread count (default 1).
+ *						Only used for large images, and only when built with zlib.
+ *
+ *	PngFilterNone with PngCompressionLevelFast is the quickest mode and is meant for temporary files.
+ */
+typedef enum {
+	JpegChromaSubsampling444	= 444,
+	JpegChromaSubsampling422	= 422,
+	JpegChromaSubsampling420	= 420,
+	JpegChromaSubsampling411	= 411
+} JpegChromaSubsampling;
+
+typedef enum {
+	JpegDctMethodInteger		= 0,
+	JpegDctMethodFastInteger	= 1,
+	JpegDctMethodFloat		= 2
+} JpegDctMethod;
+
+typedef enum {
+	PngCompressionLevelDefault	= -1,
+	PngCompressionLevelNone		= 0,
+	PngCompressionLevelFast		= 1,
+	PngCompressionLevelBest		= 9
+} PngCompressionLevel;
+
+typedef enum {
+	PngCompressionStrategyDefault	= 0,
+	PngCompressionStrategyFiltered	= 1,
+	PngCompressionStrategyHuffmanOnly = 2,
+	PngCompressionStrategyRle	= 3,
+	PngCompressionStrategyFixed	= 4
+} PngCompressionStrategy;
+
+typedef enum {
+	PngThreadsAuto			= -1
+} PngThreads;
+
+typedef enum {
+	PngFilterNone			= 0x08,
+	PngFilterSub			= 0x10,
+	PngFilterUp			= 0x20,
+	PngFilterAverage		= 0x40,
+	PngFilterPaeth			= 0x80,
+	PngFilterAll			= 0xF8
+} PngFilter;
+
 GpStatus WINGDIPAPI GdipGetImageDecodersSize (UINT *numDecoders, UINT *size);
 GpStatus WINGDIPAPI GdipGetImageDecoders (UINT numDecoders, UINT size, ImageCodecInfo *decoders);
 GpStatus WINGDIPAPI GdipGetImageEncodersSize (UINT *numEncoders, UINT *size);
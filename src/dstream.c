@@ -24,16 +24,12 @@
 struct _dstream_pvt {
 	GetBytesDelegate read;
 	SeekDelegate seek;
+	MemorySource *memory;	/* read instead of the delegates, see dstream_memory_new */
 
 	BYTE *buffer;
 	int allocated;
 	int position;
 	int used;
-
-	/* EXIF APP1 buffer */
-	BYTE *exif_buffer;
-	unsigned int exif_datasize;
-	BOOL keep_exif_buffer;
 };
 
 /* dstream_t */
@@ -58,6 +54,30 @@ dstream_input_new (GetBytesDelegate read, SeekDelegate seek)
 	return st;
 }
 
+/* a stream reading encoded data kept in memory, e.g. an image embedded in a metafile */
+dstream_t *
+dstream_memory_new (MemorySource *memory)
+{
+	dstream_t *st;
+
+	st = dstream_input_new (NULL, NULL);
+	if (st == NULL)
+		return NULL;
+
+	st->pvt->memory = memory;
+	return st;
+}
+
+/* like GetBytesDelegate, a NULL buffer skips the bytes */
+static int
+read_from_source (dstream_private *loader, BYTE *buffer, int size)
+{
+	if (loader->memory != NULL)
+		return gdip_memory_source_read (loader->memory, buffer, size);
+
+	return loader->read (buffer, size, 0);
+}
+
 void
 dstream_free (dstream_t *st)
 {
@@ -66,8 +86,6 @@ dstream_free (dstream_t *st)
 
 		if (loader->buffer)
 			GdipFree (loader->buffer);
-		if (loader->exif_buffer)
-			GdipFree (loader->exif_buffer);
 		memset (loader, 0, sizeof (dstream_t));
 		GdipFree (loader);
 		GdipFree (st);
@@ -107,7 +125,7 @@ fill_buffer (dstream_private *loader)
 
 	offset = 0;
 	do {
-		nbytes = loader->read (loader->buffer + offset, loader->allocated - offset, 0);
+		nbytes = read_from_source (loader, loader->buffer + offset, loader->allocated - offset);
 		if (nbytes > 0)
 			offset += nbytes;
 	} while (nbytes > 0 && ((loader->allocated - offset) > 0));
@@ -116,16 +134,6 @@ fill_buffer (dstream_private *loader)
 		loader->position = 0;
 		loader->used = offset;
 	}
-
-	/* First chunk read */
-	if (nbytes > 0 && loader->keep_exif_buffer && loader->exif_buffer == NULL) {
-		loader->exif_buffer = GdipAlloc (offset);
-		if (!loader->exif_buffer)
-			return;
-
-		loader->exif_datasize = offset;
-		memcpy (loader->exif_buffer, loader->buffer, offset);
-	}
 }
 
 int
@@ -168,7 +176,10 @@ dstream_skip (dstream_t *st, int nbytes)
 
 		/* 'read' ignores reads into a NULL buffer */
 		while (nbytes > 0) {
-			nbytes -= loader->read (NULL, nbytes, 0);
+			int skipped = read_from_source (loader, NULL, nbytes);
+			if (skipped <= 0)
+				break;
+			nbytes -= skipped;
 		}
 	}
 
@@ -176,24 +187,3 @@ dstream_skip (dstream_t *st, int nbytes)
 	loader->used = 0;
 	loader->position = 0;
 }
-
-void
-dstream_keep_exif_buffer (dstream_t *st)
-{
-	dstream_private *loader = st->pvt;
-	loader->keep_exif_buffer = TRUE;
-}
-
-void
-dstream_get_exif_buffer (dstream_t *st, BYTE **ptr, unsigned int *length)
-{
-	dstream_private *loader = st->pvt;
-
-	if (loader->keep_exif_buffer) {
-		*ptr = loader->exif_buffer;
-		*length = loader->exif_datasize;
-	} else {
-		*ptr = NULL;
-		*length = 0;
-	}
-}
@@ -427,6 +427,12 @@ gdip_metafile_play_emf (MetafilePlayContext *context)
 #ifdef DEBUG_EMF
 		printf ("\n[#%d] size %d ", i++, size);
 #endif
+		/* in dual metafiles the EMF records are only played when an EMF+ GetDC record asks for them */
+		if (context->emfplus && !context->emfplus->get_dc && (func != EMR_GDICOMMENT) && (func != EMR_EOF)) {
+			data += size;
+			continue;
+		}
+
 		switch (func) {
 		case EMR_POLYBEZIER:
 			status = PolyBezier (context, data, size - EMF_MIN_RECORD_SIZE, FALSE);
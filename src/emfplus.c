@@ -30,6 +30,1899 @@
 #define DEBUG_EMFPLUS_NOTIMPLEMENTED
 #endif
 
+#define EMFPLUS_RECORD_HEADER_SIZE	12
+
+/* record flags */
+#define EMFPLUS_FLAGS_OBJECT_ID		0x00FF
+#define EMFPLUS_FLAGS_RELATIVE		0x0800
+#define EMFPLUS_FLAGS_FILLMODE_WINDING	0x2000
+#define EMFPLUS_FLAGS_CLOSED_SHAPE	0x2000
+#define EMFPLUS_FLAGS_APPEND_ORDER	0x2000
+#define EMFPLUS_FLAGS_USE_INT16		0x4000
+#define EMFPLUS_FLAGS_USE_ARGB		0x8000
+#define EMFPLUS_FLAGS_CONTINUED_OBJECT	0x8000
+
+#define EMFPLUS_OBJECT_TYPE(flags)	(((flags) >> 8) & 0x7F)
+#define EMFPLUS_COMBINE_MODE(flags)	(((flags) >> 8) & 0x0F)
+
+/* optional brush data */
+#define EMFPLUS_BRUSH_PATH		0x0001
+#define EMFPLUS_BRUSH_TRANSFORM		0x0002
+#define EMFPLUS_BRUSH_PRESET_COLORS	0x0004
+#define EMFPLUS_BRUSH_BLEND_FACTORS_H	0x0008
+#define EMFPLUS_BRUSH_BLEND_FACTORS_V	0x0010
+#define EMFPLUS_BRUSH_FOCUS_SCALES	0x0040
+#define EMFPLUS_BRUSH_GAMMA_CORRECTED	0x0080
+
+/* optional pen data, serialized in this order */
+#define EMFPLUS_PEN_TRANSFORM		0x0001
+#define EMFPLUS_PEN_START_CAP		0x0002
+#define EMFPLUS_PEN_END_CAP		0x0004
+#define EMFPLUS_PEN_JOIN		0x0008
+#define EMFPLUS_PEN_MITER_LIMIT		0x0010
+#define EMFPLUS_PEN_LINE_STYLE		0x0020
+#define EMFPLUS_PEN_DASHED_LINE_CAP	0x0040
+#define EMFPLUS_PEN_DASHED_LINE_OFFSET	0x0080
+#define EMFPLUS_PEN_DASHED_LINE		0x0100
+#define EMFPLUS_PEN_NON_CENTER		0x0200
+#define EMFPLUS_PEN_COMPOUND_LINE	0x0400
+#define EMFPLUS_PEN_CUSTOM_START_CAP	0x0800
+#define EMFPLUS_PEN_CUSTOM_END_CAP	0x1000
+
+/* path points */
+#define EMFPLUS_PATH_RELATIVE		0x0800
+#define EMFPLUS_PATH_RLE_TYPES		0x1000
+#define EMFPLUS_PATH_USE_INT16		0x4000
+
+/* region nodes */
+#define EMFPLUS_REGION_NODE_AND		0x00000001
+#define EMFPLUS_REGION_NODE_OR		0x00000002
+#define EMFPLUS_REGION_NODE_XOR		0x00000003
+#define EMFPLUS_REGION_NODE_EXCLUDE	0x00000004
+#define EMFPLUS_REGION_NODE_COMPLEMENT	0x00000005
+#define EMFPLUS_REGION_NODE_RECT	0x10000000
+#define EMFPLUS_REGION_NODE_PATH	0x10000001
+#define EMFPLUS_REGION_NODE_EMPTY	0x10000002
+#define EMFPLUS_REGION_NODE_INFINITE	0x10000003
+/* left nodes are read recursively, right nodes iteratively */
+#define EMFPLUS_REGION_MAX_DEPTH	64
+
+/* images */
+#define EMFPLUS_IMAGE_BITMAP		1
+#define EMFPLUS_IMAGE_METAFILE		2
+#define EMFPLUS_BITMAP_PIXELS		0
+#define EMFPLUS_BITMAP_COMPRESSED	1
+
+/* record data reader, reading past the end of the data marks the reader as failed */
+typedef struct {
+	BYTE *data;
+	BYTE *end;
+	BOOL failed;
+} EmfPlusReader;
+
+typedef struct {
+	GpRegion *region;
+	CombineMode mode;
+} EmfPlusRegionOperand;
+
+static void
+emfplus_reader_init (EmfPlusReader *reader, BYTE *data, int size)
+{
+	reader->data = data;
+	reader->end = data + size;
+	reader->failed = FALSE;
+}
+
+static int
+emfplus_reader_left (EmfPlusReader *reader)
+{
+	return reader->failed ? 0 : reader->end - reader->data;
+}
+
+/* returns the next size bytes, NULL if there isn't enough data */
+static BYTE*
+emfplus_read_bytes (EmfPlusReader *reader, int size)
+{
+	BYTE *bytes = reader->data;
+
+	if ((size < 0) || (size > emfplus_reader_left (reader))) {
+		reader->failed = TRUE;
+		return NULL;
+	}
+	reader->data += size;
+	return bytes;
+}
+
+static DWORD
+emfplus_read_dword (EmfPlusReader *reader)
+{
+	BYTE *data = emfplus_read_bytes (reader, sizeof (DWORD));
+	return data ? GETDW(0) : 0;
+}
+
+static float
+emfplus_read_float (EmfPlusReader *reader)
+{
+	union {
+		float f;
+		DWORD dw;
+	} u;
+
+	u.dw = emfplus_read_dword (reader);
+	return u.f;
+}
+
+static void
+emfplus_read_rect (EmfPlusReader *reader, BOOL use_int16, GpRectF *rect)
+{
+	if (use_int16) {
+		DWORD xy = emfplus_read_dword (reader);
+		DWORD wh = emfplus_read_dword (reader);
+		rect->X = (gint16) (xy & 0xFFFF);
+		rect->Y = (gint16) (xy >> 16);
+		rect->Width = (gint16) (wh & 0xFFFF);
+		rect->Height = (gint16) (wh >> 16);
+	} else {
+		rect->X = emfplus_read_float (reader);
+		rect->Y = emfplus_read_float (reader);
+		rect->Width = emfplus_read_float (reader);
+		rect->Height = emfplus_read_float (reader);
+	}
+}
+
+static void
+emfplus_read_matrix (EmfPlusReader *reader, GpMatrix *matrix)
+{
+	matrix->xx = emfplus_read_float (reader);
+	matrix->yx = emfplus_read_float (reader);
+	matrix->xy = emfplus_read_float (reader);
+	matrix->yy = emfplus_read_float (reader);
+	matrix->x0 = emfplus_read_float (reader);
+	matrix->y0 = emfplus_read_float (reader);
+}
+
+/* a relative coordinate is either a 7 bits, or a (big endian) 15 bits, signed integer */
+static float
+emfplus_read_relative (EmfPlusReader *reader)
+{
+	BYTE *data = emfplus_read_bytes (reader, 1);
+	int value;
+
+	if (!data)
+		return 0;
+
+	if (!(data [0] & 0x80)) {
+		value = data [0];
+		return (value & 0x40) ? value - 0x80 : value;
+	}
+
+	value = (data [0] & 0x7F) << 8;
+	data = emfplus_read_bytes (reader, 1);
+	if (!data)
+		return 0;
+	value |= data [0];
+	return (value & 0x4000) ? value - 0x8000 : value;
+}
+
+/* points are floats, INT16 (C flag) or relative to the previous point (P flag) */
+static GpStatus
+emfplus_read_points (EmfPlusReader *reader, WORD flags, int count, GpPointF **points)
+{
+	GpPointF *result;
+	int i;
+
+	/* a point is at least 2 bytes long, don't allocate more than the data can hold */
+	if ((count <= 0) || (count > emfplus_reader_left (reader) / 2))
+		return InvalidParameter;
+
+	result = (GpPointF*) GdipAlloc (count * sizeof (GpPointF));
+	if (!result)
+		return OutOfMemory;
+
+	for (i = 0; i < count; i++) {
+		if (flags & EMFPLUS_FLAGS_RELATIVE) {
+			result [i].X = emfplus_read_relative (reader);
+			result [i].Y = emfplus_read_relative (reader);
+			if (i > 0) {
+				result [i].X += result [i - 1].X;
+				result [i].Y += result [i - 1].Y;
+			}
+		} else if (flags & EMFPLUS_FLAGS_USE_INT16) {
+			DWORD xy = emfplus_read_dword (reader);
+			result [i].X = (gint16) (xy & 0xFFFF);
+			result [i].Y = (gint16) (xy >> 16);
+		} else {
+			result [i].X = emfplus_read_float (reader);
+			result [i].Y = emfplus_read_float (reader);
+		}
+	}
+
+	if (reader->failed) {
+		GdipFree (result);
+		return InvalidParameter;
+	}
+	*points = result;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_floats (EmfPlusReader *reader, int count, float **values)
+{
+	float *result;
+	int i;
+
+	if ((count <= 0) || (count > emfplus_reader_left (reader) / sizeof (float)))
+		return InvalidParameter;
+
+	result = (float*) GdipAlloc (count * sizeof (float));
+	if (!result)
+		return OutOfMemory;
+	for (i = 0; i < count; i++)
+		result [i] = emfplus_read_float (reader);
+
+	*values = result;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_colors (EmfPlusReader *reader, int count, ARGB **colors)
+{
+	ARGB *result;
+	int i;
+
+	if ((count <= 0) || (count > emfplus_reader_left (reader) / sizeof (ARGB)))
+		return InvalidParameter;
+
+	result = (ARGB*) GdipAlloc (count * sizeof (ARGB));
+	if (!result)
+		return OutOfMemory;
+	for (i = 0; i < count; i++)
+		result [i] = emfplus_read_dword (reader);
+
+	*colors = result;
+	return Ok;
+}
+
+/* objects - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/Object.html */
+
+static void
+emfplus_delete_object (MetaObject *object)
+{
+	if (!object->ptr)
+		return;
+
+	switch (object->type) {
+	case ObjectTypeBrush:
+		GdipDeleteBrush ((GpBrush*) object->ptr);
+		break;
+	case ObjectTypePen:
+		GdipDeletePen ((GpPen*) object->ptr);
+		break;
+	case ObjectTypePath:
+		GdipDeletePath ((GpPath*) object->ptr);
+		break;
+	case ObjectTypeRegion:
+		GdipDeleteRegion ((GpRegion*) object->ptr);
+		break;
+	case ObjectTypeImage:
+		GdipDisposeImage ((GpImage*) object->ptr);
+		break;
+	case ObjectTypeFont:
+		GdipDeleteFont ((GpFont*) object->ptr);
+		break;
+	case ObjectTypeStringFormat:
+		GdipDeleteStringFormat ((GpStringFormat*) object->ptr);
+		break;
+	case ObjectTypeImageAttributes:
+		GdipDisposeImageAttributes ((GpImageAttributes*) object->ptr);
+		break;
+	default:
+		break;
+	}
+	object->ptr = NULL;
+	object->type = ObjectTypeInvalid;
+}
+
+/* returns NULL if the object doesn't exist, e.g. an unsupported type, or isn't of the expected type */
+static void*
+emfplus_get_object (MetafilePlayContext *context, DWORD id, ObjectType type)
+{
+	MetaObject *object;
+
+	if (id >= EMFPLUS_MAX_OBJECTS)
+		return NULL;
+
+	object = &context->emfplus->objects [id];
+	return (object->type == type) ? object->ptr : NULL;
+}
+
+/* a brush is either an ARGB color (S flag) or the id of a brush object */
+static GpBrush*
+emfplus_get_brush (MetafilePlayContext *context, WORD flags, DWORD value)
+{
+	if (flags & EMFPLUS_FLAGS_USE_ARGB) {
+		GdipSetSolidFillColor (context->emfplus->solid, value);
+		return (GpBrush*) context->emfplus->solid;
+	}
+	return (GpBrush*) emfplus_get_object (context, value, ObjectTypeBrush);
+}
+
+static GpStatus
+emfplus_read_path (EmfPlusReader *reader, GpPath **path)
+{
+	GpPointF *points = NULL;
+	BYTE *types = NULL;
+	GpStatus status;
+	DWORD count;
+	DWORD flags;
+	int i;
+
+	emfplus_read_dword (reader); /* version */
+	count = emfplus_read_dword (reader);
+	flags = emfplus_read_dword (reader);
+	if (reader->failed)
+		return InvalidParameter;
+	/* note: the fill mode isn't part of the EMF+ path object */
+	if (count == 0)
+		return GdipCreatePath (FillModeAlternate, path);
+
+	status = emfplus_read_points (reader, (flags & EMFPLUS_PATH_RELATIVE) ? EMFPLUS_FLAGS_RELATIVE :
+		((flags & EMFPLUS_PATH_USE_INT16) ? EMFPLUS_FLAGS_USE_INT16 : 0), count, &points);
+	if (status != Ok)
+		return status;
+
+	types = (BYTE*) GdipAlloc (count);
+	if (!types) {
+		GdipFree (points);
+		return OutOfMemory;
+	}
+
+	if (flags & EMFPLUS_PATH_RLE_TYPES) {
+		/* run length encoded types, each run is a count (6 bits), with a bezier flag, and a type */
+		i = 0;
+		while ((i < count) && !reader->failed) {
+			BYTE *run = emfplus_read_bytes (reader, 2);
+			BYTE type;
+			int j;
+
+			if (!run)
+				break;
+			type = run [1];
+			if (run [0] & 0x80)
+				type = (type & ~PathPointTypePathTypeMask) | PathPointTypeBezier;
+			for (j = 0; (j < (run [0] & 0x3F)) && (i < count); j++)
+				types [i++] = type;
+		}
+	} else {
+		BYTE *data = emfplus_read_bytes (reader, count);
+		if (data)
+			memcpy (types, data, count);
+	}
+
+	if (reader->failed)
+		status = InvalidParameter;
+	else
+		status = GdipCreatePath2 (points, types, count, FillModeAlternate, path);
+
+	GdipFree (types);
+	GdipFree (points);
+	return status;
+}
+
+static GpStatus
+emfplus_read_region_leaf (EmfPlusReader *reader, DWORD type, GpRegion **region)
+{
+	EmfPlusReader path_reader;
+	GpStatus status;
+	GpPath *path;
+	GpRectF rect;
+	BYTE *data;
+	DWORD size;
+
+	switch (type) {
+	case EMFPLUS_REGION_NODE_RECT:
+		emfplus_read_rect (reader, FALSE, &rect);
+		if (reader->failed)
+			return InvalidParameter;
+		return GdipCreateRegionRect (&rect, region);
+	case EMFPLUS_REGION_NODE_PATH:
+		size = emfplus_read_dword (reader);
+		data = emfplus_read_bytes (reader, size);
+		if (!data)
+			return InvalidParameter;
+		emfplus_reader_init (&path_reader, data, size);
+		status = emfplus_read_path (&path_reader, &path);
+		if (status != Ok)
+			return status;
+		status = GdipCreateRegionPath (path, region);
+		GdipDeletePath (path);
+		return status;
+	case EMFPLUS_REGION_NODE_EMPTY:
+		status = GdipCreateRegion (region);
+		if (status == Ok)
+			status = GdipSetEmpty (*region);
+		return status;
+	case EMFPLUS_REGION_NODE_INFINITE:
+		return GdipCreateRegion (region);
+	default:
+		return InvalidParameter;
+	}
+}
+
+/*
+ * Combining nodes are followed by their left and right nodes. Regions are mostly serialized as long chains
+ * of right nodes, e.g. an union of rectangles, so those are read iteratively and combined backward.
+ */
+static GpStatus
+emfplus_read_region_node (EmfPlusReader *reader, int depth, GpRegion **region)
+{
+	GArray *operands = NULL;
+	GpRegion *result = NULL;
+	GpStatus status = Ok;
+	int i;
+
+	if (depth > EMFPLUS_REGION_MAX_DEPTH)
+		return InvalidParameter;
+
+	while (status == Ok) {
+		DWORD type = emfplus_read_dword (reader);
+		EmfPlusRegionOperand operand;
+
+		if (reader->failed)
+			return InvalidParameter;
+
+		/* the right node is combined into the left one: swap the non commutative modes */
+		switch (type) {
+		case EMFPLUS_REGION_NODE_AND:
+			operand.mode = CombineModeIntersect;
+			break;
+		case EMFPLUS_REGION_NODE_OR:
+			operand.mode = CombineModeUnion;
+			break;
+		case EMFPLUS_REGION_NODE_XOR:
+			operand.mode = CombineModeXor;
+			break;
+		case EMFPLUS_REGION_NODE_EXCLUDE:
+			operand.mode = CombineModeComplement;
+			break;
+		case EMFPLUS_REGION_NODE_COMPLEMENT:
+			operand.mode = CombineModeExclude;
+			break;
+		default:
+			status = emfplus_read_region_leaf (reader, type, &result);
+			goto combine;
+		}
+
+		status = emfplus_read_region_node (reader, depth + 1, &operand.region);
+		if (status != Ok)
+			break;
+		if (!operands)
+			operands = g_array_new (FALSE, FALSE, sizeof (EmfPlusRegionOperand));
+		g_array_append_val (operands, operand);
+	}
+
+combine:
+	for (i = operands ? operands->len - 1 : -1; i >= 0; i--) {
+		EmfPlusRegionOperand *operand = &g_array_index (operands, EmfPlusRegionOperand, i);
+		if (status == Ok)
+			status = GdipCombineRegionRegion (result, operand->region, operand->mode);
+		GdipDeleteRegion (operand->region);
+	}
+	if (operands)
+		g_array_free (operands, TRUE);
+
+	if (status != Ok) {
+		if (result)
+			GdipDeleteRegion (result);
+		return status;
+	}
+	*region = result;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_region (EmfPlusReader *reader, GpRegion **region)
+{
+	emfplus_read_dword (reader); /* version */
+	emfplus_read_dword (reader); /* node count */
+	return emfplus_read_region_node (reader, 0, region);
+}
+
+static GpStatus
+emfplus_read_bitmap (EmfPlusReader *reader, GpImage **image)
+{
+	ColorPalette *palette = NULL;
+	GpBitmap *bitmap;
+	GpStatus status;
+	PixelFormat format;
+	BYTE *pixels;
+	int width, height, stride;
+
+	width = emfplus_read_dword (reader);
+	height = emfplus_read_dword (reader);
+	stride = emfplus_read_dword (reader);
+	format = emfplus_read_dword (reader);
+	if (emfplus_read_dword (reader) == EMFPLUS_BITMAP_COMPRESSED) {
+		/* e.g. PNG or JPEG, the rest of the object */
+		if (reader->failed)
+			return InvalidParameter;
+		return gdip_load_image_from_memory (reader->data, emfplus_reader_left (reader), image);
+	}
+
+	if ((width <= 0) || (height <= 0) || (stride <= 0))
+		return InvalidParameter;
+
+	if (gdip_is_an_indexed_pixelformat (format)) {
+		DWORD flags = emfplus_read_dword (reader);
+		DWORD count = emfplus_read_dword (reader);
+		ARGB *entries;
+
+		if (count > 256)
+			return InvalidParameter;
+		status = emfplus_read_colors (reader, count, &entries);
+		if (status != Ok)
+			return status;
+		palette = GdipAlloc (sizeof (ColorPalette) + count * sizeof (ARGB));
+		if (!palette) {
+			GdipFree (entries);
+			return OutOfMemory;
+		}
+		palette->Flags = flags;
+		palette->Count = count;
+		memcpy (palette->Entries, entries, count * sizeof (ARGB));
+		GdipFree (entries);
+	}
+
+	/* the pixels are in the record, the bitmap is cloned to own them */
+	pixels = (height <= emfplus_reader_left (reader) / stride) ? emfplus_read_bytes (reader, height * stride) : NULL;
+	if (!pixels)
+		status = InvalidParameter;
+	else
+		status = GdipCreateBitmapFromScan0 (width, height, stride, format, pixels, &bitmap);
+
+	if (status == Ok) {
+		status = GdipCloneImage (bitmap, image);
+		GdipDisposeImage (bitmap);
+		if ((status == Ok) && palette) {
+			status = GdipSetImagePalette (*image, palette);
+			if (status != Ok)
+				GdipDisposeImage (*image);
+		}
+	}
+
+	if (palette)
+		GdipFree (palette);
+	return status;
+}
+
+static GpStatus
+emfplus_read_image (EmfPlusReader *reader, GpImage **image)
+{
+	DWORD size;
+	BYTE *data;
+
+	emfplus_read_dword (reader); /* version */
+	switch (emfplus_read_dword (reader)) {
+	case EMFPLUS_IMAGE_BITMAP:
+		return emfplus_read_bitmap (reader, image);
+	case EMFPLUS_IMAGE_METAFILE:
+		emfplus_read_dword (reader); /* type, the codec finds it from the data */
+		size = emfplus_read_dword (reader);
+		data = emfplus_read_bytes (reader, size);
+		if (!data)
+			return InvalidParameter;
+		return gdip_load_image_from_memory (data, size, image);
+	default:
+		return reader->failed ? InvalidParameter : NotImplemented;
+	}
+}
+
+static GpStatus
+emfplus_read_line_gradient (EmfPlusReader *reader, GpLineGradient **brush)
+{
+	GpLineGradient *line;
+	GpStatus status;
+	GpMatrix matrix;
+	GpRectF rect;
+	DWORD flags;
+	WrapMode wrap;
+	ARGB color1, color2;
+
+	flags = emfplus_read_dword (reader);
+	wrap = emfplus_read_dword (reader);
+	emfplus_read_rect (reader, FALSE, &rect);
+	color1 = emfplus_read_dword (reader);
+	color2 = emfplus_read_dword (reader);
+	emfplus_read_dword (reader); /* reserved */
+	emfplus_read_dword (reader); /* reserved */
+	if (reader->failed)
+		return InvalidParameter;
+
+	status = GdipCreateLineBrushFromRect (&rect, color1, color2, LinearGradientModeHorizontal, wrap, &line);
+	if (status != Ok)
+		return status;
+
+	if (flags & EMFPLUS_BRUSH_TRANSFORM) {
+		emfplus_read_matrix (reader, &matrix);
+		status = reader->failed ? InvalidParameter : GdipSetLineTransform (line, &matrix);
+	}
+
+	if ((status == Ok) && (flags & EMFPLUS_BRUSH_PRESET_COLORS)) {
+		int count = emfplus_read_dword (reader);
+		float *positions = NULL;
+		ARGB *colors = NULL;
+
+		status = emfplus_read_floats (reader, count, &positions);
+		if (status == Ok)
+			status = emfplus_read_colors (reader, count, &colors);
+		if (status == Ok)
+			status = GdipSetLinePresetBlend (line, colors, positions, count);
+		if (colors)
+			GdipFree (colors);
+		if (positions)
+			GdipFree (positions);
+	} else if ((status == Ok) && (flags & (EMFPLUS_BRUSH_BLEND_FACTORS_H | EMFPLUS_BRUSH_BLEND_FACTORS_V))) {
+		/* a single blend is supported, vertical factors are only used without horizontal ones */
+		int count = emfplus_read_dword (reader);
+		float *positions = NULL;
+		float *factors = NULL;
+
+		status = emfplus_read_floats (reader, count, &positions);
+		if (status == Ok)
+			status = emfplus_read_floats (reader, count, &factors);
+		if (status == Ok)
+			status = GdipSetLineBlend (line, factors, positions, count);
+		if (factors)
+			GdipFree (factors);
+		if (positions)
+			GdipFree (positions);
+	}
+
+	if ((status == Ok) && (flags & EMFPLUS_BRUSH_GAMMA_CORRECTED))
+		status = GdipSetLineGammaCorrection (line, TRUE);
+
+	if (status != Ok) {
+		GdipDeleteBrush ((GpBrush*) line);
+		return status;
+	}
+	*brush = line;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_path_gradient (EmfPlusReader *reader, GpPathGradient **brush)
+{
+	GpPathGradient *gradient = NULL;
+	ARGB *surrounding = NULL;
+	GpStatus status;
+	GpMatrix matrix;
+	GpPointF center;
+	DWORD flags;
+	WrapMode wrap;
+	ARGB center_color;
+	int count;
+
+	flags = emfplus_read_dword (reader);
+	wrap = emfplus_read_dword (reader);
+	center_color = emfplus_read_dword (reader);
+	center.X = emfplus_read_float (reader);
+	center.Y = emfplus_read_float (reader);
+	count = emfplus_read_dword (reader);
+	if (reader->failed)
+		return InvalidParameter;
+	status = emfplus_read_colors (reader, count, &surrounding);
+	if (status != Ok)
+		return status;
+
+	/* the boundary is either a path object or points */
+	if (flags & EMFPLUS_BRUSH_PATH) {
+		EmfPlusReader path_reader;
+		DWORD size = emfplus_read_dword (reader);
+		BYTE *data = emfplus_read_bytes (reader, size);
+		GpPath *path;
+
+		if (!data) {
+			status = InvalidParameter;
+		} else {
+			emfplus_reader_init (&path_reader, data, size);
+			status = emfplus_read_path (&path_reader, &path);
+			if (status == Ok) {
+				status = GdipCreatePathGradientFromPath (path, &gradient);
+				GdipDeletePath (path);
+			}
+		}
+	} else {
+		int points_count = emfplus_read_dword (reader);
+		GpPointF *points;
+
+		status = emfplus_read_points (reader, 0, points_count, &points);
+		if (status == Ok) {
+			status = GdipCreatePathGradient (points, points_count, wrap, &gradient);
+			GdipFree (points);
+		}
+	}
+
+	if (status == Ok)
+		status = GdipSetPathGradientWrapMode (gradient, wrap);
+	if (status == Ok)
+		status = GdipSetPathGradientCenterColor (gradient, center_color);
+	if (status == Ok)
+		status = GdipSetPathGradientCenterPoint (gradient, &center);
+	if (status == Ok)
+		status = GdipSetPathGradientSurroundColorsWithCount (gradient, surrounding, &count);
+	GdipFree (surrounding);
+
+	if ((status == Ok) && (flags & EMFPLUS_BRUSH_TRANSFORM)) {
+		emfplus_read_matrix (reader, &matrix);
+		status = reader->failed ? InvalidParameter : GdipSetPathGradientTransform (gradient, &matrix);
+	}
+
+	if ((status == Ok) && (flags & (EMFPLUS_BRUSH_PRESET_COLORS | EMFPLUS_BRUSH_BLEND_FACTORS_H))) {
+		int blend_count = emfplus_read_dword (reader);
+		float *positions = NULL;
+		float *factors = NULL;
+		ARGB *colors = NULL;
+
+		status = emfplus_read_floats (reader, blend_count, &positions);
+		if ((status == Ok) && (flags & EMFPLUS_BRUSH_PRESET_COLORS)) {
+			status = emfplus_read_colors (reader, blend_count, &colors);
+			if (status == Ok)
+				status = GdipSetPathGradientPresetBlend (gradient, colors, positions, blend_count);
+		} else if (status == Ok) {
+			status = emfplus_read_floats (reader, blend_count, &factors);
+			if (status == Ok)
+				status = GdipSetPathGradientBlend (gradient, factors, positions, blend_count);
+		}
+		if (colors)
+			GdipFree (colors);
+		if (factors)
+			GdipFree (factors);
+		if (positions)
+			GdipFree (positions);
+	}
+
+	if ((status == Ok) && (flags & EMFPLUS_BRUSH_FOCUS_SCALES)) {
+		float x, y;
+		emfplus_read_dword (reader); /* count, always 2 */
+		x = emfplus_read_float (reader);
+		y = emfplus_read_float (reader);
+		status = reader->failed ? InvalidParameter : GdipSetPathGradientFocusScales (gradient, x, y);
+	}
+
+	if ((status == Ok) && (flags & EMFPLUS_BRUSH_GAMMA_CORRECTED))
+		status = GdipSetPathGradientGammaCorrection (gradient, TRUE);
+
+	if (status != Ok) {
+		if (gradient)
+			GdipDeleteBrush ((GpBrush*) gradient);
+		return status;
+	}
+	*brush = gradient;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_texture (EmfPlusReader *reader, GpTexture **brush)
+{
+	GpTexture *texture;
+	GpImage *image;
+	GpStatus status;
+	GpMatrix matrix;
+	DWORD flags;
+	WrapMode wrap;
+
+	flags = emfplus_read_dword (reader);
+	wrap = emfplus_read_dword (reader);
+	if (flags & EMFPLUS_BRUSH_TRANSFORM)
+		emfplus_read_matrix (reader, &matrix);
+	if (reader->failed)
+		return InvalidParameter;
+
+	status = emfplus_read_image (reader, &image);
+	if (status != Ok)
+		return status;
+
+	/* the texture keeps a copy of the image */
+	status = GdipCreateTexture (image, wrap, &texture);
+	GdipDisposeImage (image);
+	if (status != Ok)
+		return status;
+
+	if (flags & EMFPLUS_BRUSH_TRANSFORM) {
+		status = GdipSetTextureTransform (texture, &matrix);
+		if (status != Ok) {
+			GdipDeleteBrush ((GpBrush*) texture);
+			return status;
+		}
+	}
+	*brush = texture;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_brush (EmfPlusReader *reader, GpBrush **brush)
+{
+	DWORD style;
+	ARGB fore, back;
+
+	emfplus_read_dword (reader); /* version */
+	switch (emfplus_read_dword (reader)) {
+	case BrushTypeSolidColor:
+		fore = emfplus_read_dword (reader);
+		if (reader->failed)
+			return InvalidParameter;
+		return GdipCreateSolidFill (fore, (GpSolidFill**) brush);
+	case BrushTypeHatchFill:
+		style = emfplus_read_dword (reader);
+		fore = emfplus_read_dword (reader);
+		back = emfplus_read_dword (reader);
+		if (reader->failed)
+			return InvalidParameter;
+		return GdipCreateHatchBrush (style, fore, back, (GpHatch**) brush);
+	case BrushTypeTextureFill:
+		return emfplus_read_texture (reader, (GpTexture**) brush);
+	case BrushTypePathGradient:
+		return emfplus_read_path_gradient (reader, (GpPathGradient**) brush);
+	case BrushTypeLinearGradient:
+		return emfplus_read_line_gradient (reader, (GpLineGradient**) brush);
+	default:
+		return InvalidParameter;
+	}
+}
+
+static GpStatus
+emfplus_read_pen (EmfPlusReader *reader, GpPen **result)
+{
+	GpStatus status;
+	GpBrush *brush;
+	GpPen *pen;
+	GpMatrix matrix;
+	DWORD flags;
+	GpUnit unit;
+	float width;
+	float *values;
+	int count;
+
+	emfplus_read_dword (reader); /* version */
+	emfplus_read_dword (reader); /* type, always 0 */
+	flags = emfplus_read_dword (reader);
+	unit = emfplus_read_dword (reader);
+	width = emfplus_read_float (reader);
+	if (reader->failed)
+		return InvalidParameter;
+
+	/* the brush is serialized after the optional data, the pen is created with a temporary color */
+	status = GdipCreatePen1 (0xFF000000, width, unit, &pen);
+	if (status != Ok)
+		return status;
+
+	if (flags & EMFPLUS_PEN_TRANSFORM) {
+		emfplus_read_matrix (reader, &matrix);
+		if (!reader->failed)
+			status = GdipSetPenTransform (pen, &matrix);
+	}
+	if ((status == Ok) && (flags & EMFPLUS_PEN_START_CAP))
+		status = GdipSetPenStartCap (pen, emfplus_read_dword (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_END_CAP))
+		status = GdipSetPenEndCap (pen, emfplus_read_dword (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_JOIN))
+		status = GdipSetPenLineJoin (pen, emfplus_read_dword (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_MITER_LIMIT))
+		status = GdipSetPenMiterLimit (pen, emfplus_read_float (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_LINE_STYLE))
+		status = GdipSetPenDashStyle (pen, emfplus_read_dword (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_DASHED_LINE_CAP))
+		status = GdipSetPenDashCap197819 (pen, emfplus_read_dword (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_DASHED_LINE_OFFSET))
+		status = GdipSetPenDashOffset (pen, emfplus_read_float (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_DASHED_LINE)) {
+		count = emfplus_read_dword (reader);
+		status = emfplus_read_floats (reader, count, &values);
+		if (status == Ok) {
+			status = GdipSetPenDashArray (pen, values, count);
+			GdipFree (values);
+		}
+	}
+	if ((status == Ok) && (flags & EMFPLUS_PEN_NON_CENTER))
+		status = GdipSetPenMode (pen, emfplus_read_dword (reader));
+	if ((status == Ok) && (flags & EMFPLUS_PEN_COMPOUND_LINE)) {
+		count = emfplus_read_dword (reader);
+		status = emfplus_read_floats (reader, count, &values);
+		if (status == Ok) {
+			status = GdipSetPenCompoundArray (pen, values, count);
+			GdipFree (values);
+		}
+	}
+	/* TODO - custom line caps, they are skipped */
+	if (flags & EMFPLUS_PEN_CUSTOM_START_CAP)
+		emfplus_read_bytes (reader, emfplus_read_dword (reader));
+	if (flags & EMFPLUS_PEN_CUSTOM_END_CAP)
+		emfplus_read_bytes (reader, emfplus_read_dword (reader));
+
+	if ((status == Ok) && reader->failed)
+		status = InvalidParameter;
+	if (status == Ok) {
+		status = emfplus_read_brush (reader, &brush);
+		if (status == Ok) {
+			status = GdipSetPenBrushFill (pen, brush);
+			GdipDeleteBrush (brush);
+		}
+	}
+
+	if (status != Ok) {
+		GdipDeletePen (pen);
+		return status;
+	}
+	*result = pen;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_font (EmfPlusReader *reader, GpFont **font)
+{
+	GpFontFamily *family = NULL;
+	GpStatus status;
+	WCHAR *name;
+	BYTE *data;
+	float size;
+	GpUnit unit;
+	INT style;
+	int length;
+	int i;
+
+	emfplus_read_dword (reader); /* version */
+	size = emfplus_read_float (reader);
+	unit = emfplus_read_dword (reader);
+	style = emfplus_read_dword (reader);
+	emfplus_read_dword (reader); /* reserved */
+	length = emfplus_read_dword (reader);
+	data = emfplus_read_bytes (reader, length * sizeof (WCHAR));
+	if (!data || (length <= 0))
+		return InvalidParameter;
+
+	name = (WCHAR*) GdipAlloc ((length + 1) * sizeof (WCHAR));
+	if (!name)
+		return OutOfMemory;
+	for (i = 0; i < length; i++)
+		name [i] = GUINT16_FROM_LE (((WORD*) data) [i]);
+	name [length] = 0;
+
+	/* like GDI+ a missing family is replaced */
+	status = GdipCreateFontFamilyFromName (name, NULL, &family);
+	if (status == FontFamilyNotFound)
+		status = GdipGetGenericFontFamilySansSerif (&family);
+	GdipFree (name);
+	if (status != Ok)
+		return status;
+
+	status = GdipCreateFont (family, size, style, unit, font);
+	GdipDeleteFontFamily (family);
+	return status;
+}
+
+static GpStatus
+emfplus_read_string_format (EmfPlusReader *reader, GpStringFormat **result)
+{
+	GpStringFormat *format;
+	GpStatus status;
+	DWORD flags, language, digit_substitution, digit_language, hotkey_prefix, trimming;
+	StringAlignment align, line_align;
+	float first_tab_offset;
+	int tab_count, range_count;
+
+	emfplus_read_dword (reader); /* version */
+	flags = emfplus_read_dword (reader);
+	language = emfplus_read_dword (reader);
+	align = emfplus_read_dword (reader);
+	line_align = emfplus_read_dword (reader);
+	digit_substitution = emfplus_read_dword (reader);
+	digit_language = emfplus_read_dword (reader);
+	first_tab_offset = emfplus_read_float (reader);
+	hotkey_prefix = emfplus_read_dword (reader);
+	emfplus_read_float (reader); /* leading margin */
+	emfplus_read_float (reader); /* trailing margin */
+	emfplus_read_float (reader); /* tracking */
+	trimming = emfplus_read_dword (reader);
+	tab_count = emfplus_read_dword (reader);
+	range_count = emfplus_read_dword (reader);
+	if (reader->failed)
+		return InvalidParameter;
+
+	status = GdipCreateStringFormat (flags, (LANGID) language, &format);
+	if (status != Ok)
+		return status;
+
+	status = GdipSetStringFormatAlign (format, align);
+	if (status == Ok)
+		status = GdipSetStringFormatLineAlign (format, line_align);
+	if (status == Ok)
+		status = GdipSetStringFormatDigitSubstitution (format, (LANGID) digit_language, digit_substitution);
+	if (status == Ok)
+		status = GdipSetStringFormatHotkeyPrefix (format, hotkey_prefix);
+	if (status == Ok)
+		status = GdipSetStringFormatTrimming (format, trimming);
+
+	if ((status == Ok) && (tab_count > 0)) {
+		float *tabs;
+		status = emfplus_read_floats (reader, tab_count, &tabs);
+		if (status == Ok) {
+			status = GdipSetStringFormatTabStops (format, first_tab_offset, tab_count, tabs);
+			GdipFree (tabs);
+		}
+	}
+
+	if ((status == Ok) && (range_count > 0)) {
+		CharacterRange *ranges;
+		int i;
+
+		if (range_count > emfplus_reader_left (reader) / sizeof (CharacterRange))
+			status = InvalidParameter;
+		else if (!(ranges = (CharacterRange*) GdipAlloc (range_count * sizeof (CharacterRange))))
+			status = OutOfMemory;
+		else {
+			for (i = 0; i < range_count; i++) {
+				ranges [i].First = emfplus_read_dword (reader);
+				ranges [i].Length = emfplus_read_dword (reader);
+			}
+			status = GdipSetStringFormatMeasurableCharacterRanges (format, range_count, ranges);
+			GdipFree (ranges);
+		}
+	}
+
+	if (status != Ok) {
+		GdipDeleteStringFormat (format);
+		return status;
+	}
+	*result = format;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_image_attributes (EmfPlusReader *reader, GpImageAttributes **result)
+{
+	GpImageAttributes *attributes;
+	GpStatus status;
+	WrapMode wrap;
+	ARGB color;
+	DWORD clamp;
+
+	emfplus_read_dword (reader); /* version */
+	emfplus_read_dword (reader); /* reserved */
+	wrap = emfplus_read_dword (reader);
+	color = emfplus_read_dword (reader);
+	clamp = emfplus_read_dword (reader);
+	if (reader->failed)
+		return InvalidParameter;
+
+	status = GdipCreateImageAttributes (&attributes);
+	if (status != Ok)
+		return status;
+
+	status = GdipSetImageAttributesWrapMode (attributes, wrap, color, clamp);
+	if (status != Ok) {
+		GdipDisposeImageAttributes (attributes);
+		return status;
+	}
+	*result = attributes;
+	return Ok;
+}
+
+static GpStatus
+emfplus_read_object (EmfPlusReader *reader, ObjectType type, MetaObject *object)
+{
+	void *ptr = NULL;
+	GpStatus status;
+
+	switch (type) {
+	case ObjectTypeBrush:
+		status = emfplus_read_brush (reader, (GpBrush**) &ptr);
+		break;
+	case ObjectTypePen:
+		status = emfplus_read_pen (reader, (GpPen**) &ptr);
+		break;
+	case ObjectTypePath:
+		status = emfplus_read_path (reader, (GpPath**) &ptr);
+		break;
+	case ObjectTypeRegion:
+		status = emfplus_read_region (reader, (GpRegion**) &ptr);
+		break;
+	case ObjectTypeImage:
+		status = emfplus_read_image (reader, (GpImage**) &ptr);
+		break;
+	case ObjectTypeFont:
+		status = emfplus_read_font (reader, (GpFont**) &ptr);
+		break;
+	case ObjectTypeStringFormat:
+		status = emfplus_read_string_format (reader, (GpStringFormat**) &ptr);
+		break;
+	case ObjectTypeImageAttributes:
+		status = emfplus_read_image_attributes (reader, (GpImageAttributes**) &ptr);
+		break;
+	default:
+		/* TODO - custom line caps */
+		status = NotImplemented;
+		break;
+	}
+
+	if (status != Ok)
+		return status;
+
+	object->type = type;
+	object->ptr = ptr;
+	return Ok;
+}
+
+/* objects larger than a record are split in many Object records, the (C)ontinued ones start with the total size */
+static GpStatus
+emfplus_append_partial_object (MetafilePlayContext *context, EmfPlusReader *reader, DWORD total)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	int size = emfplus_reader_left (reader);
+
+	if (!state->partial) {
+		if (total > context->metafile->length)
+			return InvalidParameter;
+		state->partial = (BYTE*) GdipAlloc (total);
+		if (!state->partial)
+			return OutOfMemory;
+		state->partial_size = 0;
+		state->partial_total = total;
+	}
+
+	size = min (size, state->partial_total - state->partial_size);
+	memcpy (state->partial + state->partial_size, reader->data, size);
+	state->partial_size += size;
+	return Ok;
+}
+
+static GpStatus
+EmfPlusObject (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	MetaObject *object;
+	EmfPlusReader reader;
+	GpStatus status;
+
+#ifdef DEBUG_EMFPLUS
+	printf ("EmfPlusRecordTypeObject flags %X", flags);
+#endif
+	if ((flags & EMFPLUS_FLAGS_OBJECT_ID) >= EMFPLUS_MAX_OBJECTS)
+		return InvalidParameter;
+	object = &state->objects [flags & EMFPLUS_FLAGS_OBJECT_ID];
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	if (flags & EMFPLUS_FLAGS_CONTINUED_OBJECT) {
+		DWORD total = emfplus_read_dword (&reader);
+		return reader.failed ? InvalidParameter : emfplus_append_partial_object (context, &reader, total);
+	}
+
+	/* the last part of a split object */
+	if (state->partial) {
+		status = emfplus_append_partial_object (context, &reader, state->partial_total);
+		if (status != Ok)
+			return status;
+		emfplus_reader_init (&reader, state->partial, state->partial_size);
+	}
+
+	emfplus_delete_object (object);
+	status = emfplus_read_object (&reader, EMFPLUS_OBJECT_TYPE(flags), object);
+
+	if (state->partial) {
+		GdipFree (state->partial);
+		state->partial = NULL;
+	}
+
+	/* like GDI+ an object that can't be created, e.g. an unsupported image, doesn't stop the playback,
+	 * the records using it are ignored */
+	if (status != OutOfMemory) {
+#ifdef DEBUG_EMFPLUS_NOTIMPLEMENTED
+		if (status != Ok)
+			printf ("EMF+ object of type %d not created, status %d", EMFPLUS_OBJECT_TYPE(flags), status);
+#endif
+		status = Ok;
+	}
+	return status;
+}
+
+/* transforms - the device transform is the world transform, then the page transform, then the base one */
+
+static GpStatus
+emfplus_update_transform (MetafilePlayContext *context)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	GpMatrix matrix;
+	GpMatrix page;
+
+	cairo_matrix_init_scale (&page,
+		gdip_unit_conversion (state->page_unit, UnitPixel, state->dpi_x, gtMemoryBitmap, state->page_scale),
+		gdip_unit_conversion (state->page_unit, UnitPixel, state->dpi_y, gtMemoryBitmap, state->page_scale));
+	cairo_matrix_multiply (&matrix, &state->world, &page);
+	cairo_matrix_multiply (&matrix, &matrix, &state->base);
+	return GdipSetWorldTransform (context->graphics, &matrix);
+}
+
+static GpStatus
+emfplus_multiply_transform (MetafilePlayContext *context, WORD flags, GpMatrix *matrix)
+{
+	EmfPlusPlayState *state = context->emfplus;
+
+	if (flags & EMFPLUS_FLAGS_APPEND_ORDER)
+		cairo_matrix_multiply (&state->world, &state->world, matrix);
+	else
+		cairo_matrix_multiply (&state->world, matrix, &state->world);
+	return emfplus_update_transform (context);
+}
+
+static GpStatus
+EmfPlusTransform (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	EmfPlusReader reader;
+	GpMatrix matrix;
+	float v1, v2;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	switch (func) {
+	case EmfPlusRecordTypeSetWorldTransform:
+		emfplus_read_matrix (&reader, &matrix);
+		if (reader.failed)
+			return InvalidParameter;
+		state->world = matrix;
+		return emfplus_update_transform (context);
+	case EmfPlusRecordTypeResetWorldTransform:
+		cairo_matrix_init_identity (&state->world);
+		return emfplus_update_transform (context);
+	case EmfPlusRecordTypeMultiplyWorldTransform:
+		emfplus_read_matrix (&reader, &matrix);
+		break;
+	case EmfPlusRecordTypeTranslateWorldTransform:
+		v1 = emfplus_read_float (&reader);
+		v2 = emfplus_read_float (&reader);
+		cairo_matrix_init_translate (&matrix, v1, v2);
+		break;
+	case EmfPlusRecordTypeScaleWorldTransform:
+		v1 = emfplus_read_float (&reader);
+		v2 = emfplus_read_float (&reader);
+		cairo_matrix_init_scale (&matrix, v1, v2);
+		break;
+	case EmfPlusRecordTypeRotateWorldTransform:
+		cairo_matrix_init_rotate (&matrix, emfplus_read_float (&reader) * DEGTORAD);
+		break;
+	case EmfPlusRecordTypeSetPageTransform:
+		state->page_unit = flags & 0xFF;
+		state->page_scale = emfplus_read_float (&reader);
+		if (reader.failed)
+			return InvalidParameter;
+		return emfplus_update_transform (context);
+	default:
+		return NotImplemented;
+	}
+
+	if (reader.failed)
+		return InvalidParameter;
+	return emfplus_multiply_transform (context, flags, &matrix);
+}
+
+/* graphics state - Save and BeginContainer records push a state, Restore and EndContainer pop it */
+
+static GpStatus
+emfplus_push_state (MetafilePlayContext *context, DWORD index)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	EmfPlusSavedState saved;
+	GpStatus status;
+
+	status = GdipSaveGraphics (context->graphics, &saved.state);
+	if (status != Ok)
+		return status;
+
+	saved.index = index;
+	saved.base = state->base;
+	saved.world = state->world;
+	saved.page_unit = state->page_unit;
+	saved.page_scale = state->page_scale;
+	g_array_append_val (state->stack, saved);
+	return Ok;
+}
+
+static GpStatus
+emfplus_pop_state (MetafilePlayContext *context, DWORD index)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	EmfPlusSavedState *saved;
+	GpStatus status;
+	int i;
+
+	/* the most recent state with this index, the ones pushed after it are discarded */
+	for (i = state->stack->len - 1; i >= 0; i--) {
+		saved = &g_array_index (state->stack, EmfPlusSavedState, i);
+		if (saved->index == index)
+			break;
+	}
+	if (i < 0)
+		return Ok;
+
+	status = GdipRestoreGraphics (context->graphics, saved->state);
+	state->base = saved->base;
+	state->world = saved->world;
+	state->page_unit = saved->page_unit;
+	state->page_scale = saved->page_scale;
+	g_array_set_size (state->stack, i);
+
+	if (status != Ok)
+		return status;
+	return emfplus_update_transform (context);
+}
+
+/* a container maps its source rectangle to the destination rectangle, both in the current world coordinates */
+static GpStatus
+EmfPlusBeginContainer (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	EmfPlusReader reader;
+	GpRectF dest, src;
+	GpMatrix container;
+	GpMatrix page;
+	GpStatus status;
+	DWORD index;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	emfplus_read_rect (&reader, FALSE, &dest);
+	emfplus_read_rect (&reader, FALSE, &src);
+	index = emfplus_read_dword (&reader);
+	if (reader.failed || (src.Width == 0) || (src.Height == 0))
+		return InvalidParameter;
+
+	status = emfplus_push_state (context, index);
+	if (status != Ok)
+		return status;
+
+	/* the unit of the source rectangle (in the flags) applies to both the rectangle and the container content */
+	cairo_matrix_init_translate (&container, dest.X, dest.Y);
+	cairo_matrix_scale (&container, dest.Width / src.Width, dest.Height / src.Height);
+	cairo_matrix_translate (&container, -src.X, -src.Y);
+
+	cairo_matrix_init_scale (&page,
+		gdip_unit_conversion (state->page_unit, UnitPixel, state->dpi_x, gtMemoryBitmap, state->page_scale),
+		gdip_unit_conversion (state->page_unit, UnitPixel, state->dpi_y, gtMemoryBitmap, state->page_scale));
+	cairo_matrix_multiply (&container, &container, &state->world);
+	cairo_matrix_multiply (&container, &container, &page);
+	cairo_matrix_multiply (&state->base, &container, &state->base);
+
+	cairo_matrix_init_identity (&state->world);
+	state->page_unit = UnitPixel;
+	state->page_scale = 1.0f;
+	return emfplus_update_transform (context);
+}
+
+static GpStatus
+EmfPlusBeginContainerNoParams (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	EmfPlusReader reader;
+	GpMatrix page;
+	GpStatus status;
+	DWORD index;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	index = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+
+	status = emfplus_push_state (context, index);
+	if (status != Ok)
+		return status;
+
+	/* the current transforms become the base of the container */
+	cairo_matrix_init_scale (&page,
+		gdip_unit_conversion (state->page_unit, UnitPixel, state->dpi_x, gtMemoryBitmap, state->page_scale),
+		gdip_unit_conversion (state->page_unit, UnitPixel, state->dpi_y, gtMemoryBitmap, state->page_scale));
+	cairo_matrix_multiply (&page, &state->world, &page);
+	cairo_matrix_multiply (&state->base, &page, &state->base);
+
+	cairo_matrix_init_identity (&state->world);
+	state->page_unit = UnitPixel;
+	state->page_scale = 1.0f;
+	return emfplus_update_transform (context);
+}
+
+/* clipping - the clip is in world coordinates, i.e. using the current transform */
+
+static GpStatus
+EmfPlusResetClip (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	GpStatus status;
+
+	/* the clip the playback started with was saved using the base transform */
+	status = GdipSetWorldTransform (context->graphics, &state->base);
+	if (status == Ok)
+		status = GdipSetClipRegion (context->graphics, state->clip, CombineModeReplace);
+	if (status != Ok)
+		return status;
+	return emfplus_update_transform (context);
+}
+
+static GpStatus
+EmfPlusSetClip (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	CombineMode mode = EMFPLUS_COMBINE_MODE(flags);
+	GpRectF rect;
+	void *object;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	switch (func) {
+	case EmfPlusRecordTypeSetClipRect:
+		emfplus_read_rect (&reader, FALSE, &rect);
+		if (reader.failed)
+			return InvalidParameter;
+		return GdipSetClipRect (context->graphics, rect.X, rect.Y, rect.Width, rect.Height, mode);
+	case EmfPlusRecordTypeSetClipPath:
+		object = emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypePath);
+		return object ? GdipSetClipPath (context->graphics, (GpPath*) object, mode) : Ok;
+	case EmfPlusRecordTypeSetClipRegion:
+		object = emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypeRegion);
+		return object ? GdipSetClipRegion (context->graphics, (GpRegion*) object, mode) : Ok;
+	case EmfPlusRecordTypeOffsetClip:
+		rect.X = emfplus_read_float (&reader);
+		rect.Y = emfplus_read_float (&reader);
+		if (reader.failed)
+			return InvalidParameter;
+		return GdipTranslateClip (context->graphics, rect.X, rect.Y);
+	default:
+		return NotImplemented;
+	}
+}
+
+/* drawing */
+
+/* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/Clear.html */
+static GpStatus
+EmfPlusClear (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	ARGB color;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	color = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+	return GdipGraphicsClear (context->graphics, color);
+}
+
+static GpStatus
+emfplus_read_rects (EmfPlusReader *reader, WORD flags, int count, GpRectF **rects)
+{
+	BOOL use_int16 = (flags & EMFPLUS_FLAGS_USE_INT16);
+	GpRectF *result;
+	int i;
+
+	if ((count <= 0) || (count > emfplus_reader_left (reader) / (use_int16 ? 8 : 16)))
+		return InvalidParameter;
+
+	result = (GpRectF*) GdipAlloc (count * sizeof (GpRectF));
+	if (!result)
+		return OutOfMemory;
+	for (i = 0; i < count; i++)
+		emfplus_read_rect (reader, use_int16, &result [i]);
+
+	*rects = result;
+	return Ok;
+}
+
+/* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillRects.html */
+static GpStatus
+EmfPlusFillRects (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	GpStatus status;
+	GpBrush *brush;
+	GpRectF *rects;
+	DWORD count;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	brush = emfplus_get_brush (context, flags, emfplus_read_dword (&reader));
+	count = emfplus_read_dword (&reader);
+#ifdef DEBUG_EMFPLUS
+	printf ("EmfPlusRecordTypeFillRects flags %X", flags);
+	printf ("\n\t#rect: %d", count);
+#endif
+	if (reader.failed)
+		return InvalidParameter;
+	if (!brush)
+		return Ok;
+
+	status = emfplus_read_rects (&reader, flags, count, &rects);
+	if (status != Ok)
+		return status;
+
+	status = GdipFillRectangles (context->graphics, brush, rects, count);
+	GdipFree (rects);
+	return status;
+}
+
+static GpStatus
+EmfPlusDrawRects (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	GpStatus status;
+	GpRectF *rects;
+	GpPen *pen;
+	DWORD count;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	pen = (GpPen*) emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypePen);
+	count = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+	if (!pen)
+		return Ok;
+
+	status = emfplus_read_rects (&reader, flags, count, &rects);
+	if (status != Ok)
+		return status;
+
+	status = GdipDrawRectangles (context->graphics, pen, rects, count);
+	GdipFree (rects);
+	return status;
+}
+
+/* FillEllipse, FillPie, DrawEllipse, DrawPie and DrawArc: (angles and) a rectangle */
+static GpStatus
+EmfPlusEllipse (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	GpBrush *brush = NULL;
+	GpPen *pen = NULL;
+	float start = 0, sweep = 0;
+	GpRectF rect;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	if ((func == EmfPlusRecordTypeFillEllipse) || (func == EmfPlusRecordTypeFillPie))
+		brush = emfplus_get_brush (context, flags, emfplus_read_dword (&reader));
+	else
+		pen = (GpPen*) emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypePen);
+	if ((func != EmfPlusRecordTypeFillEllipse) && (func != EmfPlusRecordTypeDrawEllipse)) {
+		start = emfplus_read_float (&reader);
+		sweep = emfplus_read_float (&reader);
+	}
+	emfplus_read_rect (&reader, (flags & EMFPLUS_FLAGS_USE_INT16), &rect);
+	if (reader.failed)
+		return InvalidParameter;
+	if (!brush && !pen)
+		return Ok;
+
+	switch (func) {
+	case EmfPlusRecordTypeFillEllipse:
+		return GdipFillEllipse (context->graphics, brush, rect.X, rect.Y, rect.Width, rect.Height);
+	case EmfPlusRecordTypeFillPie:
+		return GdipFillPie (context->graphics, brush, rect.X, rect.Y, rect.Width, rect.Height, start, sweep);
+	case EmfPlusRecordTypeDrawEllipse:
+		return GdipDrawEllipse (context->graphics, pen, rect.X, rect.Y, rect.Width, rect.Height);
+	case EmfPlusRecordTypeDrawPie:
+		return GdipDrawPie (context->graphics, pen, rect.X, rect.Y, rect.Width, rect.Height, start, sweep);
+	default:
+		return GdipDrawArc (context->graphics, pen, rect.X, rect.Y, rect.Width, rect.Height, start, sweep);
+	}
+}
+
+/* FillPolygon, FillClosedCurve, DrawLines, DrawBeziers, DrawClosedCurve and DrawCurve: (parameters and) points */
+static GpStatus
+EmfPlusPoints (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	GpBrush *brush = NULL;
+	GpPen *pen = NULL;
+	GpPointF *points;
+	GpStatus status;
+	float tension = 0.5f;
+	int offset = 0, segments = 0;
+	int count;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	if ((func == EmfPlusRecordTypeFillPolygon) || (func == EmfPlusRecordTypeFillClosedCurve))
+		brush = emfplus_get_brush (context, flags, emfplus_read_dword (&reader));
+	else
+		pen = (GpPen*) emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypePen);
+	if ((func == EmfPlusRecordTypeFillClosedCurve) || (func == EmfPlusRecordTypeDrawClosedCurve) ||
+		(func == EmfPlusRecordTypeDrawCurve))
+		tension = emfplus_read_float (&reader);
+	if (func == EmfPlusRecordTypeDrawCurve) {
+		offset = emfplus_read_dword (&reader);
+		segments = emfplus_read_dword (&reader);
+	}
+	count = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+	if (!brush && !pen)
+		return Ok;
+
+	status = emfplus_read_points (&reader, flags, count, &points);
+	if (status != Ok)
+		return status;
+
+	switch (func) {
+	case EmfPlusRecordTypeFillPolygon:
+		status = GdipFillPolygon (context->graphics, brush, points, count, FillModeAlternate);
+		break;
+	case EmfPlusRecordTypeFillClosedCurve: {
+		FillMode mode = (flags & EMFPLUS_FLAGS_FILLMODE_WINDING) ? FillModeWinding : FillModeAlternate;
+		GpPath *path;
+
+		/* without tension the curve is a polygon, e.g. how winding polygons are recorded */
+		if (tension == 0.0f) {
+			status = GdipFillPolygon (context->graphics, brush, points, count, mode);
+			break;
+		}
+		status = GdipCreatePath (mode, &path);
+		if (status != Ok)
+			break;
+		status = GdipAddPathClosedCurve2 (path, points, count, tension);
+		if (status == Ok)
+			status = GdipFillPath (context->graphics, brush, path);
+		GdipDeletePath (path);
+		break;
+	}
+	case EmfPlusRecordTypeDrawLines:
+		if (flags & EMFPLUS_FLAGS_CLOSED_SHAPE)
+			status = GdipDrawPolygon (context->graphics, pen, points, count);
+		else
+			status = GdipDrawLines (context->graphics, pen, points, count);
+		break;
+	case EmfPlusRecordTypeDrawBeziers:
+		status = GdipDrawBeziers (context->graphics, pen, points, count);
+		break;
+	case EmfPlusRecordTypeDrawClosedCurve:
+		status = GdipDrawClosedCurve2 (context->graphics, pen, points, count, tension);
+		break;
+	default:
+		status = GdipDrawCurve3 (context->graphics, pen, points, count, offset, segments, tension);
+		break;
+	}
+
+	GdipFree (points);
+	return status;
+}
+
+/* FillPath, DrawPath and FillRegion */
+static GpStatus
+EmfPlusObjectShape (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	DWORD id = flags & EMFPLUS_FLAGS_OBJECT_ID;
+	DWORD value;
+	void *object;
+	void *tool;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	value = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+
+	switch (func) {
+	case EmfPlusRecordTypeFillPath:
+		object = emfplus_get_object (context, id, ObjectTypePath);
+		tool = emfplus_get_brush (context, flags, value);
+		return (object && tool) ? GdipFillPath (context->graphics, (GpBrush*) tool, (GpPath*) object) : Ok;
+	case EmfPlusRecordTypeDrawPath:
+		object = emfplus_get_object (context, id, ObjectTypePath);
+		tool = emfplus_get_object (context, value, ObjectTypePen);
+		return (object && tool) ? GdipDrawPath (context->graphics, (GpPen*) tool, (GpPath*) object) : Ok;
+	default:
+		object = emfplus_get_object (context, id, ObjectTypeRegion);
+		tool = emfplus_get_brush (context, flags, value);
+		return (object && tool) ? GdipFillRegion (context->graphics, (GpBrush*) tool, (GpRegion*) object) : Ok;
+	}
+}
+
+/* DrawImage (destination rectangle) and DrawImagePoints (destination parallelogram) */
+static GpStatus
+EmfPlusDrawImage (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	GpImageAttributes *attributes;
+	GpImage *image;
+	GpPointF *points;
+	GpStatus status;
+	GpRectF src, dest;
+	GpUnit unit;
+	int count;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	image = (GpImage*) emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypeImage);
+	attributes = (GpImageAttributes*) emfplus_get_object (context, emfplus_read_dword (&reader), ObjectTypeImageAttributes);
+	unit = emfplus_read_dword (&reader);
+	emfplus_read_rect (&reader, FALSE, &src);
+	if (reader.failed)
+		return InvalidParameter;
+	if (!image)
+		return Ok;
+
+	if (func == EmfPlusRecordTypeDrawImage) {
+		emfplus_read_rect (&reader, (flags & EMFPLUS_FLAGS_USE_INT16), &dest);
+		if (reader.failed)
+			return InvalidParameter;
+		return GdipDrawImageRectRect (context->graphics, image, dest.X, dest.Y, dest.Width, dest.Height,
+			src.X, src.Y, src.Width, src.Height, unit, attributes, NULL, NULL);
+	}
+
+	count = emfplus_read_dword (&reader);
+	if (reader.failed || (count != 3))
+		return InvalidParameter;
+	status = emfplus_read_points (&reader, flags, count, &points);
+	if (status != Ok)
+		return status;
+
+	status = GdipDrawImagePointsRect (context->graphics, image, points, count, src.X, src.Y, src.Width, src.Height,
+		unit, attributes, NULL, NULL);
+	GdipFree (points);
+	return status;
+}
+
+static GpStatus
+EmfPlusDrawString (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	GpStringFormat *format;
+	GpBrush *brush;
+	GpFont *font;
+	GpStatus status;
+	GpRectF rect;
+	WCHAR *string;
+	BYTE *chars;
+	int length;
+	int i;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	font = (GpFont*) emfplus_get_object (context, flags & EMFPLUS_FLAGS_OBJECT_ID, ObjectTypeFont);
+	brush = emfplus_get_brush (context, flags, emfplus_read_dword (&reader));
+	format = (GpStringFormat*) emfplus_get_object (context, emfplus_read_dword (&reader), ObjectTypeStringFormat);
+	length = emfplus_read_dword (&reader);
+	emfplus_read_rect (&reader, FALSE, &rect);
+	if (reader.failed || (length < 0) || (length > emfplus_reader_left (&reader) / sizeof (WCHAR)))
+		return InvalidParameter;
+	if (!font || !brush || (length == 0))
+		return Ok;
+
+	chars = emfplus_read_bytes (&reader, length * sizeof (WCHAR));
+	string = (WCHAR*) GdipAlloc (length * sizeof (WCHAR));
+	if (!string)
+		return OutOfMemory;
+	for (i = 0; i < length; i++)
+		string [i] = GUINT16_FROM_LE (((WORD*) chars) [i]);
+
+	status = GdipDrawString (context->graphics, string, length, font, &rect, format, brush);
+	GdipFree (string);
+	return status;
+}
+
+/* rendering settings, the value is in the flags */
+static GpStatus
+EmfPlusSetMode (MetafilePlayContext *context, WORD func, WORD flags)
+{
+	GpGraphics *graphics = context->graphics;
+
+	switch (func) {
+	case EmfPlusRecordTypeSetAntiAliasMode:
+		/* the smoothing mode, shifted, and the antialiasing bit */
+		return GdipSetSmoothingMode (graphics, (flags >> 1) & 0x7F);
+	case EmfPlusRecordTypeSetTextRenderingHint:
+		return GdipSetTextRenderingHint (graphics, flags & 0xFF);
+	case EmfPlusRecordTypeSetTextContrast:
+		return GdipSetTextContrast (graphics, flags & 0xFFF);
+	case EmfPlusRecordTypeSetInterpolationMode:
+		return GdipSetInterpolationMode (graphics, flags & 0xFF);
+	case EmfPlusRecordTypeSetPixelOffsetMode:
+		return GdipSetPixelOffsetMode (graphics, flags & 0xFF);
+	case EmfPlusRecordTypeSetCompositingMode:
+		return GdipSetCompositingMode (graphics, flags & 0xFF);
+	case EmfPlusRecordTypeSetCompositingQuality:
+		return GdipSetCompositingQuality (graphics, flags & 0xFF);
+	default:
+		return NotImplemented;
+	}
+}
+
+static GpStatus
+EmfPlusSetRenderingOrigin (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	int x, y;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	x = emfplus_read_dword (&reader);
+	y = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+	return GdipSetRenderingOrigin (context->graphics, x, y);
+}
+
+static GpStatus
+EmfPlusStackIndex (MetafilePlayContext *context, WORD func, WORD flags, BYTE* data, int size)
+{
+	EmfPlusReader reader;
+	DWORD index;
+
+	emfplus_reader_init (&reader, data + EMFPLUS_RECORD_HEADER_SIZE, size - EMFPLUS_RECORD_HEADER_SIZE);
+	index = emfplus_read_dword (&reader);
+	if (reader.failed)
+		return InvalidParameter;
+
+	if (func == EmfPlusRecordTypeSave)
+		return emfplus_push_state (context, index);
+	/* Restore and EndContainer */
+	return emfplus_pop_state (context, index);
+}
+
+/* the EMF+ state is created with the header. When compiling only the GetDC state is tracked */
+static GpStatus
+emfplus_begin (MetafilePlayContext *context, float dpi_x, float dpi_y)
+{
+	EmfPlusPlayState *state;
+	GpStatus status;
+
+	if (context->emfplus)
+		return Ok;
+
+	state = (EmfPlusPlayState*) GdipAlloc (sizeof (EmfPlusPlayState));
+	if (!state)
+		return OutOfMemory;
+	memset (state, 0, sizeof (EmfPlusPlayState));
+	context->emfplus = state;
+
+	cairo_matrix_init_identity (&state->world);
+	state->page_unit = UnitPixel;
+	state->page_scale = 1.0f;
+	state->dpi_x = (dpi_x > 0) ? dpi_x : context->metafile->metafile_header.DpiX;
+	state->dpi_y = (dpi_y > 0) ? dpi_y : context->metafile->metafile_header.DpiY;
+	if (!context->graphics)
+		return Ok;
+
+	/* the graphics state (e.g. clip and rendering modes) is restored once the playback is done */
+	GdipGetWorldTransform (context->graphics, &state->base);
+	status = GdipSaveGraphics (context->graphics, &state->state);
+	if (status != Ok)
+		return status;
+	state->saved = TRUE;
+
+	status = GdipCreateRegion (&state->clip);
+	if (status == Ok)
+		status = GdipGetClip (context->graphics, state->clip);
+	if (status == Ok)
+		status = GdipCreateSolidFill (0xFF000000, &state->solid);
+	if (status != Ok)
+		return status;
+
+	state->stack = g_array_new (FALSE, FALSE, sizeof (EmfPlusSavedState));
+	return Ok;
+}
+
+void
+gdip_metafile_emfplus_release (MetafilePlayContext *context)
+{
+	EmfPlusPlayState *state = context->emfplus;
+	int i;
+
+	if (!state)
+		return;
+
+	for (i = 0; i < EMFPLUS_MAX_OBJECTS; i++)
+		emfplus_delete_object (&state->objects [i]);
+	if (state->saved && context->graphics)
+		GdipRestoreGraphics (context->graphics, state->state);
+	if (state->clip)
+		GdipDeleteRegion (state->clip);
+	if (state->solid)
+		GdipDeleteBrush ((GpBrush*) state->solid);
+	if (state->stack)
+		g_array_free (state->stack, TRUE);
+	if (state->partial)
+		GdipFree (state->partial);
+
+	GdipFree (state);
+	context->emfplus = NULL;
+}
 
 /* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/Header.html */
 static GpStatus
@@ -48,7 +1941,11 @@ EmfPlusHeader (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
 	/* ObjectHeader, not Version, is returned to be compatible with GDI+ */
 	context->metafile->metafile_header.Version = GETDW(DWP2);
 	/* Horizontal and Vertical Resolution aren't reported correctly by GDI+ (generally 0) */
-	return Ok;
+	if (!context->graphics && !context->list)
+		return Ok;
+
+	/* but they are the resolution of the EMF+ page units */
+	return emfplus_begin (context, (size >= DWP6) ? (float) GETDW(DWP4) : 0, (size >= DWP6) ? (float) GETDW(DWP5) : 0);
 }
 
 /* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/EndOfFile.html */
@@ -61,63 +1958,30 @@ EmfPlusEndOfFile (MetafilePlayContext *context, WORD flags, BYTE* data, int size
 	return Ok;
 }
 
-/* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillRects.html */
+/* when compiling only the header, and the GetDC records, are looked at */
 static GpStatus
-EmfPlusFillRects (MetafilePlayContext *context, WORD flags, BYTE* data, int size)
+emfplus_scan_block (MetafilePlayContext *context, BYTE* data, int length)
 {
 	GpStatus status = Ok;
-	GpSolidFill *solid = NULL;
-	GpBrush *brush = NULL;
+	BYTE *end = data + length;
 
-#ifdef DEBUG_EMFPLUS
-	printf ("EmfPlusRecordTypeFillRects flags %X", flags, size);
-	printf ("\n\tColor: 0x%X", GETDW(DWP2));
-	printf ("\n\t#rect: %d", GETDW(DWP3));
-#endif
-	BOOL use_int16 = (flags & 0x4000);
-	BOOL use_color = (flags & 0x8000);
-	DWORD num = GETDW(DWP3);
-	int i = 0;
-	int n = 3;
-
-	if (use_color) {
-		status = GdipCreateSolidFill (GETDW(DWP2), &solid);
-		if (status != Ok)
-			return status;
-		brush = (GpBrush*)solid;
-	} else {
-		/* TODO - get brush from index */
-	}
-
-	while ((i++ < num) && (status == Ok)) {
-		float x, y, w, h;
-		if (use_int16) {
-			DWORD xy = GETDW(DWP(n));
-			n++;
-			x = (xy >> 16);
-			y = (WORD)xy;
-			DWORD wh = GETDW(DWP(n));
-			n++;
-			w = (wh >> 16);
-			h = (WORD)wh;
-		} else {
-			x = (float) GETDW(DWP(n));
-			n++;
-			y = (float) GETDW(DWP(n));
-			n++;
-			w = (float) GETDW(DWP(n));
-			n++;
-			h = (float) GETDW(DWP(n));
-			n++;
-		}
-#ifdef DEBUG_EMFPLUS_2
-		printf ("\n\t\t%d - x %g, y %g, w %g, h %g", i, x, y, w, h);
-#endif
-		status = GdipFillRectangle (context->graphics, brush, x, y, w, h);
-	}
+	while (data < end - EMF_MIN_RECORD_SIZE) {
+		DWORD record = GETDW(EMF_FUNCTION);
+		WORD func = (WORD)record;
+		DWORD size = GETDW(EMF_RECORDSIZE);
+
+		if ((size < EMFPLUS_RECORD_HEADER_SIZE) || (size > end - data))
+			break;
 
-	if (solid)
-		GdipDeleteBrush (brush); /* brush == a GpBrush* typecasted solid, if used */
+		if (func == EmfPlusRecordTypeHeader)
+			status = EmfPlusHeader (context, (record >> 16), data, size);
+		if (context->emfplus)
+			context->emfplus->get_dc = (func == EmfPlusRecordTypeGetDC);
+		if ((status != Ok) || (func == EmfPlusRecordTypeEndOfFile))
+			break;
+
+		data += size;
+	}
 	return status;
 }
 
@@ -130,6 +1994,16 @@ gdip_metafile_play_emfplus_block (MetafilePlayContext *context, BYTE* data, int
 	int i = 1, j;
 #endif
 
+	/* when compiling the block is kept as a whole, it's played from the display list */
+	if (context->list) {
+		MetafileOp *op = gdip_metafile_add_op (context, MetafileOpEmfPlus);
+		if (!op)
+			return OutOfMemory;
+		op->u.emfplus.data = data;
+		op->u.emfplus.length = length;
+		return emfplus_scan_block (context, data, length);
+	}
+
 	/* special case to update the header informations (we're not really playing the metafile) */
 	if (!context->graphics) {
 		DWORD record = GETDW(EMF_FUNCTION);
@@ -152,27 +2026,120 @@ gdip_metafile_play_emfplus_block (MetafilePlayContext *context, BYTE* data, int
 #ifdef DEBUG_EMFPLUS
 		printf ("\n\tEMF+[#%d] size %d ", i++, size);
 #endif
+		if ((size < EMFPLUS_RECORD_HEADER_SIZE) || (size > end - data)) {
+			status = InvalidParameter;
+			goto cleanup;
+		}
+
+		/* records before the header are ignored */
+		if (!context->emfplus && (func != EmfPlusRecordTypeHeader)) {
+			data += size;
+			continue;
+		}
+
 		switch (func) {
 		case EmfPlusRecordTypeHeader:
 			status = EmfPlusHeader (context, flags, data, size);
 			break;
 		case EmfPlusRecordTypeEndOfFile:
+			context->emfplus->get_dc = FALSE;
 			return EmfPlusEndOfFile (context, flags, data, size);
+		case EmfPlusRecordTypeObject:
+			status = EmfPlusObject (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeClear:
+			status = EmfPlusClear (context, flags, data, size);
+			break;
 		case EmfPlusRecordTypeFillRects:
 			status = EmfPlusFillRects (context, flags, data, size);
 			break;
+		case EmfPlusRecordTypeDrawRects:
+			status = EmfPlusDrawRects (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeFillPolygon:
+		case EmfPlusRecordTypeFillClosedCurve:
+		case EmfPlusRecordTypeDrawLines:
+		case EmfPlusRecordTypeDrawBeziers:
+		case EmfPlusRecordTypeDrawClosedCurve:
+		case EmfPlusRecordTypeDrawCurve:
+			status = EmfPlusPoints (context, func, flags, data, size);
+			break;
+		case EmfPlusRecordTypeFillEllipse:
+		case EmfPlusRecordTypeDrawEllipse:
+		case EmfPlusRecordTypeFillPie:
+		case EmfPlusRecordTypeDrawPie:
+		case EmfPlusRecordTypeDrawArc:
+			status = EmfPlusEllipse (context, func, flags, data, size);
+			break;
+		case EmfPlusRecordTypeFillRegion:
+		case EmfPlusRecordTypeFillPath:
+		case EmfPlusRecordTypeDrawPath:
+			status = EmfPlusObjectShape (context, func, flags, data, size);
+			break;
+		case EmfPlusRecordTypeDrawImage:
+		case EmfPlusRecordTypeDrawImagePoints:
+			status = EmfPlusDrawImage (context, func, flags, data, size);
+			break;
+		case EmfPlusRecordTypeDrawString:
+			status = EmfPlusDrawString (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeSetRenderingOrigin:
+			status = EmfPlusSetRenderingOrigin (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeSetAntiAliasMode:
+		case EmfPlusRecordTypeSetTextRenderingHint:
+		case EmfPlusRecordTypeSetTextContrast:
+		case EmfPlusRecordTypeSetInterpolationMode:
+		case EmfPlusRecordTypeSetPixelOffsetMode:
+		case EmfPlusRecordTypeSetCompositingMode:
+		case EmfPlusRecordTypeSetCompositingQuality:
+			status = EmfPlusSetMode (context, func, flags);
+			break;
+		case EmfPlusRecordTypeSave:
+		case EmfPlusRecordTypeRestore:
+		case EmfPlusRecordTypeEndContainer:
+			status = EmfPlusStackIndex (context, func, flags, data, size);
+			break;
+		case EmfPlusRecordTypeBeginContainer:
+			status = EmfPlusBeginContainer (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeBeginContainerNoParams:
+			status = EmfPlusBeginContainerNoParams (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeSetWorldTransform:
+		case EmfPlusRecordTypeResetWorldTransform:
+		case EmfPlusRecordTypeMultiplyWorldTransform:
+		case EmfPlusRecordTypeTranslateWorldTransform:
+		case EmfPlusRecordTypeScaleWorldTransform:
+		case EmfPlusRecordTypeRotateWorldTransform:
+		case EmfPlusRecordTypeSetPageTransform:
+			status = EmfPlusTransform (context, func, flags, data, size);
+			break;
+		case EmfPlusRecordTypeResetClip:
+			status = EmfPlusResetClip (context, flags, data, size);
+			break;
+		case EmfPlusRecordTypeSetClipRect:
+		case EmfPlusRecordTypeSetClipPath:
+		case EmfPlusRecordTypeSetClipRegion:
+		case EmfPlusRecordTypeOffsetClip:
+			status = EmfPlusSetClip (context, func, flags, data, size);
+			break;
 		default:
-			/* unprocessed records, ignore the data */
+			/* unprocessed records (e.g. Comment, GetDC or DrawDriverString), ignore the data */
 #ifdef DEBUG_EMFPLUS_NOTIMPLEMENTED
 			printf ("Unimplemented_%d (", func);
-			for (j = 0; j < params; j++) {
-				printf (" %d", GETDW(DWP(j)));
+			for (j = 0; j < (size - EMFPLUS_RECORD_HEADER_SIZE) / sizeof (DWORD); j++) {
+				printf (" %d", GETDW(DWP(j + 1)));
 			}
 			printf (" )");
 #endif
 			break;
 		}
 
+		/* in dual metafiles the EMF records following a GetDC record are played */
+		if (context->emfplus)
+			context->emfplus->get_dc = (func == EmfPlusRecordTypeGetDC);
+
 		if (status != Ok) {
 			g_warning ("EMF+ parsing interupted, status %d returned from function %d.", status, func);
 			goto cleanup;
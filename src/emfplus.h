@@ -27,7 +27,20 @@
 #include "metafile-private.h"
 #include "emfcodec.h"
 #include "graphics.h"
+#include "text.h"
+#include "graphics-path-private.h"
+#include "region-private.h"
+#include "pen-private.h"
+#include "image-private.h"
+#include "imageattributes-private.h"
+#include "font-private.h"
+#include "fontfamily.h"
+#include "stringformat-private.h"
 #include "solidbrush-private.h"
+#include "hatchbrush-private.h"
+#include "texturebrush-private.h"
+#include "lineargradientbrush-private.h"
+#include "pathgradientbrush-private.h"
 
 /*
  * Some interesting links...
@@ -796,10 +796,83 @@ typedef enum {
 
 typedef enum {
 	EmfRecordTypeGdiComment = 70,
+	EmfPlusRecordTypeInvalid = 16384,
 	EmfPlusRecordTypeHeader = 16385,
 	EmfPlusRecordTypeEndOfFile = 16386,
+	EmfPlusRecordTypeComment = 16387,
+	EmfPlusRecordTypeGetDC = 16388,
+	EmfPlusRecordTypeMultiFormatStart = 16389,
+	EmfPlusRecordTypeMultiFormatSection = 16390,
+	EmfPlusRecordTypeMultiFormatEnd = 16391,
+	EmfPlusRecordTypeObject = 16392,
 	EmfPlusRecordTypeClear = 16393,
 	EmfPlusRecordTypeFillRects = 16394,
+	EmfPlusRecordTypeDrawRects = 16395,
+	EmfPlusRecordTypeFillPolygon = 16396,
+	EmfPlusRecordTypeDrawLines = 16397,
+	EmfPlusRecordTypeFillEllipse = 16398,
+	EmfPlusRecordTypeDrawEllipse = 16399,
+	EmfPlusRecordTypeFillPie = 16400,
+	EmfPlusRecordTypeDrawPie = 16401,
+	EmfPlusRecordTypeDrawArc = 16402,
+	EmfPlusRecordTypeFillRegion = 16403,
+	EmfPlusRecordTypeFillPath = 16404,
+	EmfPlusRecordTypeDrawPath = 16405,
+	EmfPlusRecordTypeFillClosedCurve = 16406,
+	EmfPlusRecordTypeDrawClosedCurve = 16407,
+	EmfPlusRecordTypeDrawCurve = 16408,
+	EmfPlusRecordTypeDrawBeziers = 16409,
+	EmfPlusRecordTypeDrawImage = 16410,
+	EmfPlusRecordTypeDrawImagePoints = 16411,
+	EmfPlusRecordTypeDrawString = 16412,
+	EmfPlusRecordTypeSetRenderingOrigin = 16413,
+	EmfPlusRecordTypeSetAntiAliasMode = 16414,
+	EmfPlusRecordTypeSetTextRenderingHint = 16415,
+	EmfPlusRecordTypeSetTextContrast = 16416,
+	EmfPlusRecordTypeSetInterpolationMode = 16417,
+	EmfPlusRecordTypeSetPixelOffsetMode = 16418,
+	EmfPlusRecordTypeSetCompositingMode = 16419,
+	EmfPlusRecordTypeSetCompositingQuality = 16420,
+	EmfPlusRecordTypeSave = 16421,
+	EmfPlusRecordTypeRestore = 16422,
+	EmfPlusRecordTypeBeginContainer = 16423,
+	EmfPlusRecordTypeBeginContainerNoParams = 16424,
+	EmfPlusRecordTypeEndContainer = 16425,
+	EmfPlusRecordTypeSetWorldTransform = 16426,
+	EmfPlusRecordTypeResetWorldTransform = 16427,
+	EmfPlusRecordTypeMultiplyWorldTransform = 16428,
+	EmfPlusRecordTypeTranslateWorldTransform = 16429,
+	EmfPlusRecordTypeScaleWorldTransform = 16430,
+	EmfPlusRecordTypeRotateWorldTransform = 16431,
+	EmfPlusRecordTypeSetPageTransform = 16432,
+	EmfPlusRecordTypeResetClip = 16433,
+	EmfPlusRecordTypeSetClipRect = 16434,
+	EmfPlusRecordTypeSetClipPath = 16435,
+	EmfPlusRecordTypeSetClipRegion = 16436,
+	EmfPlusRecordTypeOffsetClip = 16437,
+	EmfPlusRecordTypeDrawDriverString = 16438,
+	EmfPlusRecordTypeStrokeFillPath = 16439,
+	EmfPlusRecordTypeSerializableObject = 16440,
+	EmfPlusRecordTypeSetTSGraphics = 16441,
+	EmfPlusRecordTypeSetTSClip = 16442,
+	EmfPlusRecordTotal = 16443,
+	EmfPlusRecordTypeMax = EmfPlusRecordTotal - 1,
+	EmfPlusRecordTypeMin = EmfPlusRecordTypeHeader
 } EmfPlusRecordType;
 
+typedef enum {
+	ObjectTypeInvalid = 0,
+	ObjectTypeBrush = 1,
+	ObjectTypePen = 2,
+	ObjectTypePath = 3,
+	ObjectTypeRegion = 4,
+	ObjectTypeImage = 5,
+	ObjectTypeFont = 6,
+	ObjectTypeStringFormat = 7,
+	ObjectTypeImageAttributes = 8,
+	ObjectTypeCustomLineCap = 9,
+	ObjectTypeMax = ObjectTypeCustomLineCap,
+	ObjectTypeMin = ObjectTypeBrush
+} ObjectType;
+
 #endif
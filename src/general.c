@@ -469,6 +469,17 @@ gdip_is_scaled (GpGraphics *graphics)
 	return ((matrix.xx != 1.0f) || (matrix.yy != 1.0f));
 }
 
+/* convert a world point into device space, like cairo does when drawing */
+void
+gdip_world_to_device (GpGraphics *graphics, double *x, double *y)
+{
+	if (!OPTIMIZE_CONVERSION (graphics)) {
+		*x = gdip_unitx_convgr (graphics, *x);
+		*y = gdip_unity_convgr (graphics, *y);
+	}
+	cairo_user_to_device (graphics->ct, x, y);
+}
+
 /* cairo has a (signed) 15(1)/16(2)bits pixel positioning, while GDI+ use (signed) 23 bits (infinity).
  * Using larger values confuse the bits used for subpixel positioning.
  * (1) http://lists.freedesktop.org/archives/cairo/2006-June/007251.html
@@ -53,7 +53,7 @@ typedef struct
 {
 	GetBytesDelegate getBytesFunc;
 	SeekDelegate seekFunc;
-	
+	MemorySource *memory;	/* read instead of getBytesFunc when set */
 } gif_callback_data;
 
 /* Codecinfo related data*/
@@ -100,6 +100,9 @@ gdip_gif_inputfunc (GifFileType *gif, GifByteType *data, int len)
 	int read = 0;	
 	gif_callback_data *gcd = (gif_callback_data*) gif->UserData;
 	
+	if (gcd->memory)
+		return gdip_memory_source_read (gcd->memory, data, len);
+
 	read = gcd->getBytesFunc (data, len, 0);
 	return read;
 }
@@ -690,10 +693,23 @@ gdip_load_gif_image_from_stream_delegate (GetBytesDelegate getBytesFunc, SeekDel
 	
 	gif_data.getBytesFunc = getBytesFunc;
 	gif_data.seekFunc = seekFunc;
+	gif_data.memory = NULL;
 	
 	return gdip_load_gif_image (&gif_data, image, FALSE);	
 }
 
+GpStatus
+gdip_load_gif_image_from_memory (MemorySource *memory, GpImage **image)
+{
+	gif_callback_data gif_data;
+
+	gif_data.getBytesFunc = NULL;
+	gif_data.seekFunc = NULL;
+	gif_data.memory = memory;
+
+	return gdip_load_gif_image (&gif_data, image, FALSE);
+}
+
 /* Write callback function for the gif libbrary*/
 static int 
 gdip_gif_outputfunc (GifFileType *gif,  const GifByteType *data, int len) 
@@ -1125,6 +1141,13 @@ gdip_load_gif_image_from_stream_delegate (GetBytesDelegate getBytesFunc, SeekDel
 	return UnknownImageFormat;
 }
 
+GpStatus
+gdip_load_gif_image_from_memory (MemorySource *memory, GpImage **image)
+{
+	*image = NULL;
+	return UnknownImageFormat;
+}
+
 #endif
 
 GpStatus
@@ -18,6 +18,8 @@ GpStatus gdip_load_gif_image_from_file (FILE *fp, GpImage **image) GDIP_INTERNAL
 
 GpStatus gdip_load_gif_image_from_stream_delegate (GetBytesDelegate getBytesFunc, SeekDelegate seekFunc, 
 	GpImage **image) GDIP_INTERNAL;
+
+GpStatus gdip_load_gif_image_from_memory (MemorySource *memory, GpImage **image) GDIP_INTERNAL;
 					   
 GpStatus gdip_save_gif_image_to_file (unsigned char *filename, GpImage *image) GDIP_INTERNAL;
 
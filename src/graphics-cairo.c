@@ -74,6 +74,137 @@ stroke_graphics_with_pen (GpGraphics *graphics, GpPen *pen)
 	return gdip_get_status (cairo_status (graphics->ct));
 }
 
+/*
+ * Culling: a primitive whose device bounds, grown by what the pen can add around them, don't intersect the
+ * device extents of the clip (bounded by the surface) can't change a pixel, so its cairo path is never built.
+ */
+
+typedef struct {
+	BOOL	enabled;
+	double	x1, y1, x2, y2;	/* device extents of the clip */
+	double	margin;		/* device pixels added around the geometry */
+} CullContext;
+
+static void
+gdip_cull_init (GpGraphics *graphics, GpPen *pen, CullContext *cull)
+{
+	/* custom caps are drawn outside of the stroke, with their own geometry */
+	cull->enabled = !pen || (!pen->custom_start_cap && !pen->custom_end_cap);
+	if (!cull->enabled)
+		return;
+
+	if (graphics->clip_is_rect) {
+		cull->x1 = graphics->clip_rect.X;
+		cull->y1 = graphics->clip_rect.Y;
+		cull->x2 = graphics->clip_rect.X + graphics->clip_rect.Width;
+		cull->y2 = graphics->clip_rect.Y + graphics->clip_rect.Height;
+	} else {
+		cairo_save (graphics->ct);
+		cairo_identity_matrix (graphics->ct);
+		cairo_clip_extents (graphics->ct, &cull->x1, &cull->y1, &cull->x2, &cull->y2);
+		cairo_restore (graphics->ct);
+	}
+
+	/* antialiasing, the stroke of filled paths and hairlines touch one more pixel */
+	cull->margin = 1.0;
+
+	if (pen) {
+		cairo_matrix_t product;
+		double scale;
+
+		/* the pen is stroked with its own matrix, see gdip_pen_setup; the norm bounds how much it grows */
+		cairo_matrix_multiply (&product, &pen->matrix, graphics->copy_of_ctm);
+		scale = sqrt (product.xx * product.xx + product.yx * product.yx + product.xy * product.xy + product.yy * product.yy);
+
+		/* miter joins reach up to miter_limit half widths away, square caps sqrt(2) */
+		cull->margin += pen->width / 2 * max (pen->miter_limit, 2) * scale;
+	}
+}
+
+/* returns TRUE, and counts it, if the world rectangle can't draw anything */
+static BOOL
+gdip_cull_rect (GpGraphics *graphics, CullContext *cull, double left, double top, double right, double bottom)
+{
+	double x [4] = { left, right, right, left };
+	double y [4] = { top, top, bottom, bottom };
+	double x1, y1, x2, y2;
+	int i;
+
+	if (!cull->enabled)
+		return FALSE;
+
+	for (i = 0; i < 4; i++)
+		gdip_world_to_device (graphics, &x [i], &y [i]);
+
+	x1 = x2 = x [0];
+	y1 = y2 = y [0];
+	for (i = 1; i < 4; i++) {
+		x1 = min (x1, x [i]);
+		y1 = min (y1, y [i]);
+		x2 = max (x2, x [i]);
+		y2 = max (y2, y [i]);
+	}
+
+	if ((x2 + cull->margin < cull->x1) || (x1 - cull->margin > cull->x2) ||
+		(y2 + cull->margin < cull->y1) || (y1 - cull->margin > cull->y2)) {
+		graphics->culled_primitives++;
+		return TRUE;
+	}
+	return FALSE;
+}
+
+static BOOL
+gdip_cull_points (GpGraphics *graphics, CullContext *cull, GDIPCONST GpPointF *points, int count)
+{
+	float left, top, right, bottom;
+	int i;
+
+	if (!cull->enabled || (count < 1))
+		return FALSE;
+
+	left = right = points [0].X;
+	top = bottom = points [0].Y;
+	for (i = 1; i < count; i++) {
+		left = min (left, points [i].X);
+		top = min (top, points [i].Y);
+		right = max (right, points [i].X);
+		bottom = max (bottom, points [i].Y);
+	}
+
+	return gdip_cull_rect (graphics, cull, left, top, right, bottom);
+}
+
+static BOOL
+gdip_cull_pointsI (GpGraphics *graphics, CullContext *cull, GDIPCONST GpPoint *points, int count)
+{
+	int left, top, right, bottom;
+	int i;
+
+	if (!cull->enabled || (count < 1))
+		return FALSE;
+
+	left = right = points [0].X;
+	top = bottom = points [0].Y;
+	for (i = 1; i < count; i++) {
+		left = min (left, points [i].X);
+		top = min (top, points [i].Y);
+		right = max (right, points [i].X);
+		bottom = max (bottom, points [i].Y);
+	}
+
+	return gdip_cull_rect (graphics, cull, left, top, right, bottom);
+}
+
+/* culls a primitive contained in the box, pen is NULL for fills */
+static BOOL
+gdip_is_culled (GpGraphics *graphics, GpPen *pen, double x, double y, double width, double height)
+{
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	return gdip_cull_rect (graphics, &cull, x, y, x + width, y + height);
+}
+
 cairo_fill_rule_t
 gdip_convert_fill_mode (FillMode fill_mode)
 {
@@ -258,6 +389,9 @@ GpStatus
 cairo_DrawArc (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height, float startAngle, 
 	float sweepAngle)
 {
+	if (gdip_is_culled (graphics, pen, x, y, width, height))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should
 	 * have it set already.
 	 */
@@ -276,6 +410,13 @@ GpStatus
 cairo_DrawBezier (GpGraphics *graphics, GpPen *pen, float x1, float y1, float x2, float y2, float x3, float y3, 
 	float x4, float y4)
 {
+	GpPointF points [4] = { { x1, y1 }, { x2, y2 }, { x3, y3 }, { x4, y4 } };
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_points (graphics, &cull, points, 4))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	gdip_cairo_move_to (graphics, x1, y1, TRUE, TRUE);
 	gdip_cairo_curve_to (graphics, x2, y2, x3, y3, x4, y4, TRUE, TRUE);
@@ -292,8 +433,13 @@ cairo_DrawBezierI (GpGraphics *graphics, GpPen *pen, int x1, int y1, int x2, int
 GpStatus 
 cairo_DrawBeziers (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, int count)
 {
+	CullContext cull;
 	int i, j, k;
-		
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_points (graphics, &cull, points, count))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	gdip_cairo_move_to (graphics, points [0].X, points [0].Y, TRUE, TRUE);
 
@@ -308,8 +454,13 @@ cairo_DrawBeziers (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points,
 GpStatus
 cairo_DrawBeziersI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, int count)
 {
+	CullContext cull;
 	int i, j, k;
-		
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_pointsI (graphics, &cull, points, count))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	gdip_cairo_move_to (graphics, points [0].X, points [0].Y, TRUE, TRUE);
 
@@ -454,7 +605,10 @@ cairo_DrawCurve3I (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPoint *points,
 
 GpStatus 
 cairo_DrawEllipse (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height)
-{	
+{
+	if (gdip_is_culled (graphics, pen, x, y, width, height))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	make_ellipse (graphics, x, y, width, height, TRUE, TRUE);
 
@@ -470,6 +624,9 @@ cairo_DrawEllipseI (GpGraphics *graphics, GpPen *pen, int x, int y, int width, i
 GpStatus
 cairo_FillEllipse (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height)
 {
+	if (gdip_is_culled (graphics, NULL, x, y, width, height))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	make_ellipse (graphics, x, y, width, height, TRUE, FALSE);
 	
@@ -482,11 +639,38 @@ cairo_FillEllipseI (GpGraphics *graphics, GpBrush *brush, int x, int y, int widt
 	return cairo_FillEllipse (graphics, brush, x, y, width, height);
 }
 
+GpStatus
+cairo_FillEllipses (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rects, int count)
+{
+	BOOL draw = FALSE;
+	CullContext cull;
+	int i;
+
+	gdip_cull_init (graphics, NULL, &cull);
+
+	/* all the ellipses are filled as a single path */
+	for (i = 0; i < count; i++) {
+		if (gdip_cull_rect (graphics, &cull, rects [i].X, rects [i].Y, rects [i].X + rects [i].Width, rects [i].Y + rects [i].Height))
+			continue;
+
+		make_ellipse (graphics, rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height, TRUE, FALSE);
+		draw = TRUE;
+	}
+
+	if (!draw)
+		return Ok;
+
+	return fill_graphics_with_brush (graphics, brush, FALSE);
+}
+
 GpStatus
 cairo_DrawLine (GpGraphics *graphics, GpPen *pen, float x1, float y1, float x2, float y2)
 {
 	GpStatus ret;
 
+	if (gdip_is_culled (graphics, pen, x1, y1, x2 - x1, y2 - y1))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	gdip_cairo_move_to (graphics, x1, y1, TRUE, TRUE);
 	gdip_cairo_line_to (graphics, x2, y2, TRUE, TRUE);
@@ -505,6 +689,11 @@ cairo_DrawLines (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, i
 	int i;
 	float last_x, last_y, prev_x, prev_y;
 	GpStatus ret;
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_points (graphics, &cull, points, count))
+		return Ok;
 
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	gdip_cairo_move_to (graphics, points [0].X, points [0].Y, TRUE, TRUE);
@@ -533,6 +722,11 @@ cairo_DrawLinesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, i
 	int i;
 	float last_x, last_y, prev_x, prev_y;
 	GpStatus ret;
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_pointsI (graphics, &cull, points, count))
+		return Ok;
 
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
 	gdip_cairo_move_to (graphics, points [0].X, points [0].Y, TRUE, TRUE);
@@ -611,9 +805,15 @@ cairo_DrawPath (GpGraphics *graphics, GpPen *pen, GpPath *path)
 	GpStatus ret;
 	int count;
 	GpPointF *points;
+	GpStatus status;
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_points (graphics, &cull, (GpPointF*) path->points->data, path->count))
+		return Ok;
 
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
-	GpStatus status = gdip_plot_path (graphics, path, TRUE);
+	status = gdip_plot_path (graphics, path, TRUE);
 	if (status != Ok)
 		return status;
 
@@ -649,8 +849,15 @@ cairo_DrawPath (GpGraphics *graphics, GpPen *pen, GpPath *path)
 GpStatus
 cairo_FillPath (GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
+	GpStatus status;
+	CullContext cull;
+
+	gdip_cull_init (graphics, NULL, &cull);
+	if (gdip_cull_points (graphics, &cull, (GpPointF*) path->points->data, path->count))
+		return Ok;
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We should have it set already. */
-	GpStatus status = gdip_plot_path (graphics, path, TRUE);
+	status = gdip_plot_path (graphics, path, TRUE);
 	if (status != Ok)
 		return status;
 
@@ -719,6 +926,9 @@ GpStatus
 cairo_DrawPie (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height, 
 	float startAngle, float sweepAngle)
 {
+	if (gdip_is_culled (graphics, pen, x, y, width, height))
+		return Ok;
+
 	make_pie (graphics, x, y, width, height, startAngle, sweepAngle, TRUE);
 	return stroke_graphics_with_pen (graphics, pen);
 }
@@ -727,6 +937,9 @@ GpStatus
 cairo_FillPie (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height, 
 	float startAngle, float sweepAngle)
 {
+	if (gdip_is_culled (graphics, NULL, x, y, width, height))
+		return Ok;
+
 	make_pie (graphics, x, y, width, height, startAngle, sweepAngle, FALSE);
 	return fill_graphics_with_brush (graphics, brush, FALSE);
 }
@@ -782,6 +995,12 @@ make_polygon_from_integers (GpGraphics *graphics, GDIPCONST GpPoint *points, int
 GpStatus
 cairo_DrawPolygon (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, int count)
 {
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_points (graphics, &cull, points, count))
+		return Ok;
+
 	make_polygon (graphics, points, count, TRUE);
 	return stroke_graphics_with_pen (graphics, pen);
 }
@@ -789,6 +1008,12 @@ cairo_DrawPolygon (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points,
 GpStatus
 cairo_DrawPolygonI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, int count)
 {
+	CullContext cull;
+
+	gdip_cull_init (graphics, pen, &cull);
+	if (gdip_cull_pointsI (graphics, &cull, points, count))
+		return Ok;
+
 	make_polygon_from_integers (graphics, points, count, TRUE);
 	return stroke_graphics_with_pen (graphics, pen);
 }
@@ -796,6 +1021,12 @@ cairo_DrawPolygonI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points,
 GpStatus
 cairo_FillPolygon (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *points, int count, FillMode fillMode)
 {
+	CullContext cull;
+
+	gdip_cull_init (graphics, NULL, &cull);
+	if (gdip_cull_points (graphics, &cull, points, count))
+		return Ok;
+
 	make_polygon (graphics, points, count, FALSE);
 	cairo_set_fill_rule (graphics->ct, gdip_convert_fill_mode (fillMode));
 	return fill_graphics_with_brush (graphics, brush, FALSE);
@@ -804,6 +1035,12 @@ cairo_FillPolygon (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *poi
 GpStatus
 cairo_FillPolygonI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *points, int count, FillMode fillMode)
 {
+	CullContext cull;
+
+	gdip_cull_init (graphics, NULL, &cull);
+	if (gdip_cull_pointsI (graphics, &cull, points, count))
+		return Ok;
+
 	make_polygon_from_integers (graphics, points, count, FALSE);
 	cairo_set_fill_rule (graphics->ct, gdip_convert_fill_mode (fillMode));
 	return fill_graphics_with_brush (graphics, brush, FALSE);
@@ -821,6 +1058,9 @@ cairo_DrawRectangle (GpGraphics *graphics, GpPen *pen, float x, float y, float w
 		x -= 1.0f;
 		y -= 1.0f;
 	}
+	if (gdip_is_culled (graphics, pen, x, y, width, height))
+		return Ok;
+
 	gdip_cairo_rectangle (graphics, x, y, width, height, TRUE);
 	return stroke_graphics_with_pen (graphics, pen);
 }
@@ -828,6 +1068,9 @@ cairo_DrawRectangle (GpGraphics *graphics, GpPen *pen, float x, float y, float w
 GpStatus 
 cairo_FillRectangle (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height)
 {
+	if (gdip_is_culled (graphics, NULL, x, y, width, height))
+		return Ok;
+
 	gdip_cairo_rectangle (graphics, x, y, width, height, FALSE);
 	return fill_graphics_with_brush (graphics, brush, FALSE);
 }
@@ -837,8 +1080,11 @@ cairo_DrawRectangles (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRectF *rects
 {
 	BOOL draw = FALSE;
 	BOOL adjust = gdip_cairo_pen_width_needs_adjustment (pen);
+	CullContext cull;
 	int i;
 
+	gdip_cull_init (graphics, pen, &cull);
+
 	for (i = 0; i < count; i++) {
 		float x = rects [i].X;
 		float y = rects [i].Y;
@@ -855,6 +1101,9 @@ cairo_DrawRectangles (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRectF *rects
 			y -= 1.0f;
 		}
 
+		if (gdip_cull_rect (graphics, &cull, x, y, x + w, y + h))
+			continue;
+
 		gdip_cairo_rectangle (graphics, x, y, w, h, TRUE);
 		draw = TRUE;
 	}
@@ -870,8 +1119,11 @@ cairo_DrawRectanglesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRect *rects
 {
 	BOOL draw = FALSE;
 	BOOL adjust = gdip_cairo_pen_width_needs_adjustment (pen);
+	CullContext cull;
 	int i;
 
+	gdip_cull_init (graphics, pen, &cull);
+
 	for (i = 0; i < count; i++) {
 		int x = rects [i].X;
 		int y = rects [i].Y;
@@ -888,6 +1140,9 @@ cairo_DrawRectanglesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRect *rects
 			y -= 1;
 		}
 
+		if (gdip_cull_rect (graphics, &cull, x, y, x + w, y + h))
+			continue;
+
 		gdip_cairo_rectangle (graphics, x, y, w, h, TRUE);
 		draw = TRUE;
 	}
@@ -902,8 +1157,11 @@ GpStatus
 cairo_FillRectangles (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rects, int count)
 {
 	BOOL draw = FALSE;
+	CullContext cull;
 	int i;
 
+	gdip_cull_init (graphics, NULL, &cull);
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We
 	 * should have it set already.
 	 */
@@ -911,6 +1169,9 @@ cairo_FillRectangles (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *r
 		/* don't draw/fill rectangles with negative width/height (bug #77129) */
 		if ((rects [i].Width < 0) || (rects [i].Height < 0))
 			continue;
+		if (gdip_cull_rect (graphics, &cull, rects [i].X, rects [i].Y, (double) rects [i].X + rects [i].Width,
+			(double) rects [i].Y + rects [i].Height))
+			continue;
 
 		gdip_cairo_rectangle (graphics, rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height, FALSE);
 		draw = TRUE;
@@ -927,8 +1188,11 @@ GpStatus
 cairo_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect *rects, int count)
 {
 	BOOL draw = FALSE;
+	CullContext cull;
 	int i;
 
+	gdip_cull_init (graphics, NULL, &cull);
+
 	/* We use graphics->copy_of_ctm matrix for path creation. We
 	 * should have it set already.
 	 */
@@ -936,6 +1200,9 @@ cairo_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect *r
 		/* don't draw/fill rectangles with negative width/height (bug #77129) */
 		if ((rects [i].Width < 0) || (rects [i].Height < 0))
 			continue;
+		if (gdip_cull_rect (graphics, &cull, rects [i].X, rects [i].Y, (double) rects [i].X + rects [i].Width,
+			(double) rects [i].Y + rects [i].Height))
+			continue;
 
 		gdip_cairo_rectangle (graphics, rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height, FALSE);
 		draw = TRUE;
@@ -957,8 +1224,9 @@ cairo_FillRegion (GpGraphics *graphics, GpBrush *brush, GpRegion *region)
 {
 	/* if this is a region with a complex path */
 	if (region->type == RegionTypePath) {
-		GpStatus status;
-		GpBitmap *bitmap = NULL;
+		GpRegionBitmap *bitmap;
+		cairo_surface_t *mask;
+		int i, j;
 
 		/* (optimization) if if the path is empty, return immediately */
 		if (!region->tree)
@@ -978,27 +1246,46 @@ cairo_FillRegion (GpGraphics *graphics, GpBrush *brush, GpRegion *region)
 		if (!region->bitmap)
 			return OutOfMemory;
 
-		status = GdipCreateBitmapFromGraphics (region->bitmap->Width, region->bitmap->Height, graphics, &bitmap);
-		if (status == Ok) {
-			GpGraphics *bitgraph = NULL;
-			status = GdipGetImageGraphicsContext ((GpImage*)bitmap, &bitgraph);
-			if (status == Ok) {
-				/* fill the "full" rectangle using the specified brush */
-				cairo_FillRectangle (bitgraph, brush, 0, 0, region->bitmap->Width, region->bitmap->Height);
-
-				/* adjust bitmap alpha (i.e. shape the brushed-rectangle like the region) */
-				gdip_region_bitmap_apply_alpha (bitmap, region->bitmap);
-
-				/* draw the region */
-				status = GdipDrawImageRect (graphics, (GpImage*)bitmap, region->bitmap->X, region->bitmap->Y,
-					region->bitmap->Width, region->bitmap->Height);
+		bitmap = region->bitmap;
+		if (bitmap->BandCount == 0)
+			return Ok;
+
+		/* fill the brush through the region bitmap (a cairo A1 surface, kept with the region) */
+		mask = gdip_region_bitmap_get_surface (bitmap);
+		if (mask) {
+			double x = bitmap->X, y = bitmap->Y, scale_x = 1.0, scale_y = 1.0;
+
+			if (!OPTIMIZE_CONVERSION (graphics)) {
+				x = gdip_unitx_convgr (graphics, x);
+				y = gdip_unity_convgr (graphics, y);
+				scale_x = gdip_unitx_convgr (graphics, 1);
+				scale_y = gdip_unity_convgr (graphics, 1);
+			}
+
+			/* We do brush setup just before filling. */
+			gdip_brush_setup (graphics, brush);
+			cairo_set_matrix (graphics->ct, graphics->copy_of_ctm);
+
+			cairo_translate (graphics->ct, x, y);
+			cairo_scale (graphics->ct, scale_x, scale_y);
+			cairo_mask_surface (graphics->ct, mask, 0, 0);
+
+			cairo_set_matrix (graphics->ct, graphics->copy_of_ctm);
+			return gdip_get_status (cairo_status (graphics->ct));
+		}
+
+		/* too large for a mask: the spans are filled as a single path of boxes, so the memory doesn't depend on the area */
+
+		for (i = 0; i < bitmap->BandCount; i++) {
+			GpRegionBand *band = &bitmap->Bands [i];
+
+			for (j = band->First; j < band [1].First; j++) {
+				gdip_cairo_rectangle (graphics, bitmap->X + bitmap->Spans [j].X1, bitmap->Y + band->Y,
+					bitmap->Spans [j].X2 - bitmap->Spans [j].X1, band->Height, FALSE);
 			}
-			if (bitgraph)
-				GdipDeleteGraphics (bitgraph);
 		}
-		if (bitmap)
-			GdipDisposeImage ((GpImage*)bitmap);
-		return status;
+
+		return fill_graphics_with_brush (graphics, brush, FALSE);
 	}
 
 	/* if there's no rectangles, we can return directly */
@@ -1078,18 +1365,98 @@ cairo_SetSmoothingMode (GpGraphics *graphics, SmoothingMode mode)
 	best thing for now is keep track of what the user wants and let Cairo do its autoclipping
 */
 
+/*
+ * Return TRUE if the graphics clip is a single rectangle covering whole device pixels, and that rectangle (in
+ * device space). cairo clips such a box without any path or mask.
+ */
+static BOOL
+gdip_get_device_clip_rect (GpGraphics *graphics, GpRect *rect)
+{
+	GpRegion *clip = graphics->clip;
+	cairo_matrix_t ctm;
+	double x1, y1, x2, y2;
+
+	if ((clip->type != RegionTypeRect) || (clip->cnt != 1))
+		return FALSE;
+
+	/* rotated or skewed rectangles aren't rectangles on the device */
+	cairo_get_matrix (graphics->ct, &ctm);
+	if ((ctm.xy != 0) || (ctm.yx != 0) || (graphics->clip_matrix->xy != 0) || (graphics->clip_matrix->yx != 0))
+		return FALSE;
+
+	x1 = clip->rects->X;
+	y1 = clip->rects->Y;
+	x2 = clip->rects->X + clip->rects->Width;
+	y2 = clip->rects->Y + clip->rects->Height;
+	cairo_matrix_transform_point (graphics->clip_matrix, &x1, &y1);
+	cairo_matrix_transform_point (graphics->clip_matrix, &x2, &y2);
+
+	if (!OPTIMIZE_CONVERSION (graphics)) {
+		x1 = gdip_unitx_convgr (graphics, x1);
+		y1 = gdip_unity_convgr (graphics, y1);
+		x2 = gdip_unitx_convgr (graphics, x2);
+		y2 = gdip_unity_convgr (graphics, y2);
+	}
+
+	/* the path would have been limited */
+	if ((x1 != CAIRO_LIMIT (x1)) || (y1 != CAIRO_LIMIT (y1)) || (x2 != CAIRO_LIMIT (x2)) || (y2 != CAIRO_LIMIT (y2)))
+		return FALSE;
+
+	cairo_user_to_device (graphics->ct, &x1, &y1);
+	cairo_user_to_device (graphics->ct, &x2, &y2);
+	if ((x1 != floor (x1)) || (y1 != floor (y1)) || (x2 != floor (x2)) || (y2 != floor (y2)))
+		return FALSE;
+	if ((fabs (x1) > GDIP_MAX_COORD) || (fabs (y1) > GDIP_MAX_COORD) || (fabs (x2) > GDIP_MAX_COORD) || (fabs (y2) > GDIP_MAX_COORD))
+		return FALSE;
+
+	rect->X = (int) MIN (x1, x2);
+	rect->Y = (int) MIN (y1, y2);
+	rect->Width = (int) fabs (x2 - x1);
+	rect->Height = (int) fabs (y2 - y1);
+	return TRUE;
+}
+
 GpStatus
 cairo_SetGraphicsClip (GpGraphics *graphics)
 {
 	GpRegion *work;
 	GpRectF* rect;
+	cairo_matrix_t ctm;
 	int i;
 
 	cairo_reset_clip (graphics->ct);
+	graphics->clip_is_rect = FALSE;
  
 	if (gdip_is_InfiniteRegion (graphics->clip))
 		return Ok;
 
+	cairo_get_matrix (graphics->ct, &ctm);
+
+	/* (optimization) pixel aligned rectangles are clipped as boxes, in device space */
+	if (gdip_get_device_clip_rect (graphics, &graphics->clip_rect)) {
+		graphics->clip_is_rect = TRUE;
+		cairo_identity_matrix (graphics->ct);
+		cairo_new_path (graphics->ct);
+		cairo_rectangle (graphics->ct, graphics->clip_rect.X, graphics->clip_rect.Y,
+			graphics->clip_rect.Width, graphics->clip_rect.Height);
+		cairo_clip (graphics->ct);
+		cairo_set_matrix (graphics->ct, &ctm);
+		return Ok;
+	}
+
+	/* the clip path, in device space, only changes with the clip, its matrix and the units */
+	if (graphics->clip_path && (graphics->clip_path_generation == graphics->clip_generation) &&
+		gdip_cairo_matrix_equal (&graphics->clip_path_matrix, graphics->clip_matrix) &&
+		gdip_cairo_matrix_equal (&graphics->clip_path_ctm, &ctm) &&
+		(graphics->clip_path_unit == graphics->page_unit) && (graphics->clip_path_scale == graphics->scale)) {
+		cairo_identity_matrix (graphics->ct);
+		cairo_new_path (graphics->ct);
+		cairo_append_path (graphics->ct, graphics->clip_path);
+		cairo_clip (graphics->ct);
+		cairo_set_matrix (graphics->ct, &ctm);
+		return Ok;
+	}
+
 	if (gdip_is_matrix_empty (graphics->clip_matrix)) {
 		work = graphics->clip;
 	} else {
@@ -1097,6 +1464,7 @@ cairo_SetGraphicsClip (GpGraphics *graphics)
 		GdipTransformRegion (work, graphics->clip_matrix);
 	}
 
+	cairo_new_path (graphics->ct);
 	switch (work->type) {
 	case RegionTypeRect:
 		for (i = 0, rect = work->rects; i < work->cnt; i++, rect++) {
@@ -1126,6 +1494,23 @@ cairo_SetGraphicsClip (GpGraphics *graphics)
 		g_warning ("Unknown region type %d", work->type);
 		break;
 	}
+
+	/* keep the path, in device space, for the next calls */
+	if (graphics->clip_path)
+		cairo_path_destroy (graphics->clip_path);
+	cairo_identity_matrix (graphics->ct);
+	graphics->clip_path = cairo_copy_path (graphics->ct);
+	cairo_set_matrix (graphics->ct, &ctm);
+	if (graphics->clip_path->status == CAIRO_STATUS_SUCCESS) {
+		graphics->clip_path_generation = graphics->clip_generation;
+		gdip_cairo_matrix_copy (&graphics->clip_path_matrix, graphics->clip_matrix);
+		graphics->clip_path_ctm = ctm;
+		graphics->clip_path_unit = graphics->page_unit;
+		graphics->clip_path_scale = graphics->scale;
+	} else {
+		cairo_path_destroy (graphics->clip_path);
+		graphics->clip_path = NULL;
+	}
 	
 	cairo_clip (graphics->ct);
 
@@ -1140,6 +1525,7 @@ GpStatus
 cairo_ResetClip (GpGraphics *graphics)
 {
 	cairo_reset_clip (graphics->ct);
+	graphics->clip_is_rect = FALSE;
 	return gdip_get_status (cairo_status (graphics->ct));
 }
 
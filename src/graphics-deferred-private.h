@@ -0,0 +1,48 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Deferred graphics backend, solid fills are queued and drawn together
+ */
+
+#ifndef __GRAPHICS_DEFERRED_PRIVATE_H__
+#define __GRAPHICS_DEFERRED_PRIVATE_H__
+
+#include "gdiplus-private.h"
+#include "graphics-private.h"
+
+typedef enum {
+	DeferredFillRectangle,
+	DeferredFillEllipse
+} DeferredCommandType;
+
+typedef struct {
+	DeferredCommandType	type;
+	ARGB			color;
+	GpRectF			rect;	/* world coordinates, drawn with the state current at the flush */
+	BOOL			hidden;	/* fully overdrawn by a later fill */
+} DeferredCommand;
+
+GpStatus deferred_FillEllipse (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height) GDIP_INTERNAL;
+GpStatus deferred_FillEllipseI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height) GDIP_INTERNAL;
+GpStatus deferred_FillRectangle (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height) GDIP_INTERNAL;
+GpStatus deferred_FillRectangleI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height) GDIP_INTERNAL;
+GpStatus deferred_FillRectangles (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rects, int count) GDIP_INTERNAL;
+GpStatus deferred_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect *rects, int count) GDIP_INTERNAL;
+
+GpStatus gdip_deferred_flush (GpGraphics *graphics) GDIP_INTERNAL;
+void gdip_deferred_free (GpGraphics *graphics) GDIP_INTERNAL;
+
+#endif
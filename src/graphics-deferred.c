@@ -0,0 +1,328 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Deferred graphics backend, solid fills are queued and drawn together
+ */
+
+#include "graphics-deferred-private.h"
+#include "graphics-cairo-private.h"
+#include "solidbrush-private.h"
+#include "general-private.h"
+
+/*
+ * The deferred backend is the cairo backend where rectangles and ellipses filled with a solid brush are queued
+ * instead of being drawn. Every other drawing call, state change (transform, clip, modes...) and GdipFlush,
+ * GdipGetDC or GdipDeleteGraphics draws the queued fills first, so they are drawn with the state current
+ * when they were queued.
+ *
+ * When the fills are drawn:
+ * - the fills entirely covered by a later opaque rectangle are dropped;
+ * - consecutive opaque fills, of the same color and shape, are filled as a single cairo path;
+ * - the brush is only setup when the color changes.
+ */
+
+/* the queued fills are drawn once there are that many */
+#define DEFERRED_MAX_COMMANDS	16384
+
+#define DEFERRED_IS_OPAQUE(color)	(((color) & 0xFF000000) == 0xFF000000)
+
+static GpStatus
+gdip_deferred_queue (GpGraphics *graphics, DeferredCommandType type, ARGB color, float x, float y, float width, float height)
+{
+	DeferredCommand command;
+
+	/* nothing to draw */
+	if ((width == 0) || (height == 0))
+		return Ok;
+	if (((color & 0xFF000000) == 0) && (graphics->composite_mode == CompositingModeSourceOver))
+		return Ok;
+
+	/* the same area is filled whatever the direction but, once merged, all ellipses must turn the same way */
+	if (width < 0) {
+		x += width;
+		width = -width;
+	}
+	if (height < 0) {
+		y += height;
+		height = -height;
+	}
+
+	if (!graphics->deferred)
+		graphics->deferred = g_array_new (FALSE, FALSE, sizeof (DeferredCommand));
+
+	command.type = type;
+	command.color = color;
+	command.rect.X = x;
+	command.rect.Y = y;
+	command.rect.Width = width;
+	command.rect.Height = height;
+	command.hidden = FALSE;
+	g_array_append_val (graphics->deferred, command);
+
+	if (graphics->deferred->len >= DEFERRED_MAX_COMMANDS)
+		return gdip_deferred_flush (graphics);
+	return Ok;
+}
+
+GpStatus
+deferred_FillEllipse (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height)
+{
+	GpStatus status;
+
+	if (brush->vtable->type != BrushTypeSolidColor) {
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		return cairo_FillEllipse (graphics, brush, x, y, width, height);
+	}
+
+	return gdip_deferred_queue (graphics, DeferredFillEllipse, ((GpSolidFill*) brush)->color, x, y, width, height);
+}
+
+GpStatus
+deferred_FillEllipseI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height)
+{
+	return deferred_FillEllipse (graphics, brush, x, y, width, height);
+}
+
+GpStatus
+deferred_FillRectangle (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height)
+{
+	GpStatus status;
+
+	if (brush->vtable->type != BrushTypeSolidColor) {
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		return cairo_FillRectangle (graphics, brush, x, y, width, height);
+	}
+
+	return gdip_deferred_queue (graphics, DeferredFillRectangle, ((GpSolidFill*) brush)->color, x, y, width, height);
+}
+
+GpStatus
+deferred_FillRectangleI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height)
+{
+	return deferred_FillRectangle (graphics, brush, x, y, width, height);
+}
+
+GpStatus
+deferred_FillRectangles (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rects, int count)
+{
+	GpStatus status = Ok;
+	int i;
+
+	if (brush->vtable->type != BrushTypeSolidColor) {
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		return cairo_FillRectangles (graphics, brush, rects, count);
+	}
+
+	for (i = 0; (i < count) && (status == Ok); i++) {
+		/* don't draw/fill rectangles with negative width/height (bug #77129) */
+		if ((rects [i].Width < 0) || (rects [i].Height < 0))
+			continue;
+
+		status = gdip_deferred_queue (graphics, DeferredFillRectangle, ((GpSolidFill*) brush)->color,
+			rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height);
+	}
+	return status;
+}
+
+GpStatus
+deferred_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect *rects, int count)
+{
+	GpStatus status = Ok;
+	int i;
+
+	if (brush->vtable->type != BrushTypeSolidColor) {
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		return cairo_FillRectanglesI (graphics, brush, rects, count);
+	}
+
+	for (i = 0; (i < count) && (status == Ok); i++) {
+		/* don't draw/fill rectangles with negative width/height (bug #77129) */
+		if ((rects [i].Width < 0) || (rects [i].Height < 0))
+			continue;
+
+		status = gdip_deferred_queue (graphics, DeferredFillRectangle, ((GpSolidFill*) brush)->color,
+			rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height);
+	}
+	return status;
+}
+
+/* device bounds of a queued fill, using the same unit conversion as gdip_cairo_rectangle */
+static void
+gdip_deferred_get_device_bounds (GpGraphics *graphics, GpRectF *rect, double *x1, double *y1, double *x2, double *y2)
+{
+	double left = rect->X;
+	double top = rect->Y;
+	double right = rect->X + rect->Width;
+	double bottom = rect->Y + rect->Height;
+
+	if (!OPTIMIZE_CONVERSION (graphics)) {
+		left = gdip_unitx_convgr (graphics, left);
+		top = gdip_unity_convgr (graphics, top);
+		right = gdip_unitx_convgr (graphics, right);
+		bottom = gdip_unity_convgr (graphics, bottom);
+	}
+
+	cairo_user_to_device (graphics->ct, &left, &top);
+	cairo_user_to_device (graphics->ct, &right, &bottom);
+	*x1 = min (left, right);
+	*y1 = min (top, bottom);
+	*x2 = max (left, right);
+	*y2 = max (top, bottom);
+}
+
+/*
+ * Walking back from the last fill, the largest opaque rectangle seen so far hides the earlier fills it contains.
+ * Its (antialiased) edges are blended with what's under them so only its inside, one pixel in, is used.
+ */
+static void
+gdip_deferred_hide_overdrawn (GpGraphics *graphics)
+{
+	GArray *commands = graphics->deferred;
+	double cover_x1 = 0, cover_y1 = 0, cover_x2 = 0, cover_y2 = 0;
+	double cover_area = 0;
+	cairo_matrix_t matrix;
+	int i;
+
+	/* rotated or skewed rectangles aren't rectangles on the device */
+	cairo_get_matrix (graphics->ct, &matrix);
+	if ((matrix.xy != 0) || (matrix.yx != 0))
+		return;
+
+	for (i = commands->len - 1; i >= 0; i--) {
+		DeferredCommand *command = &g_array_index (commands, DeferredCommand, i);
+		double x1, y1, x2, y2;
+
+		gdip_deferred_get_device_bounds (graphics, &command->rect, &x1, &y1, &x2, &y2);
+		if ((cover_area > 0) && (x1 >= cover_x1) && (y1 >= cover_y1) && (x2 <= cover_x2) && (y2 <= cover_y2)) {
+			command->hidden = TRUE;
+			continue;
+		}
+
+		if ((command->type != DeferredFillRectangle) || !DEFERRED_IS_OPAQUE (command->color))
+			continue;
+
+		x1 += 1;
+		y1 += 1;
+		x2 -= 1;
+		y2 -= 1;
+		if ((x2 > x1) && (y2 > y1) && ((x2 - x1) * (y2 - y1) > cover_area)) {
+			cover_x1 = x1;
+			cover_y1 = y1;
+			cover_x2 = x2;
+			cover_y2 = y2;
+			cover_area = (x2 - x1) * (y2 - y1);
+		}
+	}
+}
+
+GpStatus
+gdip_deferred_flush (GpGraphics *graphics)
+{
+	GArray *commands = graphics->deferred;
+	cairo_fill_rule_t fill_rule;
+	GpStatus status = Ok;
+	GpRectF *rects;
+	BOOL has_color = FALSE;
+	ARGB color = 0;
+	int i, j, count;
+
+	if ((graphics->backend != GraphicsBackEndDeferred) || !commands || (commands->len == 0))
+		return Ok;
+
+	if (!graphics->deferred_brush) {
+		status = GdipCreateSolidFill (0, &graphics->deferred_brush);
+		if (status != Ok)
+			goto cleanup;
+	}
+
+	rects = (GpRectF*) GdipAlloc (commands->len * sizeof (GpRectF));
+	if (!rects) {
+		status = OutOfMemory;
+		goto cleanup;
+	}
+
+	gdip_deferred_hide_overdrawn (graphics);
+
+	/* overlapping shapes of a merged path must not cancel each other */
+	fill_rule = cairo_get_fill_rule (graphics->ct);
+	cairo_set_fill_rule (graphics->ct, CAIRO_FILL_RULE_WINDING);
+
+	i = 0;
+	while ((i < commands->len) && (status == Ok)) {
+		DeferredCommand *first = &g_array_index (commands, DeferredCommand, i);
+
+		if (first->hidden) {
+			i++;
+			continue;
+		}
+
+		/* translucent fills are blended one by one */
+		count = 0;
+		for (j = i; j < commands->len; j++) {
+			DeferredCommand *command = &g_array_index (commands, DeferredCommand, j);
+
+			if (command->hidden)
+				continue;
+			if ((count > 0) && (!DEFERRED_IS_OPAQUE (first->color) || (command->type != first->type) ||
+				(command->color != first->color)))
+				break;
+			rects [count++] = command->rect;
+		}
+
+		if (!has_color || (first->color != color)) {
+			GdipSetSolidFillColor (graphics->deferred_brush, first->color);
+			color = first->color;
+			has_color = TRUE;
+		}
+
+		if (first->type == DeferredFillEllipse)
+			status = cairo_FillEllipses (graphics, (GpBrush*) graphics->deferred_brush, rects, count);
+		else
+			status = cairo_FillRectangles (graphics, (GpBrush*) graphics->deferred_brush, rects, count);
+		i = j;
+	}
+
+	cairo_set_fill_rule (graphics->ct, fill_rule);
+	GdipFree (rects);
+
+cleanup:
+	g_array_set_size (commands, 0);
+	return status;
+}
+
+void
+gdip_deferred_free (GpGraphics *graphics)
+{
+	if (graphics->deferred) {
+		g_array_free (graphics->deferred, TRUE);
+		graphics->deferred = NULL;
+	}
+
+	if (graphics->deferred_brush) {
+		if (graphics->last_brush == (GpBrush*) graphics->deferred_brush)
+			graphics->last_brush = NULL;
+		GdipDeleteBrush ((GpBrush*) graphics->deferred_brush);
+		graphics->deferred_brush = NULL;
+	}
+}
@@ -21,18 +21,72 @@
  */
 
 #include "graphics-metafile-private.h"
+#include "graphics-private.h"
+#include "graphics-path-private.h"
+#include "metafile-private.h"
+#include "pen-private.h"
+#include "region-private.h"
+#include "solidbrush-private.h"
+#include "hatchbrush-private.h"
+#include "lineargradientbrush-private.h"
+#include "pathgradientbrush-private.h"
+#include "texturebrush-private.h"
 
 /*
  * NOTE: all parameter's validations are done inside graphics.c
+ *
+ * Every call is recorded as an EMF+ record into the metafile's recorder. Pens, brushes (other than
+ * solid ones), paths and regions are recorded as objects. An object is only recorded again if its
+ * serialized content differs from the ones already in the (64 entries) object table.
  */
 
 #define FIT_IN_INT16(x)		(((x) >= G_MININT16) && ((x) <= G_MAXINT16))
 
 #define EMFPLUS_FLAGS_USE_SINGLE	0x0000
 #define EMFPLUS_FLAGS_FILLMODE_WINDING	0x2000
+#define EMFPLUS_FLAGS_CLOSED_SHAPE	0x2000
+#define EMFPLUS_FLAGS_APPEND_ORDER	0x2000
 #define EMFPLUS_FLAGS_USE_INT16		0x4000
 #define EMFPLUS_FLAGS_USE_ARGB		0x8000
 
+#define EMFPLUS_HEADER_DUAL		0x0001
+#define EMFPLUS_HEADER_VIDEO_DISPLAY	0x00000001
+
+/* version of the GDI+ graphics engine, written in the header and in every object */
+#define EMFPLUS_VERSION			0xDBC01002
+
+#define EMFPLUS_RECORD_HEADER_SIZE	12
+
+/* optional brush data */
+#define EMFPLUS_BRUSH_PATH		0x0001
+#define EMFPLUS_BRUSH_TRANSFORM		0x0002
+#define EMFPLUS_BRUSH_PRESET_COLORS	0x0004
+#define EMFPLUS_BRUSH_BLEND_FACTORS_H	0x0008
+#define EMFPLUS_BRUSH_FOCUS_SCALES	0x0040
+#define EMFPLUS_BRUSH_GAMMA_CORRECTED	0x0080
+
+/* images embedded in texture brushes */
+#define EMFPLUS_IMAGE_BITMAP		1
+#define EMFPLUS_BITMAP_PIXELS		0
+
+/* optional pen data, serialized in this order */
+#define EMFPLUS_PEN_TRANSFORM		0x0001
+#define EMFPLUS_PEN_START_CAP		0x0002
+#define EMFPLUS_PEN_END_CAP		0x0004
+#define EMFPLUS_PEN_JOIN		0x0008
+#define EMFPLUS_PEN_MITER_LIMIT		0x0010
+#define EMFPLUS_PEN_LINE_STYLE		0x0020
+#define EMFPLUS_PEN_DASHED_LINE_OFFSET	0x0080
+#define EMFPLUS_PEN_DASHED_LINE		0x0100
+#define EMFPLUS_PEN_NON_CENTER		0x0200
+#define EMFPLUS_PEN_COMPOUND_LINE	0x0400
+
+/* region nodes */
+#define EMFPLUS_REGION_NODE_OR		0x00000002
+#define EMFPLUS_REGION_NODE_RECT	0x10000000
+#define EMFPLUS_REGION_NODE_EMPTY	0x10000002
+#define EMFPLUS_REGION_NODE_INFINITE	0x10000003
+
 static BOOL
 RectFitInInt16 (int x, int y, int width, int height)
 {
@@ -57,6 +111,17 @@ GpRectArrayFitInInt16 (GDIPCONST GpRect *rects, int count)
 	return TRUE;
 }
 
+static BOOL
+GpPointArrayFitInInt16 (GDIPCONST GpPoint *points, int count)
+{
+	int i;
+	for (i = 0; i < count; i++) {
+		if (!FIT_IN_INT16(points [i].X) || !FIT_IN_INT16(points [i].Y))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 static GpRectF *
 convert_rects (GDIPCONST GpRect *rects, int count)
 {
@@ -75,14 +140,698 @@ convert_rects (GDIPCONST GpRect *rects, int count)
 	return result;
 }
 
+/* buffer writers - once an allocation fails the buffer is marked as failed and everything else is ignored */
+
+static BOOL
+emfplus_buffer_reserve (EmfPlusBuffer *buffer, int size)
+{
+	BYTE *data;
+	int capacity;
+
+	if (buffer->failed)
+		return FALSE;
+	if (buffer->size + size <= buffer->capacity)
+		return TRUE;
+
+	/* records are only appended, so grow geometrically */
+	capacity = max (max (buffer->capacity * 2, buffer->size + size), 256);
+	data = (BYTE*) gdip_realloc (buffer->data, capacity);
+	if (!data) {
+		buffer->failed = TRUE;
+		return FALSE;
+	}
+
+	buffer->data = data;
+	buffer->capacity = capacity;
+	return TRUE;
+}
+
+static void
+emfplus_write_bytes (EmfPlusBuffer *buffer, const void *bytes, int size)
+{
+	if (!emfplus_buffer_reserve (buffer, size))
+		return;
+
+	memcpy (buffer->data + buffer->size, bytes, size);
+	buffer->size += size;
+}
+
+static void
+emfplus_write_dword (EmfPlusBuffer *buffer, DWORD value)
+{
+	value = GUINT32_TO_LE (value);
+	emfplus_write_bytes (buffer, &value, sizeof (DWORD));
+}
+
+static void
+emfplus_write_float (EmfPlusBuffer *buffer, float value)
+{
+	union {
+		float f;
+		DWORD dw;
+	} u;
+
+	u.f = value;
+	emfplus_write_dword (buffer, u.dw);
+}
+
+/* two INT16 packed in a DWORD, e.g. the X and Y of a compressed point */
+static void
+emfplus_write_int16 (EmfPlusBuffer *buffer, int low, int high)
+{
+	emfplus_write_dword (buffer, (DWORD)(WORD) low | ((DWORD)(WORD) high << 16));
+}
+
+static void
+emfplus_write_padding (EmfPlusBuffer *buffer)
+{
+	static const BYTE zero [3] = { 0, 0, 0 };
+
+	if (buffer->size & 3)
+		emfplus_write_bytes (buffer, zero, 4 - (buffer->size & 3));
+}
+
+static void
+emfplus_write_rectf (EmfPlusBuffer *buffer, float x, float y, float width, float height)
+{
+	emfplus_write_float (buffer, x);
+	emfplus_write_float (buffer, y);
+	emfplus_write_float (buffer, width);
+	emfplus_write_float (buffer, height);
+}
+
+static void
+emfplus_write_rect (EmfPlusBuffer *buffer, int x, int y, int width, int height)
+{
+	emfplus_write_int16 (buffer, x, y);
+	emfplus_write_int16 (buffer, width, height);
+}
+
+static void
+emfplus_write_pointsf (EmfPlusBuffer *buffer, GDIPCONST GpPointF *points, int count)
+{
+	int i;
+	for (i = 0; i < count; i++) {
+		emfplus_write_float (buffer, points [i].X);
+		emfplus_write_float (buffer, points [i].Y);
+	}
+}
+
+static void
+emfplus_write_points (EmfPlusBuffer *buffer, GDIPCONST GpPoint *points, int count)
+{
+	int i;
+	for (i = 0; i < count; i++)
+		emfplus_write_int16 (buffer, points [i].X, points [i].Y);
+}
+
+static void
+emfplus_write_matrix (EmfPlusBuffer *buffer, GpMatrix *matrix)
+{
+	emfplus_write_float (buffer, matrix->xx);
+	emfplus_write_float (buffer, matrix->yx);
+	emfplus_write_float (buffer, matrix->xy);
+	emfplus_write_float (buffer, matrix->yy);
+	emfplus_write_float (buffer, matrix->x0);
+	emfplus_write_float (buffer, matrix->y0);
+}
+
+/* records - the Size and DataSize fields are filled once the record is complete */
+
+static EmfPlusBuffer*
+emfplus_record_begin (MetafileRecorder *recorder, EmfPlusRecordType type, WORD flags)
+{
+	EmfPlusBuffer *buffer = &recorder->records;
+
+	recorder->record_start = buffer->size;
+	emfplus_write_dword (buffer, (DWORD) type | ((DWORD) flags << 16));
+	emfplus_write_dword (buffer, 0);
+	emfplus_write_dword (buffer, 0);
+	return buffer;
+}
+
+static GpStatus
+emfplus_record_end (MetafileRecorder *recorder)
+{
+	EmfPlusBuffer *buffer = &recorder->records;
+	DWORD *header;
+	DWORD size;
+
+	emfplus_write_padding (buffer);
+	if (buffer->failed)
+		return OutOfMemory;
+
+	header = (DWORD*) (buffer->data + recorder->record_start);
+	size = buffer->size - recorder->record_start;
+	header [1] = GUINT32_TO_LE (size);
+	header [2] = GUINT32_TO_LE (size - EMFPLUS_RECORD_HEADER_SIZE);
+	return Ok;
+}
+
+MetafileRecorder*
+gdip_metafile_recorder_new (EmfType type, GDIPCONST GpRectF *frame, MetafileFrameUnit frameUnit)
+{
+	MetafileRecorder *recorder = (MetafileRecorder*) GdipAlloc (sizeof (MetafileRecorder));
+	EmfPlusBuffer *buffer;
+	float dpi = gdip_get_display_dpi ();
+
+	if (!recorder)
+		return NULL;
+
+	memset (recorder, 0, sizeof (MetafileRecorder));
+	recorder->frame = *frame;
+	recorder->frame_unit = frameUnit;
+
+	/* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/Header.html */
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeHeader, (type == EmfTypeEmfPlusDual) ? EMFPLUS_HEADER_DUAL : 0);
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, EMFPLUS_HEADER_VIDEO_DISPLAY);
+	emfplus_write_dword (buffer, dpi);
+	emfplus_write_dword (buffer, dpi);
+	if (emfplus_record_end (recorder) != Ok) {
+		gdip_metafile_recorder_free (recorder);
+		return NULL;
+	}
+
+	return recorder;
+}
+
+void
+gdip_metafile_recorder_free (MetafileRecorder *recorder)
+{
+	int i;
+
+	for (i = 0; i < EMFPLUS_MAX_OBJECTS; i++) {
+		if (recorder->objects [i].data)
+			GdipFree (recorder->objects [i].data);
+	}
+	if (recorder->object.data)
+		GdipFree (recorder->object.data);
+	if (recorder->records.data)
+		GdipFree (recorder->records.data);
+	GdipFree (recorder);
+}
+
+/* http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/EndOfFile.html */
+GpStatus
+gdip_metafile_recorder_end (MetafileRecorder *recorder)
+{
+	emfplus_record_begin (recorder, EmfPlusRecordTypeEndOfFile, 0);
+	return emfplus_record_end (recorder);
+}
+
+/* objects - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/Object.html */
+
+static EmfPlusBuffer*
+emfplus_object_begin (MetafileRecorder *recorder)
+{
+	recorder->object.size = 0;
+	recorder->object.failed = FALSE;
+	return &recorder->object;
+}
+
+/* record the serialized object unless an identical one is already in the table, returns its id */
+static GpStatus
+emfplus_record_object (MetafileRecorder *recorder, ObjectType type, int *id)
+{
+	EmfPlusBuffer *object = &recorder->object;
+	EmfPlusRecordedObject *slot = NULL;
+	EmfPlusBuffer *buffer;
+	BYTE *data;
+	int i;
+
+	if (object->failed)
+		return OutOfMemory;
+
+	recorder->clock++;
+	for (i = 0; i < EMFPLUS_MAX_OBJECTS; i++) {
+		EmfPlusRecordedObject *entry = &recorder->objects [i];
+		if ((entry->type == type) && (entry->size == object->size) && (memcmp (entry->data, object->data, object->size) == 0)) {
+			entry->last_use = recorder->clock;
+			*id = i;
+			return Ok;
+		}
+
+		/* unused entries first, otherwise replace the least recently used object */
+		if (!slot || (slot->data && (!entry->data || (entry->last_use < slot->last_use))))
+			slot = entry;
+	}
+
+	data = (BYTE*) GdipAlloc (object->size);
+	if (!data)
+		return OutOfMemory;
+	memcpy (data, object->data, object->size);
+
+	if (slot->data)
+		GdipFree (slot->data);
+	slot->type = type;
+	slot->data = data;
+	slot->size = object->size;
+	slot->last_use = recorder->clock;
+	*id = slot - recorder->objects;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeObject, *id | (type << 8));
+	emfplus_write_bytes (buffer, data, object->size);
+	return emfplus_record_end (recorder);
+}
+
+static void
+emfplus_write_linear_gradient (EmfPlusBuffer *buffer, GpLineGradient *brush)
+{
+	DWORD flags = 0;
+	int i;
+
+	if (!gdip_is_matrix_empty (&brush->matrix))
+		flags |= EMFPLUS_BRUSH_TRANSFORM;
+	if (brush->presetColors->count >= 2)
+		flags |= EMFPLUS_BRUSH_PRESET_COLORS;
+	else if (brush->blend->count >= 2)
+		flags |= EMFPLUS_BRUSH_BLEND_FACTORS_H;
+	if (brush->gammaCorrection)
+		flags |= EMFPLUS_BRUSH_GAMMA_CORRECTED;
+
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, BrushTypeLinearGradient);
+	emfplus_write_dword (buffer, flags);
+	emfplus_write_dword (buffer, brush->wrapMode);
+	emfplus_write_rectf (buffer, brush->rectangle.X, brush->rectangle.Y, brush->rectangle.Width, brush->rectangle.Height);
+	emfplus_write_dword (buffer, brush->lineColors [0]);
+	emfplus_write_dword (buffer, brush->lineColors [1]);
+	/* reserved, GDI+ repeats the colors */
+	emfplus_write_dword (buffer, brush->lineColors [0]);
+	emfplus_write_dword (buffer, brush->lineColors [1]);
+
+	if (flags & EMFPLUS_BRUSH_TRANSFORM)
+		emfplus_write_matrix (buffer, &brush->matrix);
+
+	if (flags & EMFPLUS_BRUSH_PRESET_COLORS) {
+		emfplus_write_dword (buffer, brush->presetColors->count);
+		for (i = 0; i < brush->presetColors->count; i++)
+			emfplus_write_float (buffer, brush->presetColors->positions [i]);
+		for (i = 0; i < brush->presetColors->count; i++)
+			emfplus_write_dword (buffer, brush->presetColors->colors [i]);
+	} else if (flags & EMFPLUS_BRUSH_BLEND_FACTORS_H) {
+		emfplus_write_dword (buffer, brush->blend->count);
+		for (i = 0; i < brush->blend->count; i++)
+			emfplus_write_float (buffer, brush->blend->positions [i]);
+		for (i = 0; i < brush->blend->count; i++)
+			emfplus_write_float (buffer, brush->blend->factors [i]);
+	}
+}
+
+/* the size of a serialized path object, see emfplus_write_path */
+#define EMFPLUS_PATH_SIZE(count)	((12 + (count) * 9 + 3) & ~3)
+
+static void
+emfplus_write_path (EmfPlusBuffer *buffer, GpPath *path)
+{
+	/* note: the fill mode isn't part of the EMF+ path object */
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, path->count);
+	emfplus_write_dword (buffer, 0);
+	emfplus_write_pointsf (buffer, (GpPointF*) path->points->data, path->count);
+	emfplus_write_bytes (buffer, path->types->data, path->count);
+	emfplus_write_padding (buffer);
+}
+
+static GpStatus
+emfplus_write_path_gradient (EmfPlusBuffer *buffer, GpPathGradient *brush)
+{
+	DWORD flags = EMFPLUS_BRUSH_PATH;
+	int i;
+
+	if (!brush->boundary)
+		return InvalidParameter;
+
+	if (!gdip_is_matrix_empty (&brush->transform))
+		flags |= EMFPLUS_BRUSH_TRANSFORM;
+	if (brush->presetColors->count >= 2)
+		flags |= EMFPLUS_BRUSH_PRESET_COLORS;
+	else if (brush->blend->count >= 2)
+		flags |= EMFPLUS_BRUSH_BLEND_FACTORS_H;
+	if ((brush->focusScales.X != 0.0f) || (brush->focusScales.Y != 0.0f))
+		flags |= EMFPLUS_BRUSH_FOCUS_SCALES;
+	if (brush->useGammaCorrection)
+		flags |= EMFPLUS_BRUSH_GAMMA_CORRECTED;
+
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, BrushTypePathGradient);
+	emfplus_write_dword (buffer, flags);
+	emfplus_write_dword (buffer, brush->wrapMode);
+	emfplus_write_dword (buffer, brush->centerColor);
+	emfplus_write_float (buffer, brush->center.X);
+	emfplus_write_float (buffer, brush->center.Y);
+	emfplus_write_dword (buffer, brush->boundaryColorsCount);
+	for (i = 0; i < brush->boundaryColorsCount; i++)
+		emfplus_write_dword (buffer, brush->boundaryColors [i]);
+
+	/* the boundary is embedded as a path object */
+	emfplus_write_dword (buffer, EMFPLUS_PATH_SIZE (brush->boundary->count));
+	emfplus_write_path (buffer, brush->boundary);
+
+	if (flags & EMFPLUS_BRUSH_TRANSFORM)
+		emfplus_write_matrix (buffer, &brush->transform);
+
+	if (flags & EMFPLUS_BRUSH_PRESET_COLORS) {
+		emfplus_write_dword (buffer, brush->presetColors->count);
+		for (i = 0; i < brush->presetColors->count; i++)
+			emfplus_write_float (buffer, brush->presetColors->positions [i]);
+		for (i = 0; i < brush->presetColors->count; i++)
+			emfplus_write_dword (buffer, brush->presetColors->colors [i]);
+	} else if (flags & EMFPLUS_BRUSH_BLEND_FACTORS_H) {
+		emfplus_write_dword (buffer, brush->blend->count);
+		for (i = 0; i < brush->blend->count; i++)
+			emfplus_write_float (buffer, brush->blend->positions [i]);
+		for (i = 0; i < brush->blend->count; i++)
+			emfplus_write_float (buffer, brush->blend->factors [i]);
+	}
+
+	if (flags & EMFPLUS_BRUSH_FOCUS_SCALES) {
+		emfplus_write_dword (buffer, 2);
+		emfplus_write_float (buffer, brush->focusScales.X);
+		emfplus_write_float (buffer, brush->focusScales.Y);
+	}
+	return Ok;
+}
+
+/* the texture embeds its bitmap, as an image object with uncompressed pixels */
+static GpStatus
+emfplus_write_texture (EmfPlusBuffer *buffer, GpTexture *brush)
+{
+	BitmapData *bitmap;
+	DWORD flags = 0;
+	int i;
+
+	if (!brush->image || (brush->image->type != ImageTypeBitmap) || !brush->image->active_bitmap)
+		return NotImplemented;
+	bitmap = brush->image->active_bitmap;
+
+	if (!gdip_is_matrix_empty (&brush->matrix))
+		flags |= EMFPLUS_BRUSH_TRANSFORM;
+
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, BrushTypeTextureFill);
+	emfplus_write_dword (buffer, flags);
+	emfplus_write_dword (buffer, brush->wrapMode);
+	if (flags & EMFPLUS_BRUSH_TRANSFORM)
+		emfplus_write_matrix (buffer, &brush->matrix);
+
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, EMFPLUS_IMAGE_BITMAP);
+	emfplus_write_dword (buffer, bitmap->width);
+	emfplus_write_dword (buffer, bitmap->height);
+	emfplus_write_dword (buffer, bitmap->stride);
+	emfplus_write_dword (buffer, bitmap->pixel_format);
+	emfplus_write_dword (buffer, EMFPLUS_BITMAP_PIXELS);
+
+	if (gdip_is_an_indexed_pixelformat (bitmap->pixel_format)) {
+		ColorPalette *palette = bitmap->palette;
+
+		emfplus_write_dword (buffer, palette ? palette->Flags : 0);
+		emfplus_write_dword (buffer, palette ? palette->Count : 0);
+		for (i = 0; palette && (i < palette->Count); i++)
+			emfplus_write_dword (buffer, palette->Entries [i]);
+	}
+
+	emfplus_write_bytes (buffer, bitmap->scan0, bitmap->stride * bitmap->height);
+	return Ok;
+}
+
+static GpStatus
+emfplus_write_brush (EmfPlusBuffer *buffer, GpBrush *brush)
+{
+	switch (brush->vtable->type) {
+	case BrushTypeSolidColor:
+		emfplus_write_dword (buffer, EMFPLUS_VERSION);
+		emfplus_write_dword (buffer, BrushTypeSolidColor);
+		emfplus_write_dword (buffer, ((GpSolidFill*) brush)->color);
+		return Ok;
+	case BrushTypeHatchFill: {
+		GpHatch *hatch = (GpHatch*) brush;
+		emfplus_write_dword (buffer, EMFPLUS_VERSION);
+		emfplus_write_dword (buffer, BrushTypeHatchFill);
+		emfplus_write_dword (buffer, hatch->hatchStyle);
+		emfplus_write_dword (buffer, hatch->foreColor);
+		emfplus_write_dword (buffer, hatch->backColor);
+		return Ok;
+	}
+	case BrushTypeLinearGradient:
+		emfplus_write_linear_gradient (buffer, (GpLineGradient*) brush);
+		return Ok;
+	case BrushTypePathGradient:
+		return emfplus_write_path_gradient (buffer, (GpPathGradient*) brush);
+	case BrushTypeTextureFill:
+		return emfplus_write_texture (buffer, (GpTexture*) brush);
+	default:
+		return NotImplemented;
+	}
+}
+
+/* a brush is either a color (S flag) or the id of a brush object */
+static GpStatus
+emfplus_record_brush (MetafileRecorder *recorder, GpBrush *brush, WORD *flags, DWORD *value)
+{
+	GpStatus status;
+	int id;
+
+	if (brush->vtable->type == BrushTypeSolidColor) {
+		*flags |= EMFPLUS_FLAGS_USE_ARGB;
+		*value = ((GpSolidFill*) brush)->color;
+		return Ok;
+	}
+
+	status = emfplus_write_brush (emfplus_object_begin (recorder), brush);
+	if (status != Ok)
+		return status;
+
+	status = emfplus_record_object (recorder, ObjectTypeBrush, &id);
+	*value = id;
+	return status;
+}
+
+static GpStatus
+emfplus_record_pen (MetafileRecorder *recorder, GpPen *pen, int *id)
+{
+	EmfPlusBuffer *buffer = emfplus_object_begin (recorder);
+	DWORD flags = 0;
+	GpStatus status;
+	int i;
+
+	if (!gdip_is_matrix_empty (&pen->matrix))
+		flags |= EMFPLUS_PEN_TRANSFORM;
+	if (pen->line_cap != LineCapFlat)
+		flags |= EMFPLUS_PEN_START_CAP;
+	if (pen->end_cap != LineCapFlat)
+		flags |= EMFPLUS_PEN_END_CAP;
+	if (pen->line_join != LineJoinMiter)
+		flags |= EMFPLUS_PEN_JOIN;
+	if (pen->miter_limit != 10.0f)
+		flags |= EMFPLUS_PEN_MITER_LIMIT;
+	if (pen->dash_style != DashStyleSolid)
+		flags |= EMFPLUS_PEN_LINE_STYLE;
+	if (pen->dash_offset != 0.0f)
+		flags |= EMFPLUS_PEN_DASHED_LINE_OFFSET;
+	if ((pen->dash_style == DashStyleCustom) && (pen->dash_count > 0))
+		flags |= EMFPLUS_PEN_DASHED_LINE;
+	if (pen->mode != PenAlignmentCenter)
+		flags |= EMFPLUS_PEN_NON_CENTER;
+	if (pen->compound_count > 0)
+		flags |= EMFPLUS_PEN_COMPOUND_LINE;
+
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+	emfplus_write_dword (buffer, 0);
+	emfplus_write_dword (buffer, flags);
+	emfplus_write_dword (buffer, pen->unit);
+	emfplus_write_float (buffer, pen->width);
+
+	if (flags & EMFPLUS_PEN_TRANSFORM)
+		emfplus_write_matrix (buffer, &pen->matrix);
+	if (flags & EMFPLUS_PEN_START_CAP)
+		emfplus_write_dword (buffer, pen->line_cap);
+	if (flags & EMFPLUS_PEN_END_CAP)
+		emfplus_write_dword (buffer, pen->end_cap);
+	if (flags & EMFPLUS_PEN_JOIN)
+		emfplus_write_dword (buffer, pen->line_join);
+	if (flags & EMFPLUS_PEN_MITER_LIMIT)
+		emfplus_write_float (buffer, pen->miter_limit);
+	if (flags & EMFPLUS_PEN_LINE_STYLE)
+		emfplus_write_dword (buffer, pen->dash_style);
+	if (flags & EMFPLUS_PEN_DASHED_LINE_OFFSET)
+		emfplus_write_float (buffer, pen->dash_offset);
+	if (flags & EMFPLUS_PEN_DASHED_LINE) {
+		emfplus_write_dword (buffer, pen->dash_count);
+		for (i = 0; i < pen->dash_count; i++)
+			emfplus_write_float (buffer, pen->dash_array [i]);
+	}
+	if (flags & EMFPLUS_PEN_NON_CENTER)
+		emfplus_write_dword (buffer, pen->mode);
+	if (flags & EMFPLUS_PEN_COMPOUND_LINE) {
+		emfplus_write_dword (buffer, pen->compound_count);
+		for (i = 0; i < pen->compound_count; i++)
+			emfplus_write_float (buffer, pen->compound_array [i]);
+	}
+
+	/* the pen embeds its brush object */
+	status = emfplus_write_brush (buffer, pen->brush);
+	if (status != Ok)
+		return status;
+
+	return emfplus_record_object (recorder, ObjectTypePen, id);
+}
+
+static GpStatus
+emfplus_record_path (MetafileRecorder *recorder, GpPath *path, int *id)
+{
+	emfplus_write_path (emfplus_object_begin (recorder), path);
+	return emfplus_record_object (recorder, ObjectTypePath, id);
+}
+
+/* the region is recorded from its scans, as an union of rectangles */
+static GpStatus
+emfplus_record_region (MetafileRecorder *recorder, GpRegion *region, int *id)
+{
+	EmfPlusBuffer *buffer = emfplus_object_begin (recorder);
+	GpMatrix identity;
+	GpRectF *rects;
+	GpStatus status;
+	UINT count;
+	int i;
+
+	emfplus_write_dword (buffer, EMFPLUS_VERSION);
+
+	if (gdip_is_InfiniteRegion (region)) {
+		emfplus_write_dword (buffer, 0);
+		emfplus_write_dword (buffer, EMFPLUS_REGION_NODE_INFINITE);
+		return emfplus_record_object (recorder, ObjectTypeRegion, id);
+	}
+
+	cairo_matrix_init_identity (&identity);
+	status = GdipGetRegionScansCount (region, &count, &identity);
+	if (status != Ok)
+		return status;
+
+	if (count == 0) {
+		emfplus_write_dword (buffer, 0);
+		emfplus_write_dword (buffer, EMFPLUS_REGION_NODE_EMPTY);
+		return emfplus_record_object (recorder, ObjectTypeRegion, id);
+	}
+
+	rects = (GpRectF*) GdipAlloc (count * sizeof (GpRectF));
+	if (!rects)
+		return OutOfMemory;
+
+	status = GdipGetRegionScans (region, rects, (INT*) &count, &identity);
+	if (status != Ok) {
+		GdipFree (rects);
+		return status;
+	}
+
+	/* (count - 1) Or nodes, each one with a rectangle on its left, and the last rectangle */
+	emfplus_write_dword (buffer, 2 * count - 2);
+	for (i = 0; i < count; i++) {
+		if (i < count - 1)
+			emfplus_write_dword (buffer, EMFPLUS_REGION_NODE_OR);
+		emfplus_write_dword (buffer, EMFPLUS_REGION_NODE_RECT);
+		emfplus_write_rectf (buffer, rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height);
+	}
+	GdipFree (rects);
+
+	return emfplus_record_object (recorder, ObjectTypeRegion, id);
+}
+
+/* records drawn with a pen, e.g. DrawLines or DrawBeziers, whose data is only the points */
+static GpStatus
+emfplus_record_pen_points (GpGraphics *graphics, EmfPlusRecordType type, WORD flags, GpPen *pen,
+	GDIPCONST GpPointF *pointsf, GDIPCONST GpPoint *points, int count)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_pen (recorder, pen, &id);
+	if (status != Ok)
+		return status;
+
+	if (points)
+		flags |= EMFPLUS_FLAGS_USE_INT16;
+	buffer = emfplus_record_begin (recorder, type, flags | id);
+	emfplus_write_dword (buffer, count);
+	if (points)
+		emfplus_write_points (buffer, points, count);
+	else
+		emfplus_write_pointsf (buffer, pointsf, count);
+	return emfplus_record_end (recorder);
+}
+
+/* DrawArc and DrawPie share the same layout */
+static GpStatus
+emfplus_record_pen_arc (GpGraphics *graphics, EmfPlusRecordType type, GpPen *pen, BOOL use_int16, float x, float y,
+	float width, float height, float startAngle, float sweepAngle)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_pen (recorder, pen, &id);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, type, (use_int16 ? EMFPLUS_FLAGS_USE_INT16 : 0) | id);
+	emfplus_write_float (buffer, startAngle);
+	emfplus_write_float (buffer, sweepAngle);
+	if (use_int16)
+		emfplus_write_rect (buffer, x, y, width, height);
+	else
+		emfplus_write_rectf (buffer, x, y, width, height);
+	return emfplus_record_end (recorder);
+}
+
+/* records with a single data-less parameter, passed in the flags */
+static GpStatus
+emfplus_record_flags (GpGraphics *graphics, EmfPlusRecordType type, WORD flags)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+
+	if (!recorder)
+		return Ok;
+
+	emfplus_record_begin (recorder, type, flags);
+	return emfplus_record_end (recorder);
+}
+
+/* world transform changes, with an optional matrix order and up to two values */
+static GpStatus
+emfplus_record_transform (GpGraphics *graphics, EmfPlusRecordType type, GpMatrixOrder order, int count, float v1, float v2)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, type, (order == MatrixOrderAppend) ? EMFPLUS_FLAGS_APPEND_ORDER : 0);
+	if (count > 0)
+		emfplus_write_float (buffer, v1);
+	if (count > 1)
+		emfplus_write_float (buffer, v2);
+	return emfplus_record_end (recorder);
+}
+
 /* DrawArcs - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/DrawArc.html */
 
 GpStatus
-metafile_DrawArc (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height, float startAngle, 
+metafile_DrawArc (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height, float startAngle,
 	float sweepAngle)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_pen_arc (graphics, EmfPlusRecordTypeDrawArc, pen, FALSE, x, y, width, height, startAngle, sweepAngle);
 }
 
 GpStatus
@@ -91,106 +840,256 @@ metafile_DrawArcI (GpGraphics *graphics, GpPen *pen, int x, int y, int width, in
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
 		return metafile_DrawArc (graphics, pen, x, y, width, height, startAngle, sweepAngle);
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_pen_arc (graphics, EmfPlusRecordTypeDrawArc, pen, TRUE, x, y, width, height, startAngle, sweepAngle);
 }
 
 /* DrawBeziers - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/DrawBeziers.html */
 
-GpStatus 
-metafile_DrawBezier (GpGraphics *graphics, GpPen *pen, float x1, float y1, float x2, float y2, float x3, float y3, 
+GpStatus
+metafile_DrawBezier (GpGraphics *graphics, GpPen *pen, float x1, float y1, float x2, float y2, float x3, float y3,
 	float x4, float y4)
 {
-	/* TODO */
-	return Ok;
+	GpPointF points [4] = { { x1, y1 }, { x2, y2 }, { x3, y3 }, { x4, y4 } };
+
+	return metafile_DrawBeziers (graphics, pen, points, 4);
 }
 
 GpStatus
 metafile_DrawBezierI (GpGraphics *graphics, GpPen *pen, int x1, int y1, int x2, int y2, int x3, int y3, int x4, int y4)
 {
-	/* TODO */
-	return Ok;
+	GpPoint points [4] = { { x1, y1 }, { x2, y2 }, { x3, y3 }, { x4, y4 } };
+
+	return metafile_DrawBeziersI (graphics, pen, points, 4);
 }
 
-GpStatus 
+GpStatus
 metafile_DrawBeziers (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, int count)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_pen_points (graphics, EmfPlusRecordTypeDrawBeziers, 0, pen, points, NULL, count);
 }
 
 GpStatus
 metafile_DrawBeziersI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, int count)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_DrawBeziers (graphics, pen, pf, count);
+		GdipFree (pf);
+		return status;
+	}
+
+	return emfplus_record_pen_points (graphics, EmfPlusRecordTypeDrawBeziers, 0, pen, NULL, points, count);
 }
 
 /*
  * DrawClosedCurve - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/DrawClosedCurve.html
  */
 
+static GpStatus
+emfplus_record_draw_closed_curve (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *pointsf, GDIPCONST GpPoint *points,
+	int count, float tension)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_pen (recorder, pen, &id);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeDrawClosedCurve, (points ? EMFPLUS_FLAGS_USE_INT16 : 0) | id);
+	emfplus_write_float (buffer, tension);
+	emfplus_write_dword (buffer, count);
+	if (points)
+		emfplus_write_points (buffer, points, count);
+	else
+		emfplus_write_pointsf (buffer, pointsf, count);
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
 metafile_DrawClosedCurve2 (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, int count, float tension)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_draw_closed_curve (graphics, pen, points, NULL, count, tension);
 }
 
 GpStatus
 metafile_DrawClosedCurve2I (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, int count, float tension)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_DrawClosedCurve2 (graphics, pen, pf, count, tension);
+		GdipFree (pf);
+		return status;
+	}
+
+	return emfplus_record_draw_closed_curve (graphics, pen, NULL, points, count, tension);
 }
 
 /*
  * FillClosedCurve - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillClosedCurve.html
  */
 
+static GpStatus
+emfplus_record_fill_closed_curve (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *pointsf, GDIPCONST GpPoint *points,
+	int count, float tension, FillMode fillMode)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	if (points)
+		flags |= EMFPLUS_FLAGS_USE_INT16;
+	if (fillMode == FillModeWinding)
+		flags |= EMFPLUS_FLAGS_FILLMODE_WINDING;
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillClosedCurve, flags);
+	emfplus_write_dword (buffer, value);
+	emfplus_write_float (buffer, tension);
+	emfplus_write_dword (buffer, count);
+	if (points)
+		emfplus_write_points (buffer, points, count);
+	else
+		emfplus_write_pointsf (buffer, pointsf, count);
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
 metafile_FillClosedCurve2 (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *points, int count, float tension)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_fill_closed_curve (graphics, brush, points, NULL, count, tension, FillModeAlternate);
 }
 
 GpStatus
 metafile_FillClosedCurve2I (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *points, int count, float tension)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_FillClosedCurve2 (graphics, brush, pf, count, tension);
+		GdipFree (pf);
+		return status;
+	}
+
+	return emfplus_record_fill_closed_curve (graphics, brush, NULL, points, count, tension, FillModeAlternate);
 }
 
 /*
  * DrawCurve - ?
  */
 
+static GpStatus
+emfplus_record_draw_curve (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPointF *pointsf, GDIPCONST GpPoint *points,
+	int count, int offset, int numOfSegments, float tension)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_pen (recorder, pen, &id);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeDrawCurve, (points ? EMFPLUS_FLAGS_USE_INT16 : 0) | id);
+	emfplus_write_float (buffer, tension);
+	emfplus_write_dword (buffer, offset);
+	emfplus_write_dword (buffer, numOfSegments);
+	emfplus_write_dword (buffer, count);
+	if (points)
+		emfplus_write_points (buffer, points, count);
+	else
+		emfplus_write_pointsf (buffer, pointsf, count);
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
-metafile_DrawCurve3 (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPointF *points, int count, int offset, int numOfSegments, 
+metafile_DrawCurve3 (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPointF *points, int count, int offset, int numOfSegments,
 	float tension)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_draw_curve (graphics, pen, points, NULL, count, offset, numOfSegments, tension);
 }
 
 GpStatus
 metafile_DrawCurve3I (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPoint *points, int count, int offset, int numOfSegments,
 	float tension)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_DrawCurve3 (graphics, pen, pf, count, offset, numOfSegments, tension);
+		GdipFree (pf);
+		return status;
+	}
+
+	return emfplus_record_draw_curve (graphics, pen, NULL, points, count, offset, numOfSegments, tension);
 }
 
 /*
  * DrawEllipse - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/DrawEllipse.html
  */
 
-GpStatus 
+static GpStatus
+emfplus_record_draw_ellipse (GpGraphics *graphics, GpPen *pen, BOOL use_int16, float x, float y, float width, float height)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_pen (recorder, pen, &id);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeDrawEllipse, (use_int16 ? EMFPLUS_FLAGS_USE_INT16 : 0) | id);
+	if (use_int16)
+		emfplus_write_rect (buffer, x, y, width, height);
+	else
+		emfplus_write_rectf (buffer, x, y, width, height);
+	return emfplus_record_end (recorder);
+}
+
+GpStatus
 metafile_DrawEllipse (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height)
-{	
-	/* TODO */
-	return Ok;
+{
+	return emfplus_record_draw_ellipse (graphics, pen, FALSE, x, y, width, height);
 }
 
 GpStatus
@@ -199,19 +1098,43 @@ metafile_DrawEllipseI (GpGraphics *graphics, GpPen *pen, int x, int y, int width
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
 		return metafile_DrawEllipse (graphics, pen, x, y, width, height);
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_draw_ellipse (graphics, pen, TRUE, x, y, width, height);
 }
 
 /*
  * FillEllipse - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillEllipse.html
  */
 
+static GpStatus
+emfplus_record_fill_ellipse (GpGraphics *graphics, GpBrush *brush, BOOL use_int16, float x, float y, float width, float height)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillEllipse, flags | (use_int16 ? EMFPLUS_FLAGS_USE_INT16 : 0));
+	emfplus_write_dword (buffer, value);
+	if (use_int16)
+		emfplus_write_rect (buffer, x, y, width, height);
+	else
+		emfplus_write_rectf (buffer, x, y, width, height);
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
 metafile_FillEllipse (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_fill_ellipse (graphics, brush, FALSE, x, y, width, height);
 }
 
 GpStatus
@@ -220,8 +1143,8 @@ metafile_FillEllipseI (GpGraphics *graphics, GpBrush *brush, int x, int y, int w
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
 		return metafile_FillEllipse (graphics, brush, x, y, width, height);
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_fill_ellipse (graphics, brush, TRUE, x, y, width, height);
 }
 
 /*
@@ -231,29 +1154,41 @@ metafile_FillEllipseI (GpGraphics *graphics, GpBrush *brush, int x, int y, int w
 GpStatus
 metafile_DrawLine (GpGraphics *graphics, GpPen *pen, float x1, float y1, float x2, float y2)
 {
-	/* TODO */
-	return Ok;
+	GpPointF points [2] = { { x1, y1 }, { x2, y2 } };
+
+	return metafile_DrawLines (graphics, pen, points, 2);
 }
 
 GpStatus
 metafile_DrawLineI (GpGraphics *graphics, GpPen *pen, int x1, int y1, int x2, int y2)
 {
-	/* TODO */
-	return Ok;
+	GpPoint points [2] = { { x1, y1 }, { x2, y2 } };
+
+	return metafile_DrawLinesI (graphics, pen, points, 2);
 }
 
-GpStatus 
+GpStatus
 metafile_DrawLines (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, int count)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_pen_points (graphics, EmfPlusRecordTypeDrawLines, 0, pen, points, NULL, count);
 }
 
 GpStatus
 metafile_DrawLinesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, int count)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_DrawLines (graphics, pen, pf, count);
+		GdipFree (pf);
+		return status;
+	}
+
+	return emfplus_record_pen_points (graphics, EmfPlusRecordTypeDrawLines, 0, pen, NULL, points, count);
 }
 
 /*
@@ -262,8 +1197,24 @@ metafile_DrawLinesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points
 GpStatus
 metafile_DrawPath (GpGraphics *graphics, GpPen *pen, GpPath *path)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int path_id, pen_id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_path (recorder, path, &path_id);
+	if (status != Ok)
+		return status;
+	status = emfplus_record_pen (recorder, pen, &pen_id);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeDrawPath, path_id);
+	emfplus_write_dword (buffer, pen_id);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -273,8 +1224,26 @@ metafile_DrawPath (GpGraphics *graphics, GpPen *pen, GpPath *path)
 GpStatus
 metafile_FillPath (GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_path (recorder, path, &id);
+	if (status != Ok)
+		return status;
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillPath, flags | id);
+	emfplus_write_dword (buffer, value);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -282,11 +1251,10 @@ metafile_FillPath (GpGraphics *graphics, GpBrush *brush, GpPath *path)
  */
 
 GpStatus
-metafile_DrawPie (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height, 
+metafile_DrawPie (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height,
 	float startAngle, float sweepAngle)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_pen_arc (graphics, EmfPlusRecordTypeDrawPie, pen, FALSE, x, y, width, height, startAngle, sweepAngle);
 }
 
 GpStatus
@@ -295,95 +1263,204 @@ metafile_DrawPieI (GpGraphics *graphics, GpPen *pen, int x, int y, int width, in
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
 		return metafile_DrawPie (graphics, pen, x, y, width, height, startAngle, sweepAngle);
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_pen_arc (graphics, EmfPlusRecordTypeDrawPie, pen, TRUE, x, y, width, height, startAngle, sweepAngle);
 }
 
 /*
  * FillPie - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillPie.html
  */
 
+static GpStatus
+emfplus_record_fill_pie (GpGraphics *graphics, GpBrush *brush, BOOL use_int16, float x, float y, float width, float height,
+	float startAngle, float sweepAngle)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillPie, flags | (use_int16 ? EMFPLUS_FLAGS_USE_INT16 : 0));
+	emfplus_write_dword (buffer, value);
+	emfplus_write_float (buffer, startAngle);
+	emfplus_write_float (buffer, sweepAngle);
+	if (use_int16)
+		emfplus_write_rect (buffer, x, y, width, height);
+	else
+		emfplus_write_rectf (buffer, x, y, width, height);
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
-metafile_FillPie (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height, 
+metafile_FillPie (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height,
 	float startAngle, float sweepAngle)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_fill_pie (graphics, brush, FALSE, x, y, width, height, startAngle, sweepAngle);
 }
 
 GpStatus
-metafile_FillPieI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height, 
+metafile_FillPieI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height,
 	float startAngle, float sweepAngle)
 {
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
 		return metafile_FillPie (graphics, brush, x, y, width, height, startAngle, sweepAngle);
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_fill_pie (graphics, brush, TRUE, x, y, width, height, startAngle, sweepAngle);
 }
 
 /*
- * DrawPolygon - ?
+ * DrawPolygon - DrawLines with the closed shape flag
  */
 
 GpStatus
 metafile_DrawPolygon (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, int count)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_pen_points (graphics, EmfPlusRecordTypeDrawLines, EMFPLUS_FLAGS_CLOSED_SHAPE, pen, points, NULL, count);
 }
 
 GpStatus
 metafile_DrawPolygonI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, int count)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_DrawPolygon (graphics, pen, pf, count);
+		GdipFree (pf);
+		return status;
+	}
+
+	return emfplus_record_pen_points (graphics, EmfPlusRecordTypeDrawLines, EMFPLUS_FLAGS_CLOSED_SHAPE, pen, NULL, points, count);
 }
 
 /*
  * FillPolygon - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillPolygon.html
  */
 
+static GpStatus
+emfplus_record_fill_polygon (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *pointsf, GDIPCONST GpPoint *points,
+	int count)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillPolygon, flags | (points ? EMFPLUS_FLAGS_USE_INT16 : 0));
+	emfplus_write_dword (buffer, value);
+	emfplus_write_dword (buffer, count);
+	if (points)
+		emfplus_write_points (buffer, points, count);
+	else
+		emfplus_write_pointsf (buffer, pointsf, count);
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
 metafile_FillPolygon (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *points, int count, FillMode fillMode)
 {
-	/* TODO */
-	return Ok;
+	/* FillPolygon is always alternate, a winding polygon is a closed curve without tension */
+	if (fillMode == FillModeWinding)
+		return emfplus_record_fill_closed_curve (graphics, brush, points, NULL, count, 0.0f, fillMode);
+
+	return emfplus_record_fill_polygon (graphics, brush, points, NULL, count);
 }
 
 GpStatus
 metafile_FillPolygonI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *points, int count, FillMode fillMode)
 {
-	/* TODO */
-	return Ok;
+	/* every point must fit into a INT16 or we must use the float version */
+	if (!GpPointArrayFitInInt16 (points, count)) {
+		GpStatus status;
+		GpPointF *pf = convert_points (points, count);
+		if (!pf)
+			return OutOfMemory;
+
+		status = metafile_FillPolygon (graphics, brush, pf, count, fillMode);
+		GdipFree (pf);
+		return status;
+	}
+
+	if (fillMode == FillModeWinding)
+		return emfplus_record_fill_closed_curve (graphics, brush, NULL, points, count, 0.0f, fillMode);
+
+	return emfplus_record_fill_polygon (graphics, brush, NULL, points, count);
 }
 
 /*
  * DrawRects - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/DrawRects.html
  */
 
+static GpStatus
+emfplus_record_draw_rects (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRectF *rectsf, GDIPCONST GpRect *rects, int count)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	int id, i;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_pen (recorder, pen, &id);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeDrawRects, (rects ? EMFPLUS_FLAGS_USE_INT16 : 0) | id);
+	emfplus_write_dword (buffer, count);
+	for (i = 0; i < count; i++) {
+		if (rects)
+			emfplus_write_rect (buffer, rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height);
+		else
+			emfplus_write_rectf (buffer, rectsf [i].X, rectsf [i].Y, rectsf [i].Width, rectsf [i].Height);
+	}
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
 metafile_DrawRectangle (GpGraphics *graphics, GpPen *pen, float x, float y, float width, float height)
 {
-	/* TODO */
-	return Ok;
+	GpRectF rect = { x, y, width, height };
+
+	return metafile_DrawRectangles (graphics, pen, &rect, 1);
 }
 
 GpStatus
 metafile_DrawRectangleI (GpGraphics *graphics, GpPen *pen, int x, int y, int width, int height)
 {
+	GpRect rect = { x, y, width, height };
+
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
-		return metafile_DrawRectangleI (graphics, pen, x, y, width, height);
-	/* TODO */
-	return Ok;
+		return metafile_DrawRectangle (graphics, pen, x, y, width, height);
+
+	return emfplus_record_draw_rects (graphics, pen, NULL, &rect, 1);
 }
 
 GpStatus
 metafile_DrawRectangles (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRectF *rects, int count)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_draw_rects (graphics, pen, rects, NULL, count);
 }
 
 GpStatus
@@ -400,39 +1477,70 @@ metafile_DrawRectanglesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRect *re
 		GdipFree (rf);
 		return status;
 	}
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_draw_rects (graphics, pen, NULL, rects, count);
 }
 
 /*
  * FillRects - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/FillRects.html
  */
 
+static GpStatus
+emfplus_record_fill_rects (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rectsf, GDIPCONST GpRect *rects, int count)
+{
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+	int i;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillRects, flags | (rects ? EMFPLUS_FLAGS_USE_INT16 : 0));
+	emfplus_write_dword (buffer, value);
+	emfplus_write_dword (buffer, count);
+	for (i = 0; i < count; i++) {
+		if (rects)
+			emfplus_write_rect (buffer, rects [i].X, rects [i].Y, rects [i].Width, rects [i].Height);
+		else
+			emfplus_write_rectf (buffer, rectsf [i].X, rectsf [i].Y, rectsf [i].Width, rectsf [i].Height);
+	}
+	return emfplus_record_end (recorder);
+}
+
 GpStatus
 metafile_FillRectangle (GpGraphics *graphics, GpBrush *brush, float x, float y, float width, float height)
 {
-	/* TODO */
-	return Ok;
+	GpRectF rect = { x, y, width, height };
+
+	return metafile_FillRectangles (graphics, brush, &rect, 1);
 }
 
-GpStatus 
+GpStatus
 metafile_FillRectangleI (GpGraphics *graphics, GpBrush *brush, int x, int y, int width, int height)
 {
+	GpRect rect = { x, y, width, height };
+
 	/* every rectangle must fit into a INT16 or we must use the float version */
 	if (!RectFitInInt16 (x, y, width, height))
 		return metafile_FillRectangle (graphics, brush, x, y, width, height);
-	/* TODO */
-	return Ok;
+
+	return emfplus_record_fill_rects (graphics, brush, NULL, &rect, 1);
 }
 
-GpStatus 
+GpStatus
 metafile_FillRectangles (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rects, int count)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_fill_rects (graphics, brush, rects, NULL, count);
 }
 
-GpStatus 
+GpStatus
 metafile_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect *rects, int count)
 {
 	/* every rectangle must fit into a INT16 or we must use the float version */
@@ -447,8 +1555,7 @@ metafile_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect
 		return status;
 	}
 
-	/* TODO */
-	return Ok;
+	return emfplus_record_fill_rects (graphics, brush, NULL, rects, count);
 }
 
 /*
@@ -458,8 +1565,26 @@ metafile_FillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect
 GpStatus
 metafile_FillRegion (GpGraphics *graphics, GpBrush *brush, GpRegion *region)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+	GpStatus status;
+	WORD flags = 0;
+	DWORD value;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_region (recorder, region, &id);
+	if (status != Ok)
+		return status;
+	status = emfplus_record_brush (recorder, brush, &flags, &value);
+	if (status != Ok)
+		return status;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeFillRegion, flags | id);
+	emfplus_write_dword (buffer, value);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -469,8 +1594,15 @@ metafile_FillRegion (GpGraphics *graphics, GpBrush *brush, GpRegion *region)
 GpStatus
 metafile_GraphicsClear (GpGraphics *graphics, ARGB color)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeClear, 0);
+	emfplus_write_dword (buffer, color);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -480,8 +1612,7 @@ metafile_GraphicsClear (GpGraphics *graphics, ARGB color)
 GpStatus
 metafile_SetCompositingMode (GpGraphics *graphics, CompositingMode compositingMode)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetCompositingMode, compositingMode);
 }
 
 /*
@@ -491,8 +1622,7 @@ metafile_SetCompositingMode (GpGraphics *graphics, CompositingMode compositingMo
 GpStatus
 metafile_SetCompositingQuality (GpGraphics *graphics, CompositingQuality compositingQuality)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetCompositingQuality, compositingQuality);
 }
 
 /*
@@ -502,8 +1632,7 @@ metafile_SetCompositingQuality (GpGraphics *graphics, CompositingQuality composi
 GpStatus
 metafile_SetInterpolationMode (GpGraphics *graphics, InterpolationMode interpolationMode)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetInterpolationMode, interpolationMode);
 }
 
 /*
@@ -513,8 +1642,7 @@ metafile_SetInterpolationMode (GpGraphics *graphics, InterpolationMode interpola
 GpStatus
 metafile_SetPixelOffsetMode (GpGraphics *graphics, PixelOffsetMode pixelOffsetMode)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetPixelOffsetMode, pixelOffsetMode);
 }
 
 /*
@@ -524,19 +1652,34 @@ metafile_SetPixelOffsetMode (GpGraphics *graphics, PixelOffsetMode pixelOffsetMo
 GpStatus
 metafile_SetPageTransform (GpGraphics *graphics, GpUnit unit, float scale)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeSetPageTransform, unit);
+	emfplus_write_float (buffer, scale);
+	return emfplus_record_end (recorder);
 }
 
 /*
  * SetRenderingOrigin - http://www.aces.uiuc.edu/~jhtodd/Metafile/MetafileRecords/SetRenderingOrigin.html
  */
 
-GpStatus 
+GpStatus
 metafile_SetRenderingOrigin (GpGraphics *graphics, int x, int y)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeSetRenderingOrigin, 0);
+	emfplus_write_dword (buffer, x);
+	emfplus_write_dword (buffer, y);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -546,8 +1689,10 @@ metafile_SetRenderingOrigin (GpGraphics *graphics, int x, int y)
 GpStatus
 metafile_SetSmoothingMode (GpGraphics *graphics, SmoothingMode mode)
 {
-	/* TODO */
-	return Ok;
+	/* the lowest bit tells if anti-aliasing is used, the smoothing mode follows */
+	BOOL antialias = (mode == SmoothingModeHighQuality) || (mode == SmoothingModeAntiAlias);
+
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetAntiAliasMode, (mode << 1) | (antialias ? 1 : 0));
 }
 
 /*
@@ -557,8 +1702,7 @@ metafile_SetSmoothingMode (GpGraphics *graphics, SmoothingMode mode)
 GpStatus
 metafile_SetTextContrast (GpGraphics *graphics, UINT contrast)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetTextContrast, contrast);
 }
 
 /*
@@ -568,8 +1712,7 @@ metafile_SetTextContrast (GpGraphics *graphics, UINT contrast)
 GpStatus
 metafile_SetTextRenderingHint (GpGraphics *graphics, TextRenderingHint mode)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetTextRenderingHint, mode);
 }
 
 /*
@@ -579,8 +1722,7 @@ metafile_SetTextRenderingHint (GpGraphics *graphics, TextRenderingHint mode)
 GpStatus
 metafile_ResetClip (GpGraphics *graphics)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeResetClip, 0);
 }
 
 /*
@@ -590,8 +1732,18 @@ metafile_ResetClip (GpGraphics *graphics)
 GpStatus
 metafile_SetClipPath (GpGraphics *graphics, GpPath *path, CombineMode combineMode)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_path (recorder, path, &id);
+	if (status != Ok)
+		return status;
+
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetClipPath, (combineMode << 8) | id);
 }
 
 /*
@@ -601,8 +1753,15 @@ metafile_SetClipPath (GpGraphics *graphics, GpPath *path, CombineMode combineMod
 GpStatus
 metafile_SetClipRect (GpGraphics *graphics, float x, float y, float width, float height, CombineMode combineMode)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeSetClipRect, combineMode << 8);
+	emfplus_write_rectf (buffer, x, y, width, height);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -612,8 +1771,18 @@ metafile_SetClipRect (GpGraphics *graphics, float x, float y, float width, float
 GpStatus
 metafile_SetClipRegion (GpGraphics *graphics, GpRegion *region, CombineMode combineMode)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	GpStatus status;
+	int id;
+
+	if (!recorder)
+		return Ok;
+
+	status = emfplus_record_region (recorder, region, &id);
+	if (status != Ok)
+		return status;
+
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeSetClipRegion, (combineMode << 8) | id);
 }
 
 /*
@@ -623,8 +1792,7 @@ metafile_SetClipRegion (GpGraphics *graphics, GpRegion *region, CombineMode comb
 GpStatus
 metafile_TranslateClip (GpGraphics *graphics, float dx, float dy)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_transform (graphics, EmfPlusRecordTypeOffsetClip, MatrixOrderPrepend, 2, dx, dy);
 }
 
 /*
@@ -634,8 +1802,7 @@ metafile_TranslateClip (GpGraphics *graphics, float dx, float dy)
 GpStatus
 metafile_ResetWorldTransform (GpGraphics *graphics)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_flags (graphics, EmfPlusRecordTypeResetWorldTransform, 0);
 }
 
 /*
@@ -645,8 +1812,15 @@ metafile_ResetWorldTransform (GpGraphics *graphics)
 GpStatus
 metafile_SetWorldTransform (GpGraphics *graphics, GpMatrix *matrix)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeSetWorldTransform, 0);
+	emfplus_write_matrix (buffer, matrix);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -656,8 +1830,16 @@ metafile_SetWorldTransform (GpGraphics *graphics, GpMatrix *matrix)
 GpStatus
 metafile_MultiplyWorldTransform (GpGraphics *graphics, GpMatrix *matrix, GpMatrixOrder order)
 {
-	/* TODO */
-	return Ok;
+	MetafileRecorder *recorder = graphics->metafile->recorder;
+	EmfPlusBuffer *buffer;
+
+	if (!recorder)
+		return Ok;
+
+	buffer = emfplus_record_begin (recorder, EmfPlusRecordTypeMultiplyWorldTransform,
+		(order == MatrixOrderAppend) ? EMFPLUS_FLAGS_APPEND_ORDER : 0);
+	emfplus_write_matrix (buffer, matrix);
+	return emfplus_record_end (recorder);
 }
 
 /*
@@ -667,8 +1849,7 @@ metafile_MultiplyWorldTransform (GpGraphics *graphics, GpMatrix *matrix, GpMatri
 GpStatus
 metafile_RotateWorldTransform (GpGraphics *graphics, float angle, GpMatrixOrder order)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_transform (graphics, EmfPlusRecordTypeRotateWorldTransform, order, 1, angle, 0);
 }
 
 /*
@@ -678,8 +1859,7 @@ metafile_RotateWorldTransform (GpGraphics *graphics, float angle, GpMatrixOrder
 GpStatus
 metafile_ScaleWorldTransform (GpGraphics *graphics, float sx, float sy, GpMatrixOrder order)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_transform (graphics, EmfPlusRecordTypeScaleWorldTransform, order, 2, sx, sy);
 }
 
 /*
@@ -689,6 +1869,5 @@ metafile_ScaleWorldTransform (GpGraphics *graphics, float sx, float sy, GpMatrix
 GpStatus
 metafile_TranslateWorldTransform (GpGraphics *graphics, float dx, float dy, GpMatrixOrder order)
 {
-	/* TODO */
-	return Ok;
+	return emfplus_record_transform (graphics, EmfPlusRecordTypeTranslateWorldTransform, order, 2, dx, dy);
 }
@@ -79,7 +79,8 @@ typedef enum {
 typedef enum {
 	GraphicsBackEndInvalid	= -1,
 	GraphicsBackEndCairo	= 0,
-	GraphicsBackEndMetafile	= 1
+	GraphicsBackEndMetafile	= 1,
+	GraphicsBackEndDeferred	= 2	/* cairo, with solid fills queued until a flush */
 } GraphicsBackEnd;
 
 typedef struct {
@@ -87,6 +88,7 @@ typedef struct {
 	cairo_matrix_t		previous_matrix;
 	GpRegion*		clip;
 	cairo_matrix_t		clip_matrix;
+	int			clip_generation;
 	CompositingMode    	composite_mode;
 	CompositingQuality 	composite_quality;
 	InterpolationMode 	interpolation;
@@ -127,9 +129,24 @@ typedef struct _Graphics {
 	EmfType			emf_type;
 	GpMetafile		*metafile;
 	cairo_surface_t		*metasurface;	/* bogus surface to satisfy some API calls */
+	/* deferred-specific stuff */
+	GArray			*deferred;	/* pending fills, see graphics-deferred.c */
+	GpSolidFill		*deferred_brush;
 	/* common-stuff */
 	GpRegion*		clip;
 	GpMatrix*		clip_matrix;
+	int			clip_generation;	/* a new value each time clip is changed */
+	int			last_clip_generation;
+	/* device space copy of the cairo clip path, see cairo_SetGraphicsClip */
+	cairo_path_t		*clip_path;
+	int			clip_path_generation;
+	cairo_matrix_t		clip_path_matrix;
+	cairo_matrix_t		clip_path_ctm;
+	GpUnit			clip_path_unit;
+	float			clip_path_scale;
+	BOOL			clip_is_rect;	/* cairo clip is the clip_rect box */
+	GpRect			clip_rect;	/* device space */
+	unsigned int		culled_primitives;	/* primitives outside of the clip, see graphics-cairo.c */
 	GpRect			bounds;
 	GpUnit			page_unit;
 	float			scale;
@@ -160,6 +177,7 @@ GpGraphics* gdip_graphics_new (cairo_surface_t *surface) GDIP_INTERNAL;
 GpGraphics* gdip_metafile_graphics_new (GpMetafile *metafile) GDIP_INTERNAL;
 
 BOOL gdip_is_scaled (GpGraphics *graphics) GDIP_INTERNAL;
+void gdip_world_to_device (GpGraphics *graphics, double *x, double *y) GDIP_INTERNAL;
 
 /* prototypes for cairo wrappers to deal with coordonates limits, unit conversion and antialiasing) */
 void gdip_cairo_rectangle (GpGraphics *graphics, double x, double y, double width, double height, BOOL antialiasing) GDIP_INTERNAL;
@@ -28,6 +28,7 @@
 
 #include "graphics-private.h"
 #include "graphics-cairo-private.h"
+#include "graphics-deferred-private.h"
 #include "graphics-metafile-private.h"
 #include "region-private.h"
 #include "graphics-path-private.h"
@@ -143,9 +144,16 @@ gdip_graphics_common_init (GpGraphics *graphics)
 
 	GdipCreateRegion (&graphics->clip);
 	GdipCreateMatrix (&graphics->clip_matrix);
+	graphics->clip_generation = 0;
+	graphics->last_clip_generation = 0;
+	graphics->clip_path = NULL;
+	graphics->clip_is_rect = FALSE;
+	graphics->culled_primitives = 0;
 	graphics->bounds.X = graphics->bounds.Y = graphics->bounds.Width = graphics->bounds.Height = 0;
 	graphics->last_pen = NULL;
 	graphics->last_brush = NULL;
+	graphics->deferred = NULL;
+	graphics->deferred_brush = NULL;
 	graphics->saved_status = NULL;
 	graphics->saved_status_pos = 0;
 	graphics->render_origin_x = 0;
@@ -379,6 +387,10 @@ GdipDeleteGraphics (GpGraphics *graphics)
 	if (graphics->state != GraphicsStateValid)
 		return ObjectBusy;
 
+	/* the queued fills are drawn, e.g. into the image, before the graphics goes away */
+	gdip_deferred_flush (graphics);
+	gdip_deferred_free (graphics);
+
 	/* We don't destroy image because we did not create one. */
 	if (graphics->copy_of_ctm) {
 		GdipDeleteMatrix (graphics->copy_of_ctm);
@@ -395,6 +407,11 @@ GdipDeleteGraphics (GpGraphics *graphics)
 		graphics->clip_matrix = NULL;
 	}
 
+	if (graphics->clip_path) {
+		cairo_path_destroy (graphics->clip_path);
+		graphics->clip_path = NULL;
+	}
+
 	if (graphics->ct) {
 #if HAS_X11 && CAIRO_HAS_XLIB_SURFACE
 		int (*old_error_handler)(Display *dpy, XErrorEvent *ev) = NULL;
@@ -439,12 +456,19 @@ GdipDeleteGraphics (GpGraphics *graphics)
 GpStatus WINGDIPAPI
 GdipGetDC (GpGraphics *graphics, HDC *hdc)
 {
+	GpStatus status;
+
 	if (!graphics || !hdc)
 		return InvalidParameter;
 
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
+	/* the device context can be used to draw, or read, without this graphics */
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	*hdc = (void *)graphics;
 	graphics->state = GraphicsStateBusy;
 
@@ -468,6 +492,7 @@ GdipReleaseDC (GpGraphics *graphics, HDC hdc)
 GpStatus WINGDIPAPI
 GdipRestoreGraphics (GpGraphics *graphics, unsigned int graphicsState)
 {
+	GpStatus status;
 	GpState* pos_state;
 
 	if (!graphics)
@@ -478,6 +503,10 @@ GdipRestoreGraphics (GpGraphics *graphics, unsigned int graphicsState)
 	if (graphicsState >= MAX_GRAPHICS_STATE_STACK || graphicsState > graphics->saved_status_pos)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	pos_state = graphics->saved_status;
 	pos_state += graphicsState;	
 
@@ -491,6 +520,8 @@ GdipRestoreGraphics (GpGraphics *graphics, unsigned int graphicsState)
 		GdipDeleteRegion (graphics->clip);
 	GdipCloneRegion (pos_state->clip, &graphics->clip);
 	gdip_cairo_matrix_copy (graphics->clip_matrix, &pos_state->clip_matrix);
+	/* the clip is back to what it was, so is its cairo path */
+	graphics->clip_generation = pos_state->clip_generation;
 
 	graphics->composite_mode = pos_state->composite_mode;
 	graphics->composite_quality = pos_state->composite_quality;
@@ -542,6 +573,7 @@ GdipSaveGraphics (GpGraphics *graphics, unsigned int *state)
 		GdipDeleteRegion (pos_state->clip);
 	GdipCloneRegion (graphics->clip, &pos_state->clip);
 	gdip_cairo_matrix_copy (&pos_state->clip_matrix, graphics->clip_matrix);
+	pos_state->clip_generation = graphics->clip_generation;
 
 	pos_state->composite_mode = graphics->composite_mode;
 	pos_state->composite_quality = graphics->composite_quality;
@@ -592,9 +624,15 @@ apply_world_to_bounds (GpGraphics *graphics)
 GpStatus WINGDIPAPI
 GdipResetWorldTransform (GpGraphics *graphics)
 {
+	GpStatus status;
+
 	if (!graphics)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	GdipInvertMatrix (graphics->clip_matrix);
 	apply_world_to_bounds (graphics);
 
@@ -602,6 +640,7 @@ GdipResetWorldTransform (GpGraphics *graphics)
 	cairo_matrix_init_identity (graphics->clip_matrix);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return cairo_ResetWorldTransform (graphics);
 	case GraphicsBackEndMetafile:
@@ -620,6 +659,10 @@ GdipSetWorldTransform (GpGraphics *graphics, GpMatrix *matrix)
 	if (!graphics || !matrix)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
@@ -639,6 +682,7 @@ GdipSetWorldTransform (GpGraphics *graphics, GpMatrix *matrix)
 	GdipInvertMatrix (graphics->clip_matrix);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return cairo_SetWorldTransform (graphics, matrix);
 	case GraphicsBackEndMetafile:
@@ -681,6 +725,10 @@ GdipMultiplyWorldTransform (GpGraphics *graphics, GpMatrix *matrix, GpMatrixOrde
 	if (!graphics)
 		return InvalidParameter;
 
+	s = gdip_deferred_flush (graphics);
+	if (s != Ok)
+		return s;
+
 	/* the matrix MUST be invertible to be used */
 	s = GdipIsMatrixInvertible (matrix, &invertible);
 	if (!invertible || (s != Ok))
@@ -703,6 +751,7 @@ GdipMultiplyWorldTransform (GpGraphics *graphics, GpMatrix *matrix, GpMatrixOrde
 	apply_world_to_bounds (graphics);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* not a typo - we apply to calculated matrix to cairo context */
 		return cairo_SetWorldTransform (graphics, graphics->copy_of_ctm);
@@ -721,6 +770,10 @@ GdipRotateWorldTransform (GpGraphics *graphics, float angle, GpMatrixOrder order
 	if (!graphics)
 		return InvalidParameter;
 
+	s = gdip_deferred_flush (graphics);
+	if (s != Ok)
+		return s;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
@@ -735,6 +788,7 @@ GdipRotateWorldTransform (GpGraphics *graphics, float angle, GpMatrixOrder order
 	apply_world_to_bounds (graphics);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* not a typo - we apply to calculated matrix to cairo context */
 		return cairo_SetWorldTransform (graphics, graphics->copy_of_ctm);
@@ -753,6 +807,10 @@ GdipScaleWorldTransform (GpGraphics *graphics, float sx, float sy, GpMatrixOrder
 	if (!graphics || (sx == 0.0f) || (sy == 0.0f))
 		return InvalidParameter;
 
+	s = gdip_deferred_flush (graphics);
+	if (s != Ok)
+		return s;
+
 	s = GdipScaleMatrix (graphics->copy_of_ctm, sx, sy, order);
 	if (s != Ok)
 		return s;
@@ -764,6 +822,7 @@ GdipScaleWorldTransform (GpGraphics *graphics, float sx, float sy, GpMatrixOrder
 	apply_world_to_bounds (graphics);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* not a typo - we apply to calculated matrix to cairo context */
 		return cairo_SetWorldTransform (graphics, graphics->copy_of_ctm);
@@ -782,6 +841,10 @@ GdipTranslateWorldTransform (GpGraphics *graphics, float dx, float dy, GpMatrixO
 	if (!graphics)
 		return InvalidParameter;
 
+	s = gdip_deferred_flush (graphics);
+	if (s != Ok)
+		return s;
+
 	s = GdipTranslateMatrix (graphics->copy_of_ctm, dx, dy, order);
 	if (s != Ok) 
 		return s;
@@ -793,6 +856,7 @@ GdipTranslateWorldTransform (GpGraphics *graphics, float dx, float dy, GpMatrixO
 	apply_world_to_bounds (graphics);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* not a typo - we apply to calculated matrix to cairo context */
 		return cairo_SetWorldTransform (graphics, graphics->copy_of_ctm);
@@ -810,10 +874,17 @@ GdipTranslateWorldTransform (GpGraphics *graphics, float dx, float dy, GpMatrixO
 GpStatus WINGDIPAPI
 GdipDrawArc (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL height, REAL startAngle, REAL sweepAngle)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawArc (graphics, pen, x, y, width, height, startAngle, sweepAngle);
 	case GraphicsBackEndMetafile:
@@ -826,10 +897,17 @@ GdipDrawArc (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL
 GpStatus WINGDIPAPI
 GdipDrawArcI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT height, REAL startAngle, REAL sweepAngle)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawArcI (graphics, pen, x, y, width, height, startAngle, sweepAngle);
 	case GraphicsBackEndMetafile:
@@ -843,10 +921,17 @@ GpStatus WINGDIPAPI
 GdipDrawBezier (GpGraphics *graphics, GpPen *pen, REAL x1, REAL y1, REAL x2, REAL y2, REAL x3, REAL y3,
 	REAL x4, REAL y4)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawBezier (graphics, pen, x1, y1, x2, y2, x3, y3, x4, y4);
 	case GraphicsBackEndMetafile:
@@ -859,10 +944,17 @@ GdipDrawBezier (GpGraphics *graphics, GpPen *pen, REAL x1, REAL y1, REAL x2, REA
 GpStatus WINGDIPAPI
 GdipDrawBezierI (GpGraphics *graphics, GpPen *pen, INT x1, INT y1, INT x2, INT y2, INT x3, INT y3, INT x4, INT y4)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawBezierI (graphics, pen, x1, y1, x2, y2, x3, y3, x4, y4);
 	case GraphicsBackEndMetafile:
@@ -875,6 +967,8 @@ GdipDrawBezierI (GpGraphics *graphics, GpPen *pen, INT x1, INT y1, INT x2, INT y
 GpStatus WINGDIPAPI
 GdipDrawBeziers (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, INT count)
 {
+	GpStatus status;
+
 	if (count == 0)
 		return Ok;
 
@@ -882,6 +976,11 @@ GdipDrawBeziers (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, I
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawBeziers (graphics, pen, points, count);
 	case GraphicsBackEndMetafile:
@@ -894,6 +993,8 @@ GdipDrawBeziers (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, I
 GpStatus WINGDIPAPI
 GdipDrawBeziersI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, INT count)
 {
+	GpStatus status;
+
 	if (count == 0)
 		return Ok;
 
@@ -901,6 +1002,11 @@ GdipDrawBeziersI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, I
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawBeziersI (graphics, pen, points, count);
 	case GraphicsBackEndMetafile:
@@ -913,10 +1019,17 @@ GdipDrawBeziersI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, I
 GpStatus WINGDIPAPI
 GdipDrawEllipse (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL height)
 {	
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 	
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawEllipse (graphics, pen, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -929,10 +1042,17 @@ GdipDrawEllipse (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, R
 GpStatus WINGDIPAPI
 GdipDrawEllipseI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT height)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawEllipseI (graphics, pen, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -945,10 +1065,17 @@ GdipDrawEllipseI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT
 GpStatus WINGDIPAPI
 GdipDrawLine (GpGraphics *graphics, GpPen *pen, REAL x1, REAL y1, REAL x2, REAL y2)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawLine (graphics, pen, x1, y1, x2, y2);
 	case GraphicsBackEndMetafile:
@@ -961,10 +1088,17 @@ GdipDrawLine (GpGraphics *graphics, GpPen *pen, REAL x1, REAL y1, REAL x2, REAL
 GpStatus WINGDIPAPI
 GdipDrawLineI (GpGraphics *graphics, GpPen *pen, INT x1, INT y1, INT x2, INT y2)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawLineI (graphics, pen, x1, y1, x2, y2);
 	case GraphicsBackEndMetafile:
@@ -977,10 +1111,17 @@ GdipDrawLineI (GpGraphics *graphics, GpPen *pen, INT x1, INT y1, INT x2, INT y2)
 GpStatus WINGDIPAPI
 GdipDrawLines (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, INT count)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !points || count < 2)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawLines (graphics, pen, points, count);
 	case GraphicsBackEndMetafile:
@@ -993,10 +1134,17 @@ GdipDrawLines (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, INT
 GpStatus WINGDIPAPI
 GdipDrawLinesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, INT count)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !points || count < 2)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawLinesI (graphics, pen, points, count);
 	case GraphicsBackEndMetafile:
@@ -1009,10 +1157,17 @@ GdipDrawLinesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, INT
 GpStatus WINGDIPAPI
 GdipDrawPath (GpGraphics *graphics, GpPen *pen, GpPath *path)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !path)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawPath (graphics, pen, path);
 	case GraphicsBackEndMetafile:
@@ -1025,6 +1180,8 @@ GdipDrawPath (GpGraphics *graphics, GpPen *pen, GpPath *path)
 GpStatus WINGDIPAPI
 GdipDrawPie (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL height, REAL startAngle, REAL sweepAngle)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
@@ -1033,6 +1190,11 @@ GdipDrawPie (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawPie (graphics, pen, x, y, width, height, startAngle, sweepAngle);
 	case GraphicsBackEndMetafile:
@@ -1045,6 +1207,8 @@ GdipDrawPie (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL
 GpStatus WINGDIPAPI
 GdipDrawPieI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT height, REAL startAngle, REAL sweepAngle)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
@@ -1053,6 +1217,11 @@ GdipDrawPieI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT hei
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawPieI (graphics, pen, x, y, width, height, startAngle, sweepAngle);
 	case GraphicsBackEndMetafile:
@@ -1065,10 +1234,17 @@ GdipDrawPieI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT hei
 GpStatus WINGDIPAPI
 GdipDrawPolygon (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, INT count)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !points || count < 2)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawPolygon (graphics, pen, points, count);
 	case GraphicsBackEndMetafile:
@@ -1081,10 +1257,17 @@ GdipDrawPolygon (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, I
 GpStatus WINGDIPAPI
 GdipDrawPolygonI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, INT count)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !points || count < 2)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawPolygonI (graphics, pen, points, count);
 	case GraphicsBackEndMetafile:
@@ -1097,6 +1280,8 @@ GdipDrawPolygonI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, I
 GpStatus WINGDIPAPI
 GdipDrawRectangle (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width, REAL height)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
@@ -1105,6 +1290,11 @@ GdipDrawRectangle (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width,
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawRectangle (graphics, pen, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -1117,6 +1307,8 @@ GdipDrawRectangle (GpGraphics *graphics, GpPen *pen, REAL x, REAL y, REAL width,
 GpStatus WINGDIPAPI
 GdipDrawRectangleI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, INT height)
 {
+	GpStatus status;
+
 	if (!graphics || !pen)
 		return InvalidParameter;
 
@@ -1125,6 +1317,11 @@ GdipDrawRectangleI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, I
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawRectangle (graphics, pen, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -1137,10 +1334,17 @@ GdipDrawRectangleI (GpGraphics *graphics, GpPen *pen, INT x, INT y, INT width, I
 GpStatus WINGDIPAPI
 GdipDrawRectangles (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRectF *rects, INT count)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !rects || count <= 0)
 		return InvalidParameter;
 	
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawRectangles (graphics, pen, rects, count);
 	case GraphicsBackEndMetafile:
@@ -1153,10 +1357,17 @@ GdipDrawRectangles (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRectF *rects,
 GpStatus WINGDIPAPI
 GdipDrawRectanglesI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpRect *rects, INT count)
 {
+	GpStatus status;
+
 	if (!graphics || !pen || !rects || count <= 0)
 		return InvalidParameter;
 	
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawRectanglesI (graphics, pen, rects, count);
 	case GraphicsBackEndMetafile:
@@ -1181,6 +1392,8 @@ GdipDrawClosedCurveI (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *point
 GpStatus WINGDIPAPI
 GdipDrawClosedCurve2 (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *points, INT count, REAL tension)
 {
+	GpStatus status;
+
 	/* when tension is 0, draw straight lines */
 	if (tension == 0)
 		return GdipDrawPolygon (graphics, pen, points, count);
@@ -1189,6 +1402,11 @@ GdipDrawClosedCurve2 (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *poin
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawClosedCurve2 (graphics, pen, points, count, tension);
 	case GraphicsBackEndMetafile:
@@ -1201,6 +1419,8 @@ GdipDrawClosedCurve2 (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPointF *poin
 GpStatus WINGDIPAPI
 GdipDrawClosedCurve2I (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *points, INT count, REAL tension)
 {
+	GpStatus status;
+
 	/* when tension is 0, draw straight lines */
 	if (tension == 0)
 		return GdipDrawPolygonI (graphics, pen, points, count);
@@ -1209,6 +1429,11 @@ GdipDrawClosedCurve2I (GpGraphics *graphics, GpPen *pen, GDIPCONST GpPoint *poin
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawClosedCurve2I (graphics, pen, points, count, tension);
 	case GraphicsBackEndMetafile:
@@ -1265,6 +1490,8 @@ GdipDrawCurve2I (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPoint *points, IN
 GpStatus WINGDIPAPI
 GdipDrawCurve3 (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPointF *points, INT count, INT offset, INT numOfSegments, REAL tension)
 {
+	GpStatus status;
+
 	/* draw lines if tension = 0 */
 	if (tension == 0)
 		return GdipDrawLines (graphics, pen, points, count);
@@ -1280,6 +1507,11 @@ GdipDrawCurve3 (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPointF *points, IN
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawCurve3 (graphics, pen, points, count, offset, numOfSegments, tension);
 	case GraphicsBackEndMetafile:
@@ -1292,6 +1524,8 @@ GdipDrawCurve3 (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPointF *points, IN
 GpStatus WINGDIPAPI
 GdipDrawCurve3I (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPoint *points, INT count, INT offset, INT numOfSegments, REAL tension)
 {
+	GpStatus status;
+
 	/* draw lines if tension = 0 */
 	if (tension == 0)
 		return GdipDrawLinesI (graphics, pen, points, count);
@@ -1307,6 +1541,11 @@ GdipDrawCurve3I (GpGraphics *graphics, GpPen* pen, GDIPCONST GpPoint *points, IN
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_DrawCurve3I (graphics, pen, points, count, offset, numOfSegments, tension);
 	case GraphicsBackEndMetafile:
@@ -1326,6 +1565,8 @@ GdipFillEllipse (GpGraphics *graphics, GpBrush *brush, REAL x, REAL y, REAL widt
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		return deferred_FillEllipse (graphics, brush, x, y, width, height);
 	case GraphicsBackEndCairo:
 		return cairo_FillEllipse (graphics, brush, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -1342,6 +1583,8 @@ GdipFillEllipseI (GpGraphics *graphics, GpBrush *brush, INT x, INT y, INT width,
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		return deferred_FillEllipseI (graphics, brush, x, y, width, height);
 	case GraphicsBackEndCairo:
 		return cairo_FillEllipseI (graphics, brush, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -1362,6 +1605,8 @@ GdipFillRectangle (GpGraphics *graphics, GpBrush *brush, REAL x, REAL y, REAL wi
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		return deferred_FillRectangle (graphics, brush, x, y, width, height);
 	case GraphicsBackEndCairo:
 		return cairo_FillRectangle (graphics, brush, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -1382,6 +1627,8 @@ GdipFillRectangleI (GpGraphics *graphics, GpBrush *brush, INT x, INT y, INT widt
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		return deferred_FillRectangleI (graphics, brush, x, y, width, height);
 	case GraphicsBackEndCairo:
 		return cairo_FillRectangleI (graphics, brush, x, y, width, height);
 	case GraphicsBackEndMetafile:
@@ -1398,6 +1645,8 @@ GdipFillRectangles (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRectF *rec
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		return deferred_FillRectangles (graphics, brush, rects, count);
 	case GraphicsBackEndCairo:
 		return cairo_FillRectangles (graphics, brush, rects, count);
 	case GraphicsBackEndMetafile:
@@ -1414,6 +1663,8 @@ GdipFillRectanglesI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpRect *rec
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		return deferred_FillRectanglesI (graphics, brush, rects, count);
 	case GraphicsBackEndCairo:
 		return cairo_FillRectanglesI (graphics, brush, rects, count);
 	case GraphicsBackEndMetafile:
@@ -1427,6 +1678,8 @@ GpStatus WINGDIPAPI
 GdipFillPie (GpGraphics *graphics, GpBrush *brush, REAL x, REAL y, REAL width, REAL height,
 	REAL startAngle, REAL sweepAngle)
 {
+	GpStatus status;
+
 	if (!graphics || !brush)
 		return InvalidParameter;
 
@@ -1435,6 +1688,11 @@ GdipFillPie (GpGraphics *graphics, GpBrush *brush, REAL x, REAL y, REAL width, R
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillPie (graphics, brush, x, y, width, height, startAngle, sweepAngle);
 	case GraphicsBackEndMetafile:
@@ -1447,6 +1705,8 @@ GdipFillPie (GpGraphics *graphics, GpBrush *brush, REAL x, REAL y, REAL width, R
 GpStatus WINGDIPAPI
 GdipFillPieI (GpGraphics *graphics, GpBrush *brush, INT x, INT y, INT width, INT height, REAL startAngle, REAL sweepAngle)
 {
+	GpStatus status;
+
 	if (!graphics || !brush)
 		return InvalidParameter;
 
@@ -1455,6 +1715,11 @@ GdipFillPieI (GpGraphics *graphics, GpBrush *brush, INT x, INT y, INT width, INT
 		return Ok;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillPieI (graphics, brush, x, y, width, height, startAngle, sweepAngle);
 	case GraphicsBackEndMetafile:
@@ -1467,10 +1732,17 @@ GdipFillPieI (GpGraphics *graphics, GpBrush *brush, INT x, INT y, INT width, INT
 GpStatus WINGDIPAPI
 GdipFillPath (GpGraphics *graphics, GpBrush *brush, GpPath *path)
 {
+	GpStatus status;
+
 	if (!graphics || !brush || !path)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillPath (graphics, brush, path);
 	case GraphicsBackEndMetafile:
@@ -1483,10 +1755,17 @@ GdipFillPath (GpGraphics *graphics, GpBrush *brush, GpPath *path)
 GpStatus WINGDIPAPI
 GdipFillPolygon (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *points, INT count, FillMode fillMode)
 {
+	GpStatus status;
+
 	if (!graphics || !brush || !points)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillPolygon (graphics, brush, points, count, fillMode);
 	case GraphicsBackEndMetafile:
@@ -1499,10 +1778,17 @@ GdipFillPolygon (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *point
 GpStatus WINGDIPAPI
 GdipFillPolygonI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *points, INT count, FillMode fillMode)
 {
+	GpStatus status;
+
 	if (!graphics || !brush || !points)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillPolygonI (graphics, brush, points, count, fillMode);
 	case GraphicsBackEndMetafile:
@@ -1539,6 +1825,8 @@ GdipFillClosedCurveI (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *p
 GpStatus WINGDIPAPI
 GdipFillClosedCurve2 (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *points, INT count, REAL tension)
 {
+	GpStatus status;
+
 	/* when tension is 0, the edges are straight lines */
 	if (tension == 0)
 		return GdipFillPolygon2 (graphics, brush, points, count);
@@ -1547,6 +1835,11 @@ GdipFillClosedCurve2 (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillClosedCurve2 (graphics, brush, points, count, tension);
 	case GraphicsBackEndMetafile:
@@ -1559,6 +1852,8 @@ GdipFillClosedCurve2 (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPointF *
 GpStatus WINGDIPAPI
 GdipFillClosedCurve2I (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *points, INT count, REAL tension)
 {
+	GpStatus status;
+
 	/* when tension is 0, the edges are straight lines */
 	if (tension == 0)
 		return GdipFillPolygon2I (graphics, brush, points, count);
@@ -1567,6 +1862,11 @@ GdipFillClosedCurve2I (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillClosedCurve2I (graphics, brush, points, count, tension);
 	case GraphicsBackEndMetafile:
@@ -1579,10 +1879,17 @@ GdipFillClosedCurve2I (GpGraphics *graphics, GpBrush *brush, GDIPCONST GpPoint *
 GpStatus WINGDIPAPI
 GdipFillRegion (GpGraphics *graphics, GpBrush *brush, GpRegion *region)
 {
+	GpStatus status;
+
 	if (!graphics || !brush || !region)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_FillRegion (graphics, brush, region);
 	case GraphicsBackEndMetafile:
@@ -1595,16 +1902,23 @@ GdipFillRegion (GpGraphics *graphics, GpBrush *brush, GpRegion *region)
 GpStatus WINGDIPAPI
 GdipSetRenderingOrigin (GpGraphics *graphics, INT x, INT y)
 {
+	GpStatus status;
+
 	if (!graphics)
 		return InvalidParameter;
 	
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	graphics->render_origin_x = x;
 	graphics->render_origin_y = y;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return Ok;
 	case GraphicsBackEndMetafile:
@@ -1658,10 +1972,17 @@ GdipGetDpiY (GpGraphics *graphics, REAL *dpi)
 GpStatus WINGDIPAPI
 GdipGraphicsClear (GpGraphics *graphics, ARGB color)
 {
+	GpStatus status;
+
 	if (!graphics)
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return cairo_GraphicsClear (graphics, color);
 	case GraphicsBackEndMetafile:
@@ -1674,9 +1995,15 @@ GdipGraphicsClear (GpGraphics *graphics, ARGB color)
 GpStatus WINGDIPAPI
 GdipSetInterpolationMode (GpGraphics *graphics, InterpolationMode interpolationMode)
 {
+	GpStatus status;
+
 	if (!graphics || interpolationMode <= InterpolationModeInvalid || interpolationMode > InterpolationModeHighQualityBicubic)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
@@ -1694,6 +2021,7 @@ GdipSetInterpolationMode (GpGraphics *graphics, InterpolationMode interpolationM
 	}
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return Ok;
 	case GraphicsBackEndMetafile:
@@ -1719,15 +2047,22 @@ GdipGetInterpolationMode (GpGraphics *graphics, InterpolationMode *imode)
 GpStatus WINGDIPAPI
 GdipSetTextRenderingHint (GpGraphics *graphics, TextRenderingHint mode)
 {
+	GpStatus status;
+
 	if (!graphics || mode < TextRenderingHintSystemDefault || mode > TextRenderingHintClearTypeGridFit)
 		return InvalidParameter;
 	
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	graphics->text_mode = mode;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return Ok;
 	case GraphicsBackEndMetafile:
@@ -1754,15 +2089,22 @@ GdipGetTextRenderingHint (GpGraphics *graphics, TextRenderingHint *mode)
 GpStatus WINGDIPAPI
 GdipSetPixelOffsetMode (GpGraphics *graphics, PixelOffsetMode pixelOffsetMode)
 {
+	GpStatus status;
+
 	if (!graphics || pixelOffsetMode <= PixelOffsetModeInvalid || pixelOffsetMode > PixelOffsetModeHalf)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 	
 	graphics->pixel_mode = pixelOffsetMode;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* FIXME: changing pixel mode affects other properties (e.g. the visible clip bounds) */
 		return Ok;
@@ -1791,17 +2133,24 @@ GdipGetPixelOffsetMode (GpGraphics *graphics, PixelOffsetMode *pixelOffsetMode)
 GpStatus WINGDIPAPI
 GdipSetTextContrast (GpGraphics *graphics, UINT contrast)
 {
+	GpStatus status;
+
 	/* The gamma correction value must be between 0 and 12.
 	 * The default value is 4. */
 	if (!graphics || contrast > 12)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
 	graphics->text_contrast = contrast;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return Ok;
 	case GraphicsBackEndMetafile:
@@ -1828,9 +2177,15 @@ GdipGetTextContrast (GpGraphics *graphics, UINT *contrast)
 GpStatus WINGDIPAPI
 GdipSetSmoothingMode (GpGraphics *graphics, SmoothingMode mode)
 {
+	GpStatus status;
+
 	if (!graphics || mode <= SmoothingModeInvalid || mode > SmoothingModeAntiAlias)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
@@ -1848,6 +2203,7 @@ GdipSetSmoothingMode (GpGraphics *graphics, SmoothingMode mode)
 	}
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return cairo_SetSmoothingMode (graphics, mode);
 	case GraphicsBackEndMetafile:
@@ -1933,6 +2289,7 @@ GpStatus WINGDIPAPI
 GdipFlush (GpGraphics *graphics, GpFlushIntention intention)
 {
 	cairo_surface_t* surface;
+	GpStatus status;
 
 	if (!graphics)
 		return InvalidParameter;
@@ -1940,6 +2297,10 @@ GdipFlush (GpGraphics *graphics, GpFlushIntention intention)
 	if (graphics->state != GraphicsStateValid)
 		return ObjectBusy;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	surface = cairo_get_target (graphics->ct);
 	cairo_surface_flush (surface);
 
@@ -1959,6 +2320,70 @@ GdipFlush (GpGraphics *graphics, GpFlushIntention intention)
 	return Ok;
 }
 
+/*
+ * Solid rectangle and ellipse fills are queued, and drawn together, when another call needs them (e.g. a state
+ * change or a different drawing), at GdipFlush, GdipGetDC and GdipDeleteGraphics. Until then the image doesn't
+ * contain them.
+ */
+GpStatus WINGDIPAPI
+GdipSetDeferredRendering_linux (GpGraphics *graphics, BOOL deferred)
+{
+	GpStatus status;
+
+	if (!graphics)
+		return InvalidParameter;
+
+	if (graphics->state == GraphicsStateBusy)
+		return ObjectBusy;
+
+	switch (graphics->backend) {
+	case GraphicsBackEndCairo:
+		if (deferred)
+			graphics->backend = GraphicsBackEndDeferred;
+		return Ok;
+	case GraphicsBackEndDeferred:
+		if (deferred)
+			return Ok;
+		status = gdip_deferred_flush (graphics);
+		gdip_deferred_free (graphics);
+		graphics->backend = GraphicsBackEndCairo;
+		return status;
+	case GraphicsBackEndMetafile:
+		/* recording a metafile already defers the drawing */
+		return NotImplemented;
+	default:
+		return GenericError;
+	}
+}
+
+GpStatus WINGDIPAPI
+GdipGetDeferredRendering_linux (GpGraphics *graphics, BOOL *deferred)
+{
+	if (!graphics || !deferred)
+		return InvalidParameter;
+
+	*deferred = (graphics->backend == GraphicsBackEndDeferred);
+	return Ok;
+}
+
+/* the number of primitives that were not drawn because they were entirely outside of the clip */
+GpStatus WINGDIPAPI
+GdipGetGraphicsCulledPrimitiveCount_linux (GpGraphics *graphics, UINT *count)
+{
+	if (!graphics || !count)
+		return InvalidParameter;
+
+	*count = graphics->culled_primitives;
+	return Ok;
+}
+
+/* the cached cairo clip path is only valid for a given clip generation */
+static void
+gdip_graphics_clip_changed (GpGraphics *graphics)
+{
+	graphics->clip_generation = ++graphics->last_clip_generation;
+}
+
 GpStatus WINGDIPAPI
 GdipSetClipGraphics (GpGraphics *graphics, GpGraphics *srcgraphics, CombineMode combineMode)
 {
@@ -1981,6 +2406,10 @@ GdipSetClipRect (GpGraphics *graphics, REAL x, REAL y, REAL width, REAL height,
 	if (!graphics)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
@@ -2004,10 +2433,12 @@ GdipSetClipRect (GpGraphics *graphics, REAL x, REAL y, REAL width, REAL height,
 	}
 
 	status = GdipCombineRegionRegion (graphics->clip, region, combineMode);	
+	gdip_graphics_clip_changed (graphics);
 	if (status != Ok)
 		goto cleanup;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* adjust cairo clipping according to graphics->clip */
 		status = cairo_SetGraphicsClip (graphics);
@@ -2041,6 +2472,10 @@ GdipSetClipPath (GpGraphics *graphics, GpPath *path, CombineMode combineMode)
 	if (!graphics || !path)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	/* if the matrix is empty, avoid path cloning and transform */
 	if (gdip_is_matrix_empty (graphics->clip_matrix)) {
 		work = path;
@@ -2057,10 +2492,12 @@ GdipSetClipPath (GpGraphics *graphics, GpPath *path, CombineMode combineMode)
 	}
 
 	status = GdipCombineRegionPath (graphics->clip, work, combineMode);	
+	gdip_graphics_clip_changed (graphics);
 	if (status != Ok)
 		goto cleanup;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* adjust cairo clipping according to graphics->clip */
 		status = cairo_SetGraphicsClip (graphics);
@@ -2088,6 +2525,10 @@ GdipSetClipRegion (GpGraphics *graphics, GpRegion *region, CombineMode combineMo
 	if (!graphics || !region)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
@@ -2105,10 +2546,12 @@ GdipSetClipRegion (GpGraphics *graphics, GpRegion *region, CombineMode combineMo
 	}
 
 	status = GdipCombineRegionRegion (graphics->clip, work, combineMode);
+	gdip_graphics_clip_changed (graphics);
 	if (status != Ok)
 		goto cleanup;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* adjust cairo clipping according to graphics->clip */
 		status = cairo_SetGraphicsClip (graphics);
@@ -2145,16 +2588,24 @@ GdipSetClipHrgn (GpGraphics *graphics, void *hRgn, CombineMode combineMode)
 GpStatus WINGDIPAPI
 GdipResetClip (GpGraphics *graphics)
 {
+	GpStatus status;
+
 	if (!graphics)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
 	GdipSetInfinite (graphics->clip);
 	cairo_matrix_init_identity (graphics->clip_matrix);
+	gdip_graphics_clip_changed (graphics);
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return cairo_ResetClip (graphics);
 	case GraphicsBackEndMetafile:
@@ -2172,14 +2623,20 @@ GdipTranslateClip (GpGraphics *graphics, REAL dx, REAL dy)
 	if (!graphics)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
 	status = GdipTranslateRegion (graphics->clip, dx, dy);
+	gdip_graphics_clip_changed (graphics);
 	if (status != Ok)
 		return status;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* adjust cairo clipping according to graphics->clip */
 		return cairo_SetGraphicsClip (graphics);
@@ -2348,9 +2805,34 @@ GdipIsVisibleClipEmpty (GpGraphics *graphics, BOOL *result)
 	return Ok;
 }
 
+/* the clip in world coordinates, see GdipGetClip; only a copy when the clip matrix isn't empty */
+static GpStatus
+gdip_get_world_clip (GpGraphics *graphics, GpRegion **clip)
+{
+	GpStatus status;
+
+	if (gdip_is_matrix_empty (graphics->clip_matrix)) {
+		*clip = graphics->clip;
+		return Ok;
+	}
+
+	status = GdipCloneRegion (graphics->clip, clip);
+	if (status != Ok)
+		return status;
+
+	status = GdipTransformRegion (*clip, graphics->clip_matrix);
+	if (status != Ok) {
+		GdipDeleteRegion (*clip);
+		return status;
+	}
+	return Ok;
+}
+
 GpStatus WINGDIPAPI
 GdipIsVisiblePoint (GpGraphics *graphics, REAL x, REAL y, BOOL *result)
 {
+	GpStatus status;
+	GpRegion *clip;
 	GpRectF rectF;
 
 	if (!graphics || !result)
@@ -2362,8 +2844,29 @@ GdipIsVisiblePoint (GpGraphics *graphics, REAL x, REAL y, BOOL *result)
 	rectF.Height = graphics->bounds.Height;	
 
 	*result = gdip_is_Point_in_RectF_inclusive (x, y, &rectF);
+	if (!*result || gdip_is_InfiniteRegion (graphics->clip))
+		return Ok;
 
-	return Ok;
+	/* (optimization) a pixel aligned rectangular clip is known in device space */
+	if (graphics->clip_is_rect) {
+		double dx = x, dy = y;
+		GpRect *clip = &graphics->clip_rect;
+
+		gdip_world_to_device (graphics, &dx, &dy);
+		dx = floor (dx);
+		dy = floor (dy);
+		*result = (dx >= clip->X) && (dx < clip->X + clip->Width) && (dy >= clip->Y) && (dy < clip->Y + clip->Height);
+		return Ok;
+	}
+
+	status = gdip_get_world_clip (graphics, &clip);
+	if (status != Ok)
+		return status;
+
+	status = GdipIsVisibleRegionPoint (clip, x, y, graphics, result);
+	if (clip != graphics->clip)
+		GdipDeleteRegion (clip);
+	return status;
 }
 
 GpStatus WINGDIPAPI
@@ -2375,6 +2878,8 @@ GdipIsVisiblePointI (GpGraphics *graphics, INT x, INT y, BOOL *result)
 GpStatus WINGDIPAPI
 GdipIsVisibleRect (GpGraphics *graphics, REAL x, REAL y, REAL width, REAL height, BOOL *result)
 {
+	GpStatus status;
+	GpRegion *clip;
 	BOOL found = FALSE;
 	float posy, posx;
 	GpRectF recthit, boundsF;
@@ -2398,7 +2903,7 @@ GdipIsVisibleRect (GpGraphics *graphics, REAL x, REAL y, REAL width, REAL height
 	recthit.Height = height;
 
 	/* Any point of intersection ?*/
-	for (posy = 0; posy < recthit.Height+1; posy++) {	
+	for (posy = 0; (posy < recthit.Height+1) && !found; posy++) {	
 		for (posx = 0; posx < recthit.Width +1; posx++) {
 			if (gdip_is_Point_in_RectF_inclusive (recthit.X + posx , recthit.Y + posy, &boundsF) == TRUE) {
 				found = TRUE;
@@ -2407,8 +2912,31 @@ GdipIsVisibleRect (GpGraphics *graphics, REAL x, REAL y, REAL width, REAL height
 		}
 	}
 	
-	*result = found;
-	return Ok;
+	if (!found || gdip_is_InfiniteRegion (graphics->clip)) {
+		*result = found;
+		return Ok;
+	}
+
+	/* (optimization) a pixel aligned rectangular clip is known in device space */
+	if (graphics->clip_is_rect) {
+		double x1 = x, y1 = y, x2 = x + width, y2 = y + height;
+		GpRect *clip = &graphics->clip_rect;
+
+		gdip_world_to_device (graphics, &x1, &y1);
+		gdip_world_to_device (graphics, &x2, &y2);
+		*result = (floor (MIN (x1, x2)) < clip->X + clip->Width) && (ceil (MAX (x1, x2)) > clip->X) &&
+			(floor (MIN (y1, y2)) < clip->Y + clip->Height) && (ceil (MAX (y1, y2)) > clip->Y);
+		return Ok;
+	}
+
+	status = gdip_get_world_clip (graphics, &clip);
+	if (status != Ok)
+		return status;
+
+	status = GdipIsVisibleRegionRect (clip, x, y, width, height, graphics, result);
+	if (clip != graphics->clip)
+		GdipDeleteRegion (clip);
+	return status;
 }
 
 GpStatus WINGDIPAPI
@@ -2420,15 +2948,22 @@ GdipIsVisibleRectI (GpGraphics *graphics, INT x, INT y, INT width, INT height, B
 GpStatus WINGDIPAPI
 GdipSetCompositingMode (GpGraphics *graphics, CompositingMode compositingMode)
 {
+	GpStatus status;
+
 	if (!graphics)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
 	graphics->composite_mode = compositingMode;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return cairo_SetCompositingMode (graphics, compositingMode);
 	case GraphicsBackEndMetafile:
@@ -2454,15 +2989,22 @@ GdipGetCompositingMode (GpGraphics *graphics, CompositingMode *compositingMode)
 GpStatus WINGDIPAPI
 GdipSetCompositingQuality (GpGraphics *graphics, CompositingQuality compositingQuality)
 {
+	GpStatus status;
+
 	if (!graphics)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
 	graphics->composite_quality = compositingQuality;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		/* In Cairo there is no way of setting this, always use high quality */
 		return Ok;
@@ -2495,15 +3037,22 @@ GdipGetNearestColor (GpGraphics *graphics, ARGB *argb)
 GpStatus WINGDIPAPI
 GdipSetPageScale (GpGraphics *graphics, REAL scale)
 {
+	GpStatus status;
+
 	if (!graphics || scale <= 0.0 || scale > 1000000032)
 		return InvalidParameter;
 	
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 	
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	graphics->scale = scale;	
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return Ok;
 	case GraphicsBackEndMetafile:
@@ -2530,15 +3079,22 @@ GdipGetPageScale (GpGraphics *graphics, REAL *scale)
 GpStatus WINGDIPAPI
 GdipSetPageUnit (GpGraphics *graphics, GpUnit unit)
 {
+	GpStatus status;
+
 	if (!graphics || unit <= UnitWorld || unit > UnitCairoPoint)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	if (graphics->state == GraphicsStateBusy)
 		return ObjectBusy;
 
 	graphics->page_unit = unit;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 		return Ok;
 	case GraphicsBackEndMetafile:
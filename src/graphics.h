@@ -164,6 +164,9 @@ GpStatus WINGDIPAPI GdipSetClipRect (GpGraphics *graphics, REAL x, REAL y, REAL
 GpStatus WINGDIPAPI GdipSetClipRectI (GpGraphics *graphics, INT x, INT y, INT width, INT height, CombineMode combineMode);
 GpStatus WINGDIPAPI GdipSetClipRegion (GpGraphics *graphics, GpRegion *region, CombineMode combineMode);
 GpStatus WINGDIPAPI GdipSetVisibleClip_linux (GpGraphics *graphics, GpRect *rect);
+GpStatus WINGDIPAPI GdipSetDeferredRendering_linux (GpGraphics *graphics, BOOL deferred);
+GpStatus WINGDIPAPI GdipGetDeferredRendering_linux (GpGraphics *graphics, BOOL *deferred);
+GpStatus WINGDIPAPI GdipGetGraphicsCulledPrimitiveCount_linux (GpGraphics *graphics, UINT *count);
 GpStatus WINGDIPAPI GdipTranslateClip (GpGraphics *graphics, REAL dx, REAL dy);
 GpStatus WINGDIPAPI GdipTranslateClipI (GpGraphics *graphics, INT dx, INT dy);
 
@@ -22,6 +22,7 @@
 
 #include "gdiplus-private.h"
 #include "icocodec.h"
+#include "pngcodec.h"
 
 GUID gdip_ico_image_format_guid = {0xb96b3cb5U, 0x0728U, 0x11d3U, {0x9d, 0x7b, 0x00, 0x00, 0xf8, 0x1e, 0xf3, 0x2e}};
 
@@ -54,37 +55,28 @@ gdip_getcodecinfo_ico ()
 	return &ico_codec; 
 }
 
-static BYTE
-get_ico_data (BYTE *data, int x, int y, int bpp, int line_length)
-{
-	BYTE result = 0;
-	BYTE *line_data = data + y * line_length;
+/* PNG compressed entries (Vista icons) start with the PNG signature instead of a BITMAPINFOHEADER */
+static const BYTE ico_png_signature[] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
 
-	switch (bpp) {
-	case 1:
-		result = (line_data [x >> 3] >> (7 - (x & 7))) & 0x01;
-		break;
-	case 4:
-		result = line_data [x >> 1];
-		if ((x & 1) == 1)
-			result &= 0x0F;
-		else
-			result >>= 4;
-		break;
-	case 8:
-		result = line_data [x];
-		break;
-	}
-	return result;
-}
+/* size of the chunks used to read the images of the icon into memory */
+#define ICO_READ_CHUNK_SIZE	8192
+
+typedef struct {
+	ICONDIRENTRY	entry;
+	int		index;		/* position in the directory */
+	int		width;
+	int		height;
+	const BYTE	*data;
+	unsigned int	length;
+} IcoImage;
 
 static BOOL
-read_ICONDIRENTRY (void *pointer, ICONDIRENTRY *entry, ImageSource source, BOOL decode)
+read_ICONDIRENTRY (void *pointer, ICONDIRENTRY *entry, ImageSource source)
 {
 	if (gdip_read_ico_data (pointer, (void*)entry, sizeof (ICONDIRENTRY), source) != sizeof (ICONDIRENTRY))
 		return FALSE;
 #if WORDS_BIGENDIAN
-	if (decode) {
+	{
 		BYTE *b;
 		/* entry->bWidth, bHeight, bColorCount, bReserved are all BYTE, no change required */
 		b = (BYTE*)&entry->wPlanes;
@@ -100,89 +92,186 @@ read_ICONDIRENTRY (void *pointer, ICONDIRENTRY *entry, ImageSource source, BOOL
 	return TRUE;
 }
 
+/* the images follow the directory, read them all at once so every entry can be decoded later */
+static BYTE*
+read_ico_images (void *pointer, ImageSource source, unsigned int *length)
+{
+	BYTE *buffer = NULL;
+	unsigned int size = 0;
+	unsigned int capacity = 0;
+	int got;
+
+	do {
+		if (capacity - size < ICO_READ_CHUNK_SIZE) {
+			BYTE *grown;
+
+			capacity = (capacity == 0) ? ICO_READ_CHUNK_SIZE * 2 : capacity * 2;
+			grown = gdip_realloc (buffer, capacity);
+			if (!grown) {
+				GdipFree (buffer);
+				return NULL;
+			}
+			buffer = grown;
+		}
+
+		got = gdip_read_ico_data (pointer, buffer + size, ICO_READ_CHUNK_SIZE, source);
+		if (got > 0)
+			size += got;
+	} while (got == ICO_READ_CHUNK_SIZE);
+
+	*length = size;
+	return buffer;
+}
+
 static GpStatus
-gdip_read_ico_image_from_file_stream (void *pointer, GpImage **image, ImageSource source)
+decode_ico_png (BitmapData *data, const BYTE *raw, unsigned int length)
 {
-	GpStatus status = OutOfMemory;
-	GpBitmap *result = NULL;
-	BYTE *pixels = NULL;
-	WORD w, count;
-	void *p = &w;
-	BYTE *b = (BYTE*)&w;
-	ICONDIRENTRY entry;
-	int i, pos;
-	BOOL upsidedown = TRUE;
-	BOOL os2format = FALSE;
-	BITMAPV5HEADER bih;
-	int palette_entries = -1;
-	ARGB *colors = NULL;
-	int x, y;
-	int line_xor_length, xor_size;
-	int line_and_length, and_size;
-	BYTE *xor_data = NULL, *and_data = NULL;
+	GpStatus status;
+	GpImage *png;
+	BitmapData *png_data;
+	BYTE *pixels;
+	int stride;
 
-	/* WORD ICONDIR.idReserved / reversed, MUST be 0 */
-	if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
-		goto error;
-	if (w != 0)
-		goto error;
+	status = gdip_load_png_image_from_memory (raw, length, &png);
+	if (status != Ok)
+		return (status == UnknownImageFormat) ? OutOfMemory : status;
+
+	png_data = png->active_bitmap;
+	stride = png_data->width * 4;
+	if ((png_data->pixel_format == PixelFormat32bppARGB) && (png_data->stride == stride) &&
+		((png_data->reserved & (GBD_OWN_SCAN0 | GBD_SHARED_SCAN0)) == GBD_OWN_SCAN0)) {
+		/* the decoded pixels are already what we need, take them over */
+		pixels = png_data->scan0;
+		png_data->scan0 = NULL;
+		png_data->reserved &= ~GBD_OWN_SCAN0;
+	} else {
+		Rect rect = { 0, 0, png_data->width, png_data->height };
+		BitmapData locked;
+
+		pixels = GdipAlloc (stride * png_data->height);
+		if (!pixels) {
+			GdipDisposeImage (png);
+			return OutOfMemory;
+		}
 
-	/* WORD ICONDIR.idType / resource type, MUST be 1 for icons */
-	if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
-		goto error;
-	i = (b[1] << 8 | b[0]);
-	if (i != 1)
-		goto error;
+		memset (&locked, 0, sizeof (BitmapData));
+		locked.scan0 = pixels;
+		locked.stride = stride;
+		status = GdipBitmapLockBits (png, &rect, ImageLockModeRead | ImageLockModeUserInputBuf, PixelFormat32bppARGB, &locked);
+		if (status == Ok)
+			GdipBitmapUnlockBits (png, &locked);
+		if (status != Ok) {
+			GdipFree (pixels);
+			GdipDisposeImage (png);
+			return status;
+		}
+	}
 
-	/* WORD ICONDIR.idCount / number of icons, must be greater than 0 */
-	if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
-		goto error;
-	count = (b[1] << 8 | b[0]); 
-	if (count < 1)
-		goto error;
+	/* the size stored in the directory isn't trusted, the PNG header is */
+	data->width = png_data->width;
+	data->height = png_data->height;
+	data->stride = stride;
+	data->scan0 = pixels;
+	data->reserved = GBD_OWN_SCAN0;
 
-	pos = 6;
-	/*
-	 * NOTE: it looks like (from unit tests) that we get the last icon 
-	 * (e.g. it can return the 16 pixel version, instead of the 32 or 48 pixels available in the same file)
-	 */ 
-	for (i = 0; i < count - 1; i++) {
-		if (!read_ICONDIRENTRY (pointer, &entry, source, FALSE))
-			goto error;
-		pos += sizeof (ICONDIRENTRY);
+	GdipDisposeImage (png);
+	return Ok;
+}
+
+/*
+ * Let's build the 32bpp ARGB bitmap from the icon's XOR and AND bitmaps
+ * notes:
+ * - XORBitmap can be a 1, 4, 8, 24 or 32 bpp bitmap
+ * - ANDBitmap is *always* a monochrome (1bpp) bitmap
+ * - in every case each line is padded to 32 bits boundary
+ * - lines are stored bottom-up
+ * Each line is merged straight into scan0, eight pixels (one byte of the AND mask) at a time.
+ */
+static void
+merge_ico_line (ARGB *target, const BYTE *xor_line, const BYTE *and_line, int width, int bpp, const ARGB *colors)
+{
+	int x, bit;
+
+	if (bpp == 32) {
+		/* the alpha channel is part of the XOR bitmap, the AND mask is ignored */
+#if WORDS_BIGENDIAN
+		for (x = 0; x < width; x++, xor_line += 4)
+			target [x] = xor_line [0] | xor_line [1] << 8 | xor_line [2] << 16 | xor_line [3] << 24;
+#else
+		memcpy (target, xor_line, width * sizeof (ARGB));
+#endif
+		return;
 	}
-	/* last one is important, so we must decode (endianess) it's values */
-	if (!read_ICONDIRENTRY (pointer, &entry, source, TRUE))
-		goto error;
-	pos += sizeof (ICONDIRENTRY);
 
-	while (pos < entry.dwImageOffset) {
-		if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
-			goto error;
-		pos += sizeof (WORD);
+	for (x = 0; x < width; x += 8) {
+		BYTE mask = and_line [x >> 3];
+		int count = (width - x < 8) ? width - x : 8;
+
+		switch (bpp) {
+		case 1: {
+			BYTE indexes = xor_line [x >> 3];
+			for (bit = 0; bit < count; bit++)
+				target [x + bit] = colors [(indexes >> (7 - bit)) & 0x01];
+			break;
+		}
+		case 4:
+			for (bit = 0; bit < count; bit += 2) {
+				BYTE indexes = xor_line [(x + bit) >> 1];
+				target [x + bit] = colors [indexes >> 4];
+				if (bit + 1 < count)
+					target [x + bit + 1] = colors [indexes & 0x0F];
+			}
+			break;
+		case 8:
+			for (bit = 0; bit < count; bit++)
+				target [x + bit] = colors [xor_line [x + bit]];
+			break;
+		case 24: {
+			/* 24bits icons only get a 1bpp alpha, from the AND mask, transparent pixels are black */
+			const BYTE *bgr = xor_line + x * 3;
+			for (bit = 0; bit < count; bit++, bgr += 3)
+				target [x + bit] = 0xFF000000 | bgr [0] | bgr [1] << 8 | bgr [2] << 16;
+			break;
+		}
+		}
+
+		/* most icons are fully opaque in large areas, skip the mask when it doesn't hide anything */
+		if (mask == 0)
+			continue;
+
+		for (bit = 0; bit < count; bit++) {
+			if (mask & (0x80 >> bit))
+				target [x + bit] = (bpp == 24) ? 0 : target [x + bit] & 0x00FFFFFF;
+		}
 	}
+}
+
+static GpStatus
+decode_ico_bmp (BitmapData *data, const BYTE *raw, unsigned int length)
+{
+	MemorySource ms;
+	BOOL upsidedown = TRUE;
+	BOOL os2format = FALSE;
+	BITMAPV5HEADER bih;
+	int palette_entries = -1;
+	ColorPalette *palette;
+	BYTE *pixels;
+	int i, y;
+	int line_xor_length, xor_size;
+	int line_and_length, and_size;
+	const BYTE *xor_data, *and_data;
+	GpStatus status;
+
+	ms.ptr = (BYTE *) raw;
+	ms.size = length;
+	ms.pos = 0;
 
 	/* BITMAPINFOHEADER */
-	status = gdip_read_BITMAPINFOHEADER (pointer, source, &bih, &os2format, &upsidedown);
+	status = gdip_read_BITMAPINFOHEADER (&ms, Memory, &bih, &os2format, &upsidedown);
 	if (status != Ok)
-		goto error;
-	
-	result = gdip_bitmap_new_with_frame (NULL, TRUE);
-	if (!result) {
-		status = OutOfMemory;
-		goto error;
-	}
-
-	result->type = ImageTypeBitmap;
-	result->image_format = ICON;
-	result->active_bitmap->pixel_format = PixelFormat32bppARGB; /* icons are always promoted to 32 bbp */
-	result->active_bitmap->width = entry.bWidth;
-	result->active_bitmap->height = entry.bHeight;
-	result->active_bitmap->stride = result->active_bitmap->width * 4;
-	/* Ensure 32bits alignment */
-	gdip_align_stride (result->active_bitmap->stride);
-	result->active_bitmap->dpi_horz = 96.0f;
-	result->active_bitmap->dpi_vert = 96.0f;
+		return status;
+	if (ms.pos < (int) bih.bV5Size)
+		return OutOfMemory;
 
 	switch (bih.bV5BitCount) {
 	case 1:
@@ -201,109 +290,209 @@ gdip_read_ico_image_from_file_stream (void *pointer, GpImage **image, ImageSourc
 		break;
 	}
 
-	if (palette_entries < 0) {
-		status = OutOfMemory;
-		goto error;
-	}
+	if (palette_entries < 0)
+		return OutOfMemory;
+
+	line_xor_length = (((bih.bV5BitCount * data->width + 31) & ~31) >> 3);
+	xor_size = line_xor_length * data->height;
+	line_and_length = (((data->width + 31) & ~31) >> 3);
+	and_size = line_and_length * data->height;
+
+	/* colors are stored as B, G, R and reserved (always 0) */
+	if ((unsigned int) ms.pos + palette_entries * 4 + xor_size + and_size > length)
+		return OutOfMemory;
 
 	/*
 	 * Strangely, even if we're supplying a 32bits ARGB image, 
 	 * the icon's palette is also supplied with the image.
 	 */
-	result->active_bitmap->palette = GdipAlloc (sizeof(ColorPalette) + sizeof(ARGB) * palette_entries);
-	if (result->active_bitmap->palette == NULL) {
-		status = OutOfMemory;
-		goto error;
-	}
-	result->active_bitmap->palette->Flags = 0;
-	result->active_bitmap->palette->Count = palette_entries;
+	palette = GdipAlloc (sizeof(ColorPalette) + sizeof(ARGB) * palette_entries);
+	if (!palette)
+		return OutOfMemory;
+	palette->Flags = 0;
+	palette->Count = palette_entries;
 
 	for (i = 0; i < palette_entries; i++) {
-		/* colors are stored as R, G, B and reserved (always 0) */
-		BYTE color[4]; 
-		void *p = &color;
-
-		if (gdip_read_ico_data (pointer, p, 4, source) < 4) {
-			status = OutOfMemory;
-			goto error;
-		}
+		const BYTE *color = raw + ms.pos + i * 4;
 
-		set_pixel_bgra (result->active_bitmap->palette->Entries, i * 4,
+		set_pixel_bgra (palette->Entries, i * 4,
 			(color[0] & 0xFF),		/* B */
 			(color[1] & 0xFF),		/* G */
 			(color[2] & 0xFF),		/* R */
 			0xFF);				/* Alpha */
 	}
 
-	/*
-	 * Let's build the 32bpp ARGB bitmap from the icon's XOR and AND bitmaps
-	 * notes:
-	 * - XORBitmap can be a 1, 4 or 8 bpp bitmap
-	 * - ANDBitmap is *always* a monochrome (1bpp) bitmap
-	 * - in every case each line is padded to 32 bits boundary
-	 */
-	pixels = GdipAlloc (result->active_bitmap->stride * result->active_bitmap->height);
-	if (pixels == NULL) {
-		status = OutOfMemory;
-		goto error;
+	data->stride = data->width * 4;
+	/* Ensure 32bits alignment */
+	gdip_align_stride (data->stride);
+	pixels = GdipAlloc (data->stride * data->height);
+	if (!pixels) {
+		GdipFree (palette);
+		return OutOfMemory;
+	}
+
+	xor_data = raw + ms.pos + palette_entries * 4;
+	and_data = xor_data + xor_size;
+	for (y = 0; y < data->height; y++) {
+		/* image is reversed (y) */
+		merge_ico_line ((ARGB *) (pixels + (data->height - y - 1) * data->stride),
+			xor_data + y * line_xor_length, and_data + y * line_and_length,
+			data->width, bih.bV5BitCount, palette->Entries);
 	}
 
-	result->active_bitmap->scan0 = pixels;
-	result->active_bitmap->reserved = GBD_OWN_SCAN0;
-	result->active_bitmap->image_flags = ImageFlagsReadOnly | ImageFlagsHasRealPixelSize | ImageFlagsColorSpaceRGB | ImageFlagsHasAlpha;
+	if (data->palette)
+		GdipFree (data->palette);
+	data->palette = palette;
+	data->scan0 = pixels;
+	data->reserved = GBD_OWN_SCAN0;
+	return Ok;
+}
+
+/* used directly for the default image and as the load function of the other, encoded, ones */
+static GpStatus
+decode_ico_image (BitmapData *data, const BYTE *raw, unsigned int length)
+{
+	if ((length >= sizeof (ico_png_signature)) && (memcmp (raw, ico_png_signature, sizeof (ico_png_signature)) == 0))
+		return decode_ico_png (data, raw, length);
+
+	return decode_ico_bmp (data, raw, length);
+}
+
+static void
+init_ico_bitmapdata (BitmapData *data, IcoImage *image)
+{
+	data->pixel_format = PixelFormat32bppARGB; /* icons are always promoted to 32 bbp */
+	data->width = image->width;
+	data->height = image->height;
+	data->dpi_horz = 96.0f;
+	data->dpi_vert = 96.0f;
+	data->image_flags = ImageFlagsReadOnly | ImageFlagsHasRealPixelSize | ImageFlagsColorSpaceRGB | ImageFlagsHasAlpha;
+}
+
+/* smaller images first, for the same size the best color depth first */
+static int
+compare_ico_images (const void *a, const void *b)
+{
+	const IcoImage *ia = (const IcoImage *) a;
+	const IcoImage *ib = (const IcoImage *) b;
+	int diff;
+
+	diff = ia->width * ia->height - ib->width * ib->height;
+	if (diff != 0)
+		return diff;
+	diff = ib->entry.wBitCount - ia->entry.wBitCount;
+	if (diff != 0)
+		return diff;
+	return ia->index - ib->index;
+}
+
+/*
+ * Windows only exposes the last image of the directory (e.g. it can return the 16 pixel version, instead
+ * of the 32 or 48 pixels available in the same file), as a single page, so this is what gets decoded.
+ * When the icon holds several images, all of them can also be selected thru FrameDimensionResolution,
+ * ordered by size. They aren't frames of the bitmap (like GDI+ the icon has a single dimension, and a
+ * single TIFF page), are counted by GdipImageGetResolutionCount_linux and are only decoded when selected
+ * by GdipImageSelectActiveFrame.
+ * Cursors only differ by the hotspot stored in the directory, which isn't used here.
+ */
+static GpStatus
+gdip_read_ico_image_from_file_stream (void *pointer, GpImage **image, ImageSource source)
+{
+	GpStatus status = OutOfMemory;
+	GpBitmap *result = NULL;
+	WORD w, count;
+	void *p = &w;
+	BYTE *b = (BYTE*)&w;
+	IcoImage *images = NULL;
+	IcoImage *last;
+	BYTE *buffer = NULL;
+	unsigned int buffer_length;
+	unsigned int header_length;
+	int i;
+
+	/* WORD ICONDIR.idReserved / reversed, MUST be 0 */
+	if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
+		goto error;
+	if (w != 0)
+		goto error;
 
-	line_xor_length = (((bih.bV5BitCount * entry.bWidth + 31) & ~31) >> 3);
-	xor_size = line_xor_length * entry.bHeight;
-	xor_data = (BYTE*) GdipAlloc (xor_size);
-	if (!xor_data) {
-		status = OutOfMemory;
+	/* WORD ICONDIR.idType / resource type, MUST be 1 for icons or 2 for cursors */
+	if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
 		goto error;
-	}
-	if (gdip_read_ico_data (pointer, xor_data, xor_size, source) < xor_size) {
-		status = OutOfMemory;
+	i = (b[1] << 8 | b[0]);
+	if ((i != 1) && (i != 2))
+		goto error;
+
+	/* WORD ICONDIR.idCount / number of icons, must be greater than 0 */
+	if (gdip_read_ico_data (pointer, p, sizeof (WORD), source) != sizeof (WORD))
+		goto error;
+	count = (b[1] << 8 | b[0]); 
+	if (count < 1)
 		goto error;
-	}
 
-	line_and_length = (((entry.bWidth + 31) & ~31) >> 3);
-	and_size = line_and_length * entry.bHeight;
-	and_data = (BYTE*) GdipAlloc (and_size);
-	if (!and_data) {
-		status = OutOfMemory;
+	images = GdipAlloc (sizeof (IcoImage) * count);
+	if (!images)
 		goto error;
+
+	for (i = 0; i < count; i++) {
+		if (!read_ICONDIRENTRY (pointer, &images[i].entry, source))
+			goto error;
+		images[i].index = i;
+		/* 0 means 256 pixels */
+		images[i].width = images[i].entry.bWidth ? images[i].entry.bWidth : 256;
+		images[i].height = images[i].entry.bHeight ? images[i].entry.bHeight : 256;
 	}
-	if (gdip_read_ico_data (pointer, and_data, and_size, source) < and_size) {
-		status = OutOfMemory;
+	header_length = 6 + count * sizeof (ICONDIRENTRY);
+
+	buffer = read_ico_images (pointer, source, &buffer_length);
+	if (!buffer)
 		goto error;
+
+	for (i = 0; i < count; i++) {
+		unsigned int offset = images[i].entry.dwImageOffset;
+		unsigned int length;
+
+		offset = (offset > header_length) ? offset - header_length : 0;
+		if (offset > buffer_length)
+			offset = buffer_length;
+		length = buffer_length - offset;
+		/* the size of the default image was never checked, a truncated one is reported when decoding it */
+		if ((i != count - 1) && (images[i].entry.dwBytesInRes > 0) && (images[i].entry.dwBytesInRes < length))
+			length = images[i].entry.dwBytesInRes;
+
+		images[i].data = buffer + offset;
+		images[i].length = length;
 	}
 
-	colors = result->active_bitmap->palette->Entries;
-	for (y = 0; y < entry.bHeight; y++) {
-		for (x = 0; x < entry.bWidth; x++) {
-			ARGB color;
-			if (palette_entries > 0) {
-				color = colors [get_ico_data (xor_data, x, y, bih.bV5BitCount, line_xor_length)];
-				if (get_ico_data (and_data, x, y, 1, line_and_length) == 1)
-					color &= 0x00FFFFFF;
-			} else if (bih.bV5BitCount == 24) {
-				/* take 1bpp alpha from the and_data */
-				if (get_ico_data (and_data, x, y, 1, line_and_length) == 1) {
-					color = 0;
-				} else {
-					BYTE *line_data = xor_data + y * line_xor_length + x * 3;
-					color = 0xFF000000 | (line_data [0] | line_data [1] << 8| line_data [2] << 16);
-				}
-			} else {
-				BYTE *line_data = xor_data + y * line_xor_length + x * 4;
-				/* ARGB to BRGA */
-				color = (line_data [0] | line_data [1] << 8 | line_data [2] << 16 | line_data [3] << 24);
+	result = gdip_bitmap_new_with_frame (NULL, TRUE);
+	if (!result)
+		goto error;
+
+	result->type = ImageTypeBitmap;
+	result->image_format = ICON;
+
+	last = &images[count - 1];
+	init_ico_bitmapdata (result->active_bitmap, last);
+	status = decode_ico_image (result->active_bitmap, last->data, last->length);
+	if (status != Ok)
+		goto error;
+
+	if (count > 1) {
+		qsort (images, count, sizeof (IcoImage), compare_ico_images);
+		for (i = 0; i < count; i++) {
+			BitmapData *data = gdip_bitmap_add_encoded_frame (result, &gdip_image_frameDimension_resolution_guid,
+				images[i].data, images[i].length, decode_ico_image);
+			if (!data) {
+				status = OutOfMemory;
+				goto error;
 			}
-			/* image is reversed (y) */
-			GdipBitmapSetPixel (result, x, entry.bHeight - y - 1, color);
+
+			init_ico_bitmapdata (data, &images[i]);
 		}
 	}
 
-	GdipFree (xor_data);
-	GdipFree (and_data);
+	GdipFree (images);
+	GdipFree (buffer);
 
 	*image = result;
 	return Ok;
@@ -311,10 +500,10 @@ gdip_read_ico_image_from_file_stream (void *pointer, GpImage **image, ImageSourc
 error:
 	if (result)
 		GdipDisposeImage (result);
-	if (xor_data)
-		GdipFree (xor_data);
-	if (and_data)
-		GdipFree (and_data);
+	if (images)
+		GdipFree (images);
+	if (buffer)
+		GdipFree (buffer);
 
 	return status;
 }
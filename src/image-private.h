@@ -49,6 +49,7 @@ typedef enum {
 	EMF,
 	ICON,
 	MEMBMP,
+	RAW,
 	INVALID
 } ImageFormat;
 
@@ -62,4 +63,41 @@ void gdip_image_init (GpImage *image) GDIP_INTERNAL;
 
 #include "image.h"
 
+/*
+ * Codec registry (see codecs.c). Every codec registers an entry describing how to load and save
+ * its format; the signatures of its ImageCodecInfo are used to sniff the format of the data.
+ */
+typedef struct {
+	GetBytesDelegate	getBytes;
+	PutBytesDelegate	putBytes;
+	SeekDelegate		seek;
+	CloseDelegate		close;
+	SizeDelegate		size;
+	/* when set, the data is read from memory and the delegates aren't used, see gdip_load_image_from_memory */
+	MemorySource		*memory;
+} ImageDelegates;
+
+typedef struct {
+	ImageFormat	format;
+	ImageCodecInfo* (*get_codec_info) ();
+	/* decoder, both NULL for encoder-only codecs */
+	GpStatus (*load_from_file) (FILE *fp, const char *file_name, GpImage **image);
+	GpStatus (*load_from_delegates) (const ImageDelegates *delegates, GpImage **image);
+	/* encoder, both NULL for decoder-only codecs */
+	GpStatus (*save_to_file) (const char *file_name, GpImage *image, GDIPCONST EncoderParameters *params);
+	GpStatus (*save_to_delegates) (const ImageDelegates *delegates, GpImage *image, GDIPCONST EncoderParameters *params);
+	/* NULL if the encoder does not support GdipGetEncoderParameterList */
+	GpStatus (*fill_encoder_parameter_list) (EncoderParameters *buffer, UINT size);
+	UINT		encoder_parameter_list_size;
+} ImageCodec;
+
+GpStatus gdip_register_codec (const ImageCodec *codec) GDIP_INTERNAL;
+GpStatus gdip_register_codec_signature (const ImageCodec *codec, const BYTE *pattern, const BYTE *mask, int size,
+	ImageFormat public_format) GDIP_INTERNAL;
+
+const ImageCodec *gdip_codec_from_signature (const BYTE *data, size_t size, ImageFormat *public_format) GDIP_INTERNAL;
+const ImageCodec *gdip_codec_from_encoder_clsid (GDIPCONST CLSID *encoderCLSID) GDIP_INTERNAL;
+
+GpStatus gdip_load_image_from_memory (const BYTE *data, int size, GpImage **image) GDIP_INTERNAL;
+
 #endif
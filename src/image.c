@@ -33,6 +33,7 @@
 #include "image-private.h"
 #include "imageattributes-private.h"
 #include "graphics-private.h"
+#include "graphics-deferred-private.h"
 #include "matrix.h"
 
 #include "metafile-private.h"
@@ -56,6 +57,7 @@ extern GUID gdip_tif_image_format_guid;
 extern GUID gdip_wmf_image_format_guid;
 extern GUID gdip_emf_image_format_guid;
 extern GUID gdip_ico_image_format_guid;
+extern GUID gdip_raw_image_format_guid;
 GUID gdip_exif_image_format_guid = {0xb96b3cb2U, 0x0728U, 0x11d3U, {0x9d, 0x7b, 0x00, 0x00, 0xf8, 0x1e, 0xf3, 0x2e}};
 GUID gdip_membmp_image_format_guid = {0xb96b3caaU, 0x0728U, 0x11d3U, {0x9d, 0x7b, 0x00, 0x00, 0xf8, 0x1e, 0xf3, 0x2e}};
 
@@ -71,93 +73,19 @@ GUID GdipEncoderTransformation = {0x8D0EB2D1U, 0x0A58EU, 0x4EA8U, {0x0AA, 0x14,
 GUID GdipEncoderQuality = {0x1D5BE4B5U, 0x0FA4AU, 0x452DU, {0x9C, 0x0DD, 0x5D, 0x0B3, 0x51, 0x5, 0x0E7, 0x0EB}};
 GUID GdipEncoderLuminanceTable = {0x0EDB33BCEU, 0x266U, 0x4A77U, {0x0B9, 0x4, 0x27, 0x21, 0x60, 0x99, 0x0E7, 0x17}};
 GUID GdipEncoderChrominanceTable = {0x0F2E455DCU, 0x9B3U, 0x4316U, {0x82, 0x60, 0x67, 0x6A, 0x0DA, 0x32, 0x48, 0x1C}};
+GUID GdipEncoderScanMethod = {0x3A4E2661U, 0x3109U, 0x4E56U, {0x85, 0x36, 0x42, 0xC1, 0x56, 0xE7, 0xDC, 0xFA}};
+GUID GdipEncoderRenderMethod = {0x6D42C53AU, 0x229AU, 0x4825U, {0x8B, 0xB7, 0x5C, 0x99, 0xE2, 0xB9, 0xA8, 0xB8}};
 
-#define DECODERS_SUPPORTED 8
-#define ENCODERS_SUPPORTED 5
-static BYTE *g_decoder_list;
-static int g_decoders = 0;
-static BYTE *g_encoder_list;
-static int g_encoders = 0;
-
-static ImageFormat
-gdip_image_format_for_format_guid (GDIPCONST GUID *formatGUID)
-{
-	if (memcmp (formatGUID, &gdip_bmp_image_format_guid, sizeof (GUID)) == 0)
-		return BMP;
-	if (memcmp (formatGUID, &gdip_jpg_image_format_guid, sizeof (GUID)) == 0)
-		return JPEG;
-	if (memcmp (formatGUID, &gdip_png_image_format_guid, sizeof (GUID)) == 0)
-		return PNG;
-	if (memcmp (formatGUID, &gdip_gif_image_format_guid, sizeof (GUID)) == 0)
-		return GIF;
-	if (memcmp (formatGUID, &gdip_tif_image_format_guid, sizeof (GUID)) == 0)
-		return TIF;
-	if (memcmp (formatGUID, &gdip_exif_image_format_guid, sizeof (GUID)) == 0)
-		return EXIF;
-	if (memcmp (formatGUID, &gdip_wmf_image_format_guid, sizeof (GUID)) == 0)
-		return WMF;
-	if (memcmp (formatGUID, &gdip_emf_image_format_guid, sizeof (GUID)) == 0)
-		return EMF;
-	if (memcmp (formatGUID, &gdip_ico_image_format_guid, sizeof (GUID)) == 0)
-		return ICON;
-	if (memcmp (formatGUID, &gdip_membmp_image_format_guid, sizeof (GUID)) == 0)
-		return PNG; /* MemoryBmp is saved as PNG */
-	return INVALID;
-}
-
-/* hack #1 - nonplaceable WMF metafiles are supported by no signature match them in the codecs */
-static const BYTE nonplaceable_wmf_sig_pattern[] = { 0x01, 0x00, 0x09, 0x00, 0x00, 0x03 };
-static const BYTE nonplaceable_wmf_sig_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
-static const int nonplaceable_wmf_sig_count = 1;
-static const int nonplaceable_wmf_sig_size = 6;
-
-static BOOL
-signature_match (char *data, size_t data_size, int size, int count, BYTE* sig_pattern, BYTE* sig_mask)
-{
-	if (data_size < size)
-		return FALSE;
-
-	int sig;
-	for (sig = 0; sig < (size * count); sig += size) {
-		BOOL match = TRUE;
-		int p;
-		for (p = 0; ((p < size) && (p < data_size)); p++) {
-			BYTE *mask = (BYTE*)(&sig_mask [sig]);
-			BYTE *pattern = (BYTE*)(&sig_pattern [sig]);
-			if ((data [p] & mask[p]) != pattern[p]) {
-				match = FALSE;
-				break;
-			}
-		}
-		if (match)
-			return TRUE;
-	}
-	return FALSE;
-}
-
-static ImageFormat 
-get_image_format (char *sig_read, size_t size_read, ImageFormat *final)
-{
-	ImageCodecInfo *decoder = (ImageCodecInfo*)g_decoder_list;
-	int index;
-	/* look at every decoder available, this will depends on how libgdiplus is compiled */
-	for (index = 0; index < g_decoders; index++, decoder++) {
-		/* for each signature in the codec */
-		if (signature_match (sig_read, size_read, decoder->SigSize, decoder->SigCount, (BYTE*)&decoder->SigPattern[0],
-			(BYTE*)&decoder->SigMask[0])) {
-			*final = gdip_image_format_for_format_guid (&decoder->FormatID);
-			return *final;
-		}
-	}
-	/* last chance - GDI+ still detects some files even if they don't match the codec signatures */
-	/* [mis-]handle non-placeable metafiles are WMF but reported as EMF (see #81178 for a test case) */
-	if (signature_match (sig_read, size_read, nonplaceable_wmf_sig_size, nonplaceable_wmf_sig_count, 
-		(BYTE*)&nonplaceable_wmf_sig_pattern[0], (BYTE*)&nonplaceable_wmf_sig_mask[0])) {
-		*final = EMF;
-		return WMF;
-	}
-	return INVALID;
-}
+/*
+ * libgdiplus-specific encoder param guids (see codecs.h)
+ */
+GUID GdipEncoderChromaSubsampling = {0x9890C06DU, 0x0D9EU, 0x4EA3U, {0xBA, 0x0C, 0xEE, 0x45, 0x7E, 0x45, 0xC7, 0xF9}};
+GUID GdipEncoderOptimizeCoding = {0x48B857B1U, 0xD6DCU, 0x4CD7U, {0x9F, 0x82, 0x52, 0x79, 0x8F, 0x6C, 0x1A, 0x9B}};
+GUID GdipEncoderDctMethod = {0xFF09D8F9U, 0x1A2CU, 0x449FU, {0x8B, 0x77, 0x2C, 0x44, 0xD4, 0xE8, 0xC1, 0xF8}};
+GUID GdipEncoderCompressionLevel = {0x8F4FF533U, 0xF92FU, 0x41BDU, {0xB4, 0x0C, 0xE0, 0x29, 0x01, 0x71, 0x17, 0xD0}};
+GUID GdipEncoderCompressionStrategy = {0x0A973E15U, 0x10DFU, 0x4D31U, {0xA6, 0x92, 0xE2, 0x36, 0x3B, 0xB8, 0x66, 0x8C}};
+GUID GdipEncoderPngFilters = {0x0FC82FFAU, 0x7FB0U, 0x49F1U, {0x8F, 0x10, 0x47, 0x6D, 0x4C, 0x3B, 0x62, 0xCE}};
+GUID GdipEncoderPngThreads = {0xDB0B2E30U, 0x528DU, 0x461EU, {0x9F, 0x0B, 0x6F, 0xBD, 0xAB, 0x10, 0x6B, 0xA9}};
 
 /* Converts the given interpolation value to cairo_filter_t */
 static cairo_filter_t
@@ -210,6 +138,10 @@ gdip_flip_x (GpImage *image)
 	width = image->active_bitmap->width;
 	height = image->active_bitmap->height;
 	pixel_size = gdip_get_pixel_format_components (image->active_bitmap->pixel_format) * gdip_get_pixel_format_depth (image->active_bitmap->pixel_format) / 8;
+	if (gdip_bitmap_ensure_writable (image) != Ok) {
+		return OutOfMemory;
+	}
+
 	line = GdipAlloc (stride);
 	if (!line) {
 		return OutOfMemory;
@@ -242,6 +174,10 @@ gdip_flip_y (GpImage *image)
 	
 	stride = image->active_bitmap->stride;
 	height = image->active_bitmap->height;
+	if (gdip_bitmap_ensure_writable (image) != Ok) {
+		return OutOfMemory;
+	}
+
 	line = GdipAlloc (stride);
 	if (!line) {
 		return OutOfMemory;
@@ -317,6 +253,11 @@ GdipGetImageGraphicsContext (GpImage *image, GpGraphics **graphics)
 		return OutOfMemory;
 	}
 
+	/* The Graphics draws straight into scan0, so from now on it can't be shared with clones */
+	if (gdip_bitmap_ensure_writable (image) != Ok)
+		return OutOfMemory;
+	image->active_bitmap->reserved |= GBD_DIRECT_WRITE;
+
 	surface = cairo_image_surface_create_for_data ((BYTE*) image->active_bitmap->scan0, image->cairo_format,
 				image->active_bitmap->width, image->active_bitmap->height, image->active_bitmap->stride);
 
@@ -388,6 +329,7 @@ GdipDrawImageRectI (GpGraphics *graphics, GpImage *image, INT x, INT y, INT widt
 GpStatus WINGDIPAPI
 GdipDrawImageRect (GpGraphics *graphics, GpImage *image, REAL x, REAL y, REAL width, REAL height)
 {
+	GpStatus status;
 	cairo_pattern_t *pattern;
 	cairo_pattern_t *org_pattern;
 	MetafilePlayContext *metacontext = NULL;
@@ -402,6 +344,10 @@ GdipDrawImageRect (GpGraphics *graphics, GpImage *image, REAL x, REAL y, REAL wi
 
 	if ((width <= 0) || (height <= 0))
 		return Ok;
+
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
 			
 	if (image->type == ImageTypeBitmap) {
 		/* check does not apply to metafiles, and it's better be done before converting the image */
@@ -420,6 +366,14 @@ GdipDrawImageRect (GpGraphics *graphics, GpImage *image, REAL x, REAL y, REAL wi
 		}
 	}
 
+	/* a metafile drawn again at the same resolution can reuse its previous rendering (if enabled) */
+	if (image->type == ImageTypeMetafile) {
+		GpRectF rect = {x, y, width, height};
+		GpBitmap *raster = gdip_metafile_get_raster ((GpMetafile*)image, graphics, &rect);
+		if (raster)
+			return GdipDrawImageRect (graphics, raster, rect.X, rect.Y, rect.Width, rect.Height);
+	}
+
 	/* conversion must be done after the recursive call to GdipDrawImageRect to remove the indexed bitmap */
 	if (!OPTIMIZE_CONVERSION (graphics)) {
 		x = gdip_unitx_convgr (graphics, x);
@@ -500,6 +454,7 @@ GdipDrawImageRect (GpGraphics *graphics, GpImage *image, REAL x, REAL y, REAL wi
 GpStatus WINGDIPAPI
 GdipDrawImagePoints (GpGraphics *graphics, GpImage *image, GDIPCONST GpPointF *dstPoints, INT count)
 {
+	GpStatus status;
 	cairo_pattern_t	*pattern;
 	cairo_pattern_t	*org_pattern;
 	GpMatrix *matrix = NULL;
@@ -512,6 +467,10 @@ GdipDrawImagePoints (GpGraphics *graphics, GpImage *image, GDIPCONST GpPointF *d
 	if (!graphics || !image || !dstPoints || (count != 3))
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	cairo_new_path (graphics->ct);
 
 	if (image->type == ImageTypeBitmap) {
@@ -633,12 +592,14 @@ GdipDrawImageRectRect (GpGraphics *graphics, GpImage *image,
                        GDIPCONST GpImageAttributes *imageAttributes,
                        DrawImageAbort callback, void *callbackData)
 {
+	GpStatus status;
 	cairo_pattern_t	*pattern;
 	cairo_pattern_t	*orig;
 	cairo_matrix_t	mat;
 	void		*dest;
 	void		*org;
 	int		org_format;
+	unsigned int	org_reserved;
 	BOOL		allocated = FALSE;
 	BYTE			*premul = NULL;
 	cairo_surface_t	*original = NULL;
@@ -646,6 +607,10 @@ GdipDrawImageRectRect (GpGraphics *graphics, GpImage *image,
 	if (!graphics || !image)
 		return InvalidParameter;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	switch (srcUnit) {
 	case UnitPixel:
 		break;
@@ -695,11 +660,14 @@ GdipDrawImageRectRect (GpGraphics *graphics, GpImage *image,
 
 	org = dest = image->active_bitmap->scan0; 
 	org_format = image->active_bitmap->pixel_format;
+	org_reserved = image->active_bitmap->reserved;
 	gdip_process_bitmap_attributes (image, &dest, (GpImageAttributes *) imageAttributes, &allocated);
 
 	/*  If allocated is true we have a newly allocated and altered Scan0 in dest */
 	if (allocated) {
 		image->active_bitmap->scan0 = dest;
+		/* the bitmap doesn't own dest, so the (flipped) clones made while drawing copy it instead of sharing it */
+		image->active_bitmap->reserved &= ~(GBD_OWN_SCAN0 | GBD_SHARED_SCAN0);
 	}
 	
 	/* Drop the existing surface if attributes are being applied since the surface might be out-of-date */
@@ -951,6 +919,7 @@ GdipDrawImageRectRect (GpGraphics *graphics, GpImage *image,
 	if (allocated) {
 		image->active_bitmap->scan0 = org;
 		image->active_bitmap->pixel_format = org_format;
+		image->active_bitmap->reserved = org_reserved;
 		GdipFree (dest);
 	}
 	
@@ -983,6 +952,10 @@ GdipDrawImagePointsRect (GpGraphics *graphics, GpImage *image, GDIPCONST GpPoint
 	if (count > 3)
 		return NotImplemented;
 
+	status = gdip_deferred_flush (graphics);
+	if (status != Ok)
+		return status;
+
 	rect.X = 0; 
 	rect.Y = 0; 
 	if (image->type == ImageTypeBitmap) {
@@ -1064,7 +1037,8 @@ GdipLoadImageFromFile (GDIPCONST WCHAR *file, GpImage **image)
 	FILE		*fp = NULL;
 	GpImage		*result = NULL;
 	GpStatus	status = Ok;
-	ImageFormat	format, public_format;
+	const ImageCodec *codec;
+	ImageFormat	public_format;
 	char		*file_name = NULL;
 	char		format_peek[MAX_CODEC_SIG_LENGTH];
 	int		format_peek_sz;
@@ -1085,41 +1059,13 @@ GdipLoadImageFromFile (GDIPCONST WCHAR *file, GpImage **image)
 	}
 	
 	format_peek_sz = fread (format_peek, 1, MAX_CODEC_SIG_LENGTH, fp);
-	format = get_image_format (format_peek, format_peek_sz, &public_format);
+	codec = gdip_codec_from_signature ((BYTE *)format_peek, format_peek_sz, &public_format);
 	fseek (fp, 0, SEEK_SET);
 	
-	switch (format) {
-	case BMP:
-		status = gdip_load_bmp_image_from_file (fp, &result);
-		break;
-	case TIF:
-		status = gdip_load_tiff_image_from_file (fp, &result);
-		break;
-	case GIF:
-		status = gdip_load_gif_image_from_file (fp, &result);
-		break;
-	case PNG:
-		status = gdip_load_png_image_from_file (fp, &result);
-		break;
-	case JPEG:
-		status = gdip_load_jpeg_image_from_file (fp, file_name, &result);
-		break;
-	case ICON:
-		status = gdip_load_ico_image_from_file (fp, &result);
-		break;
-	case WMF:
-		status = gdip_load_wmf_image_from_file (fp, &result);
-		break;
-	case EMF:
-		status = gdip_load_emf_image_from_file (fp, &result);
-		break;
-	case EXIF:
-		status = NotImplemented;
-		break;
-	default:
+	if (codec)
+		status = codec->load_from_file (fp, file_name, &result);
+	else
 		status = OutOfMemory;
-		break;
-	}
 
 	if (result && (status == Ok))
 		result->image_format = public_format;
@@ -1138,43 +1084,45 @@ GdipLoadImageFromFile (GDIPCONST WCHAR *file, GpImage **image)
 	return status;
 }
 
-/* Note: use only for encoders (there's more decoders than encoders) */
-static ImageFormat 
-gdip_get_imageformat_from_codec_clsid (CLSID *encoderCLSID)
+/* load an encoded image, e.g. embedded in a metafile, the codecs read it from the MemorySource given with the delegates */
+GpStatus
+gdip_load_image_from_memory (const BYTE *data, int size, GpImage **image)
 {
-	GpStatus status;
-	UINT numEncoders, size, cnt;
-	ImageCodecInfo *encoders, *encoder;
-
-	status = GdipGetImageEncodersSize (&numEncoders, &size);
-	if ((status != Ok) ||(numEncoders == 0))
-		return INVALID;
+	GpImage		*result = NULL;
+	GpStatus	status;
+	const ImageCodec *codec;
+	ImageFormat	public_format;
+	ImageDelegates	delegates = { NULL, NULL, NULL, NULL, NULL, NULL };
+	MemorySource	ms;
+
+	*image = NULL;
+	codec = gdip_codec_from_signature (data, size, &public_format);
+	if (!codec)
+		return UnknownImageFormat;
 
-	encoders = GdipAlloc (size);
+	ms.ptr = (BYTE *) data;
+	ms.size = size;
+	ms.pos = 0;
+	delegates.memory = &ms;
 
-	status = GdipGetImageEncoders (numEncoders, size, encoders);
+	status = codec->load_from_delegates (&delegates, &result);
 	if (status != Ok)
-		return INVALID;
+		return status;
 
-	for (cnt = 0, encoder = encoders; cnt < numEncoders; cnt++, encoder++) {
-		if (memcmp (&encoder->Clsid, encoderCLSID, sizeof (GUID)) == 0) {
-		ImageFormat ifmt = gdip_image_format_for_format_guid (&encoder->FormatID);
-				GdipFree (encoders);
-		return ifmt;
-		}
-	}
+	result->image_format = public_format;
+	if ((result->type == ImageTypeBitmap) && !result->active_bitmap)
+		gdip_bitmap_setactive (result, NULL, 0);
 
-	GdipFree (encoders);
-	return INVALID;
+	*image = result;
+	return Ok;
 }
 
 GpStatus WINGDIPAPI
 GdipSaveImageToFile (GpImage *image, GDIPCONST WCHAR *file, GDIPCONST CLSID *encoderCLSID, GDIPCONST EncoderParameters *params)
 {
-	FILE *fp = 0;
-	GpStatus status = 0;
+	GpStatus status;
 	char *file_name;
-	ImageFormat format;
+	const ImageCodec *codec;
 	
 	if (!image || !file || !encoderCLSID)
 		return InvalidParameter;
@@ -1182,50 +1130,17 @@ GdipSaveImageToFile (GpImage *image, GDIPCONST WCHAR *file, GDIPCONST CLSID *enc
 	if (image->type != ImageTypeBitmap)
 		return InvalidParameter;
 	
-	format = gdip_get_imageformat_from_codec_clsid ( (CLSID *)encoderCLSID);
-	if (format == INVALID)
+	codec = gdip_codec_from_encoder_clsid (encoderCLSID);
+	if (!codec)
 		return UnknownImageFormat;
 	
 	file_name = (char *) ucs2_to_utf8 ((const gunichar2 *)file, -1);
 	if (file_name == NULL)
 		return InvalidParameter;
 	
-	if (format == GIF) { /* gif library has to open the file itself*/
-		status = gdip_save_gif_image_to_file ((BYTE*)file_name, image);
-		GdipFree (file_name);
-		return status;
-	} else if (format == TIF) { 
-		/* tif library has to open the file itself or seeking will fail when saving multi-page images*/
-		status = gdip_save_tiff_image_to_file ((BYTE*)file_name, image, params);
-		GdipFree (file_name);
-		return status;
-	}
-	
-	if ((fp = fopen(file_name, "wb")) == NULL) {
-		GdipFree (file_name);
-		return GenericError;
-	}
-		
+	status = codec->save_to_file (file_name, image, params);
 	GdipFree (file_name);
 	
-	switch (format) {
-		case BMP:
-		case ICON:
-			status = gdip_save_bmp_image_to_file (fp, image);
-			break;
-		case PNG:
-			status = gdip_save_png_image_to_file (fp, image, params);
-			break;
-		case JPEG:
-			status = gdip_save_jpeg_image_to_file (fp, image, params);
-			break;
-		default:
-			status = NotImplemented;
-			break;
-	}
-	
-	fclose (fp);
-	
 	return status;
 }
 
@@ -1426,6 +1341,9 @@ GdipGetImageRawFormat (GpImage *image, GUID *format)
 	case ICON:
 		memcpy (format, &gdip_ico_image_format_guid, sizeof (GUID));
 		break;
+	case RAW:
+		memcpy (format, &gdip_raw_image_format_guid, sizeof (GUID));
+		break;
 	default:
 		return InvalidParameter;
 		}
@@ -1554,6 +1472,73 @@ GdipImageSelectActiveFrame (GpImage *image, GDIPCONST GUID *dimensionGUID, UINT
 	}
 }
 
+/*
+ * libgdiplus extension: returns the index, in FrameDimensionResolution, of the image best suited to be
+ * drawn at the requested size (e.g. multi-resolution icons). That's the smallest one that is at least as
+ * large as requested or, if there's none, the largest one. The frame isn't selected (nor decoded).
+ */
+GpStatus WINGDIPAPI
+GdipImageGetBestFrameForSize_linux (GpImage *image, UINT width, UINT height, UINT *frameIndex)
+{
+	FrameData	*frame = NULL;
+	int		i;
+	int		best = -1;
+	int		largest = 0;
+
+	if (!image || !frameIndex || (width == 0) || (height == 0))
+		return InvalidParameter;
+
+	if (image->type != ImageTypeBitmap)
+		return NotImplemented;
+
+	if (image->encoded_frames && (memcmp (&image->encoded_frames->frame.frame_dimension, &gdip_image_frameDimension_resolution_guid, sizeof (GUID)) == 0))
+		frame = &image->encoded_frames->frame;
+
+	/* a single resolution is available */
+	if (!frame) {
+		*frameIndex = 0;
+		return Ok;
+	}
+
+	for (i = 0; i < frame->count; i++) {
+		BitmapData *data = &frame->bitmap[i];
+
+		if ((data->width < width) || (data->height < height)) {
+			if (data->width * data->height > frame->bitmap[largest].width * frame->bitmap[largest].height)
+				largest = i;
+			continue;
+		}
+
+		/* frames are sorted by size, the first large enough one is the best */
+		if ((best < 0) || (data->width * data->height < frame->bitmap[best].width * frame->bitmap[best].height))
+			best = i;
+	}
+
+	*frameIndex = (best < 0) ? largest : best;
+	return Ok;
+}
+
+/*
+ * libgdiplus extension: returns the number of images that can be selected thru FrameDimensionResolution.
+ * Like GDI+ that dimension isn't listed by GdipImageGetFrameDimensionsList (nor counted by
+ * GdipImageGetFrameCount), so an image without other resolutions returns 1, the active one.
+ */
+GpStatus WINGDIPAPI
+GdipImageGetResolutionCount_linux (GpImage *image, UINT *count)
+{
+	if (!image || !count)
+		return InvalidParameter;
+
+	if (image->type != ImageTypeBitmap)
+		return NotImplemented;
+
+	if (image->encoded_frames && (memcmp (&image->encoded_frames->frame.frame_dimension, &gdip_image_frameDimension_resolution_guid, sizeof (GUID)) == 0))
+		*count = image->encoded_frames->frame.count;
+	else
+		*count = 1;
+	return Ok;
+}
+
 static GpStatus
 gdip_rotate_orthogonal_flip_x (GpImage *image, int angle, BOOL flip_x)
 {
@@ -1663,9 +1648,7 @@ gdip_rotate_orthogonal_flip_x (GpImage *image, int angle, BOOL flip_x)
 	image->active_bitmap->height = target_height;
 	image->active_bitmap->width = target_width;
 
-	if ((image->active_bitmap->reserved & GBD_OWN_SCAN0) != 0) {
-		GdipFree(image->active_bitmap->scan0);
-	}
+	gdip_bitmapdata_release_scan0 (image->active_bitmap);
 
 	image->active_bitmap->scan0 = rotated;
 	image->active_bitmap->reserved |= GBD_OWN_SCAN0;	
@@ -1838,9 +1821,7 @@ gdip_rotate_flip_packed_indexed (GpImage *image, PixelFormat pixel_format, int a
 	image->active_bitmap->height = target_height;
 	image->active_bitmap->width = target_width;
 
-	if ((image->active_bitmap->reserved & GBD_OWN_SCAN0) != 0) {
-		GdipFree(image->active_bitmap->scan0);
-	}
+	gdip_bitmapdata_release_scan0 (image->active_bitmap);
 
 	image->active_bitmap->scan0 = rotated;
 	image->active_bitmap->reserved |= GBD_OWN_SCAN0;	
@@ -2007,6 +1988,7 @@ GdipGetPropertyCount (GpImage *image, UINT *propertyNumber)
 
 	switch (image->type) {
 	case ImageTypeBitmap:
+		gdip_bitmapdata_property_ensure_loaded (image->active_bitmap);
 		*propertyNumber = image->active_bitmap->property_count;
 		break;
 	case ImageTypeMetafile:
@@ -2030,6 +2012,7 @@ GdipGetPropertyIdList (GpImage *image, UINT propertyNumber, PROPID *list)
 	if (image->type != ImageTypeBitmap)
 		return NotImplemented;
 
+	gdip_bitmapdata_property_ensure_loaded (image->active_bitmap);
 	if (propertyNumber != image->active_bitmap->property_count)
 		return InvalidParameter;
 
@@ -2101,6 +2084,7 @@ GdipGetPropertySize (GpImage *image, UINT *totalBufferSize, UINT *numProperties)
 	if (image->type != ImageTypeBitmap)
 		return NotImplemented;
 
+	gdip_bitmapdata_property_ensure_loaded (image->active_bitmap);
 	*numProperties = image->active_bitmap->property_count;
 
 	size = image->active_bitmap->property_count * sizeof(PropertyItem);
@@ -2143,7 +2127,8 @@ GdipSetPropertyItem(GpImage *image, GDIPCONST PropertyItem *item)
 		case GIF:
 		case JPEG:
 		case PNG:
-		case ICON: {
+		case ICON:
+		case RAW: {
 			break;
 		}
 
@@ -2293,56 +2278,26 @@ GdipLoadImageFromDelegate_linux (GetHeaderDelegate getHeaderFunc,
 {
 	GpImage *result = 0;
 	GpStatus status = 0;
-	ImageFormat format, public_format;
-	dstream_t *loader = NULL;
+	ImageFormat public_format;
+	const ImageCodec *codec;
+	ImageDelegates delegates = { getBytesFunc, putBytesFunc, seekFunc, closeFunc, sizeFunc, NULL };
 	
 	BYTE format_peek[MAX_CODEC_SIG_LENGTH];
 	int format_peek_sz;
 	
 	format_peek_sz = getHeaderFunc (format_peek, MAX_CODEC_SIG_LENGTH);
-	format = get_image_format ((char *)format_peek, format_peek_sz, &public_format);
+	codec = gdip_codec_from_signature (format_peek, (format_peek_sz > 0) ? format_peek_sz : 0, &public_format);
 	
-	switch (format) {
-	case JPEG:
-		loader = dstream_input_new (getBytesFunc, seekFunc);
-		status = gdip_load_jpeg_image_from_stream_delegate (loader, &result);
-		break;
-	case PNG:
-		status = gdip_load_png_image_from_stream_delegate (getBytesFunc, seekFunc, &result);
-		break;
-	case BMP:
-		loader = dstream_input_new (getBytesFunc, seekFunc);
-		status = gdip_load_bmp_image_from_stream_delegate (loader, &result);
-		break;
-	case TIF:
-		status = gdip_load_tiff_image_from_stream_delegate (getBytesFunc, putBytesFunc,
-			seekFunc, closeFunc, sizeFunc, &result);
-		break;
-	case GIF:
-		status = gdip_load_gif_image_from_stream_delegate (getBytesFunc, seekFunc, &result);
-		break;
-	case ICON:
-		loader = dstream_input_new (getBytesFunc, seekFunc);
-		status = gdip_load_ico_image_from_stream_delegate (loader, &result);
-		break;
-	case EMF:
-		loader = dstream_input_new (getBytesFunc, seekFunc);
-		status = gdip_load_emf_image_from_stream_delegate (loader, &result);
-		break;
-	case WMF:
-		loader = dstream_input_new (getBytesFunc, seekFunc);
-		status = gdip_load_wmf_image_from_stream_delegate (loader, &result);
-		break;
-	default:
+	if (codec) {
+		status = codec->load_from_delegates (&delegates, &result);
+	} else {
 		/* NotImplemented looks better but this matchs MS behavior */
 		status = InvalidParameter;
-		break;
 	}
 
 	if (result && (status == Ok))
 		result->image_format = public_format;
 
-	dstream_free (loader);
 	*image = result;
 	if (status != Ok) {
 		*image = NULL;
@@ -2359,169 +2314,17 @@ GdipSaveImageToDelegate_linux (GpImage *image, GetBytesDelegate getBytesFunc, Pu
 	SeekDelegate seekFunc, CloseDelegate closeFunc, SizeDelegate sizeFunc, GDIPCONST CLSID *encoderCLSID,
 	GDIPCONST EncoderParameters *params)
 {
+	const ImageCodec *codec;
+	ImageDelegates delegates = { getBytesFunc, putBytesFunc, seekFunc, closeFunc, sizeFunc, NULL };
+
 	if (!image || !encoderCLSID || (image->type != ImageTypeBitmap))
 		return InvalidParameter;
 
-	switch (gdip_get_imageformat_from_codec_clsid ((CLSID *)encoderCLSID)) {
-	case ICON:
-	case BMP:
-		return gdip_save_bmp_image_to_stream_delegate (putBytesFunc, image);
-	case PNG:
-		return gdip_save_png_image_to_stream_delegate (putBytesFunc, image, params);
-	case JPEG:
-		return gdip_save_jpeg_image_to_stream_delegate (putBytesFunc, image, params);
-	case GIF:
-		return gdip_save_gif_image_to_stream_delegate (putBytesFunc, image, params);
-	case TIF:
-		return gdip_save_tiff_image_to_stream_delegate (getBytesFunc, putBytesFunc,
-			seekFunc, closeFunc, sizeFunc, image, params);
-	case INVALID:
+	codec = gdip_codec_from_encoder_clsid (encoderCLSID);
+	if (!codec)
 		return UnknownImageFormat;
-	default:
-		return NotImplemented;
-	}
-}
 
-GpStatus
-initCodecList (void)
-{
-	BYTE *dpos, *epos;
-	
-	g_decoder_list = dpos = GdipAlloc (sizeof (ImageCodecInfo) * DECODERS_SUPPORTED);
-	if (!g_decoder_list)
-		return OutOfMemory;
-
-	g_encoder_list = epos = GdipAlloc (sizeof (ImageCodecInfo) * ENCODERS_SUPPORTED);
-	if (!g_decoder_list) {
-		GdipFree (g_decoder_list);
-		g_decoder_list = NULL;
-		return OutOfMemory;
-	}
-	
-	/* BMP codec (encoder+decoder) - built-in */
-	memcpy (dpos, gdip_getcodecinfo_bmp (), sizeof (ImageCodecInfo));
-	dpos += sizeof (ImageCodecInfo);
-	g_decoders++;
-	memcpy (epos, gdip_getcodecinfo_bmp (), sizeof (ImageCodecInfo));
-	epos += sizeof (ImageCodecInfo);
-	g_encoders++;
-	
-	/* JPEG codec (encoder+decoder) */
-	if (gdip_getcodecinfo_jpeg ()) {
-		memcpy (dpos, gdip_getcodecinfo_jpeg(), sizeof (ImageCodecInfo));
-		dpos += sizeof (ImageCodecInfo);
-		g_decoders++;
-		memcpy (epos, gdip_getcodecinfo_jpeg(), sizeof (ImageCodecInfo));
-		epos += sizeof (ImageCodecInfo);
-		g_encoders++;
-	}
-	
-	/* GIF codec (encoder+decoder) */
-	if (gdip_getcodecinfo_gif ()) {
-		memcpy (dpos, gdip_getcodecinfo_gif (), sizeof (ImageCodecInfo));
-		dpos += sizeof (ImageCodecInfo);
-		g_decoders++;
-		memcpy (epos, gdip_getcodecinfo_gif (), sizeof (ImageCodecInfo));
-		epos += sizeof (ImageCodecInfo);
-		g_encoders++;
-	}
-
-	/* EMF codec (decoder-only) */
-	if (gdip_getcodecinfo_emf ()) {
-		memcpy (dpos, gdip_getcodecinfo_emf (), sizeof (ImageCodecInfo));
-		dpos += sizeof (ImageCodecInfo);
-		g_decoders++;
-	}
-
-	/* WMF codec (decoder-only) */
-	if (gdip_getcodecinfo_wmf ()) {
-		memcpy (dpos, gdip_getcodecinfo_wmf (), sizeof (ImageCodecInfo));
-		dpos += sizeof (ImageCodecInfo);
-		g_decoders++;
-	}
-	
-	/* TIFF codec (encoder+decoder) */
-	if (gdip_getcodecinfo_tiff ()) {
-		memcpy (dpos, gdip_getcodecinfo_tiff (), sizeof (ImageCodecInfo));
-		dpos += sizeof (ImageCodecInfo);
-		g_decoders++;
-		memcpy (epos, gdip_getcodecinfo_tiff (), sizeof (ImageCodecInfo));
-		epos += sizeof (ImageCodecInfo);
-		g_encoders++;
-	}
-	
-	/* PNG codec (encoder+decoder) */
-	if (gdip_getcodecinfo_png ()) {
-		memcpy (dpos, gdip_getcodecinfo_png (), sizeof (ImageCodecInfo));
-		dpos += sizeof (ImageCodecInfo);
-		g_decoders++;
-		memcpy (epos, gdip_getcodecinfo_png (), sizeof (ImageCodecInfo));
-		epos += sizeof (ImageCodecInfo);
-		g_encoders++;
-	}
-
-	/* ICO codec (decoder-only) - built-in */
-	memcpy (dpos, gdip_getcodecinfo_ico (), sizeof (ImageCodecInfo));
-	dpos += sizeof (ImageCodecInfo);
-	g_decoders++;
-
-	return Ok;
-}
-
-void releaseCodecList (void)
-{
-	if (g_decoder_list) {
-		GdipFree (g_decoder_list);
-		g_decoder_list = NULL;
-		g_decoders = 0;
-	}
-	if (g_encoder_list) {
-		GdipFree (g_encoder_list);
-		g_encoder_list = NULL;
-		g_encoders = 0;
-	}
-}
-
-GpStatus WINGDIPAPI
-GdipGetImageDecodersSize (UINT *numDecoders, UINT *size)
-{       
-	if (!numDecoders || !size)
-		return InvalidParameter;
-	
-	*numDecoders = g_decoders;
-	*size = sizeof (ImageCodecInfo) * g_decoders;
-	return Ok;
-}
-
-GpStatus WINGDIPAPI
-GdipGetImageDecoders (UINT numDecoders, UINT size, ImageCodecInfo *decoders)
-{
-	if (!decoders || (numDecoders != g_decoders) || (size != sizeof (ImageCodecInfo) * g_decoders))
-		return GenericError;
-
-	memcpy (decoders, g_decoder_list, size);
-	return Ok;
-}
-
-GpStatus WINGDIPAPI
-GdipGetImageEncodersSize (UINT *numEncoders, UINT *size)
-{
-	if (!numEncoders || !size)
-		return InvalidParameter;
-	
-	*numEncoders = g_encoders;
-	*size = sizeof (ImageCodecInfo) * g_encoders;
-	return Ok;
-}
-
-GpStatus WINGDIPAPI
-GdipGetImageEncoders (UINT numEncoders, UINT size, ImageCodecInfo *encoders)
-{
-	if (!encoders || (numEncoders != g_encoders) || (size != sizeof (ImageCodecInfo) * g_encoders))
-		return GenericError;
-
-	memcpy (encoders, g_encoder_list, size);
-	return Ok;
+	return codec->save_to_delegates (&delegates, image, params);
 }
 
 GpStatus WINGDIPAPI
@@ -2538,6 +2341,7 @@ GdipGetAllPropertyItems (GpImage *image, UINT totalBufferSize, UINT numPropertie
 	if (image->type != ImageTypeBitmap)
 		return NotImplemented;
 
+	gdip_bitmapdata_property_ensure_loaded (image->active_bitmap);
 	if (numProperties != image->active_bitmap->property_count) {
 		return InvalidParameter;
 	}
@@ -2576,74 +2380,44 @@ GdipGetAllPropertyItems (GpImage *image, UINT totalBufferSize, UINT numPropertie
 GpStatus WINGDIPAPI
 GdipGetEncoderParameterListSize (GpImage *image, GDIPCONST CLSID *clsidEncoder, UINT *size)
 {
-	ImageFormat fmt;
+	const ImageCodec *codec;
 
 	if (!image || !clsidEncoder)
 		return InvalidParameter;
 
-	fmt = gdip_get_imageformat_from_codec_clsid ((CLSID *) clsidEncoder);
-
-	switch (fmt) {
-		case TIF:
-			if (!size)
-				return InvalidParameter;
-
-			*size = sizeof (TiffEncoderParameters);
-			return Ok;
-		case GIF:
-			if (!size)
-				return InvalidParameter;
-
-			*size = sizeof (GifEncoderParameters);
-			return Ok;
-		case PNG:
-			if (!size)
-				return InvalidParameter;
-
-			*size = sizeof (PngEncoderParameters);
-			return Ok;
-		case JPEG:
-			if (!size)
-				return InvalidParameter;
+	codec = gdip_codec_from_encoder_clsid (clsidEncoder);
+	if (!codec)
+		return FileNotFound;
 
-			*size = sizeof (JpegEncoderParameters);
-			return Ok;
-		case BMP:
+	if (!codec->fill_encoder_parameter_list) {
+		if (size)
 			*size = 0;
-			return NotImplemented;
-		default:
-			break;
+		return NotImplemented;
 	}
 
-	return FileNotFound;
+	if (!size)
+		return InvalidParameter;
+
+	*size = codec->encoder_parameter_list_size;
+	return Ok;
 }
 
 GpStatus WINGDIPAPI
 GdipGetEncoderParameterList (GpImage *image, GDIPCONST CLSID *clsidEncoder, UINT size, EncoderParameters *buffer)
 {
-	ImageFormat fmt;
+	const ImageCodec *codec;
 
 	if (!image || !clsidEncoder)
 		return InvalidParameter;
 
-	fmt = gdip_get_imageformat_from_codec_clsid ((CLSID *) clsidEncoder);
+	codec = gdip_codec_from_encoder_clsid (clsidEncoder);
+	if (!codec)
+		return FileNotFound;
 
-	switch (fmt) {
-		case TIF:
-			return gdip_fill_encoder_parameter_list_tiff (buffer, size);
-		case GIF:
-			return gdip_fill_encoder_parameter_list_gif (buffer, size);
-		case PNG:
-			return gdip_fill_encoder_parameter_list_png (buffer, size);
-		case JPEG:
-			return gdip_fill_encoder_parameter_list_jpeg (buffer, size);
-		case BMP:
-			return NotImplemented;
-		default:
-			break;
-	}
+	if (!codec->fill_encoder_parameter_list)
+		return NotImplemented;
 
-	return FileNotFound;
+	return codec->fill_encoder_parameter_list (buffer, size);
 }
 
 GpStatus WINGDIPAPI
@@ -2715,6 +2489,37 @@ gdip_find_encoder_parameter (GDIPCONST EncoderParameters *eps, const GUID *guid)
 	return NULL;
 }
 
+/*
+ * Looks up a single valued integer encoder parameter. Returns FALSE if the parameter is
+ * missing or isn't using one of the integer value types.
+ */
+BOOL
+gdip_get_encoder_parameter_long (GDIPCONST EncoderParameters *eps, const GUID *guid, LONG *value)
+{
+	const EncoderParameter *param;
+
+	if (!eps)
+		return FALSE;
+
+	param = gdip_find_encoder_parameter (eps, guid);
+	if (!param || param->NumberOfValues < 1 || !param->Value)
+		return FALSE;
+
+	switch (param->Type) {
+	case EncoderParameterValueTypeByte:
+		*value = *(BYTE *) param->Value;
+		return TRUE;
+	case EncoderParameterValueTypeShort:
+		*value = *(short *) param->Value;
+		return TRUE;
+	case EncoderParameterValueTypeLong:
+		*value = *(LONG *) param->Value;
+		return TRUE;
+	default:
+		return FALSE;
+	}
+}
+
 /*
 	GDI+ 1.0 only supports multiple frames on an image for the
 	tiff format
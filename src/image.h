@@ -50,6 +50,9 @@ GpStatus WINGDIPAPI GdipSaveImageToDelegate_linux (GpImage *image, GetBytesDeleg
 	SeekDelegate seekFunc, CloseDelegate closeFunc, SizeDelegate sizeFunc, GDIPCONST CLSID *encoderCLSID,
 	GDIPCONST EncoderParameters *params);
 
+GpStatus WINGDIPAPI GdipImageGetBestFrameForSize_linux (GpImage *image, UINT width, UINT height, UINT *frameIndex);
+GpStatus WINGDIPAPI GdipImageGetResolutionCount_linux (GpImage *image, UINT *count);
+
 
 /* GDI+ exported Image functions */
 GpStatus WINGDIPAPI GdipLoadImageFromStream (void /*IStream*/ *stream, GpImage **image);
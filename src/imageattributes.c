@@ -127,11 +127,19 @@ gdip_process_bitmap_attributes (GpBitmap *bitmap, void **dest, GpImageAttributes
 
 	if (colormap->colormap_elem || gamma->gamma_correction || trans->key_enabled || 
 	    (cmatrix->colormatrix_enabled && cmatrix->colormatrix != NULL)) {
+		PixelFormat format = bitmap->active_bitmap->pixel_format;
+
 		bitmap->active_bitmap->pixel_format = PixelFormat32bppARGB;
 		bmpdest = gdip_bitmap_new_with_frame(NULL, FALSE);
 		gdip_bitmapdata_clone(bitmap->active_bitmap, &bmpdest->frames[0].bitmap, 1);
 		bmpdest->frames[0].count = 1;
 		gdip_bitmap_setactive(bmpdest, NULL, 0);
+		/* the attributes are applied in place, the pixels must not be shared with the source */
+		if (gdip_bitmap_ensure_writable (bmpdest) != Ok) {
+			gdip_bitmap_dispose (bmpdest);
+			bitmap->active_bitmap->pixel_format = format;
+			return;
+		}
 		*dest = bmpdest->active_bitmap->scan0;
 		*allocated = TRUE;
 	}
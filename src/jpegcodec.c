@@ -85,6 +85,18 @@ gdip_getcodecinfo_jpeg ()
 
 #define JPEG_BUFFER_SIZE	65536
 
+/* number of rows handed to jpeg_write_scanlines at once (the tallest MCU is 16 rows) */
+#define JPEG_WRITE_BATCH_ROWS	16
+
+/* libjpeg-turbo can read our native 32bpp layout directly, skipping the RGB conversion */
+#ifdef JCS_EXTENSIONS
+#ifdef WORDS_BIGENDIAN
+#define JPEG_NATIVE_COLOR_SPACE	JCS_EXT_XRGB
+#else
+#define JPEG_NATIVE_COLOR_SPACE	JCS_EXT_BGRX
+#endif
+#endif
+
 struct gdip_stdio_jpeg_source_mgr {
 	struct jpeg_source_mgr parent;
 
@@ -267,6 +279,39 @@ _gdip_dest_stream_term (j_compress_ptr cinfo)
 	dest->putBytesFunc (dest->buf, JPEG_BUFFER_SIZE - dest->parent.free_in_buffer);
 }
 
+#ifdef HAVE_LIBEXIF
+static void
+add_properties_from_entry (ExifEntry *entry, void *user_data)
+{
+	BitmapData *bitmap_data = (BitmapData *) user_data;
+
+	gdip_bitmapdata_property_add (bitmap_data, entry->tag, entry->size, entry->format, entry->data);
+}
+
+static void
+add_properties_from_content (ExifContent *content, void *user_data)
+{
+	exif_content_foreach_entry (content, add_properties_from_entry, user_data);
+}
+
+/* Decodes the EXIF APP1 block kept by gdip_load_jpeg_image_internal, once the properties are used */
+static void
+load_exif_properties (BitmapData *bitmap, const BYTE *raw, unsigned int length)
+{
+	ExifData *exif_data = exif_data_new_from_data (raw, length);
+
+	if (exif_data == NULL)
+		return;
+
+	exif_data_foreach_content (exif_data, add_properties_from_content, bitmap);
+	/* thumbnail */
+	if (exif_data->size != 0) {
+		gdip_bitmapdata_property_add (bitmap, PropertyTagThumbnailData, exif_data->size, PropertyTagTypeByte, exif_data->data);
+	}
+	exif_data_unref (exif_data);
+}
+#endif
+
 static GpStatus
 gdip_load_jpeg_image_internal (struct jpeg_source_mgr *src, GpImage **image)
 {
@@ -279,6 +324,9 @@ gdip_load_jpeg_image_internal (struct jpeg_source_mgr *src, GpImage **image)
 	GpStatus	status;
 	int		stride;
 	unsigned long long int size;
+#ifdef HAVE_LIBEXIF
+	jpeg_saved_marker_ptr	marker;
+#endif
 
 	destbuf = NULL;
 	result = NULL;
@@ -295,6 +343,9 @@ gdip_load_jpeg_image_internal (struct jpeg_source_mgr *src, GpImage **image)
 
 	jpeg_create_decompress (&cinfo);
 	cinfo.src = src;
+#ifdef HAVE_LIBEXIF
+	jpeg_save_markers (&cinfo, JPEG_APP0 + 1, 0xFFFF);
+#endif
 
 	jpeg_read_header (&cinfo, TRUE);
 
@@ -326,6 +377,18 @@ gdip_load_jpeg_image_internal (struct jpeg_source_mgr *src, GpImage **image)
 	if (result->active_bitmap->dpi_horz && result->active_bitmap->dpi_vert)
 		result->active_bitmap->image_flags |= ImageFlagsHasRealDPI;
 
+#ifdef HAVE_LIBEXIF
+	/* keep the EXIF block, it's only decoded if the properties are queried */
+	for (marker = cinfo.marker_list; marker != NULL; marker = marker->next) {
+		if ((marker->marker == JPEG_APP0 + 1) && (marker->data_length > 6) && (memcmp (marker->data, "Exif\0\0", 6) == 0)) {
+			status = gdip_bitmapdata_property_set_raw (result->active_bitmap, marker->data, marker->data_length, load_exif_properties);
+			if (status != Ok)
+				goto error;
+			break;
+		}
+	}
+#endif
+
 	if (cinfo.num_components == 1) {
 		result->cairo_format = CAIRO_FORMAT_A8;
 		result->active_bitmap->pixel_format = PixelFormat8bppIndexed;
@@ -539,39 +602,6 @@ error:
 	return status;
 }
 
-#ifdef HAVE_LIBEXIF
-static void
-add_properties_from_entry (ExifEntry *entry, void *user_data)
-{
-	BitmapData *bitmap_data = (BitmapData *) user_data;
-
-	gdip_bitmapdata_property_add (bitmap_data, entry->tag, entry->size, entry->format, entry->data);
-}
-
-static void
-add_properties_from_content (ExifContent *content, void *user_data)
-{
-	exif_content_foreach_entry (content, add_properties_from_entry, user_data);
-}
-
-static void
-load_exif_data (ExifData *exif_data, GpImage *image)
-{
-	BitmapData *bitmap;
-
-	if (exif_data == NULL)
-		return;
-
-	bitmap = image->active_bitmap;
-	exif_data_foreach_content (exif_data, add_properties_from_content, bitmap);
-	/* thumbnail */
-	if (exif_data->size != 0) {
-		gdip_bitmapdata_property_add (bitmap, PropertyTagThumbnailData, exif_data->size, PropertyTagTypeByte, exif_data->data);
-	}
-	exif_data_unref (exif_data);
-}
-#endif
-
 GpStatus 
 gdip_load_jpeg_image_from_file (FILE *fp, const char *filename, GpImage **image)
 {
@@ -603,11 +633,6 @@ gdip_load_jpeg_image_from_file (FILE *fp, const char *filename, GpImage **image)
 	st = gdip_load_jpeg_image_internal ((struct jpeg_source_mgr *) src, image);
 	GdipFree (src->buf);
 	GdipFree (src);
-#ifdef HAVE_LIBEXIF
-	if (st == Ok) {
-		load_exif_data (exif_data_new_from_file (filename), *image);
-	}
-#endif
 
 	return st;
 }
@@ -616,10 +641,6 @@ GpStatus
 gdip_load_jpeg_image_from_stream_delegate (dstream_t *loader, GpImage **image)
 {
 	GpStatus st;
-#ifdef HAVE_LIBEXIF
-	unsigned int length;
-	BYTE *ptr;
-#endif
 
 	gdip_stream_jpeg_source_mgr_ptr src;
 
@@ -643,19 +664,10 @@ gdip_load_jpeg_image_from_stream_delegate (dstream_t *loader, GpImage **image)
 	src->parent.next_input_byte = NULL;
 
 	src->loader = loader;
-#ifdef HAVE_LIBEXIF
-	dstream_keep_exif_buffer (loader);
-#endif
 
 	st = gdip_load_jpeg_image_internal ((struct jpeg_source_mgr *) src, image);
 	GdipFree (src->buf);
 	GdipFree (src);
-#ifdef HAVE_LIBEXIF
-	if (st == Ok){
-		dstream_get_exif_buffer (loader, &ptr, &length);
-		load_exif_data (exif_data_new_from_data (ptr, length), *image);
-	}
-#endif
 
 	return st;
 }
@@ -668,6 +680,7 @@ gdip_save_jpeg_image_internal (FILE *fp, PutBytesDelegate putBytesFunc, GpImage
 	struct gdip_jpeg_error_mgr	jerr;
 	const EncoderParameter		*param;
 	JOCTET		*scanline = NULL;
+	JSAMPROW	rows[JPEG_WRITE_BATCH_ROWS];
 	int		need_argb_conversion = 0;
 	GpStatus	status;
 
@@ -732,32 +745,23 @@ gdip_save_jpeg_image_internal (FILE *fp, PutBytesDelegate putBytesFunc, GpImage
 
 	cinfo.image_width = image->active_bitmap->width;
 	cinfo.image_height = image->active_bitmap->height;
-	if (gdip_get_pixel_format_components (image->active_bitmap->pixel_format) == 3) {
-		cinfo.in_color_space = JCS_RGB;
-		cinfo.input_components = 3;
-		if (image->active_bitmap->pixel_format == PixelFormat24bppRGB) {
-			need_argb_conversion = 1;
-		} else {
-			need_argb_conversion = 0;
-		}
-	} else if (gdip_get_pixel_format_components (image->active_bitmap->pixel_format) == 4) {
-		cinfo.in_color_space = JCS_RGB;
-		cinfo.input_components = 3;
-		need_argb_conversion = 1;
-	} else if (gdip_get_pixel_format_components (image->active_bitmap->pixel_format) == 1) {
-		cinfo.in_color_space = JCS_RGB;
-		cinfo.input_components = 1;
-		need_argb_conversion = 1; /* do this conversion */
-	}
+#ifdef JPEG_NATIVE_COLOR_SPACE
+	/* all the formats accepted above use 4 bytes per pixel, which libjpeg-turbo can consume as-is */
+	cinfo.in_color_space = JPEG_NATIVE_COLOR_SPACE;
+	cinfo.input_components = 4;
+	need_argb_conversion = 0;
+#else
+	cinfo.in_color_space = JCS_RGB;
+	cinfo.input_components = 3;
+	need_argb_conversion = 1;
+#endif
 
 	jpeg_set_defaults (&cinfo);
 
-	if (gdip_get_pixel_format_components (image->active_bitmap->pixel_format) == 1) {
-		jpeg_set_colorspace (&cinfo, JCS_GRAYSCALE);
-	}
-
 	/* Handle encoding parameters */
 	if (params) {
+		LONG value;
+
 		param = gdip_find_encoder_parameter (params, &GdipEncoderQuality);
 		if (param != NULL) {
 			int quality;
@@ -779,6 +783,55 @@ gdip_save_jpeg_image_internal (FILE *fp, PutBytesDelegate putBytesFunc, GpImage
 
 			jpeg_set_quality (&cinfo, quality, 0);
 		}
+
+		/* the chroma components keep 1x1, subsampling is expressed through the luma factors */
+		if (gdip_get_encoder_parameter_long (params, &GdipEncoderChromaSubsampling, &value)) {
+			switch (value) {
+			case JpegChromaSubsampling444:
+				cinfo.comp_info[0].h_samp_factor = 1;
+				cinfo.comp_info[0].v_samp_factor = 1;
+				break;
+			case JpegChromaSubsampling422:
+				cinfo.comp_info[0].h_samp_factor = 2;
+				cinfo.comp_info[0].v_samp_factor = 1;
+				break;
+			case JpegChromaSubsampling420:
+				cinfo.comp_info[0].h_samp_factor = 2;
+				cinfo.comp_info[0].v_samp_factor = 2;
+				break;
+			case JpegChromaSubsampling411:
+				cinfo.comp_info[0].h_samp_factor = 4;
+				cinfo.comp_info[0].v_samp_factor = 1;
+				break;
+			default:
+				status = InvalidParameter;
+				goto error;
+			}
+		}
+
+		if (gdip_get_encoder_parameter_long (params, &GdipEncoderOptimizeCoding, &value))
+			cinfo.optimize_coding = value ? TRUE : FALSE;
+
+		if (gdip_get_encoder_parameter_long (params, &GdipEncoderDctMethod, &value)) {
+			switch (value) {
+			case JpegDctMethodInteger:
+				cinfo.dct_method = JDCT_ISLOW;
+				break;
+			case JpegDctMethodFastInteger:
+				cinfo.dct_method = JDCT_IFAST;
+				break;
+			case JpegDctMethodFloat:
+				cinfo.dct_method = JDCT_FLOAT;
+				break;
+			default:
+				status = InvalidParameter;
+				goto error;
+			}
+		}
+
+		/* must come last, the scan script depends on the components set up above */
+		if (gdip_get_encoder_parameter_long (params, &GdipEncoderRenderMethod, &value) && value == EncoderValueRenderProgressive)
+			jpeg_simple_progression (&cinfo);
 	}
 
 	jpeg_start_compress (&cinfo, TRUE);
@@ -786,40 +839,54 @@ gdip_save_jpeg_image_internal (FILE *fp, PutBytesDelegate putBytesFunc, GpImage
 	if (need_argb_conversion) {
 		BYTE *inptr, *outptr;
 		int i, j;
+		int row_size = image->active_bitmap->width * 3;
 
-		scanline = GdipAlloc (image->active_bitmap->stride);
+		/* convert a band of rows at a time so libjpeg gets (at least) a full MCU row per call */
+		scanline = GdipAlloc (row_size * JPEG_WRITE_BATCH_ROWS);
 		if (!scanline) {
 			status = OutOfMemory;
 			goto error;
 		}
 
-		for (i = 0; i < image->active_bitmap->height; i++) {
-			inptr = image->active_bitmap->scan0 + (i * image->active_bitmap->stride);
-			outptr = scanline;
+		for (i = 0; i < JPEG_WRITE_BATCH_ROWS; i++)
+			rows[i] = scanline + (i * row_size);
 
-			for (j = 0; j < image->active_bitmap->width; j++) {
+		while (cinfo.next_scanline < cinfo.image_height) {
+			int count = MIN (JPEG_WRITE_BATCH_ROWS, cinfo.image_height - cinfo.next_scanline);
+
+			for (i = 0; i < count; i++) {
+				inptr = image->active_bitmap->scan0 + ((cinfo.next_scanline + i) * image->active_bitmap->stride);
+				outptr = rows[i];
+
+				for (j = 0; j < image->active_bitmap->width; j++) {
 #ifdef WORDS_BIGENDIAN
-				*outptr++ = inptr[1]; /* R */
-				*outptr++ = inptr[2]; /* G */
-				*outptr++ = inptr[3]; /* B */
+					*outptr++ = inptr[1]; /* R */
+					*outptr++ = inptr[2]; /* G */
+					*outptr++ = inptr[3]; /* B */
 #else
-				*outptr++ = inptr[2]; /* R */
-				*outptr++ = inptr[1]; /* G */
-				*outptr++ = inptr[0]; /* B */
+					*outptr++ = inptr[2]; /* R */
+					*outptr++ = inptr[1]; /* G */
+					*outptr++ = inptr[0]; /* B */
 #endif
-				inptr += 4;		  /* skip RGB+A */
+					inptr += 4;		  /* skip RGB+A */
+				}
 			}
 
-			jpeg_write_scanlines (&cinfo, &scanline, 1);
+			jpeg_write_scanlines (&cinfo, rows, count);
 		}
 
 		GdipFree (scanline);
 		scanline = NULL;
 	} else {
 		int i;
-		for (i = 0; i < image->active_bitmap->height; i++) {
-			scanline = image->active_bitmap->scan0 + (i * image->active_bitmap->stride);
-			jpeg_write_scanlines (&cinfo, &scanline, 1);
+
+		while (cinfo.next_scanline < cinfo.image_height) {
+			int count = MIN (JPEG_WRITE_BATCH_ROWS, cinfo.image_height - cinfo.next_scanline);
+
+			for (i = 0; i < count; i++)
+				rows[i] = image->active_bitmap->scan0 + ((cinfo.next_scanline + i) * image->active_bitmap->stride);
+
+			jpeg_write_scanlines (&cinfo, rows, count);
 		}
 	}
 
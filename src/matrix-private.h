@@ -45,6 +45,7 @@ typedef cairo_matrix_t GpMatrix;
 #define gdip_matrix_get_y_scale(matrix)		(matrix->yy)
 #define gdip_matrix_reverse_order(order)	((order == MatrixOrderPrepend) ? MatrixOrderAppend : MatrixOrderPrepend)
 #define gdip_cairo_matrix_copy(m1,m2)		memcpy (m1, m2, sizeof (cairo_matrix_t))
+#define gdip_cairo_matrix_equal(m1,m2)		(memcmp (m1, m2, sizeof (cairo_matrix_t)) == 0)
 
 BOOL gdip_is_matrix_a_translation (GpMatrix *matrix) GDIP_INTERNAL;
 BOOL gdip_is_matrix_empty (GpMatrix* matrix) GDIP_INTERNAL;
@@ -61,17 +61,185 @@ typedef struct {
 	int type;
 } MetaObject;
 
+/*
+ * Display list, compiled from the records on the first playback of a metafile. Objects (pens, brushes,
+ * paths, images and points) are built once and only referenced by the operations that use them.
+ */
+typedef enum {
+	MetafileOpSetMapMode,
+	MetafileOpSetWindowExt,
+	MetafileOpModifyWorldTransform,
+	MetafileOpDrawLines,
+	MetafileOpDrawArc,
+	MetafileOpRectangle,
+	MetafileOpFillRectangle,
+	MetafileOpPolygon,
+	MetafileOpDrawCurve,
+	MetafileOpFillPath,
+	MetafileOpDrawPath,
+	MetafileOpFillAndDrawPath,
+	MetafileOpDrawImage,
+	MetafileOpEmfPlus
+} MetafileOpType;
+
+typedef struct {
+	MetafileOpType type;
+	BOOL has_bounds;		/* FALSE if the operation doesn't draw or its bounds are unknown */
+	GpRectF bounds;			/* in logical units, including the pen width */
+	GpPen *pen;
+	GpBrush *brush;
+	float miter_limit;
+	union {
+		struct {
+			DWORD mode;
+			int width, height;
+		} map;
+		struct {
+			XFORM xform;
+			DWORD mode;
+		} transform;
+		struct {
+			GpPointF *points;
+			int count;
+			FillMode fill_mode;
+		} poly;
+		GpRectF rect;
+		struct {
+			GpRectF rect;
+			float start, sweep;
+		} arc;
+		GpPath *path;
+		struct {
+			GpImage *image;
+			GpRectF dest;
+			GpRectF src;
+		} image;
+		struct {
+			BYTE *data;		/* within the metafile data */
+			int length;
+		} emfplus;
+	} u;
+} MetafileOp;
+
+typedef struct {
+	MetafileOp *ops;
+	int count;
+	int capacity;
+	/* pens and brushes created by the records, owned by the list */
+	MetaObject *objects;
+	int objects_count;
+	int objects_capacity;
+	/* status that interrupted the compilation, returned once everything before it is played */
+	GpStatus status;
+} MetafileDisplayList;
+
+/* a rendering of the metafile, reused when it's drawn again at the same effective resolution */
+typedef struct _MetafileRaster {
+	float dest_width, dest_height;		/* destination size, in pixels */
+	float scale_x, scale_y;			/* world transform scale */
+	float offset_x, offset_y;		/* fractional part of the destination position on the device */
+	InterpolationMode interpolation;
+	SmoothingMode smoothing;
+	TextRenderingHint text_hint;
+	GpBitmap *bitmap;
+	unsigned int size;			/* bytes used by the bitmap */
+	unsigned int last_use;
+	struct _MetafileRaster *next;
+} MetafileRaster;
+
+/*
+ * EMF+ recorder, used while a graphics draws on the metafile (see graphics-metafile.c). Records are
+ * appended to a growable buffer, then wrapped inside an EMF when the recording stops.
+ */
+#define EMFPLUS_MAX_OBJECTS		64
+
+typedef struct {
+	BYTE *data;
+	int size;
+	int capacity;
+	BOOL failed;			/* an allocation failed, the content is incomplete */
+} EmfPlusBuffer;
+
+typedef struct {
+	ObjectType type;		/* ObjectTypeInvalid if the slot was never used */
+	BYTE *data;			/* serialized object, a new one is only recorded if it differs */
+	int size;
+	unsigned int last_use;
+} EmfPlusRecordedObject;
+
+typedef struct {
+	EmfPlusBuffer records;
+	int record_start;		/* offset of the record being written */
+	EmfPlusBuffer object;		/* scratch buffer where objects are serialized */
+	EmfPlusRecordedObject objects [EMFPLUS_MAX_OBJECTS];
+	unsigned int clock;
+	GpRectF frame;
+	MetafileFrameUnit frame_unit;
+	PutBytesDelegate put_bytes;	/* NULL unless recording into delegates */
+} MetafileRecorder;
+
+/* read-only file mapping holding the records of a large metafile, shared with its clones */
+typedef struct {
+	void *base;
+	size_t size;
+	int refcount;
+} MetafileMapping;
+
 struct _Metafile {
 	GpImage base;
 	MetafileHeader metafile_header;
 	BOOL delete;
 	BYTE *data;
 	int length;
+	MetafileMapping *mapping;	/* if set, data points inside the mapping */
 	BOOL recording;		/* recording into memory (data), file (fp) or user stream (stream) */
 	FILE *fp;
 	void *stream;
+	MetafileRecorder *recorder;
+	/* raster cache, disabled (0 bytes) by default */
+	unsigned int raster_cache_limit;
+	unsigned int raster_cache_size;
+	unsigned int raster_cache_clock;
+	MetafileRaster *raster_cache;
+	MetafileDisplayList *display_list;
+	/* number of operations skipped, since they were outside the clip, when the display list was played */
+	unsigned int culled_operations;
 };
 
+/* graphics state saved by the EMF+ Save and BeginContainer records */
+typedef struct {
+	DWORD index;			/* stack index of the Save or BeginContainer record */
+	unsigned int state;		/* GdipSaveGraphics state, e.g. the clip and the rendering modes */
+	GpMatrix base;
+	GpMatrix world;
+	GpUnit page_unit;
+	float page_scale;
+} EmfPlusSavedState;
+
+/*
+ * EMF+ playback state. Objects (pens, brushes, paths...) are built once, when their Object record is
+ * played, and then used by all the records referring to their id. The device transform is computed
+ * from the EMF+ world and page transforms, applied to the transform the playback started with.
+ */
+typedef struct {
+	MetaObject objects [EMFPLUS_MAX_OBJECTS];
+	BOOL get_dc;			/* the last EMF+ record was a GetDC, the next EMF records are played */
+	GpMatrix base;			/* metafile to device transform, EMF+ transforms are relative to it */
+	GpMatrix world;
+	GpUnit page_unit;
+	float page_scale;
+	float dpi_x, dpi_y;
+	BOOL saved;			/* the graphics state is restored at the end of the playback */
+	unsigned int state;
+	GpRegion *clip;			/* clip when the playback started, restored by ResetClip */
+	GpSolidFill *solid;		/* reused by the records with an ARGB color instead of a brush */
+	GArray *stack;			/* of EmfPlusSavedState */
+	/* object spanning several Object records */
+	BYTE *partial;
+	int partial_size;
+	int partial_total;
+} EmfPlusPlayState;
+
 typedef struct {
 	GpMetafile *metafile;
 	int x, y, width, height;
@@ -107,6 +275,10 @@ typedef struct {
 	GpSolidFill *stock_brush_null;
 	/* bitmap representation */
 	BYTE *scan0;
+	/* when compiling, operations are added to the list instead of being drawn on graphics (NULL) */
+	MetafileDisplayList *list;
+	/* set once an EMF+ header was played */
+	EmfPlusPlayState *emfplus;
 } MetafilePlayContext;
 
 typedef struct {
@@ -128,14 +300,24 @@ GpStatus gdip_get_bitmap_from_metafile (GpMetafile *metafile, INT width, INT hei
 
 GpStatus gdip_metafile_stop_recording (GpMetafile *metafile) GDIP_INTERNAL;
 
+MetafileRecorder* gdip_metafile_recorder_new (EmfType type, GDIPCONST GpRectF *frame, MetafileFrameUnit frameUnit) GDIP_INTERNAL;
+void gdip_metafile_recorder_free (MetafileRecorder *recorder) GDIP_INTERNAL;
+GpStatus gdip_metafile_recorder_end (MetafileRecorder *recorder) GDIP_INTERNAL;
+
 GpStatus gdip_metafile_play_emf (MetafilePlayContext *context) GDIP_INTERNAL;
 GpStatus gdip_metafile_play_wmf (MetafilePlayContext *context) GDIP_INTERNAL;
 GpStatus gdip_metafile_play_emfplus_block (MetafilePlayContext *context, BYTE* data, int length) GDIP_INTERNAL;
+void gdip_metafile_emfplus_release (MetafilePlayContext *context) GDIP_INTERNAL;
 
 MetafilePlayContext* gdip_metafile_play_setup (GpMetafile *metafile, GpGraphics *graphics, int x, int y, int width, 
 	int height) GDIP_INTERNAL;
 GpStatus gdip_metafile_play (MetafilePlayContext *context) GDIP_INTERNAL;
 GpStatus gdip_metafile_play_cleanup (MetafilePlayContext *context) GDIP_INTERNAL;
+MetafileOp* gdip_metafile_add_op (MetafilePlayContext *context, MetafileOpType type) GDIP_INTERNAL;
+void gdip_metafile_invalidate_display_list (GpMetafile *metafile) GDIP_INTERNAL;
+
+GpBitmap* gdip_metafile_get_raster (GpMetafile *metafile, GpGraphics *graphics, GpRectF *rect) GDIP_INTERNAL;
+void gdip_metafile_invalidate_raster_cache (GpMetafile *metafile) GDIP_INTERNAL;
 
 GpPen* gdip_metafile_GetSelectedPen (MetafilePlayContext *context) GDIP_INTERNAL;
 GpBrush* gdip_metafile_GetSelectedBrush (MetafilePlayContext *context) GDIP_INTERNAL;
@@ -172,6 +354,7 @@ GpStatus gdip_metafile_StretchDIBits (MetafilePlayContext *context, int XDest, i
 	UINT iUsage, DWORD dwRop) GDIP_INTERNAL;
 GpStatus gdip_metafile_PolyBezier (MetafilePlayContext *context, GpPointF *points, int count) GDIP_INTERNAL;
 GpStatus gdip_metafile_Polygon (MetafilePlayContext *context, GpPointF *points, int count) GDIP_INTERNAL;
+GpStatus gdip_metafile_Polyline (MetafilePlayContext *context, GpPointF *points, int count) GDIP_INTERNAL;
 GpStatus gdip_metafile_BeginPath (MetafilePlayContext *context) GDIP_INTERNAL;
 GpStatus gdip_metafile_EndPath (MetafilePlayContext *context) GDIP_INTERNAL;
 GpStatus gdip_metafile_CloseFigure (MetafilePlayContext *context) GDIP_INTERNAL;
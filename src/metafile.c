@@ -27,8 +27,168 @@
 #include "hatchbrush-private.h"
 #include "pen.h"
 
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* metafile files larger than this are mapped, instead of being read in memory, when loaded */
+#define METAFILE_MAPPING_THRESHOLD	(1024 * 1024)
+
 //#define DEBUG_METAFILE
 
+/*
+ * Display list. The first playback of a metafile parses its records with a context where graphics is NULL
+ * and list is set: the gdip_metafile_* functions then add operations to the list instead of drawing them.
+ * Later playbacks only replay the operations (see gdip_metafile_play_display_list).
+ */
+MetafileOp*
+gdip_metafile_add_op (MetafilePlayContext *context, MetafileOpType type)
+{
+	MetafileDisplayList *list = context->list;
+	MetafileOp *op;
+
+	if (list->count == list->capacity) {
+		int capacity = list->capacity ? list->capacity * 2 : 64;
+		MetafileOp *ops = gdip_realloc (list->ops, capacity * sizeof (MetafileOp));
+		if (!ops)
+			return NULL;
+		list->ops = ops;
+		list->capacity = capacity;
+	}
+
+	op = &list->ops [list->count++];
+	memset (op, 0, sizeof (MetafileOp));
+	op->type = type;
+	op->miter_limit = context->miter_limit;
+	return op;
+}
+
+/* the list owns the objects referenced by its operations, the object is deleted if it can't be kept */
+static GpStatus
+gdip_metafile_keep_object (MetafileDisplayList *list, int type, void *ptr)
+{
+	if (list->objects_count == list->objects_capacity) {
+		int capacity = list->objects_capacity ? list->objects_capacity * 2 : 16;
+		MetaObject *objects = gdip_realloc (list->objects, capacity * sizeof (MetaObject));
+		if (!objects) {
+			if (type == METAOBJECT_TYPE_PEN)
+				GdipDeletePen ((GpPen*) ptr);
+			else
+				GdipDeleteBrush ((GpBrush*) ptr);
+			return OutOfMemory;
+		}
+		list->objects = objects;
+		list->objects_capacity = capacity;
+	}
+
+	list->objects [list->objects_count].type = type;
+	list->objects [list->objects_count].ptr = ptr;
+	list->objects_count++;
+	return Ok;
+}
+
+static void
+gdip_metafile_set_op_bounds (MetafileOp *op, float x, float y, float width, float height)
+{
+	op->has_bounds = TRUE;
+	op->bounds.X = x;
+	op->bounds.Y = y;
+	op->bounds.Width = width;
+	op->bounds.Height = height;
+}
+
+static void
+gdip_metafile_set_op_points_bounds (MetafileOp *op, GDIPCONST GpPointF *points, int count)
+{
+	float left, top, right, bottom;
+	int i;
+
+	if (count <= 0)
+		return;
+
+	left = right = points [0].X;
+	top = bottom = points [0].Y;
+	for (i = 1; i < count; i++) {
+		left = min (left, points [i].X);
+		right = max (right, points [i].X);
+		top = min (top, points [i].Y);
+		bottom = max (bottom, points [i].Y);
+	}
+	gdip_metafile_set_op_bounds (op, left, top, right - left, bottom - top);
+}
+
+/*
+ * Grow the bounds of a stroked operation by what the pen can add around the geometry: half its width,
+ * times the miter limit for mitered joins (square caps need sqrt (2)). Hairline pens draw one device
+ * pixel, which doesn't translate in logical units, so it's up to the user of the bounds to allow it.
+ */
+static void
+gdip_metafile_inflate_op_bounds (MetafileOp *op)
+{
+	GpLineJoin join;
+	float width;
+	float factor = 1.4142135f;
+
+	if (!op->has_bounds || !op->pen || (GdipGetPenWidth (op->pen, &width) != Ok))
+		return;
+
+	if ((GdipGetPenLineJoin (op->pen, &join) == Ok) && (join == LineJoinMiter) && (op->miter_limit > factor))
+		factor = op->miter_limit;
+
+	width = width / 2 * factor;
+	op->bounds.X -= width;
+	op->bounds.Y -= width;
+	op->bounds.Width += width * 2;
+	op->bounds.Height += width * 2;
+}
+
+static GpStatus
+gdip_metafile_add_points_op (MetafilePlayContext *context, MetafileOpType type, GpPen *pen, GpBrush *brush,
+	GDIPCONST GpPointF *points, int count)
+{
+	MetafileOp *op = gdip_metafile_add_op (context, type);
+	if (!op)
+		return OutOfMemory;
+
+	if (count > 0) {
+		op->u.poly.points = GdipAlloc (count * sizeof (GpPointF));
+		if (!op->u.poly.points)
+			return OutOfMemory;
+		memcpy (op->u.poly.points, points, count * sizeof (GpPointF));
+	}
+	op->u.poly.count = count;
+	op->u.poly.fill_mode = context->fill_mode;
+	op->pen = pen;
+	op->brush = brush;
+	gdip_metafile_set_op_points_bounds (op, points, count);
+	gdip_metafile_inflate_op_bounds (op);
+	return Ok;
+}
+
+static GpStatus
+gdip_metafile_add_path_op (MetafilePlayContext *context, MetafileOpType type, GpPen *pen, GpBrush *brush)
+{
+	GpStatus status;
+	GpRectF rect;
+	MetafileOp *op = gdip_metafile_add_op (context, type);
+	if (!op)
+		return OutOfMemory;
+
+	status = GdipClonePath (context->path, &op->u.path);
+	if (status != Ok) {
+		context->list->count--;
+		return status;
+	}
+	op->pen = pen;
+	op->brush = brush;
+	if (GdipGetPathWorldBounds (op->u.path, &rect, NULL, NULL) == Ok) {
+		gdip_metafile_set_op_bounds (op, rect.X, rect.Y, rect.Width, rect.Height);
+		gdip_metafile_inflate_op_bounds (op);
+	}
+	return Ok;
+}
+
 /* http://wvware.sourceforge.net/caolan/SaveDC.html */
 GpStatus
 gdip_metafile_SaveDC (MetafilePlayContext *context)
@@ -61,6 +221,15 @@ gdip_metafile_SetMapMode (MetafilePlayContext *context, DWORD mode)
 #ifdef DEBUG_METAFILE
 	printf ("SetMapMode %d", mode);
 #endif
+	if (context->list) {
+		MetafileOp *op = gdip_metafile_add_op (context, MetafileOpSetMapMode);
+		if (!op)
+			return OutOfMemory;
+		op->u.map.mode = mode;
+		context->map_mode = mode;
+		return Ok;
+	}
+
 	context->map_mode = mode;
 
 	switch (mode) {
@@ -256,6 +425,21 @@ gdip_metafile_ModifyWorldTransform (MetafilePlayContext *context, XFORM *lpXform
 	GpMatrix matrix;
 	GpMatrixOrder order;
 
+	if (context->list) {
+		MetafileOp *op;
+
+		if ((iMode != MWT_IDENTITY) && (((iMode != MWT_LEFTMULTIPLY) && (iMode != MWT_RIGHTMULTIPLY)) || !lpXform))
+			return InvalidParameter;
+
+		op = gdip_metafile_add_op (context, MetafileOpModifyWorldTransform);
+		if (!op)
+			return OutOfMemory;
+		if (lpXform)
+			op->u.transform.xform = *lpXform;
+		op->u.transform.mode = iMode;
+		return Ok;
+	}
+
 	switch (iMode) {
 	case MWT_IDENTITY:
 		/* This is a reset and it ignores lpXform in this case */
@@ -309,10 +493,14 @@ gdip_metafile_DeleteObject (MetafilePlayContext *context, DWORD slot)
 	obj = &context->objects [slot];
 	switch (obj->type) {
 	case METAOBJECT_TYPE_PEN:
-		status = GdipDeletePen ((GpPen*)obj->ptr);
-		break;
 	case METAOBJECT_TYPE_BRUSH:
-		status = GdipDeleteBrush ((GpBrush*)obj->ptr);
+		/* when compiling the object can still be used by the operations already added to the list */
+		if (context->list)
+			status = gdip_metafile_keep_object (context->list, obj->type, obj->ptr);
+		else if (obj->type == METAOBJECT_TYPE_PEN)
+			status = GdipDeletePen ((GpPen*)obj->ptr);
+		else
+			status = GdipDeleteBrush ((GpBrush*)obj->ptr);
 		break;
 	case METAOBJECT_TYPE_EMPTY:
 		break;
@@ -359,6 +547,16 @@ gdip_metafile_SetWindowExt (MetafilePlayContext *context, int height, int width)
 #ifdef DEBUG_METAFILE
 	printf ("SetWindowExt height %d, width %d", height, width);
 #endif
+	if (context->list) {
+		/* the mapping mode is only known when the list is played */
+		MetafileOp *op = gdip_metafile_add_op (context, MetafileOpSetWindowExt);
+		if (!op)
+			return OutOfMemory;
+		op->u.map.width = width;
+		op->u.map.height = height;
+		return Ok;
+	}
+
 	switch (context->map_mode) {
 	case MM_ISOTROPIC:
 		sx = (float)context->metafile->metafile_header.Width / width;
@@ -395,6 +593,14 @@ gdip_metafile_LineTo (MetafilePlayContext *context, int x, int y)
 #endif
 	if (context->use_path) {
 		status = GdipAddPathLine (context->path, context->current_x, context->current_y, x, y);
+	} else if (context->list) {
+		GpPointF points [2];
+		points [0].X = context->current_x;
+		points [0].Y = context->current_y;
+		points [1].X = x;
+		points [1].Y = y;
+		status = gdip_metafile_add_points_op (context, MetafileOpDrawLines, gdip_metafile_GetSelectedPen (context),
+			NULL, points, 2);
 	} else {
 		GpPen *pen = gdip_metafile_GetSelectedPen (context);
 		status = GdipDrawLine (context->graphics, pen, context->current_x, context->current_y, x, y);
@@ -577,6 +783,23 @@ gdip_metafile_Arc (MetafilePlayContext *context, int left, int top, int right, i
 	if ((right - left <= 0) || (bottom - top <= 0))
 		return Ok;
 
+	if (context->list) {
+		MetafileOp *op = gdip_metafile_add_op (context, MetafileOpDrawArc);
+		if (!op)
+			return OutOfMemory;
+		op->pen = gdip_metafile_GetSelectedPen (context);
+		op->u.arc.rect.X = left;
+		op->u.arc.rect.Y = top;
+		op->u.arc.rect.Width = right - left;
+		op->u.arc.rect.Height = bottom - top;
+		op->u.arc.start = atan2 (ystart, xstart);
+		op->u.arc.sweep = atan2 (yend, xend);
+		/* the whole ellipse, the arc is within it */
+		gdip_metafile_set_op_bounds (op, left, top, right - left, bottom - top);
+		gdip_metafile_inflate_op_bounds (op);
+		return Ok;
+	}
+
 	return GdipDrawArc (context->graphics, gdip_metafile_GetSelectedPen (context), left, top, 
 		(right - left), (bottom - top), atan2 (ystart, xstart), atan2 (yend, xend));
 }
@@ -596,6 +819,18 @@ gdip_metafile_Rectangle (MetafilePlayContext *context, int bottomRect, int right
 		bottomRect, rightRect, topRect, leftRect);
 #endif
 
+	if (context->list) {
+		MetafileOp *op = gdip_metafile_add_op (context, MetafileOpRectangle);
+		if (!op)
+			return OutOfMemory;
+		op->brush = gdip_metafile_GetSelectedBrush (context);
+		op->pen = gdip_metafile_GetSelectedPen (context);
+		gdip_metafile_set_op_bounds (op, x, y, width, height);
+		op->u.rect = op->bounds;
+		gdip_metafile_inflate_op_bounds (op);
+		return Ok;
+	}
+
 	status = GdipFillRectangleI (context->graphics, gdip_metafile_GetSelectedBrush (context), x, y, width, height);
 	if (status != Ok)
 		return status;
@@ -613,6 +848,21 @@ gdip_metafile_SetPixel (MetafilePlayContext *context, DWORD color, int x, int y)
 	if (status != Ok)
 		return status;
 
+	if (context->list) {
+		MetafileOp *op;
+
+		status = gdip_metafile_keep_object (context->list, METAOBJECT_TYPE_BRUSH, fill);
+		if (status != Ok)
+			return status;
+		op = gdip_metafile_add_op (context, MetafileOpFillRectangle);
+		if (!op)
+			return OutOfMemory;
+		op->brush = fill;
+		gdip_metafile_set_op_bounds (op, x, y, 1, 1);
+		op->u.rect = op->bounds;
+		return Ok;
+	}
+
 	status = GdipFillRectangle (context->graphics, fill, x, y, 1, 1);
 	GdipDeleteBrush (fill);
 	return status;
@@ -655,6 +905,26 @@ gdip_metafile_StretchDIBits (MetafilePlayContext *context, int XDest, int YDest,
 	}
 	ms.pos = 0;
 	status = gdip_read_bmp_image (&ms, &image, Memory);
+	if ((status == Ok) && context->list) {
+		/* the decoded image is kept, and owned, by the operation */
+		MetafileOp *op = gdip_metafile_add_op (context, MetafileOpDrawImage);
+		if (!op) {
+			GdipDisposeImage (image);
+			return OutOfMemory;
+		}
+		op->u.image.image = image;
+		op->u.image.dest.X = XDest;
+		op->u.image.dest.Y = YDest;
+		op->u.image.dest.Width = nDestWidth;
+		op->u.image.dest.Height = nDestHeight;
+		op->u.image.src.X = XSrc;
+		op->u.image.src.Y = YSrc;
+		op->u.image.src.Width = nSrcWidth;
+		op->u.image.src.Height = nSrcHeight;
+		gdip_metafile_set_op_bounds (op, min (XDest, XDest + nDestWidth), min (YDest, YDest + nDestHeight),
+			abs (nDestWidth), abs (nDestHeight));
+		return Ok;
+	}
 	if (status == Ok) {
 		status = GdipDrawImageRectRect (context->graphics, image, XDest, YDest,
 			nDestWidth, nDestHeight, XSrc, YSrc, nSrcWidth, nSrcHeight, UnitPixel, NULL, NULL, NULL);
@@ -717,7 +987,9 @@ gdip_metafile_GetSelectedPen (MetafilePlayContext *context)
 	}
 
 	/* miter limit was global (i.e. context not pen specific) in GDI */
-	GdipSetPenMiterLimit (pen, context->miter_limit);
+	/* when compiling it's kept with each operation and set when the operation is played */
+	if (!context->list)
+		GdipSetPenMiterLimit (pen, context->miter_limit);
 	return pen;
 }
 
@@ -797,6 +1069,9 @@ gdip_metafile_PolyBezier (MetafilePlayContext *context, GpPointF *points, int co
 #endif
 	if (context->use_path) {
 		status = GdipAddPathBeziers (context->path, points, count);
+	} else if (context->list) {
+		status = gdip_metafile_add_points_op (context, MetafileOpDrawCurve, gdip_metafile_GetSelectedPen (context),
+			NULL, points, count);
 	} else {
 		GpPen *pen = gdip_metafile_GetSelectedPen (context);
 		return GdipDrawCurve (context->graphics, pen, points, count);
@@ -811,6 +1086,11 @@ gdip_metafile_Polygon (MetafilePlayContext *context, GpPointF *points, int count
 	printf ("Polygon %s count %d", context->use_path ? "Path " : " ", count);
 #endif
 	GpBrush *brush = gdip_metafile_GetSelectedBrush (context);
+	if (context->list) {
+		return gdip_metafile_add_points_op (context, MetafileOpPolygon, gdip_metafile_GetSelectedPen (context),
+			brush, points, count);
+	}
+
 	GpStatus status = GdipFillPolygon (context->graphics, brush, points, count, context->fill_mode);
 	if (status == Ok) {
 		GpPen *pen = gdip_metafile_GetSelectedPen (context);
@@ -819,6 +1099,32 @@ gdip_metafile_Polygon (MetafilePlayContext *context, GpPointF *points, int count
 	return status;
 }
 
+/* each segment is drawn on its own, like a serie of LineTo */
+GpStatus
+gdip_metafile_Polyline (MetafilePlayContext *context, GpPointF *points, int count)
+{
+	GpStatus status;
+	int i;
+#ifdef DEBUG_METAFILE
+	printf ("Polyline count %d", count);
+#endif
+	if (count < 2)
+		return Ok;
+
+	if (context->list) {
+		return gdip_metafile_add_points_op (context, MetafileOpDrawLines, gdip_metafile_GetSelectedPen (context),
+			NULL, points, count);
+	}
+
+	for (i = 1; i < count; i++) {
+		GpPen *pen = gdip_metafile_GetSelectedPen (context);
+		status = GdipDrawLine (context->graphics, pen, points [i - 1].X, points [i - 1].Y, points [i].X, points [i].Y);
+		if (status != Ok)
+			return status;
+	}
+	return Ok;
+}
+
 GpStatus
 gdip_metafile_BeginPath (MetafilePlayContext *context)
 {
@@ -865,6 +1171,8 @@ gdip_metafile_FillPath (MetafilePlayContext *context)
 	/* end path if required */
 	if (context->use_path)
 		gdip_metafile_EndPath (context);
+	if (context->list)
+		return gdip_metafile_add_path_op (context, MetafileOpFillPath, NULL, brush);
 	return GdipFillPath (context->graphics, brush, context->path);
 }
 
@@ -878,6 +1186,8 @@ gdip_metafile_StrokePath (MetafilePlayContext *context)
 	/* end path if required */
 	if (context->use_path)
 		gdip_metafile_EndPath (context);
+	if (context->list)
+		return gdip_metafile_add_path_op (context, MetafileOpDrawPath, pen, NULL);
 	return GdipDrawPath (context->graphics, pen, context->path);
 }
 
@@ -894,6 +1204,9 @@ gdip_metafile_StrokeAndFillPath (MetafilePlayContext *context)
 		gdip_metafile_EndPath (context);
 
 	brush = gdip_metafile_GetSelectedBrush (context);
+	if (context->list)
+		return gdip_metafile_add_path_op (context, MetafileOpFillAndDrawPath, gdip_metafile_GetSelectedPen (context), brush);
+
 	status = GdipFillPath (context->graphics, brush, context->path);
 	if (status == Ok) {
 		GpPen *pen = gdip_metafile_GetSelectedPen (context);
@@ -903,6 +1216,68 @@ gdip_metafile_StrokeAndFillPath (MetafilePlayContext *context)
 }
 
 
+/* map the rest of the file, i.e. the records, so they are only paged in while being played */
+static BOOL
+gdip_metafile_map_file (GpMetafile *metafile, FILE *fp)
+{
+#ifdef HAVE_MMAP
+	MetafileMapping *mapping;
+	struct stat st;
+	long offset;
+	void *base;
+
+	offset = ftell (fp);
+	if ((offset < 0) || (fstat (fileno (fp), &st) != 0))
+		return FALSE;
+	if ((st.st_size < METAFILE_MAPPING_THRESHOLD) || (st.st_size <= offset))
+		return FALSE;
+
+	mapping = (MetafileMapping*) GdipAlloc (sizeof (MetafileMapping));
+	if (!mapping)
+		return FALSE;
+
+	base = mmap (NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno (fp), 0);
+	if (base == MAP_FAILED) {
+		GdipFree (mapping);
+		return FALSE;
+	}
+#ifdef MADV_SEQUENTIAL
+	/* records are played in order, pages behind the playback can be dropped */
+	madvise (base, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+	mapping->base = base;
+	mapping->size = st.st_size;
+	mapping->refcount = 1;
+	metafile->mapping = mapping;
+	metafile->data = (BYTE*) base + offset;
+	/* like a read, the length is limited to what's available */
+	metafile->length = min (metafile->length, st.st_size - offset);
+	return TRUE;
+#else
+	return FALSE;
+#endif
+}
+
+static void
+gdip_metafile_release_data (GpMetafile *metafile)
+{
+	if (metafile->mapping) {
+		if (--metafile->mapping->refcount == 0) {
+#ifdef HAVE_MMAP
+			munmap (metafile->mapping->base, metafile->mapping->size);
+#endif
+			GdipFree (metafile->mapping);
+		}
+		metafile->mapping = NULL;
+	} else if (metafile->data) {
+		GdipFree (metafile->data);
+	}
+
+	metafile->data = NULL;
+	metafile->length = 0;
+}
+
 static GpMetafile*
 gdip_metafile_create ()
 {
@@ -914,9 +1289,17 @@ gdip_metafile_create ()
 		mf->delete = FALSE;
 		mf->data = NULL;
 		mf->length = 0;
+		mf->mapping = NULL;
 		mf->recording = FALSE;
 		mf->fp = NULL;
 		mf->stream = NULL;
+		mf->recorder = NULL;
+		mf->raster_cache_limit = 0;
+		mf->raster_cache_size = 0;
+		mf->raster_cache_clock = 0;
+		mf->raster_cache = NULL;
+		mf->display_list = NULL;
+		mf->culled_operations = 0;
 	}
 	return mf;
 }
@@ -946,7 +1329,13 @@ gdip_metafile_clone (GpMetafile *metafile, GpMetafile **clonedmetafile)
 	mf->base = *base;
 
 	memcpy (&mf->metafile_header, &metafile->metafile_header, sizeof (MetafileHeader));
-	if (metafile->length > 0) {
+	if (metafile->mapping) {
+		/* the records are read-only, the mapping is shared */
+		metafile->mapping->refcount++;
+		mf->mapping = metafile->mapping;
+		mf->data = metafile->data;
+		mf->length = metafile->length;
+	} else if (metafile->length > 0) {
 		mf->data = GdipAlloc (metafile->length);
 		if (!mf->data) {
 			GdipFree (mf);
@@ -957,6 +1346,12 @@ gdip_metafile_clone (GpMetafile *metafile, GpMetafile **clonedmetafile)
 		mf->length = metafile->length;
 	}
 
+	/* the cached renderings aren't shared, the clone builds its own */
+	mf->raster_cache_limit = metafile->raster_cache_limit;
+	mf->raster_cache_size = 0;
+	mf->raster_cache_clock = 0;
+	mf->raster_cache = NULL;
+
 	*clonedmetafile = mf;
 	return Ok;
 }
@@ -967,16 +1362,16 @@ gdip_metafile_dispose (GpMetafile *metafile)
 	if (!metafile)
 		return InvalidParameter;
 
-	/* TODO deal with "delete" flag */
-	metafile->length = 0;
-	if (metafile->data) {
-		GdipFree (metafile->data);
-		metafile->data = NULL;
-	}
-
+	/* saving the recording also loads it back as the metafile data */
 	if (metafile->recording)
 		gdip_metafile_stop_recording (metafile);
 
+	/* TODO deal with "delete" flag */
+	gdip_metafile_release_data (metafile);
+
+	gdip_metafile_invalidate_raster_cache (metafile);
+	gdip_metafile_invalidate_display_list (metafile);
+
 	GdipFree (metafile);
 	return Ok;
 }
@@ -1007,10 +1402,167 @@ gdip_get_bitmap_from_metafile (GpMetafile *metafile, INT width, INT height, GpIm
 	return GdipGetImageThumbnail ((GpImage *) metafile, width, height, thumbnail, NULL, NULL);
 }
 
+static void EnhMetaHeaderLE (ENHMETAHEADER3 *emf);
+
+/* EMF+ records are split, at record boundaries, into comments of this size */
+#define EMFPLUS_COMMENT_MAX_SIZE	65536
+#define EMFPLUS_COMMENT_SIGNATURE	0x2B464D45
+#define EMR_GDICOMMENT_EMFPLUS_SIZE	16
+#define EMR_EOF_SIZE			20
+
+static int
+gdip_metafile_next_comment_end (EmfPlusBuffer *records, int start)
+{
+	int end = start;
+
+	while (end < records->size) {
+		DWORD size = GUINT32_FROM_LE (*(DWORD*)(records->data + end + 4));
+		/* a record larger than a comment gets its own */
+		if ((end > start) && (end - start + size > EMFPLUS_COMMENT_MAX_SIZE))
+			break;
+		end += size;
+	}
+	return end;
+}
+
+static float
+gdip_metafile_frame_to_pixels (float value, MetafileFrameUnit unit, float dpi)
+{
+	/* MetafileFrameUnitGdi is 0.01 mm */
+	if (unit == MetafileFrameUnitGdi)
+		return value * dpi / (MM_PER_INCH * 100);
+
+	return gdip_unit_conversion ((Unit) unit, UnitPixel, dpi, gtMemoryBitmap, value);
+}
+
+/* wrap the recorded EMF+ records into an EMF, save it and load it back as the metafile data */
+static GpStatus
+gdip_metafile_save_recording (GpMetafile *metafile)
+{
+	MetafileRecorder *recorder = metafile->recorder;
+	EmfPlusBuffer *records = &recorder->records;
+	ENHMETAHEADER3 *header;
+	GpMetafile *recorded;
+	MemorySource ms;
+	GpStatus status;
+	BYTE *emf, *p;
+	DWORD *eof;
+	int size, count, start, end;
+	int x, y, width, height;
+	float dpi = gdip_get_display_dpi ();
+	/* the reference device is a 10 inches square display */
+	int device = iround (dpi * 10);
+
+	status = gdip_metafile_recorder_end (recorder);
+	if (status != Ok)
+		return status;
+
+	size = sizeof (ENHMETAHEADER3) + EMR_EOF_SIZE;
+	count = 2;
+	for (start = 0; start < records->size; start = end) {
+		end = gdip_metafile_next_comment_end (records, start);
+		size += EMR_GDICOMMENT_EMFPLUS_SIZE + end - start;
+		count++;
+	}
+
+	emf = (BYTE*) GdipAlloc (size);
+	if (!emf)
+		return OutOfMemory;
+
+	/* an empty frame (only allowed for MetafileFrameUnitGdi) covers the reference device */
+	if ((recorder->frame.Width == 0) || (recorder->frame.Height == 0)) {
+		x = y = 0;
+		width = height = device;
+	} else {
+		x = iround (gdip_metafile_frame_to_pixels (recorder->frame.X, recorder->frame_unit, dpi));
+		y = iround (gdip_metafile_frame_to_pixels (recorder->frame.Y, recorder->frame_unit, dpi));
+		width = max (iround (gdip_metafile_frame_to_pixels (recorder->frame.Width, recorder->frame_unit, dpi)), 1);
+		height = max (iround (gdip_metafile_frame_to_pixels (recorder->frame.Height, recorder->frame_unit, dpi)), 1);
+	}
+
+	header = (ENHMETAHEADER3*) emf;
+	memset (header, 0, sizeof (ENHMETAHEADER3));
+	header->iType = GUINT32_TO_LE (EMR_HEADER);
+	header->nSize = sizeof (ENHMETAHEADER3);
+	/* bounds and frame are inclusive */
+	header->rclBounds.left = x;
+	header->rclBounds.top = y;
+	header->rclBounds.right = x + width - 1;
+	header->rclBounds.bottom = y + height - 1;
+	header->rclFrame.left = iround (x * MM_PER_INCH * 100 / dpi);
+	header->rclFrame.top = iround (y * MM_PER_INCH * 100 / dpi);
+	header->rclFrame.right = iround ((x + width - 1) * MM_PER_INCH * 100 / dpi);
+	header->rclFrame.bottom = iround ((y + height - 1) * MM_PER_INCH * 100 / dpi);
+	header->dSignature = 0x464D4520;
+	header->nVersion = 0x10000;
+	header->nBytes = size;
+	header->nRecords = count;
+	header->nHandles = 1;
+	header->szlDevice.cx = device;
+	header->szlDevice.cy = device;
+	header->szlMillimeters.cx = 254;
+	header->szlMillimeters.cy = 254;
+	EnhMetaHeaderLE (header);
+
+	p = emf + sizeof (ENHMETAHEADER3);
+	for (start = 0; start < records->size; start = end) {
+		DWORD *comment = (DWORD*) p;
+		end = gdip_metafile_next_comment_end (records, start);
+		comment [0] = GUINT32_TO_LE (EMR_GDICOMMENT);
+		comment [1] = GUINT32_TO_LE (EMR_GDICOMMENT_EMFPLUS_SIZE + end - start);
+		comment [2] = GUINT32_TO_LE (sizeof (DWORD) + end - start);
+		comment [3] = GUINT32_TO_LE (EMFPLUS_COMMENT_SIGNATURE);
+		memcpy (p + EMR_GDICOMMENT_EMFPLUS_SIZE, records->data + start, end - start);
+		p += EMR_GDICOMMENT_EMFPLUS_SIZE + end - start;
+	}
+
+	eof = (DWORD*) p;
+	eof [0] = GUINT32_TO_LE (EMR_EOF);
+	eof [1] = GUINT32_TO_LE (EMR_EOF_SIZE);
+	eof [2] = 0;
+	eof [3] = GUINT32_TO_LE (EMR_EOF_SIZE - 2 * sizeof (DWORD));
+	eof [4] = GUINT32_TO_LE (EMR_EOF_SIZE);
+
+	if (metafile->fp) {
+		if (fwrite (emf, 1, size, metafile->fp) != size)
+			status = GenericError;
+	} else if (recorder->put_bytes) {
+		if (recorder->put_bytes (emf, size) != size)
+			status = GenericError;
+	}
+
+	if (status == Ok) {
+		ms.ptr = emf;
+		ms.size = size;
+		ms.pos = 0;
+		status = gdip_get_metafile_from (&ms, &recorded, Memory);
+	}
+	if (status == Ok) {
+		gdip_metafile_release_data (metafile);
+		metafile->data = recorded->data;
+		metafile->length = recorded->length;
+		metafile->base.image_format = recorded->base.image_format;
+		memcpy (&metafile->metafile_header, &recorded->metafile_header, sizeof (MetafileHeader));
+
+		recorded->data = NULL;
+		recorded->length = 0;
+		gdip_metafile_dispose (recorded);
+	}
+
+	GdipFree (emf);
+	return status;
+}
+
 GpStatus
 gdip_metafile_stop_recording (GpMetafile *metafile)
 {
-	/* TODO save current stuff */
+	GpStatus status = Ok;
+
+	if (metafile->recorder) {
+		status = gdip_metafile_save_recording (metafile);
+		gdip_metafile_recorder_free (metafile->recorder);
+		metafile->recorder = NULL;
+	}
 
 	if (metafile->fp) {
 		fclose (metafile->fp);
@@ -1022,72 +1574,206 @@ gdip_metafile_stop_recording (GpMetafile *metafile)
 	}
 	/* we cannot open a new graphics instance on this metafile - recording is over */
 	metafile->recording = FALSE;
-	return Ok;
+	/* anything rendered, or compiled, before is outdated */
+	gdip_metafile_invalidate_raster_cache (metafile);
+	gdip_metafile_invalidate_display_list (metafile);
+	return status;
 }
 
-MetafilePlayContext*
-gdip_metafile_play_setup (GpMetafile *metafile, GpGraphics *graphics, int x, int y, int width, int height)
+static void
+gdip_metafile_remove_raster (GpMetafile *metafile, MetafileRaster *raster)
+{
+	MetafileRaster **link = &metafile->raster_cache;
+
+	while (*link != raster)
+		link = &(*link)->next;
+	*link = raster->next;
+
+	metafile->raster_cache_size -= raster->size;
+	GdipDisposeImage (raster->bitmap);
+	GdipFree (raster);
+}
+
+void
+gdip_metafile_invalidate_raster_cache (GpMetafile *metafile)
+{
+	while (metafile->raster_cache)
+		gdip_metafile_remove_raster (metafile, metafile->raster_cache);
+}
+
+/* the metafile is rendered inside a width by height bitmap, in the content rectangle at x, y */
+static GpBitmap*
+gdip_metafile_render_raster (GpMetafile *metafile, GpGraphics *graphics, int width, int height, float x, float y,
+	int content_width, int content_height)
 {
-	int i;
-	MetaObject *obj;
 	MetafilePlayContext *context;
-	float scaleX;
-	float scaleY;
-	float translateX;
-	float translateY;
-	/* metafiles always render as 32bppRgb */
+	GpBitmap *bitmap;
+	GpGraphics *g;
+	GpStatus status;
 
-	if (!metafile || !graphics)
+	/* cairo renders premultiplied colors, using PARGB avoids converting them twice */
+	if (GdipCreateBitmapFromScan0 (width, height, 0, PixelFormat32bppPARGB, NULL, &bitmap) != Ok)
 		return NULL;
 
-	context = GdipAlloc (sizeof (MetafilePlayContext));
-	if (!context) {
+	if (GdipGetImageGraphicsContext (bitmap, &g) != Ok) {
+		GdipDisposeImage (bitmap);
 		return NULL;
 	}
+	GdipSetInterpolationMode (g, graphics->interpolation);
+	GdipSetSmoothingMode (g, graphics->draw_mode);
+	GdipSetTextRenderingHint (g, graphics->text_mode);
+	GdipTranslateWorldTransform (g, x, y, MatrixOrderPrepend);
+
+	status = OutOfMemory;
+	context = gdip_metafile_play_setup (metafile, g, 0, 0, content_width, content_height);
+	if (context) {
+		status = gdip_metafile_play (context);
+		gdip_metafile_play_cleanup (context);
+	}
+	GdipDeleteGraphics (g);
 
-	context->metafile = metafile;
-	context->graphics = graphics;
-	context->use_path = FALSE;
-	context->path = NULL;
+	if (status != Ok) {
+		GdipDisposeImage (bitmap);
+		return NULL;
+	}
+	return bitmap;
+}
 
-	/* keep a copy for clean up */
-	GdipGetWorldTransform (graphics, &context->initial);
-#ifdef DEBUG_METAFILE
-	MetafileHeader *mh = &metafile->metafile_header;
-	GpMatrix *m = &context->initial;
-	g_warning ("\nMetafileHeader X %d, Y %d, W %d, H %d", mh->X, mh->Y, mh->Width, mh->Height);
-	g_warning ("\n\tinitial matrix %g %g %g %g %g %g", m->xx, m->yx, m->xy, m->yy, m->x0, m->y0);
-#endif
-	context->x = x;
-	context->y = y;
-	context->width = width;
-	context->height = height;
-	/* and keep an adjusted copy for providing "resets" */
-	scaleX = (float) width / (float) metafile->metafile_header.Width;
-	scaleY = (float) height / (float) metafile->metafile_header.Height;
-	GdipScaleWorldTransform (graphics, scaleX, scaleY, MatrixOrderPrepend);
-	translateX = -metafile->metafile_header.X + x / scaleX;
-	translateY = -metafile->metafile_header.Y + y / scaleY;
-	GdipTranslateWorldTransform (graphics, translateX, translateY, MatrixOrderPrepend);
-	GdipGetWorldTransform (graphics, &context->matrix);
+/*
+ * Returns a rendering of the metafile, for the destination rect (page units) on graphics, that can be drawn
+ * instead of playing the metafile again. On return rect holds where the rendering must be drawn: it is
+ * aligned on the device pixels, so it is copied as is, and drawing the metafile at another fractional
+ * device position gets another rendering. Renderings are kept with the metafile, up to raster_cache_limit
+ * bytes, and reused as long as the size, world transform scale, device offset, interpolation and smoothing
+ * modes and text rendering hint are the same. NULL is returned when the metafile must be played, e.g. if the
+ * cache is disabled, the transform rotates or skews the image or the output is vectorial (PostScript / PDF).
+ */
+GpBitmap*
+gdip_metafile_get_raster (GpMetafile *metafile, GpGraphics *graphics, GpRectF *rect)
+{
+	MetafileRaster *raster;
+	MetafileRaster *lru;
+	GpMatrix matrix;
+	float dest_x, dest_y, dest_width, dest_height;
+	float left, top;
+	float offset_x, offset_y;
+	int content_width, content_height;
+	int raster_width, raster_height;
+	unsigned int size;
+
+	if ((metafile->raster_cache_limit == 0) || metafile->recording || (graphics->type == gtPostScript))
+		return NULL;
 
-	/* defaults */
-	context->fill_mode = FillModeAlternate;
-	switch (context->metafile->metafile_header.Type) {
-		case MetafileTypeWmfPlaceable:
-		case MetafileTypeWmf:
-			gdip_metafile_SetMapMode (context, MM_TWIPS);
-			break;
-		case MetafileTypeEmf:
-		case MetafileTypeEmfPlusOnly:
-		case MetafileTypeEmfPlusDual:
-			gdip_metafile_SetMapMode (context, MM_TEXT);
+	if (GdipGetWorldTransform (graphics, &matrix) != Ok)
+		return NULL;
+	if ((matrix.xy != 0.0) || (matrix.yx != 0.0) || (matrix.xx == 0.0) || (matrix.yy == 0.0))
+		return NULL;
+
+	if (OPTIMIZE_CONVERSION (graphics)) {
+		dest_x = rect->X;
+		dest_y = rect->Y;
+		dest_width = rect->Width;
+		dest_height = rect->Height;
+	} else {
+		dest_x = gdip_unitx_convgr (graphics, rect->X);
+		dest_y = gdip_unity_convgr (graphics, rect->Y);
+		dest_width = gdip_unitx_convgr (graphics, rect->Width);
+		dest_height = gdip_unity_convgr (graphics, rect->Height);
+	}
+	if ((dest_width <= 0) || (dest_height <= 0))
+		return NULL;
+
+	/* top-left corner of the destination on the device (the transform can mirror it) */
+	left = MIN (dest_x * matrix.xx, (dest_x + dest_width) * matrix.xx) + matrix.x0;
+	top = MIN (dest_y * matrix.yy, (dest_y + dest_height) * matrix.yy) + matrix.y0;
+	offset_x = left - floorf (left);
+	offset_y = top - floorf (top);
+
+	/* size of the rendering on the device, one more pixel holds the part moved by the offset */
+	content_width = iround (fabs (dest_width * matrix.xx));
+	content_height = iround (fabs (dest_height * matrix.yy));
+	if ((content_width <= 0) || (content_height <= 0))
+		return NULL;
+	raster_width = content_width + ((offset_x > 0) ? 1 : 0);
+	raster_height = content_height + ((offset_y > 0) ? 1 : 0);
+
+	for (raster = metafile->raster_cache; raster; raster = raster->next) {
+		if ((raster->dest_width == dest_width) && (raster->dest_height == dest_height) &&
+			(raster->scale_x == matrix.xx) && (raster->scale_y == matrix.yy) &&
+			(raster->offset_x == offset_x) && (raster->offset_y == offset_y) &&
+			(raster->interpolation == graphics->interpolation) && (raster->smoothing == graphics->draw_mode) &&
+			(raster->text_hint == graphics->text_mode))
 			break;
-		default:
-			GdipFree (context);
+	}
+
+	if (raster) {
+		raster->last_use = ++metafile->raster_cache_clock;
+	} else {
+		if (raster_width > metafile->raster_cache_limit / 4 / raster_height)
 			return NULL;
+		size = raster_width * raster_height * 4;
+
+		/* make some room by evicting the least recently used renderings */
+		while (metafile->raster_cache && (metafile->raster_cache_size + size > metafile->raster_cache_limit)) {
+			lru = metafile->raster_cache;
+			for (raster = lru->next; raster; raster = raster->next) {
+				if (raster->last_use < lru->last_use)
+					lru = raster;
+			}
+			gdip_metafile_remove_raster (metafile, lru);
+		}
+
+		raster = GdipAlloc (sizeof (MetafileRaster));
+		if (!raster)
+			return NULL;
+
+		/* the rendering is drawn mirrored when the scale is negative, so is its offset */
+		raster->bitmap = gdip_metafile_render_raster (metafile, graphics, raster_width, raster_height,
+			(matrix.xx > 0) ? offset_x : raster_width - content_width - offset_x,
+			(matrix.yy > 0) ? offset_y : raster_height - content_height - offset_y,
+			content_width, content_height);
+		if (!raster->bitmap) {
+			GdipFree (raster);
+			return NULL;
+		}
+
+		raster->dest_width = dest_width;
+		raster->dest_height = dest_height;
+		raster->scale_x = matrix.xx;
+		raster->scale_y = matrix.yy;
+		raster->offset_x = offset_x;
+		raster->offset_y = offset_y;
+		raster->interpolation = graphics->interpolation;
+		raster->smoothing = graphics->draw_mode;
+		raster->text_hint = graphics->text_mode;
+		raster->size = size;
+		raster->last_use = ++metafile->raster_cache_clock;
+		raster->next = metafile->raster_cache;
+		metafile->raster_cache = raster;
+		metafile->raster_cache_size += size;
 	}
 
+	/* the device pixels covered by the rendering, back in page units */
+	left = floorf (left);
+	top = floorf (top);
+	rect->X = (((matrix.xx > 0) ? left : left + raster_width) - matrix.x0) / matrix.xx * (rect->Width / dest_width);
+	rect->Y = (((matrix.yy > 0) ? top : top + raster_height) - matrix.y0) / matrix.yy * (rect->Height / dest_height);
+	rect->Width *= raster_width / fabs (dest_width * matrix.xx);
+	rect->Height *= raster_height / fabs (dest_height * matrix.yy);
+	return raster->bitmap;
+}
+
+/* defaults, and the objects array, shared by the playback and the compilation contexts */
+static BOOL
+gdip_metafile_init_state (MetafilePlayContext *context)
+{
+	int i;
+	MetaObject *obj;
+	GpMetafile *metafile = context->metafile;
+
+	context->use_path = FALSE;
+	context->path = NULL;
+	context->fill_mode = FillModeAlternate;
 	context->miter_limit = 10.0f;
 	context->selected_pen =  ENHMETA_STOCK_OBJECT + BLACK_PEN;
 	context->selected_brush = ENHMETA_STOCK_OBJECT + WHITE_BRUSH;
@@ -1110,7 +1796,7 @@ gdip_metafile_play_setup (GpMetafile *metafile, GpGraphics *graphics, int x, int
 	context->stock_brush_null = NULL;
 
 	/* SelectObject | DeleteObject works on this array */
-	switch (context->metafile->metafile_header.Type) {
+	switch (metafile->metafile_header.Type) {
 	case MetafileTypeWmfPlaceable:
 	case MetafileTypeWmf:
 		context->objects_count = metafile->metafile_header.Header.Wmf.mtNoObjects;
@@ -1121,67 +1807,53 @@ gdip_metafile_play_setup (GpMetafile *metafile, GpGraphics *graphics, int x, int
 		context->objects_count = metafile->metafile_header.Header.Emf.nHandles + 1; /* 0 is reserved */
 		break;
 	default:
-		GdipFree (context);
-		return NULL;
+		return FALSE;
 	}
 	context->objects = (MetaObject*) GdipAlloc (context->objects_count * sizeof (MetaObject));
-	if (!context->objects) {
-		GdipFree (context);
-		return NULL;
-	}
+	if (!context->objects)
+		return FALSE;
 	obj = context->objects;
 	for (i = 0; i < context->objects_count; i++) {
 		obj->type = METAOBJECT_TYPE_EMPTY;
 		obj->ptr = NULL;
 		obj++;
 	}
-
-	return context;
+	return TRUE;
 }
 
-GpStatus
-gdip_metafile_play (MetafilePlayContext *context)
+static GpStatus
+gdip_metafile_release_stock_object (MetafilePlayContext *context, int type, void *ptr)
 {
-	if (!context || !context->metafile)
-		return InvalidParameter;
+	if (!ptr)
+		return Ok;
 
-	switch (context->metafile->metafile_header.Type) {
-	case MetafileTypeWmfPlaceable:
-	case MetafileTypeWmf:
-		return gdip_metafile_play_wmf (context);
-	case MetafileTypeEmf:
-		return gdip_metafile_play_emf (context);
-	case MetafileTypeEmfPlusOnly:
-	case MetafileTypeEmfPlusDual:
-		return gdip_metafile_play_emf (context);
-	default:
-		g_warning ("Invalid metafile format %d", context->metafile->metafile_header.Type);
-		break;
-	}
-	return NotImplemented;
+	/* compiled operations can refer to the stock objects, the list keeps them */
+	if (context->list)
+		return gdip_metafile_keep_object (context->list, type, ptr);
+	if (type == METAOBJECT_TYPE_PEN)
+		return GdipDeletePen ((GpPen*) ptr);
+	return GdipDeleteBrush ((GpBrush*) ptr);
 }
 
-GpStatus
-gdip_metafile_play_cleanup (MetafilePlayContext *context)
+static GpStatus
+gdip_metafile_release_state (MetafilePlayContext *context)
 {
-	if (!context)
-		return InvalidParameter;
+	GpStatus status = Ok;
 
-	GdipSetWorldTransform (context->graphics, &context->initial);
-	context->graphics = NULL;
 	if (context->path) {
 		GdipDeletePath (context->path);
 		context->path = NULL;
 	}
 	context->created.type = METAOBJECT_TYPE_EMPTY;
 	context->created.ptr = NULL;
+	gdip_metafile_emfplus_release (context);
 	if (context->objects) {
 		int i;
-		MetaObject *obj = context->objects;
 		/* free each object */
 		for (i = 0; i < context->objects_count; i++) {
-			gdip_metafile_DeleteObject (context, i);
-			obj++;
+			GpStatus s = gdip_metafile_DeleteObject (context, i);
+			if (s == OutOfMemory)
+				status = s;
 		}
 		GdipFree (context->objects);
 		context->objects = NULL;
@@ -1194,24 +1866,379 @@ gdip_metafile_play_cleanup (MetafilePlayContext *context)
 	context->selected_palette = -1;
 
 	/* stock objects */
-	if (context->stock_pen_white)
-		GdipDeletePen (context->stock_pen_white);
-	if (context->stock_pen_black)
-		GdipDeletePen (context->stock_pen_black);
-	if (context->stock_pen_null)
-		GdipDeletePen (context->stock_pen_null);
-	if (context->stock_brush_white)
-		GdipDeleteBrush ((GpBrush*)context->stock_brush_white);
-	if (context->stock_brush_ltgray)
-		GdipDeleteBrush ((GpBrush*)context->stock_brush_ltgray);
-	if (context->stock_brush_gray)
-		GdipDeleteBrush ((GpBrush*)context->stock_brush_gray);
-	if (context->stock_brush_dkgray)
-		GdipDeleteBrush ((GpBrush*)context->stock_brush_dkgray);
-	if (context->stock_brush_black)
-		GdipDeleteBrush ((GpBrush*)context->stock_brush_black);
-	if (context->stock_brush_null)
-		GdipDeleteBrush ((GpBrush*)context->stock_brush_null);
+	{
+		void *pens [] = { context->stock_pen_white, context->stock_pen_black, context->stock_pen_null };
+		void *brushes [] = { context->stock_brush_white, context->stock_brush_ltgray, context->stock_brush_gray,
+			context->stock_brush_dkgray, context->stock_brush_black, context->stock_brush_null };
+		int i;
+
+		for (i = 0; i < sizeof (pens) / sizeof (pens [0]); i++) {
+			if (gdip_metafile_release_stock_object (context, METAOBJECT_TYPE_PEN, pens [i]) == OutOfMemory)
+				status = OutOfMemory;
+		}
+		for (i = 0; i < sizeof (brushes) / sizeof (brushes [0]); i++) {
+			if (gdip_metafile_release_stock_object (context, METAOBJECT_TYPE_BRUSH, brushes [i]) == OutOfMemory)
+				status = OutOfMemory;
+		}
+	}
+	return status;
+}
+
+MetafilePlayContext*
+gdip_metafile_play_setup (GpMetafile *metafile, GpGraphics *graphics, int x, int y, int width, int height)
+{
+	MetafilePlayContext *context;
+	float scaleX;
+	float scaleY;
+	float translateX;
+	float translateY;
+	/* metafiles always render as 32bppRgb */
+
+	if (!metafile || !graphics)
+		return NULL;
+
+	context = GdipAlloc (sizeof (MetafilePlayContext));
+	if (!context) {
+		return NULL;
+	}
+
+	context->metafile = metafile;
+	context->graphics = graphics;
+	context->list = NULL;
+	context->emfplus = NULL;
+
+	/* keep a copy for clean up */
+	GdipGetWorldTransform (graphics, &context->initial);
+#ifdef DEBUG_METAFILE
+	MetafileHeader *mh = &metafile->metafile_header;
+	GpMatrix *m = &context->initial;
+	g_warning ("\nMetafileHeader X %d, Y %d, W %d, H %d", mh->X, mh->Y, mh->Width, mh->Height);
+	g_warning ("\n\tinitial matrix %g %g %g %g %g %g", m->xx, m->yx, m->xy, m->yy, m->x0, m->y0);
+#endif
+	context->x = x;
+	context->y = y;
+	context->width = width;
+	context->height = height;
+	/* and keep an adjusted copy for providing "resets" */
+	scaleX = (float) width / (float) metafile->metafile_header.Width;
+	scaleY = (float) height / (float) metafile->metafile_header.Height;
+	GdipScaleWorldTransform (graphics, scaleX, scaleY, MatrixOrderPrepend);
+	translateX = -metafile->metafile_header.X + x / scaleX;
+	translateY = -metafile->metafile_header.Y + y / scaleY;
+	GdipTranslateWorldTransform (graphics, translateX, translateY, MatrixOrderPrepend);
+	GdipGetWorldTransform (graphics, &context->matrix);
+
+	/* defaults */
+	switch (context->metafile->metafile_header.Type) {
+		case MetafileTypeWmfPlaceable:
+		case MetafileTypeWmf:
+			gdip_metafile_SetMapMode (context, MM_TWIPS);
+			break;
+		case MetafileTypeEmf:
+		case MetafileTypeEmfPlusOnly:
+		case MetafileTypeEmfPlusDual:
+			gdip_metafile_SetMapMode (context, MM_TEXT);
+			break;
+		default:
+			GdipFree (context);
+			return NULL;
+	}
+
+	if (!gdip_metafile_init_state (context)) {
+		GdipFree (context);
+		return NULL;
+	}
+	return context;
+}
+
+static GpStatus
+gdip_metafile_play_records (MetafilePlayContext *context)
+{
+	switch (context->metafile->metafile_header.Type) {
+	case MetafileTypeWmfPlaceable:
+	case MetafileTypeWmf:
+		return gdip_metafile_play_wmf (context);
+	case MetafileTypeEmf:
+		return gdip_metafile_play_emf (context);
+	case MetafileTypeEmfPlusOnly:
+	case MetafileTypeEmfPlusDual:
+		return gdip_metafile_play_emf (context);
+	default:
+		g_warning ("Invalid metafile format %d", context->metafile->metafile_header.Type);
+		break;
+	}
+	return NotImplemented;
+}
+
+static void
+gdip_metafile_free_display_list (MetafileDisplayList *list)
+{
+	int i;
+
+	for (i = 0; i < list->count; i++) {
+		MetafileOp *op = &list->ops [i];
+		switch (op->type) {
+		case MetafileOpDrawLines:
+		case MetafileOpPolygon:
+		case MetafileOpDrawCurve:
+			if (op->u.poly.points)
+				GdipFree (op->u.poly.points);
+			break;
+		case MetafileOpFillPath:
+		case MetafileOpDrawPath:
+		case MetafileOpFillAndDrawPath:
+			GdipDeletePath (op->u.path);
+			break;
+		case MetafileOpDrawImage:
+			GdipDisposeImage (op->u.image.image);
+			break;
+		default:
+			break;
+		}
+	}
+
+	for (i = 0; i < list->objects_count; i++) {
+		if (list->objects [i].type == METAOBJECT_TYPE_PEN)
+			GdipDeletePen ((GpPen*) list->objects [i].ptr);
+		else
+			GdipDeleteBrush ((GpBrush*) list->objects [i].ptr);
+	}
+
+	if (list->ops)
+		GdipFree (list->ops);
+	if (list->objects)
+		GdipFree (list->objects);
+	GdipFree (list);
+}
+
+void
+gdip_metafile_invalidate_display_list (GpMetafile *metafile)
+{
+	if (metafile->display_list) {
+		gdip_metafile_free_display_list (metafile->display_list);
+		metafile->display_list = NULL;
+	}
+}
+
+/*
+ * Parse the records of the metafile into a display list. A parsing error doesn't discard the list, the
+ * operations before the error are kept and the error is returned once they are played. NULL is returned
+ * if the list can't be built, e.g. out of memory, and the records must be played directly.
+ */
+static MetafileDisplayList*
+gdip_metafile_compile (GpMetafile *metafile)
+{
+	MetafilePlayContext context;
+	MetafileDisplayList *list;
+	GpStatus status;
+
+	list = GdipAlloc (sizeof (MetafileDisplayList));
+	if (!list)
+		return NULL;
+	memset (list, 0, sizeof (MetafileDisplayList));
+
+	memset (&context, 0, sizeof (MetafilePlayContext));
+	context.metafile = metafile;
+	context.graphics = NULL;
+	context.list = list;
+	/* the default mapping mode is set when the list is played */
+	switch (metafile->metafile_header.Type) {
+	case MetafileTypeWmfPlaceable:
+	case MetafileTypeWmf:
+		context.map_mode = MM_TWIPS;
+		break;
+	default:
+		context.map_mode = MM_TEXT;
+		break;
+	}
+
+	if (!gdip_metafile_init_state (&context)) {
+		GdipFree (list);
+		return NULL;
+	}
+
+	status = gdip_metafile_play_records (&context);
+	list->status = gdip_metafile_release_state (&context);
+	if (list->status == Ok)
+		list->status = status;
+
+	if (list->status == OutOfMemory) {
+		gdip_metafile_free_display_list (list);
+		return NULL;
+	}
+	return list;
+}
+
+/* logical units to device pixels, i.e. the page unit conversion followed by the cairo matrix */
+static void
+gdip_metafile_get_device_matrix (GpGraphics *graphics, cairo_matrix_t *matrix)
+{
+	gdip_cairo_matrix_copy (matrix, graphics->copy_of_ctm);
+	if (!OPTIMIZE_CONVERSION (graphics))
+		cairo_matrix_scale (matrix, gdip_unitx_convgr (graphics, 1.0f), gdip_unity_convgr (graphics, 1.0f));
+}
+
+static BOOL
+gdip_metafile_is_op_visible (MetafileOp *op, cairo_matrix_t *device, double clip_x1, double clip_y1,
+	double clip_x2, double clip_y2)
+{
+	double x [4], y [4];
+	double left, top, right, bottom;
+	int i;
+
+	x [0] = x [2] = op->bounds.X;
+	x [1] = x [3] = op->bounds.X + op->bounds.Width;
+	y [0] = y [1] = op->bounds.Y;
+	y [2] = y [3] = op->bounds.Y + op->bounds.Height;
+	for (i = 0; i < 4; i++)
+		cairo_matrix_transform_point (device, &x [i], &y [i]);
+
+	left = right = x [0];
+	top = bottom = y [0];
+	for (i = 1; i < 4; i++) {
+		left = min (left, x [i]);
+		right = max (right, x [i]);
+		top = min (top, y [i]);
+		bottom = max (bottom, y [i]);
+	}
+
+	/* hairlines, and antialiasing, can touch one more pixel around the bounds */
+	return (right + 1 >= clip_x1) && (left - 1 <= clip_x2) && (bottom + 1 >= clip_y1) && (top - 1 <= clip_y2);
+}
+
+static GpStatus
+gdip_metafile_play_display_list (MetafilePlayContext *context, MetafileDisplayList *list)
+{
+	GpGraphics *graphics = context->graphics;
+	GpStatus status = Ok;
+	cairo_matrix_t device;
+	BOOL update_device = TRUE;
+	double clip_x1, clip_y1, clip_x2, clip_y2;
+	int i, j;
+
+	/* device extents of the clip, bounded by the surface, operations entirely outside of it aren't played */
+	cairo_save (graphics->ct);
+	cairo_identity_matrix (graphics->ct);
+	cairo_clip_extents (graphics->ct, &clip_x1, &clip_y1, &clip_x2, &clip_y2);
+	cairo_restore (graphics->ct);
+
+	for (i = 0; (i < list->count) && (status == Ok); i++) {
+		MetafileOp *op = &list->ops [i];
+
+		if (op->has_bounds) {
+			if (update_device) {
+				gdip_metafile_get_device_matrix (graphics, &device);
+				update_device = FALSE;
+			}
+			if (!gdip_metafile_is_op_visible (op, &device, clip_x1, clip_y1, clip_x2, clip_y2)) {
+				context->metafile->culled_operations++;
+				continue;
+			}
+		}
+
+		if (op->pen)
+			GdipSetPenMiterLimit (op->pen, op->miter_limit);
+
+		switch (op->type) {
+		case MetafileOpSetMapMode:
+			status = gdip_metafile_SetMapMode (context, op->u.map.mode);
+			update_device = TRUE;
+			break;
+		case MetafileOpSetWindowExt:
+			status = gdip_metafile_SetWindowExt (context, op->u.map.height, op->u.map.width);
+			update_device = TRUE;
+			break;
+		case MetafileOpModifyWorldTransform:
+			status = gdip_metafile_ModifyWorldTransform (context, &op->u.transform.xform, op->u.transform.mode);
+			update_device = TRUE;
+			break;
+		case MetafileOpDrawLines:
+			for (j = 1; (j < op->u.poly.count) && (status == Ok); j++) {
+				status = GdipDrawLine (graphics, op->pen, op->u.poly.points [j - 1].X, op->u.poly.points [j - 1].Y,
+					op->u.poly.points [j].X, op->u.poly.points [j].Y);
+			}
+			break;
+		case MetafileOpDrawArc:
+			status = GdipDrawArc (graphics, op->pen, op->u.arc.rect.X, op->u.arc.rect.Y, op->u.arc.rect.Width,
+				op->u.arc.rect.Height, op->u.arc.start, op->u.arc.sweep);
+			break;
+		case MetafileOpRectangle:
+			status = GdipFillRectangle (graphics, op->brush, op->u.rect.X, op->u.rect.Y, op->u.rect.Width,
+				op->u.rect.Height);
+			if (status == Ok) {
+				status = GdipDrawRectangle (graphics, op->pen, op->u.rect.X, op->u.rect.Y, op->u.rect.Width,
+					op->u.rect.Height);
+			}
+			break;
+		case MetafileOpFillRectangle:
+			status = GdipFillRectangle (graphics, op->brush, op->u.rect.X, op->u.rect.Y, op->u.rect.Width,
+				op->u.rect.Height);
+			break;
+		case MetafileOpPolygon:
+			status = GdipFillPolygon (graphics, op->brush, op->u.poly.points, op->u.poly.count, op->u.poly.fill_mode);
+			if (status == Ok)
+				status = GdipDrawPolygon (graphics, op->pen, op->u.poly.points, op->u.poly.count);
+			break;
+		case MetafileOpDrawCurve:
+			status = GdipDrawCurve (graphics, op->pen, op->u.poly.points, op->u.poly.count);
+			break;
+		case MetafileOpFillPath:
+			status = GdipFillPath (graphics, op->brush, op->u.path);
+			break;
+		case MetafileOpDrawPath:
+			status = GdipDrawPath (graphics, op->pen, op->u.path);
+			break;
+		case MetafileOpFillAndDrawPath:
+			status = GdipFillPath (graphics, op->brush, op->u.path);
+			if (status == Ok)
+				status = GdipDrawPath (graphics, op->pen, op->u.path);
+			break;
+		case MetafileOpDrawImage:
+			status = GdipDrawImageRectRect (graphics, op->u.image.image, op->u.image.dest.X, op->u.image.dest.Y,
+				op->u.image.dest.Width, op->u.image.dest.Height, op->u.image.src.X, op->u.image.src.Y,
+				op->u.image.src.Width, op->u.image.src.Height, UnitPixel, NULL, NULL, NULL);
+			break;
+		case MetafileOpEmfPlus:
+			status = gdip_metafile_play_emfplus_block (context, op->u.emfplus.data, op->u.emfplus.length);
+			update_device = TRUE;
+			break;
+		}
+	}
+
+	return (status == Ok) ? list->status : status;
+}
+
+GpStatus
+gdip_metafile_play (MetafilePlayContext *context)
+{
+	GpMetafile *metafile;
+
+	if (!context || !context->metafile)
+		return InvalidParameter;
+
+	/* the records are parsed once, later playbacks only replay the operations. Mapped metafiles aren't
+	 * compiled, as the display list would keep everything in memory, their records are played again */
+	metafile = context->metafile;
+	if (context->graphics && !metafile->recording && !metafile->mapping) {
+		if (!metafile->display_list)
+			metafile->display_list = gdip_metafile_compile (metafile);
+		if (metafile->display_list)
+			return gdip_metafile_play_display_list (context, metafile->display_list);
+	}
+	return gdip_metafile_play_records (context);
+}
+
+GpStatus
+gdip_metafile_play_cleanup (MetafilePlayContext *context)
+{
+	if (!context)
+		return InvalidParameter;
+
+	/* restore the graphics state saved by the EMF+ header before the initial transform */
+	gdip_metafile_emfplus_release (context);
+	GdipSetWorldTransform (context->graphics, &context->initial);
+	context->graphics = NULL;
+	gdip_metafile_release_state (context);
 
 	GdipFree (context);
 	return Ok;
@@ -1337,6 +2364,8 @@ update_emf_header (MetafileHeader *header, BYTE* data, int length)
 		/* this could be an embedded EmfPlusRecordTypeHeader */
 		context.metafile = &mf;
 		context.graphics = NULL; /* special case where we're not playing the metafile */
+		context.list = NULL;
+		context.emfplus = NULL;
 		status = GdiComment (&context, data, length);
 		if (status == Ok) {
 			header->Type = mf.metafile_header.Type;
@@ -1575,14 +2604,16 @@ gdip_get_metafile_from (void *pointer, GpMetafile **metafile, ImageSource source
 		goto error;
 	}
 
-	mf->data = (BYTE*) GdipAlloc (mf->length);
-	if (!mf->data)
-		goto error;
+	/* Large files are mapped, otherwise the data is copied into memory for playback later. To match GDI+
+	 * behaviour, we don't validate that there is as much data as the header says. Instead, if the data length
+	 * is invalid and there is no EOF record before we run out of space in the buffer playback will fail. */
+	if ((source != File) || !gdip_metafile_map_file (mf, (FILE*) pointer)) {
+		mf->data = (BYTE*) GdipAlloc (mf->length);
+		if (!mf->data)
+			goto error;
 
-	/* Copy the data into memory for playback later. To match GDI+ behaviour, we don't validate that there is
-	 * as much data as the header says. Instead, if the data length is invalid and there is no EOF record before
-	 * we run out of space in the buffer playback will fail. */
-	mf->length = gdip_read_wmf_data (pointer, (void *) mf->data, mf->length, source);
+		mf->length = gdip_read_wmf_data (pointer, (void *) mf->data, mf->length, source);
+	}
 
 	if (adjust_emf_headers) {
 		/* if the first EMF record is an EmfHeader (or an Header inside a Comment) then we have extra data to extract */
@@ -1865,6 +2896,53 @@ GdipSetMetafileDownLevelRasterizationLimit (GpMetafile *metafile, UINT metafileR
 	}
 }
 
+/*
+ * libgdiplus extensions: metafiles drawn repeatedly at the same size (e.g. a logo on every page of a report)
+ * can keep their renderings, up to the given amount of memory, instead of being played every time.
+ * A limit of 0 (the default) disables the cache.
+ */
+GpStatus
+GdipSetMetafileRasterCacheLimit_linux (GpMetafile *metafile, UINT bytes)
+{
+	if (!metafile)
+		return InvalidParameter;
+
+	metafile->raster_cache_limit = bytes;
+	if (metafile->raster_cache_size > bytes)
+		gdip_metafile_invalidate_raster_cache (metafile);
+	return Ok;
+}
+
+GpStatus
+GdipGetMetafileRasterCacheLimit_linux (GpMetafile *metafile, UINT *bytes)
+{
+	if (!metafile || !bytes)
+		return InvalidParameter;
+
+	*bytes = metafile->raster_cache_limit;
+	return Ok;
+}
+
+GpStatus
+GdipInvalidateMetafileRasterCache_linux (GpMetafile *metafile)
+{
+	if (!metafile)
+		return InvalidParameter;
+
+	gdip_metafile_invalidate_raster_cache (metafile);
+	return Ok;
+}
+
+GpStatus
+GdipGetMetafileCulledOperationCount_linux (GpMetafile *metafile, UINT *count)
+{
+	if (!metafile || !count)
+		return InvalidParameter;
+
+	*count = metafile->culled_operations;
+	return Ok;
+}
+
 GpStatus
 GdipPlayMetafileRecord (GDIPCONST GpMetafile *metafile, EmfPlusRecordType recordType, UINT flags, UINT dataSize, GDIPCONST BYTE* data)
 {
@@ -1905,7 +2983,11 @@ GdipRecordMetafile (HDC referenceHdc, EmfType type, GDIPCONST GpRectF *frameRect
 	mf->metafile_header.Type = (MetafileType)type;
 	mf->recording = TRUE;
 
-	/* TODO - more stuff here! */
+	mf->recorder = gdip_metafile_recorder_new (type, frameRect, frameUnit);
+	if (!mf->recorder) {
+		gdip_metafile_dispose (mf);
+		return OutOfMemory;
+	}
 
 	*metafile = mf;
 	return Ok;
@@ -2008,7 +3090,8 @@ GdipRecordMetafileFromDelegate_linux (GetHeaderDelegate getHeaderFunc, GetBytesD
 	if (status != Ok)
 		return status;
 
-	/* TODO - keep delegates around to write stuff */
+	/* the EMF is written into the delegate once the recording is over */
+	(*metafile)->recorder->put_bytes = putBytesFunc;
 
 	return Ok;
 }
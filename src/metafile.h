@@ -85,4 +85,9 @@ GpStatus GdipRecordMetafileFromDelegateI_linux (GetHeaderDelegate getHeaderFunc,
 	EmfType type, GDIPCONST GpRect *frameRect, MetafileFrameUnit frameUnit, GDIPCONST WCHAR *description, 
 	GpMetafile **metafile);
 
+GpStatus GdipSetMetafileRasterCacheLimit_linux (GpMetafile *metafile, UINT bytes);
+GpStatus GdipGetMetafileRasterCacheLimit_linux (GpMetafile *metafile, UINT *bytes);
+GpStatus GdipInvalidateMetafileRasterCache_linux (GpMetafile *metafile);
+GpStatus GdipGetMetafileCulledOperationCount_linux (GpMetafile *metafile, UINT *count);
+
 #endif
@@ -36,6 +36,12 @@ GUID gdip_png_image_format_guid = {0xb96b3cafU, 0x0728U, 0x11d3U, {0x9d, 0x7b, 0
 #include "codecs-private.h"
 #include "pngcodec.h"
 #include <setjmp.h>
+#ifdef HAVE_LIBZ
+#include <zlib.h>
+#endif
+
+/* number of rows handed to png_write_rows at once */
+#define PNG_WRITE_BATCH_ROWS	64
 
 /* Codecinfo related data*/
 static ImageCodecInfo png_codec;
@@ -93,6 +99,19 @@ _gdip_png_stream_read_data (png_structp png_ptr, png_bytep data, png_size_t leng
 	}
 }
 
+static void
+_gdip_png_memory_read_data (png_structp png_ptr, png_bytep data, png_size_t length)
+{
+	MemorySource *ms = (MemorySource *) png_get_io_ptr (png_ptr);
+
+	if (length > (png_size_t) (ms->size - ms->pos)) {
+		png_error(png_ptr, "Read failed");
+	}
+
+	memcpy (data, ms->ptr + ms->pos, length);
+	ms->pos += length;
+}
+
 static void
 _gdip_png_stream_write_data (png_structp png_ptr, png_bytep data, png_size_t length)
 {
@@ -242,7 +261,7 @@ gdip_load_png_properties (png_structp png_ptr, png_infop info_ptr, png_infop end
 }
 
 static GpStatus 
-gdip_load_png_image_from_file_or_stream (FILE *fp, GetBytesDelegate getBytesFunc, GpImage **image)
+gdip_load_png_image_from_file_or_stream (FILE *fp, GetBytesDelegate getBytesFunc, MemorySource *memory, GpImage **image)
 {
 	png_structp	png_ptr = NULL;
 	png_infop	info_ptr = NULL;
@@ -279,6 +298,8 @@ gdip_load_png_image_from_file_or_stream (FILE *fp, GetBytesDelegate getBytesFunc
 
 	if (fp != NULL) {
 		png_init_io (png_ptr, fp);
+	} else if (memory != NULL) {
+		png_set_read_fn (png_ptr, (void *) memory, _gdip_png_memory_read_data);
 	} else {
 		png_set_read_fn (png_ptr, (void *) getBytesFunc, _gdip_png_stream_read_data);
 	}
@@ -668,24 +689,512 @@ error:
 GpStatus 
 gdip_load_png_image_from_file (FILE *fp, GpImage **image)
 {
-	return gdip_load_png_image_from_file_or_stream (fp, NULL, image);
+	return gdip_load_png_image_from_file_or_stream (fp, NULL, NULL, image);
 }
 
 GpStatus
 gdip_load_png_image_from_stream_delegate (GetBytesDelegate getBytesFunc, SeekDelegate seeknFunc, GpImage **image)
 {
-	return gdip_load_png_image_from_file_or_stream (NULL, getBytesFunc, image);
+	return gdip_load_png_image_from_file_or_stream (NULL, getBytesFunc, NULL, image);
+}
+
+/* used for the PNG images embedded in other formats (e.g. icons) */
+GpStatus
+gdip_load_png_image_from_memory (const BYTE *data, int size, GpImage **image)
+{
+	MemorySource	ms;
+
+	ms.ptr = (BYTE *) data;
+	ms.size = size;
+	ms.pos = 0;
+	return gdip_load_png_image_from_file_or_stream (NULL, NULL, &ms, image);
+}
+
+/* the deflate threads are created with g_thread_new, older glib versions always encode serially */
+#if defined(HAVE_LIBZ) && GLIB_CHECK_VERSION(2,32,0)
+#define PNG_PARALLEL_IDAT
+#endif
+
+#ifdef PNG_PARALLEL_IDAT
+
+/*
+ * Multi-threaded IDAT encoding (see GdipEncoderPngThreads in codecs.h)
+ *
+ * The filtered image data is split in bands of rows. Each band is deflated independently
+ * as a raw deflate stream, primed with the last 32KB of the previous band as dictionary,
+ * and ended with a sync flush (the last band with Z_FINISH). Concatenating the bands
+ * behind a zlib header, followed by the combined adler32, gives a single valid zlib stream.
+ */
+
+/* images smaller than this (filtered size) are not worth the threads */
+#define PNG_PARALLEL_MIN_SIZE		(1024 * 1024)
+/* approximative amount of filtered data deflated by a single job */
+#define PNG_PARALLEL_BAND_SIZE		(256 * 1024)
+/* size of the deflate window, used to prime each band */
+#define PNG_PARALLEL_DICT_SIZE		32768
+/* maximum size of a single IDAT chunk */
+#define PNG_PARALLEL_IDAT_SIZE		(8 * 1024 * 1024)
+
+typedef struct {
+	BYTE		*scan0;
+	int		stride;
+	int		width;
+	int		height;
+	int		color_type;
+	int		bit_depth;
+	int		filters;
+	int		compression_level;
+	int		compression_strategy;
+	size_t		rowbytes;
+	int		bpp;
+	int		band_rows;
+	int		band_count;
+	volatile int	next_band;
+	BYTE		**band_data;
+	size_t		*band_size;
+	uLong		*band_adler;
+	volatile gint	status;		/* first failure of a band, Ok otherwise */
+} PngParallelEncoder;
+
+static int
+gdip_png_filter_sum (const BYTE *row, size_t rowbytes)
+{
+	int sum = 0;
+	size_t i;
+
+	/* libpng's heuristic, minimum sum of absolute differences (as signed bytes) */
+	for (i = 0; i < rowbytes; i++) {
+		int v = row[i];
+		sum += v < 128 ? v : 256 - v;
+	}
+	return sum;
+}
+
+static void
+gdip_png_apply_filter (int type, const BYTE *raw, const BYTE *prior, BYTE *out, size_t rowbytes, int bpp)
+{
+	size_t i;
+
+	switch (type) {
+	case 1: /* Sub */
+		for (i = 0; i < rowbytes; i++)
+			out[i] = raw[i] - (i >= bpp ? raw[i - bpp] : 0);
+		break;
+	case 2: /* Up */
+		for (i = 0; i < rowbytes; i++)
+			out[i] = raw[i] - (prior ? prior[i] : 0);
+		break;
+	case 3: /* Average */
+		for (i = 0; i < rowbytes; i++) {
+			int left = i >= bpp ? raw[i - bpp] : 0;
+			int up = prior ? prior[i] : 0;
+			out[i] = raw[i] - ((left + up) >> 1);
+		}
+		break;
+	case 4: /* Paeth */
+		for (i = 0; i < rowbytes; i++) {
+			int a = i >= bpp ? raw[i - bpp] : 0;
+			int b = prior ? prior[i] : 0;
+			int c = (prior && i >= bpp) ? prior[i - bpp] : 0;
+			int p = a + b - c;
+			int pa = abs (p - a);
+			int pb = abs (p - b);
+			int pc = abs (p - c);
+			out[i] = raw[i] - ((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
+		}
+		break;
+	default: /* None */
+		memcpy (out, raw, rowbytes);
+		break;
+	}
+}
+
+/* converts one row of the bitmap into the byte order used in the PNG data */
+static void
+gdip_png_convert_row (PngParallelEncoder *enc, int y, BYTE *out)
+{
+	BYTE *in = enc->scan0 + (size_t) y * enc->stride;
+	int x;
+
+	switch (enc->color_type) {
+	case PNG_COLOR_TYPE_RGB_ALPHA:
+		for (x = 0; x < enc->width; x++, in += 4, out += 4) {
+#ifdef WORDS_BIGENDIAN
+			out[0] = in[1]; out[1] = in[2]; out[2] = in[3]; out[3] = in[0];
+#else
+			out[0] = in[2]; out[1] = in[1]; out[2] = in[0]; out[3] = in[3];
+#endif
+		}
+		break;
+	case PNG_COLOR_TYPE_RGB:
+		for (x = 0; x < enc->width; x++, in += 4, out += 3) {
+#ifdef WORDS_BIGENDIAN
+			out[0] = in[1]; out[1] = in[2]; out[2] = in[3];
+#else
+			out[0] = in[2]; out[1] = in[1]; out[2] = in[0];
+#endif
+		}
+		break;
+	default:
+		memcpy (out, in, enc->rowbytes);
+		break;
+	}
+}
+
+/* filters rows [first, last) into out, each row prefixed by its filter type byte */
+static BOOL
+gdip_png_filter_rows (PngParallelEncoder *enc, int first, int last, BYTE *out)
+{
+	static const int filter_flags[5] = { PNG_FILTER_NONE, PNG_FILTER_SUB, PNG_FILTER_UP, PNG_FILTER_AVG, PNG_FILTER_PAETH };
+	BYTE *raw = GdipAlloc (enc->rowbytes * 3);
+	BYTE *prior, *current, *best;
+	int y;
+
+	if (!raw)
+		return FALSE;
+
+	prior = raw;
+	current = raw + enc->rowbytes;
+	best = raw + enc->rowbytes * 2;
+
+	if (first > 0)
+		gdip_png_convert_row (enc, first - 1, prior);
+
+	for (y = first; y < last; y++) {
+		BYTE *tmp;
+		int best_type = -1;
+		int best_sum = 0;
+		int type;
+
+		gdip_png_convert_row (enc, y, current);
+
+		for (type = 0; type < 5; type++) {
+			if (!(enc->filters & filter_flags[type]) && !(enc->filters == PNG_NO_FILTERS && type == 0))
+				continue;
+
+			if (best_type == -1) {
+				best_type = type;
+				gdip_png_apply_filter (type, current, y > 0 ? prior : NULL, out + 1, enc->rowbytes, enc->bpp);
+				best_sum = gdip_png_filter_sum (out + 1, enc->rowbytes);
+			} else {
+				int sum;
+
+				gdip_png_apply_filter (type, current, y > 0 ? prior : NULL, best, enc->rowbytes, enc->bpp);
+				sum = gdip_png_filter_sum (best, enc->rowbytes);
+				if (sum < best_sum) {
+					best_type = type;
+					best_sum = sum;
+					memcpy (out + 1, best, enc->rowbytes);
+				}
+			}
+		}
+
+		out[0] = best_type;
+		out += enc->rowbytes + 1;
+
+		tmp = prior;
+		prior = current;
+		current = tmp;
+	}
+
+	GdipFree (raw);
+	return TRUE;
+}
+
+static GpStatus
+gdip_png_deflate_band (PngParallelEncoder *enc, int band)
+{
+	int first = band * enc->band_rows;
+	int last = MIN (first + enc->band_rows, enc->height);
+	/* enough previous rows to fill the deflate window */
+	int dict_rows = band > 0 ? MIN (first, (PNG_PARALLEL_DICT_SIZE + enc->rowbytes) / (enc->rowbytes + 1)) : 0;
+	size_t line = enc->rowbytes + 1;
+	size_t dict_size = MIN ((size_t) dict_rows * line, PNG_PARALLEL_DICT_SIZE);
+	size_t in_size = (size_t) (last - first) * line;
+	BYTE *in = GdipAlloc ((size_t) (last - first + dict_rows) * line);
+	BYTE *data = in + (size_t) dict_rows * line;
+	BYTE *out = NULL;
+	z_stream zs;
+	uLong bound;
+	int ret;
+	GpStatus status = OutOfMemory;
+
+	if (!in || !gdip_png_filter_rows (enc, first - dict_rows, last, in))
+		goto fail;
+
+	memset (&zs, 0, sizeof (zs));
+	ret = deflateInit2 (&zs, enc->compression_level, Z_DEFLATED, -15, 8, enc->compression_strategy);
+	if (ret != Z_OK) {
+		status = (ret == Z_MEM_ERROR) ? OutOfMemory : GenericError;
+		goto fail;
+	}
+
+	if (dict_size > 0)
+		deflateSetDictionary (&zs, data - dict_size, dict_size);
+
+	/* room for the sync flush marker on top of the worst case */
+	bound = deflateBound (&zs, in_size) + 16;
+	out = GdipAlloc (bound);
+	if (!out) {
+		deflateEnd (&zs);
+		goto fail;
+	}
+
+	zs.next_in = data;
+	zs.avail_in = in_size;
+	zs.next_out = out;
+	zs.avail_out = bound;
+	ret = deflate (&zs, band == enc->band_count - 1 ? Z_FINISH : Z_SYNC_FLUSH);
+	if ((ret != Z_OK && ret != Z_STREAM_END) || zs.avail_in != 0) {
+		status = (ret == Z_MEM_ERROR) ? OutOfMemory : GenericError;
+		deflateEnd (&zs);
+		goto fail;
+	}
+
+	enc->band_data[band] = out;
+	enc->band_size[band] = bound - zs.avail_out;
+	enc->band_adler[band] = adler32 (adler32 (0L, Z_NULL, 0), data, in_size);
+
+	deflateEnd (&zs);
+	GdipFree (in);
+	return Ok;
+
+fail:
+	if (in)
+		GdipFree (in);
+	if (out)
+		GdipFree (out);
+	return status;
 }
 
+static gpointer
+gdip_png_deflate_worker (gpointer data)
+{
+	PngParallelEncoder *enc = (PngParallelEncoder *) data;
+	GpStatus status;
+	int band;
+
+	while ((g_atomic_int_get (&enc->status) == Ok) && (band = g_atomic_int_add (&enc->next_band, 1)) < enc->band_count) {
+		status = gdip_png_deflate_band (enc, band);
+		/* the other workers stop, and the first failure is reported */
+		if (status != Ok)
+			g_atomic_int_compare_and_exchange (&enc->status, Ok, status);
+	}
+
+	return NULL;
+}
+
+static int
+gdip_png_parallel_threads (LONG requested)
+{
+	if (requested == PngThreadsAuto) {
+#if GLIB_CHECK_VERSION(2, 36, 0)
+		return g_get_num_processors ();
+#else
+		return 4;
+#endif
+	}
+
+	return requested;
+}
+
+static BOOL
+gdip_png_use_parallel_idat (int threads, BitmapData *bitmap)
+{
+	return threads > 1 && (size_t) bitmap->stride * bitmap->height >= PNG_PARALLEL_MIN_SIZE;
+}
+
+/*
+ * Writes the IDAT chunks, and IEND, for the whole image. Must be called after png_write_info
+ * and replaces png_write_rows/png_write_end (libpng only ends an image whose IDAT it compressed
+ * itself). libpng errors longjmp to the caller's handler.
+ */
+static GpStatus
+gdip_png_write_parallel_idat (png_structp png_ptr, BitmapData *bitmap, int color_type, int bit_depth,
+	int filters, int compression_level, int compression_strategy, int threads)
+{
+	PngParallelEncoder enc;
+	GThread **workers;
+	BYTE header[2];
+	BYTE trailer[4];
+	uLong adler;
+	size_t total;
+	size_t piece_offset;
+	int piece;
+	int i;
+	GpStatus status = Ok;
+
+	memset (&enc, 0, sizeof (enc));
+	enc.scan0 = bitmap->scan0;
+	enc.stride = bitmap->stride;
+	enc.width = bitmap->width;
+	enc.height = bitmap->height;
+	enc.color_type = color_type;
+	enc.bit_depth = bit_depth;
+	enc.filters = filters;
+	enc.compression_level = compression_level;
+	enc.compression_strategy = compression_strategy;
+
+	switch (color_type) {
+	case PNG_COLOR_TYPE_RGB_ALPHA:
+		enc.bpp = 4;
+		break;
+	case PNG_COLOR_TYPE_RGB:
+		enc.bpp = 3;
+		break;
+	default:
+		enc.bpp = 1;
+		break;
+	}
+	enc.rowbytes = color_type == PNG_COLOR_TYPE_PALETTE ? ((size_t) enc.width * bit_depth + 7) / 8 : (size_t) enc.width * enc.bpp;
+
+	enc.band_rows = MAX (1, PNG_PARALLEL_BAND_SIZE / (int) (enc.rowbytes + 1));
+	enc.band_count = (enc.height + enc.band_rows - 1) / enc.band_rows;
+	threads = MIN (threads, enc.band_count);
+
+	enc.band_data = GdipAlloc (sizeof (BYTE *) * enc.band_count);
+	enc.band_size = GdipAlloc (sizeof (size_t) * enc.band_count);
+	enc.band_adler = GdipAlloc (sizeof (uLong) * enc.band_count);
+	workers = GdipAlloc (sizeof (GThread *) * threads);
+	if (!enc.band_data || !enc.band_size || !enc.band_adler || !workers) {
+		status = OutOfMemory;
+		goto cleanup;
+	}
+	memset (enc.band_data, 0, sizeof (BYTE *) * enc.band_count);
+
+	/* the calling thread deflates too */
+	for (i = 0; i < threads - 1; i++)
+		workers[i] = g_thread_new ("gdip-png-deflate", gdip_png_deflate_worker, &enc);
+	gdip_png_deflate_worker (&enc);
+	for (i = 0; i < threads - 1; i++)
+		g_thread_join (workers[i]);
+
+	status = (GpStatus) enc.status;
+	if (status != Ok)
+		goto cleanup;
+
+	/* zlib header: 32K window, deflate, FLEVEL matching the compression level, FCHECK */
+	header[0] = 0x78;
+	if (compression_level == 0 || compression_level == 1)
+		header[1] = 0x01;
+	else if (compression_level >= 2 && compression_level <= 5)
+		header[1] = 0x5E;
+	else if (compression_level == 6 || compression_level == Z_DEFAULT_COMPRESSION)
+		header[1] = 0x9C;
+	else
+		header[1] = 0xDA;
+
+	adler = enc.band_adler[0];
+	for (i = 1; i < enc.band_count; i++)
+		adler = adler32_combine (adler, enc.band_adler[i], (z_off_t) MIN (enc.band_rows, enc.height - i * enc.band_rows) * (enc.rowbytes + 1));
+	trailer[0] = (adler >> 24) & 0xFF;
+	trailer[1] = (adler >> 16) & 0xFF;
+	trailer[2] = (adler >> 8) & 0xFF;
+	trailer[3] = adler & 0xFF;
+
+	/* zlib header, deflated bands and adler32, cut into IDAT chunks of at most PNG_PARALLEL_IDAT_SIZE bytes */
+	total = sizeof (header) + sizeof (trailer);
+	for (i = 0; i < enc.band_count; i++)
+		total += enc.band_size[i];
+
+	piece = -1;
+	piece_offset = 0;
+	while (total > 0) {
+		size_t chunk = MIN (total, PNG_PARALLEL_IDAT_SIZE);
+		size_t left = chunk;
+
+		png_write_chunk_start (png_ptr, (png_const_bytep) "IDAT", chunk);
+		while (left > 0) {
+			const BYTE *data;
+			size_t size;
+			size_t n;
+
+			if (piece == -1) {
+				data = header;
+				size = sizeof (header);
+			} else if (piece == enc.band_count) {
+				data = trailer;
+				size = sizeof (trailer);
+			} else {
+				data = enc.band_data[piece];
+				size = enc.band_size[piece];
+			}
+
+			n = MIN (left, size - piece_offset);
+			png_write_chunk_data (png_ptr, data + piece_offset, n);
+			left -= n;
+			piece_offset += n;
+			if (piece_offset == size) {
+				piece++;
+				piece_offset = 0;
+			}
+		}
+		png_write_chunk_end (png_ptr);
+		total -= chunk;
+	}
+
+	png_write_chunk (png_ptr, (png_const_bytep) "IEND", NULL, 0);
+	png_write_flush (png_ptr);
+
+cleanup:
+	if (enc.band_data) {
+		for (i = 0; i < enc.band_count; i++) {
+			if (enc.band_data[i])
+				GdipFree (enc.band_data[i]);
+		}
+		GdipFree (enc.band_data);
+	}
+	if (enc.band_size)
+		GdipFree (enc.band_size);
+	if (enc.band_adler)
+		GdipFree (enc.band_adler);
+	if (workers)
+		GdipFree (workers);
+	return status;
+}
+
+#endif /* PNG_PARALLEL_IDAT */
+
 static GpStatus 
 gdip_save_png_image_to_file_or_stream (FILE *fp, PutBytesDelegate putBytesFunc, GpImage *image, GDIPCONST EncoderParameters *params)
 {
 	GpStatus status;
 	png_structp	png_ptr = NULL;
 	png_infop	info_ptr = NULL;
+	png_bytep	rows[PNG_WRITE_BATCH_ROWS];
 	int		i;
+	int		count;
 	int		bit_depth;
 	int		color_type;
+	int		filters = PNG_NO_FILTERS;
+	int		compression_level = PngCompressionLevelDefault;
+	int		compression_strategy = PngCompressionStrategyDefault;
+	int		threads = 1;
+	LONG		value;
+
+	if (gdip_get_encoder_parameter_long (params, &GdipEncoderCompressionLevel, &value)) {
+		if (value < PngCompressionLevelDefault || value > PngCompressionLevelBest)
+			return InvalidParameter;
+		compression_level = value;
+	}
+
+	if (gdip_get_encoder_parameter_long (params, &GdipEncoderCompressionStrategy, &value)) {
+		if (value < PngCompressionStrategyDefault || value > PngCompressionStrategyFixed)
+			return InvalidParameter;
+		compression_strategy = value;
+	}
+
+	if (gdip_get_encoder_parameter_long (params, &GdipEncoderPngFilters, &value)) {
+		if (value == 0 || (value & ~PngFilterAll) != 0)
+			return InvalidParameter;
+		filters = value;
+	}
+
+	if (gdip_get_encoder_parameter_long (params, &GdipEncoderPngThreads, &value)) {
+		if (value < PngThreadsAuto)
+			return InvalidParameter;
+		threads = value;
+	}
 
 	png_ptr = png_create_write_struct (PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
 	if (!png_ptr) {
@@ -781,63 +1290,46 @@ gdip_save_png_image_to_file_or_stream (FILE *fp, PutBytesDelegate putBytesFunc,
 		}
 	}
 
-	png_set_filter (png_ptr, 0, PNG_NO_FILTERS);
+	png_set_filter (png_ptr, 0, filters);
+	png_set_compression_level (png_ptr, compression_level);
+	png_set_compression_strategy (png_ptr, compression_strategy);
 	png_set_sRGB_gAMA_and_cHRM (png_ptr, info_ptr, PNG_sRGB_INTENT_PERCEPTUAL);
 	png_write_info (png_ptr, info_ptr);
 
-	png_set_bgr(png_ptr);
-
-	if (gdip_is_an_indexed_pixelformat (image->active_bitmap->pixel_format)) {
-		for (i = 0; i < image->active_bitmap->height; i++) {
-			png_write_row (png_ptr, image->active_bitmap->scan0 + i * image->active_bitmap->stride);
-		}
-	} else if (image->active_bitmap->pixel_format == PixelFormat24bppRGB) {
-		int j;
-		BYTE *row_pointer = GdipAlloc (image->active_bitmap->width * 3);
-		if (!row_pointer) {
-			status = OutOfMemory;
+#ifdef PNG_PARALLEL_IDAT
+	threads = gdip_png_parallel_threads (threads);
+	if (gdip_png_use_parallel_idat (threads, image->active_bitmap)) {
+		status = gdip_png_write_parallel_idat (png_ptr, image->active_bitmap, color_type, bit_depth,
+			filters, compression_level, compression_strategy, threads);
+		if (status != Ok)
 			goto error;
-		}
 
-		for (i = 0; i < image->active_bitmap->height; i++) {
-			for (j = 0; j < image->active_bitmap->width; j++) {
+		png_destroy_write_struct (&png_ptr, &info_ptr);
+		return Ok;
+	}
+#endif
+
+	/* let libpng reorder (and for 24bpp strip the unused byte of) our 4 bytes pixels while it
+	 * filters each row, so the rows can be handed over straight from scan0 */
 #ifdef WORDS_BIGENDIAN
-				row_pointer[j*3  ] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 3);
-				row_pointer[j*3+1] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 2);
-				row_pointer[j*3+2] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 1);
+	if (color_type == PNG_COLOR_TYPE_RGB_ALPHA)
+		png_set_swap_alpha (png_ptr);
+	else if (color_type == PNG_COLOR_TYPE_RGB)
+		png_set_filler (png_ptr, 0, PNG_FILLER_BEFORE);
 #else
-				row_pointer[j*3  ] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 0);
-				row_pointer[j*3+1] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 1);
-				row_pointer[j*3+2] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 2);
-#endif /* WORDS_BIGENDIAN */
-			}
-			png_write_row (png_ptr, row_pointer);
-		}
-		GdipFree (row_pointer);
-	} else {
-#ifdef WORDS_BIGENDIAN
+	png_set_bgr (png_ptr);
+	if (color_type == PNG_COLOR_TYPE_RGB)
+		png_set_filler (png_ptr, 0, PNG_FILLER_AFTER);
+#endif
+
+	for (i = 0; i < image->active_bitmap->height; i += count) {
 		int j;
-		BYTE *row_pointer = GdipAlloc (image->active_bitmap->width * 4);
-		if (!row_pointer) {
-			status = OutOfMemory;
-			goto error;
-		}
 
-		for (i = 0; i < image->active_bitmap->height; i++) {
-			for (j = 0; j < image->active_bitmap->width; j++) {
-				row_pointer[j*4]   = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 3);
-				row_pointer[j*4+1] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 2);
-				row_pointer[j*4+2] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 1);
-				row_pointer[j*4+3] = *((BYTE*)image->active_bitmap->scan0 + (image->active_bitmap->stride * i) + (j*4) + 0);
-			}
-			png_write_row (png_ptr, row_pointer);
-		}
-		GdipFree (row_pointer);
-#else
-		for (i = 0; i < image->active_bitmap->height; i++) {
-			png_write_row (png_ptr, image->active_bitmap->scan0 + (image->active_bitmap->stride * i));
-		}
-#endif
+		count = MIN (PNG_WRITE_BATCH_ROWS, image->active_bitmap->height - i);
+		for (j = 0; j < count; j++)
+			rows[j] = image->active_bitmap->scan0 + (image->active_bitmap->stride * (i + j));
+
+		png_write_rows (png_ptr, rows, count);
 	}
 
 	png_write_end (png_ptr, NULL);
@@ -884,6 +1376,13 @@ gdip_load_png_image_from_stream_delegate (GetBytesDelegate getBytesFunc, SeekDel
 	return UnknownImageFormat;
 }
 
+GpStatus
+gdip_load_png_image_from_memory (const BYTE *data, int size, GpImage **image)
+{
+	*image = NULL;
+	return UnknownImageFormat;
+}
+
 
 GpStatus 
 gdip_save_png_image_to_file (FILE *fp, GpImage *image, GDIPCONST EncoderParameters *params)
@@ -19,6 +19,8 @@ GpStatus gdip_load_png_image_from_file (FILE *fp, GpImage **image) GDIP_INTERNAL
 GpStatus gdip_load_png_image_from_stream_delegate (GetBytesDelegate getBytesFunc, SeekDelegate seeknFunc, 
 	GpImage **image) GDIP_INTERNAL;
 
+GpStatus gdip_load_png_image_from_memory (const BYTE *data, int size, GpImage **image) GDIP_INTERNAL;
+
 GpStatus gdip_save_png_image_to_file (FILE *fp, GpImage *image, GDIPCONST EncoderParameters *params) GDIP_INTERNAL;
 
 GpStatus gdip_save_png_image_to_stream_delegate (PutBytesDelegate putBytesFunc, GpImage *image,
@@ -0,0 +1,391 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Fast, uncompressed, dump of a bitmap (see rawcodec.h for the file layout)
+ */
+
+#include "gdiplus-private.h"
+#include "rawcodec.h"
+
+GUID gdip_raw_image_format_guid = {0xfff1322bU, 0x9c89U, 0x4ce1U, {0x86, 0xcf, 0x79, 0x9c, 0x5f, 0x82, 0xf0, 0xbb}};
+
+/* Codecinfo related data*/
+static ImageCodecInfo raw_codec;
+static const WCHAR raw_codecname[] = {'B', 'u', 'i','l', 't', '-','i', 'n', ' ', 'R', 'A', 'W', ' ', 'C', 'o', 'd', 'e', 'c', 0}; /* Built-in RAW Codec */
+static const WCHAR raw_extension[] = {'*','.','G', 'D', 'I', 'P', 'R', 'A', 'W', 0}; /* *.GDIPRAW */
+static const WCHAR raw_mimetype[] = {'i', 'm', 'a','g', 'e', '/', 'x', '-', 'g', 'd', 'i', 'p', 'l', 'u', 's', '-', 'r', 'a', 'w', 0}; /* image/x-gdiplus-raw */
+static const WCHAR raw_format[] = {'R', 'A', 'W', 0}; /* RAW */
+static const BYTE raw_sig_pattern[] = { 'G', 'D', 'I', 'P', 'R', 'A', 'W', 0x1A };
+static const BYTE raw_sig_mask[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+#ifdef WORDS_BIGENDIAN
+#define RAW_NATIVE_FLAGS	RAW_FLAG_BIG_ENDIAN
+#else
+#define RAW_NATIVE_FLAGS	0
+#endif
+
+ImageCodecInfo *
+gdip_getcodecinfo_raw ()
+{
+	raw_codec.Clsid = (CLSID) { 0xd528dae9, 0x5f17, 0x4b1e, { 0xaf, 0x8c, 0x59, 0x98, 0x6a, 0xbc, 0xe9, 0x4d } };
+	raw_codec.FormatID = gdip_raw_image_format_guid;
+	raw_codec.CodecName = (const WCHAR*) raw_codecname;
+	raw_codec.DllName = NULL;
+	raw_codec.FormatDescription = (const WCHAR*) raw_format;
+	raw_codec.FilenameExtension = (const WCHAR*) raw_extension;
+	raw_codec.MimeType = (const WCHAR*) raw_mimetype;
+	raw_codec.Flags = ImageCodecFlagsEncoder | ImageCodecFlagsDecoder | ImageCodecFlagsSupportBitmap | ImageCodecFlagsBuiltin;
+	raw_codec.Version = 1;
+	raw_codec.SigCount = 1;
+	raw_codec.SigSize = 8;
+	raw_codec.SigPattern = raw_sig_pattern;
+	raw_codec.SigMask = raw_sig_mask;
+
+	return &raw_codec;
+}
+
+static DWORD
+float_to_dword (float value)
+{
+	union { float f; DWORD d; } u;
+	u.f = value;
+	return u.d;
+}
+
+static float
+dword_to_float (DWORD value)
+{
+	union { float f; DWORD d; } u;
+	u.d = value;
+	return u.f;
+}
+
+static void
+RawFileHeaderFromLE (RawFileHeader *header)
+{
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+	header->header_size = GUINT32_FROM_LE (header->header_size);
+	header->flags = GUINT32_FROM_LE (header->flags);
+	header->pixel_format = GUINT32_FROM_LE (header->pixel_format);
+	header->width = GUINT32_FROM_LE (header->width);
+	header->height = GUINT32_FROM_LE (header->height);
+	header->stride = GUINT32_FROM_LE (header->stride);
+	header->dpi_horz = GUINT32_FROM_LE (header->dpi_horz);
+	header->dpi_vert = GUINT32_FROM_LE (header->dpi_vert);
+	header->image_flags = GUINT32_FROM_LE (header->image_flags);
+	header->transparent = GUINT32_FROM_LE (header->transparent);
+	header->palette_flags = GUINT32_FROM_LE (header->palette_flags);
+	header->palette_count = GUINT32_FROM_LE (header->palette_count);
+	header->property_count = GUINT32_FROM_LE (header->property_count);
+	header->reserved = GUINT32_FROM_LE (header->reserved);
+#endif
+}
+
+static void
+RawPropertyHeaderFromLE (RawPropertyHeader *header)
+{
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+	header->id = GUINT32_FROM_LE (header->id);
+	header->length = GUINT32_FROM_LE (header->length);
+	header->type = GUINT16_FROM_LE (header->type);
+	header->reserved = GUINT16_FROM_LE (header->reserved);
+#endif
+}
+
+/* the scanlines are kept in the same layout as the one used in memory, so only the cairo format is needed */
+static int
+gdip_get_raw_cairo_format (PixelFormat format)
+{
+	switch (format) {
+	case PixelFormat1bppIndexed:
+		return CAIRO_FORMAT_A1;
+	case PixelFormat4bppIndexed:
+	case PixelFormat8bppIndexed:
+		return CAIRO_FORMAT_A8;
+	case PixelFormat24bppRGB:
+		return CAIRO_FORMAT_RGB24;
+	case PixelFormat16bppRGB555:
+	case PixelFormat16bppRGB565:
+	case PixelFormat32bppRGB:
+	case PixelFormat32bppARGB:
+	case PixelFormat32bppPARGB:
+	case PixelFormat64bppARGB:
+		return CAIRO_FORMAT_ARGB32;
+	default:
+		return -1;
+	}
+}
+
+static GpStatus
+gdip_read_raw_image (void *pointer, GpImage **image, ImageSource source)
+{
+	RawFileHeader		header;
+	RawPropertyHeader	property;
+	GpBitmap		*result = NULL;
+	BYTE			*pixels = NULL;
+	BYTE			*value = NULL;
+	GpStatus		status;
+	int			cairo_format;
+	unsigned long long int	size;
+	int			i;
+
+	if (gdip_read_bmp_data (pointer, (BYTE *) &header, sizeof (header), source) < (int) sizeof (header))
+		return OutOfMemory;
+
+	RawFileHeaderFromLE (&header);
+	if ((memcmp (header.signature, raw_sig_pattern, sizeof (raw_sig_pattern)) != 0) || (header.header_size != sizeof (RawFileHeader)))
+		return UnknownImageFormat;
+
+	/* the scanlines are a memory dump, we can't read them back on a machine of the other endianness */
+	if ((header.flags & RAW_FLAG_BIG_ENDIAN) != RAW_NATIVE_FLAGS)
+		return NotImplemented;
+
+	cairo_format = gdip_get_raw_cairo_format (header.pixel_format);
+	if (cairo_format == -1)
+		return OutOfMemory;
+
+	if ((header.width == 0) || (header.height == 0) || (header.width > G_MAXINT32) || (header.height > G_MAXINT32))
+		return OutOfMemory;
+
+	/* non-indexed formats always use 4 bytes per pixel in memory */
+	if (gdip_is_an_indexed_pixelformat (header.pixel_format))
+		size = ((unsigned long long int) header.width * gdip_get_pixel_format_depth (header.pixel_format) + 7) / 8;
+	else
+		size = (unsigned long long int) header.width * 4;
+
+	if ((header.stride < size) || (header.stride & 3))
+		return OutOfMemory;
+
+	/* ensure total 'size' does not overflow an integer and fits inside our 2GB limit */
+	size = (unsigned long long int) header.stride * header.height;
+	if (size > G_MAXINT32)
+		return OutOfMemory;
+
+	if (header.palette_count > 256)
+		return OutOfMemory;
+
+	result = gdip_bitmap_new_with_frame (NULL, TRUE);
+	if (!result) {
+		status = OutOfMemory;
+		goto error;
+	}
+
+	result->type = ImageTypeBitmap;
+	result->image_format = RAW;
+	result->cairo_format = cairo_format;
+	result->active_bitmap->pixel_format = header.pixel_format;
+	result->active_bitmap->width = header.width;
+	result->active_bitmap->height = header.height;
+	result->active_bitmap->stride = header.stride;
+	result->active_bitmap->dpi_horz = dword_to_float (header.dpi_horz);
+	result->active_bitmap->dpi_vert = dword_to_float (header.dpi_vert);
+	result->active_bitmap->image_flags = header.image_flags;
+	result->active_bitmap->transparent = header.transparent;
+
+	if (header.palette_count) {
+		result->active_bitmap->palette = GdipAlloc (sizeof (ColorPalette) + sizeof (ARGB) * header.palette_count);
+		if (!result->active_bitmap->palette) {
+			status = OutOfMemory;
+			goto error;
+		}
+		result->active_bitmap->palette->Flags = header.palette_flags;
+		result->active_bitmap->palette->Count = header.palette_count;
+
+		size = sizeof (ARGB) * header.palette_count;
+		if (gdip_read_bmp_data (pointer, (BYTE *) result->active_bitmap->palette->Entries, size, source) < (int) size) {
+			status = OutOfMemory;
+			goto error;
+		}
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+		for (i = 0; i < header.palette_count; i++)
+			result->active_bitmap->palette->Entries[i] = GUINT32_FROM_LE (result->active_bitmap->palette->Entries[i]);
+#endif
+	}
+
+	for (i = 0; i < header.property_count; i++) {
+		if (gdip_read_bmp_data (pointer, (BYTE *) &property, sizeof (property), source) < (int) sizeof (property)) {
+			status = OutOfMemory;
+			goto error;
+		}
+		RawPropertyHeaderFromLE (&property);
+
+		if (property.length > G_MAXINT32) {
+			status = OutOfMemory;
+			goto error;
+		}
+
+		if (property.length > 0) {
+			value = GdipAlloc (property.length);
+			if (!value) {
+				status = OutOfMemory;
+				goto error;
+			}
+			if (gdip_read_bmp_data (pointer, value, property.length, source) < (int) property.length) {
+				status = OutOfMemory;
+				goto error;
+			}
+		}
+
+		status = gdip_bitmapdata_property_add (result->active_bitmap, property.id, property.length, property.type, value);
+		if (status != Ok)
+			goto error;
+
+		GdipFree (value);
+		value = NULL;
+	}
+
+	/* the scanlines are read back with a single call, straight into the bitmap */
+	size = (unsigned long long int) header.stride * header.height;
+	pixels = GdipAlloc (size);
+	if (!pixels) {
+		status = OutOfMemory;
+		goto error;
+	}
+
+	if (gdip_read_bmp_data (pointer, pixels, size, source) < (int) size) {
+		status = OutOfMemory;
+		goto error;
+	}
+
+	result->active_bitmap->scan0 = pixels;
+	result->active_bitmap->reserved = GBD_OWN_SCAN0;
+
+	*image = result;
+	return Ok;
+
+error:
+	if (value)
+		GdipFree (value);
+
+	if (pixels)
+		GdipFree (pixels);
+
+	if (result)
+		gdip_bitmap_dispose (result);
+
+	return status;
+}
+
+GpStatus
+gdip_load_raw_image_from_file (FILE *fp, GpImage **image)
+{
+	return gdip_read_raw_image ((void*)fp, image, File);
+}
+
+GpStatus
+gdip_load_raw_image_from_stream_delegate (dstream_t *loader, GpImage **image)
+{
+	return gdip_read_raw_image ((void*)loader, image, DStream);
+}
+
+static BOOL
+gdip_write_raw_data (void *pointer, BYTE *data, int size, BOOL useFile)
+{
+	if (size == 0)
+		return TRUE;
+
+	if (useFile)
+		return fwrite (data, 1, size, (FILE*) pointer) == size;
+
+	((PutBytesDelegate)(pointer))(data, size);
+	return TRUE;
+}
+
+static GpStatus
+gdip_save_raw_image_to_file_stream (void *pointer, GpImage *image, BOOL useFile)
+{
+	RawFileHeader		header;
+	RawPropertyHeader	property;
+	BitmapData		*activebmp = image->active_bitmap;
+	ColorPalette		*palette = activebmp->palette;
+	int			stride;
+	int			i;
+
+	stride = (activebmp->stride < 0) ? -activebmp->stride : activebmp->stride;
+
+	memcpy (header.signature, raw_sig_pattern, sizeof (raw_sig_pattern));
+	header.header_size = GUINT32_TO_LE (sizeof (RawFileHeader));
+	header.flags = GUINT32_TO_LE (RAW_NATIVE_FLAGS);
+	header.pixel_format = GUINT32_TO_LE (activebmp->pixel_format);
+	header.width = GUINT32_TO_LE (activebmp->width);
+	header.height = GUINT32_TO_LE (activebmp->height);
+	header.stride = GUINT32_TO_LE (stride);
+	header.dpi_horz = GUINT32_TO_LE (float_to_dword (activebmp->dpi_horz));
+	header.dpi_vert = GUINT32_TO_LE (float_to_dword (activebmp->dpi_vert));
+	header.image_flags = GUINT32_TO_LE (activebmp->image_flags);
+	header.transparent = GUINT32_TO_LE (activebmp->transparent);
+	header.palette_flags = GUINT32_TO_LE (palette ? palette->Flags : 0);
+	header.palette_count = GUINT32_TO_LE (palette ? palette->Count : 0);
+	gdip_bitmapdata_property_ensure_loaded (activebmp);
+	header.property_count = GUINT32_TO_LE (activebmp->property_count);
+	header.reserved = 0;
+
+	if (!gdip_write_raw_data (pointer, (BYTE *) &header, sizeof (header), useFile))
+		return GenericError;
+
+	if (palette && palette->Count) {
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+		if (!gdip_write_raw_data (pointer, (BYTE *) palette->Entries, palette->Count * sizeof (ARGB), useFile))
+			return GenericError;
+#else
+		for (i = 0; i < palette->Count; i++) {
+			ARGB color = GUINT32_TO_LE (palette->Entries[i]);
+			if (!gdip_write_raw_data (pointer, (BYTE *) &color, sizeof (ARGB), useFile))
+				return GenericError;
+		}
+#endif
+	}
+
+	for (i = 0; i < activebmp->property_count; i++) {
+		PropertyItem *item = &activebmp->property[i];
+		ULONG length = item->value ? item->length : 0;
+
+		property.id = GUINT32_TO_LE (item->id);
+		property.length = GUINT32_TO_LE (length);
+		property.type = GUINT16_TO_LE (item->type);
+		property.reserved = 0;
+
+		if (!gdip_write_raw_data (pointer, (BYTE *) &property, sizeof (property), useFile) ||
+			!gdip_write_raw_data (pointer, (BYTE *) item->value, length, useFile))
+			return GenericError;
+	}
+
+	/* bottom-up bitmaps are written top-down, one row at a time */
+	if (activebmp->stride < 0) {
+		for (i = 0; i < activebmp->height; i++) {
+			if (!gdip_write_raw_data (pointer, activebmp->scan0 + i * activebmp->stride, stride, useFile))
+				return GenericError;
+		}
+		return Ok;
+	}
+
+	if (!gdip_write_raw_data (pointer, activebmp->scan0, stride * activebmp->height, useFile))
+		return GenericError;
+
+	return Ok;
+}
+
+GpStatus
+gdip_save_raw_image_to_file (FILE *fp, GpImage *image)
+{
+	return gdip_save_raw_image_to_file_stream ((void *)fp, image, TRUE);
+}
+
+GpStatus
+gdip_save_raw_image_to_stream_delegate (PutBytesDelegate putBytesFunc, GpImage *image)
+{
+	return gdip_save_raw_image_to_file_stream ((void *)putBytesFunc, image, FALSE);
+}
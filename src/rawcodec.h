@@ -0,0 +1,73 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _RAWCODEC_H
+#define _RAWCODEC_H
+
+#include "bitmap-private.h"
+#include "bmpcodec.h"
+
+/*
+ * RAW is a libgdiplus-only format used to persist a bitmap between two steps of a pipeline.
+ * The file is a dump of the active BitmapData, so it is written and read back without any
+ * pixel conversion:
+ *
+ *	RawFileHeader		all fields are little endian
+ *	ARGB[palette_count]	little endian
+ *	property_count times	RawPropertyHeader (little endian) followed by the value bytes
+ *	height * stride bytes	the scanlines, exactly as they are in memory
+ *
+ * The scanlines are stored in the byte order of the machine that wrote them (RAW_FLAG_BIG_ENDIAN).
+ */
+
+#define RAW_FORMAT_VERSION	1
+#define RAW_FLAG_BIG_ENDIAN	0x00000001
+
+typedef struct {
+	BYTE	signature[8];
+	DWORD	header_size;
+	DWORD	flags;
+	DWORD	pixel_format;
+	DWORD	width;
+	DWORD	height;
+	DWORD	stride;
+	DWORD	dpi_horz;	/* IEEE float bits */
+	DWORD	dpi_vert;	/* IEEE float bits */
+	DWORD	image_flags;
+	DWORD	transparent;
+	DWORD	palette_flags;
+	DWORD	palette_count;
+	DWORD	property_count;
+	DWORD	reserved;
+} RawFileHeader;
+
+typedef struct {
+	DWORD	id;
+	DWORD	length;
+	WORD	type;
+	WORD	reserved;
+} RawPropertyHeader;
+
+GpStatus gdip_load_raw_image_from_file (FILE *fp, GpImage **image) GDIP_INTERNAL;
+GpStatus gdip_load_raw_image_from_stream_delegate (dstream_t *loader, GpImage **image) GDIP_INTERNAL;
+
+GpStatus gdip_save_raw_image_to_file (FILE *fp, GpImage *image) GDIP_INTERNAL;
+GpStatus gdip_save_raw_image_to_stream_delegate (PutBytesDelegate putBytesFunc, GpImage *image) GDIP_INTERNAL;
+
+ImageCodecInfo *gdip_getcodecinfo_raw () GDIP_INTERNAL;
+
+#endif /* _RAWCODEC_H */
@@ -0,0 +1,521 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *
+ * Banded rectangles, used to combine rectangle-based regions
+ */
+
+#include "region-band.h"
+
+/*
+ * Both banded arrays are walked once, from top to bottom, splitting them at every top and bottom of
+ * their bands. Each slice is then walked once, from left to right, keeping the parts covered
+ * according to the combine mode. Combining two regions is therefore linear in their number of
+ * rectangles.
+ */
+
+typedef struct {
+	GpRectF	*rects;
+	int	count;
+	int	size;
+	int	band;		/* first rectangle of the last band, -1 if none */
+} BandBuilder;
+
+static void
+band_builder_init (BandBuilder *builder)
+{
+	builder->rects = NULL;
+	builder->count = 0;
+	builder->size = 0;
+	builder->band = -1;
+}
+
+static BOOL
+band_builder_add (BandBuilder *builder, float x1, float y1, float x2, float y2)
+{
+	GpRectF *rect;
+
+	if (builder->count == builder->size) {
+		int size = (builder->size > 0) ? builder->size * 2 : 16;
+		GpRectF *rects = (GpRectF *) gdip_realloc (builder->rects, size * sizeof (GpRectF));
+		if (!rects)
+			return FALSE;
+
+		builder->rects = rects;
+		builder->size = size;
+	}
+
+	rect = &builder->rects [builder->count++];
+	rect->X = x1;
+	rect->Y = y1;
+	rect->Width = x2 - x1;
+	rect->Height = y2 - y1;
+	return TRUE;
+}
+
+static BOOL
+band_same_spans (GDIPCONST GpRectF *band1, GDIPCONST GpRectF *band2, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if ((band1 [i].X != band2 [i].X) || (band1 [i].Width != band2 [i].Width))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the band starting at @start was just added, merge it into the previous band if they touch and match */
+static void
+band_builder_end_band (BandBuilder *builder, int start)
+{
+	GpRectF *rects = builder->rects;
+	int previous = builder->band;
+	int count = builder->count - start;
+
+	if (count == 0)
+		return;
+
+	if ((previous >= 0) && (start - previous == count) &&
+		(rects [previous].Y + rects [previous].Height == rects [start].Y) &&
+		band_same_spans (rects + previous, rects + start, count)) {
+		float bottom = rects [start].Y + rects [start].Height;
+		int i;
+
+		for (i = previous; i < start; i++)
+			rects [i].Height = bottom - rects [i].Y;
+		builder->count = start;
+		return;
+	}
+
+	builder->band = start;
+}
+
+static int
+band_end (GDIPCONST GpRectF *rects, int count, int start)
+{
+	int end = start + 1;
+
+	while ((end < count) && (rects [end].Y == rects [start].Y))
+		end++;
+	return end;
+}
+
+#define RECT_LEFT(rects, i)	((rects) [i].X)
+#define RECT_RIGHT(rects, i)	((rects) [i].X + (rects) [i].Width)
+
+/* add, between @top and @bottom, the horizontal spans covered by the combination of both (sorted) spans */
+static BOOL
+band_combine_spans (BandBuilder *builder, GDIPCONST GpRectF *spans1, int count1, GDIPCONST GpRectF *spans2, int count2,
+	CombineMode combineMode, float top, float bottom)
+{
+#define BAND_ADD(x1, x2) \
+	if (((x2) > (x1)) && !band_builder_add (builder, x1, top, x2, bottom)) \
+		return FALSE
+
+	/* (optimization) nothing can be covered by a single side */
+	if ((count1 == 0) && !gdip_region_band_is_covered (combineMode, FALSE, TRUE))
+		return TRUE;
+	if ((count2 == 0) && !gdip_region_band_is_covered (combineMode, TRUE, FALSE))
+		return TRUE;
+
+	REGION_BAND_COMBINE_SPANS (float, spans1, count1, 0, spans2, count2, 0, RECT_LEFT, RECT_RIGHT, G_MAXFLOAT,
+		combineMode, BAND_ADD);
+	return TRUE;
+#undef BAND_ADD
+}
+
+static GpStatus
+band_combine (GDIPCONST GpRectF *rects1, int count1, GDIPCONST GpRectF *rects2, int count2, CombineMode combineMode,
+	BandBuilder *builder)
+{
+	int i1 = 0, i2 = 0;
+	int end1, end2;
+	float y;
+
+	if ((count1 == 0) && (count2 == 0))
+		return Ok;
+
+	if (count1 == 0)
+		y = rects2 [0].Y;
+	else if (count2 == 0)
+		y = rects1 [0].Y;
+	else
+		y = MIN (rects1 [0].Y, rects2 [0].Y);
+
+	end1 = (count1 > 0) ? band_end (rects1, count1, 0) : 0;
+	end2 = (count2 > 0) ? band_end (rects2, count2, 0) : 0;
+
+	while ((i1 < count1) || (i2 < count2)) {
+		/* the part of the current bands that is still to be processed starts at y */
+		float top1 = (i1 < count1) ? MAX (rects1 [i1].Y, y) : G_MAXFLOAT;
+		float top2 = (i2 < count2) ? MAX (rects2 [i2].Y, y) : G_MAXFLOAT;
+		float top = MIN (top1, top2);
+		BOOL in1 = (i1 < count1) && (top1 == top);
+		BOOL in2 = (i2 < count2) && (top2 == top);
+		float bottom = MIN (in1 ? rects1 [i1].Y + rects1 [i1].Height : top1, in2 ? rects2 [i2].Y + rects2 [i2].Height : top2);
+
+		if (bottom > top) {
+			int start = builder->count;
+
+			if (!band_combine_spans (builder, rects1 + i1, in1 ? end1 - i1 : 0, rects2 + i2, in2 ? end2 - i2 : 0,
+				combineMode, top, bottom))
+				return OutOfMemory;
+			band_builder_end_band (builder, start);
+		}
+
+		y = bottom;
+		if (in1 && (rects1 [i1].Y + rects1 [i1].Height <= y)) {
+			i1 = end1;
+			end1 = (i1 < count1) ? band_end (rects1, count1, i1) : i1;
+		}
+		if (in2 && (rects2 [i2].Y + rects2 [i2].Height <= y)) {
+			i2 = end2;
+			end2 = (i2 < count2) ? band_end (rects2, count2, i2) : i2;
+		}
+	}
+	return Ok;
+}
+
+/* the union of all @rects, splitted in halves so every union stays linear */
+static GpStatus
+band_union_all (GDIPCONST GpRectF *rects, int count, BandBuilder *builder)
+{
+	BandBuilder left, right;
+	GpStatus status;
+	int half;
+
+	if (count == 1) {
+		if (!band_builder_add (builder, rects->X, rects->Y, rects->X + rects->Width, rects->Y + rects->Height))
+			return OutOfMemory;
+		return Ok;
+	}
+
+	half = count / 2;
+	band_builder_init (&left);
+	band_builder_init (&right);
+
+	status = band_union_all (rects, half, &left);
+	if (status == Ok)
+		status = band_union_all (rects + half, count - half, &right);
+	if (status == Ok)
+		status = band_combine (left.rects, left.count, right.rects, right.count, CombineModeUnion, builder);
+
+	if (left.rects)
+		GdipFree (left.rects);
+	if (right.rects)
+		GdipFree (right.rects);
+	return status;
+}
+
+/*
+ * gdip_region_band_is_covered:
+ * @combineMode: the binary operator
+ * @in1: a BOOL, TRUE if the point is inside the first shape
+ * @in2: a BOOL, TRUE if the point is inside the second shape
+ *
+ * Return TRUE if a point is inside the combination of the shapes.
+ */
+BOOL
+gdip_region_band_is_covered (CombineMode combineMode, BOOL in1, BOOL in2)
+{
+	switch (combineMode) {
+	case CombineModeIntersect:
+		return in1 && in2;
+	case CombineModeUnion:
+		return in1 || in2;
+	case CombineModeXor:
+		return in1 != in2;
+	case CombineModeExclude:
+		return in1 && !in2;
+	case CombineModeComplement:
+		return in2 && !in1;
+	default:
+		return FALSE;
+	}
+}
+
+/*
+ * gdip_region_band_is_valid:
+ * @rects: an array of GpRectF
+ * @count: the number of rectangles in @rects
+ *
+ * Return TRUE if @rects is already banded (see region-band.h).
+ */
+BOOL
+gdip_region_band_is_valid (GDIPCONST GpRectF *rects, int count)
+{
+	int band = 0, previous = -1;
+	int i;
+
+	for (i = 0; i <= count; i++) {
+		if (i < count) {
+			if ((rects [i].Width <= 0) || (rects [i].Height <= 0))
+				return FALSE;
+			if (i == 0)
+				continue;
+
+			/* same band */
+			if (rects [i].Y == rects [band].Y) {
+				if ((rects [i].Height != rects [band].Height) || (rects [i].X <= rects [i - 1].X + rects [i - 1].Width))
+					return FALSE;
+				continue;
+			}
+
+			if (rects [i].Y < rects [band].Y + rects [band].Height)
+				return FALSE;
+		}
+
+		/* the band [band, i) is complete, it must not be mergeable with the previous one */
+		if ((previous >= 0) && (band - previous == i - band) &&
+			(rects [previous].Y + rects [previous].Height == rects [band].Y) &&
+			band_same_spans (rects + previous, rects + band, i - band))
+			return FALSE;
+
+		previous = band;
+		band = i;
+	}
+	return TRUE;
+}
+
+/*
+ * gdip_region_band_from_rects:
+ * @rects: an array of GpRectF, in any order and possibly overlapping
+ * @count: the number of rectangles in @rects
+ * @normalize: a BOOL
+ * @result: the banded rectangles
+ * @resultCount: the number of rectangles in @result
+ *
+ * Return, in @result, the rectangles covering the same area as @rects, banded. If @normalize
+ * is TRUE the rectangles with a negative width or height are flipped, otherwise they are
+ * ignored like the empty ones.
+ *
+ * Note: the @result array must be freed using GdipFree.
+ */
+GpStatus
+gdip_region_band_from_rects (GDIPCONST GpRectF *rects, int count, BOOL normalize, GpRectF **result, int *resultCount)
+{
+	BandBuilder builder;
+	GpRectF *valid;
+	GpStatus status;
+	int i, n = 0;
+
+	*result = NULL;
+	*resultCount = 0;
+	if (count <= 0)
+		return Ok;
+
+	valid = (GpRectF *) GdipAlloc (count * sizeof (GpRectF));
+	if (!valid)
+		return OutOfMemory;
+
+	for (i = 0; i < count; i++) {
+		GpRectF rect = rects [i];
+
+		/* pre-process negative width and height, without modifying the originals, see bug #383878 */
+		if (normalize && (rect.Width < 0)) {
+			rect.X += rect.Width;
+			rect.Width = -rect.Width;
+		}
+		if (normalize && (rect.Height < 0)) {
+			rect.Y += rect.Height;
+			rect.Height = -rect.Height;
+		}
+
+		if ((rect.Width > 0) && (rect.Height > 0))
+			valid [n++] = rect;
+	}
+
+	if (n == 0) {
+		GdipFree (valid);
+		return Ok;
+	}
+
+	if (gdip_region_band_is_valid (valid, n)) {
+		*result = valid;
+		*resultCount = n;
+		return Ok;
+	}
+
+	band_builder_init (&builder);
+	status = band_union_all (valid, n, &builder);
+	GdipFree (valid);
+	if (status != Ok) {
+		if (builder.rects)
+			GdipFree (builder.rects);
+		return status;
+	}
+
+	*result = builder.rects;
+	*resultCount = builder.count;
+	return Ok;
+}
+
+/*
+ * gdip_region_band_combine:
+ * @rects1: an array of GpRectF (the region)
+ * @count1: the number of rectangles in @rects1
+ * @rects2: an array of GpRectF (combined into the region)
+ * @count2: the number of rectangles in @rects2
+ * @combineMode: the CombineMode (but CombineModeReplace)
+ * @result: the banded rectangles
+ * @resultCount: the number of rectangles in @result
+ *
+ * Return, in @result, the banded rectangles of @rects1 combined with @rects2. Empty and
+ * negative rectangles of @rects1 are ignored while those of @rects2 are normalized.
+ *
+ * Note: the @result array must be freed using GdipFree.
+ */
+GpStatus
+gdip_region_band_combine (GDIPCONST GpRectF *rects1, int count1, GDIPCONST GpRectF *rects2, int count2,
+	CombineMode combineMode, GpRectF **result, int *resultCount)
+{
+	GpRectF *bands1 = NULL, *bands2 = NULL;
+	int bandCount1, bandCount2;
+	BandBuilder builder;
+	GpStatus status;
+
+	*result = NULL;
+	*resultCount = 0;
+
+	/* the region is usually the result of previous combinations, so it's already banded */
+	if (!gdip_region_band_is_valid (rects1, count1)) {
+		status = gdip_region_band_from_rects (rects1, count1, FALSE, &bands1, &bandCount1);
+		if (status != Ok)
+			return status;
+		rects1 = bands1;
+		count1 = bandCount1;
+	}
+
+	status = gdip_region_band_from_rects (rects2, count2, TRUE, &bands2, &bandCount2);
+	if (status != Ok) {
+		if (bands1)
+			GdipFree (bands1);
+		return status;
+	}
+
+	band_builder_init (&builder);
+	status = band_combine (rects1, count1, bands2, bandCount2, combineMode, &builder);
+
+	if (bands1)
+		GdipFree (bands1);
+	if (bands2)
+		GdipFree (bands2);
+
+	if ((status != Ok) || (builder.count == 0)) {
+		if (builder.rects)
+			GdipFree (builder.rects);
+		return status;
+	}
+
+	*result = builder.rects;
+	*resultCount = builder.count;
+	return Ok;
+}
+
+/* first rectangle of the first band whose bottom is below @y, or @count */
+static int
+band_find (GDIPCONST GpRectF *rects, int count, float y)
+{
+	int low = 0, high = count;
+
+	/* bands don't overlap so their bottoms are sorted too */
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+
+		if (rects [middle].Y + rects [middle].Height > y)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+/* first rectangle of the band starting at @start whose right side is after @x, or the end of the band */
+static int
+band_find_span (GDIPCONST GpRectF *rects, int count, int start, float x)
+{
+	int low = start, high = count;
+
+	while (low < high) {
+		int middle = low + (high - low) / 2;
+
+		if ((rects [middle].Y != rects [start].Y) || (rects [middle].X + rects [middle].Width > x))
+			high = middle;
+		else
+			low = middle + 1;
+	}
+	return low;
+}
+
+/*
+ * gdip_region_band_is_point_visible:
+ * @rects: an array of banded GpRectF
+ * @count: the number of rectangles in @rects
+ * @x: the horizontal position
+ * @y: the vertical position
+ *
+ * Return TRUE if the @x,@y point is inside one of the rectangles. The band, then the rectangle,
+ * are found using binary searches.
+ */
+BOOL
+gdip_region_band_is_point_visible (GDIPCONST GpRectF *rects, int count, float x, float y)
+{
+	int band, i;
+
+	band = band_find (rects, count, y);
+	if ((band == count) || (rects [band].Y > y))
+		return FALSE;
+
+	i = band_find_span (rects, count, band, x);
+	return (i < count) && (rects [i].Y == rects [band].Y) && (rects [i].X <= x);
+}
+
+/*
+ * gdip_region_band_is_rect_visible:
+ * @rects: an array of banded GpRectF
+ * @count: the number of rectangles in @rects
+ * @rect: a pointer to a GpRectF
+ *
+ * Return TRUE if _any_ part of @rect is inside one of the rectangles. Only the bands crossed
+ * by @rect are visited, each one using binary searches.
+ */
+BOOL
+gdip_region_band_is_rect_visible (GDIPCONST GpRectF *rects, int count, GDIPCONST GpRectF *rect)
+{
+	float x1 = rect->X, y1 = rect->Y;
+	float x2 = rect->X + rect->Width, y2 = rect->Y + rect->Height;
+	int band, i;
+
+	if (x2 < x1) {
+		x1 = x2;
+		x2 = rect->X;
+	}
+	if (y2 < y1) {
+		y1 = y2;
+		y2 = rect->Y;
+	}
+
+	if ((x1 == x2) || (y1 == y2))
+		return FALSE;
+
+	for (band = band_find (rects, count, y1); (band < count) && (rects [band].Y < y2);
+		band = band_find (rects, count, rects [band].Y + rects [band].Height)) {
+		i = band_find_span (rects, count, band, x1);
+		if ((i < count) && (rects [i].Y == rects [band].Y) && (rects [i].X < x2))
+			return TRUE;
+	}
+	return FALSE;
+}
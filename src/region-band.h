@@ -0,0 +1,82 @@
+/*
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software
+ * and associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial
+ * portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE
+ * OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * NOTE: This is a private header files and everything is subject to changes.
+ */
+
+#ifndef __REGION_BAND_H__
+#define __REGION_BAND_H__
+
+#include "gdiplus-private.h"
+
+/*
+ * A banded array of rectangles (like X11 or pixman regions) is sorted by Y then X where:
+ * - all rectangles have a positive width and height;
+ * - rectangles sharing the same Y also share the same height (a band) and bands don't overlap;
+ * - rectangles of a band neither overlap nor touch each other;
+ * - two touching bands never have the same horizontal spans (they are merged into a single band).
+ * Equal areas therefore always have the same rectangles.
+ */
+
+BOOL gdip_region_band_is_valid (GDIPCONST GpRectF *rects, int count) GDIP_INTERNAL;
+GpStatus gdip_region_band_from_rects (GDIPCONST GpRectF *rects, int count, BOOL normalize, GpRectF **result, int *resultCount) GDIP_INTERNAL;
+GpStatus gdip_region_band_combine (GDIPCONST GpRectF *rects1, int count1, GDIPCONST GpRectF *rects2, int count2,
+	CombineMode combineMode, GpRectF **result, int *resultCount) GDIP_INTERNAL;
+BOOL gdip_region_band_is_covered (CombineMode combineMode, BOOL in1, BOOL in2) GDIP_INTERNAL;
+BOOL gdip_region_band_is_point_visible (GDIPCONST GpRectF *rects, int count, float x, float y) GDIP_INTERNAL;
+BOOL gdip_region_band_is_rect_visible (GDIPCONST GpRectF *rects, int count, GDIPCONST GpRectF *rect) GDIP_INTERNAL;
+
+/*
+ * The horizontal sweep shared by the combination of banded rectangles (region-band.c) and of region bitmaps
+ * (region-bitmap.c). Both sorted lists of spans are walked once, from left to right, and ADD (start, end) is
+ * evaluated for each span covered by their combination. LEFT (spans, i) and RIGHT (spans, i) are the sides of
+ * a span, of type @type, moved by the offset of its list, and @none is after all of them.
+ */
+#define REGION_BAND_COMBINE_SPANS(type, spans1, count1, offset1, spans2, count2, offset2, LEFT, RIGHT, none, \
+	combineMode, ADD) \
+	do { \
+		BOOL in1_ = FALSE, in2_ = FALSE, inside_ = FALSE; \
+		type start_ = 0; \
+		int i1_ = 0, i2_ = 0; \
+		while ((i1_ < (count1)) || (i2_ < (count2))) { \
+			type x1_ = (i1_ < (count1)) ? (in1_ ? RIGHT (spans1, i1_) : LEFT (spans1, i1_)) + (offset1) : (none); \
+			type x2_ = (i2_ < (count2)) ? (in2_ ? RIGHT (spans2, i2_) : LEFT (spans2, i2_)) + (offset2) : (none); \
+			type x_ = MIN (x1_, x2_); \
+			BOOL covered_; \
+			if (x1_ == x_) { \
+				if (in1_) \
+					i1_++; \
+				in1_ = !in1_; \
+			} \
+			if (x2_ == x_) { \
+				if (in2_) \
+					i2_++; \
+				in2_ = !in2_; \
+			} \
+			covered_ = gdip_region_band_is_covered (combineMode, in1_, in2_); \
+			if (covered_ && !inside_) { \
+				start_ = x_; \
+				inside_ = TRUE; \
+			} else if (!covered_ && inside_) { \
+				ADD (start_, x_); \
+				inside_ = FALSE; \
+			} \
+		} \
+	} while (0)
+
+#endif
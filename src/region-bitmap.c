@@ -20,49 +20,41 @@
  *	Sebastien Pouliot  <sebastien@ximian.com>
  */
 
+
 #include "region-private.h"
+#include "region-band.h"
 #include "graphics-path-private.h"
 
 // #define DEBUG_REGION
 
+/* cairo image surfaces can't be larger than 32767 pixels, tiles also keep the A8 data 32 bits aligned */
+#define REGION_MAX_TILE_WIDTH		32760
+
 #ifdef DEBUG_REGION
 
 /*
  * Debugging helpers
  */
 
-static void
-display32 (BYTE *shape, int width, int height)
-{
-	int i, j;
-
-	for (i = 0; i < height; i++) {
-		for (j = 0; j < width; j++) {
-			printf ("%s", (shape [(i*width + j) * 4] == 0) ? "." : "X");
-		}
-		printf ("\n");
-	}
-	printf ("\n");
-}
-
 void
 display (char* message, GpRegionBitmap *bitmap)
 {
-	int i = 0, j = 0, k;
+	int i, j, x, y;
 
-	printf ("\n%s\n\tbitmap X: %d, Y: %d, Width: %d, Height %d, Mask %p\n", message,
-		bitmap->X, bitmap->Y, bitmap->Width, bitmap->Height, bitmap->Mask);
-	if (!bitmap->Mask)
-		return;
+	printf ("\n%s\n\tbitmap X: %d, Y: %d, Width: %d, Height %d, Bands %d\n", message,
+		bitmap->X, bitmap->Y, bitmap->Width, bitmap->Height, bitmap->BandCount);
 
-	while (i < SHAPE_SIZE(bitmap)) {
-		BYTE b = bitmap->Mask [i++];
-		for (k = 0; k < 8; k++) {
-			if (j++ == bitmap->Width) {
-				j = 1;
-				printf ("\n");
+	for (i = 0; i < bitmap->BandCount; i++) {
+		GpRegionBand *band = &bitmap->Bands [i];
+
+		for (y = 0; y < band->Height; y++) {
+			j = band->First;
+			for (x = 0; x < bitmap->Width; x++) {
+				while ((j < band [1].First) && (bitmap->Spans [j].X2 <= x))
+					j++;
+				printf ("%s", ((j < band [1].First) && (bitmap->Spans [j].X1 <= x)) ? "X" : ".");
 			}
-			printf ("%s", ((b & (1 << k)) == 0) ? "." : "X");
+			printf ("\n");
 		}
 	}
 	printf ("\n");
@@ -74,51 +66,6 @@ display (char* message, GpRegionBitmap *bitmap)
 /* Helpers */
 
 
-/*
- * rect_union:
- * @bitmap1: a GpRegionBitmap
- * @bitmap2: a GpRegionBitmap
- * @rect: a pointer to a GpRect
- *
- * Calculate a rectangle, @rect, that contains both @bitmap1 and @bitmap2
- * rectangles.
- */
-static void
-rect_union (GpRegionBitmap *bitmap1, GpRegionBitmap *bitmap2, GpRect *rect)
-{
-	int max_x_1 = bitmap1->X + bitmap1->Width;
-	int max_x_2 = bitmap2->X + bitmap2->Width;
-	int max_y_1 = bitmap1->Y + bitmap1->Height;
-	int max_y_2 = bitmap2->Y + bitmap2->Height;
-
-	rect->X = (bitmap1->X < bitmap2->X) ? bitmap1->X : bitmap2->X;
-	rect->Y = (bitmap1->Y < bitmap2->Y) ? bitmap1->Y : bitmap2->Y;
-	rect->Width = ((max_x_1 > max_x_2) ? max_x_1 : max_x_2) - rect->X;
-	rect->Height = ((max_y_1 > max_y_2) ? max_y_1 : max_y_2) - rect->Y;
-}
-
-
-/*
- * rect_intersect:
- * @bitmap1: a GpRegionBitmap
- * @bitmap2: a GpRegionBitmap
- * @rect: a pointer to a GpRect
- *
- * Calculate a rectangle, @rect, that represent the area shared by both 
- * @bitmap1 and @bitmap2 rectangles.
- */
-static void
-rect_intersect (GpRegionBitmap *bitmap1, GpRegionBitmap *bitmap2, GpRect *rect)
-{
-	rect->X = (bitmap1->X > bitmap2->X) ? bitmap1->X : bitmap2->X;
-	rect->Y = (bitmap1->Y > bitmap2->Y) ? bitmap1->Y : bitmap2->Y;
-	rect->Width = (((bitmap1->X + bitmap1->Width) < (bitmap2->X + bitmap2->Width)) ? 
-		(bitmap1->X + bitmap1->Width) : (bitmap2->X + bitmap2->Width)) - rect->X;
-	rect->Height = (((bitmap1->Y + bitmap1->Height) < (bitmap2->Y + bitmap2->Height)) ? 
-		(bitmap1->Y + bitmap1->Height) : (bitmap2->Y + bitmap2->Height)) - rect->Y;
-}
-
-
 /*
  * rect_adjust_horizontal:
  * @x: a pointer to an integer
@@ -147,56 +94,22 @@ rect_adjust_horizontal (int *x, int *width)
 
 
 /*
- * alloc_bitmap_memory:
- * @size: the size of the required allocation
- * @clear: a BOOL
- *
- * Allocate the alpha (1bpp) memory required for storing a bitmap and return
- * a pointer to this memory. @clear decides if the memory will be zeroized
- * after being allocated. NULL can be returned if too much memory is 
- * requested (very large region) or if the memory couldn't be allocated (low
- * memory).
- */
-static BYTE*
-alloc_bitmap_memory (int size, BOOL clear)
-{
-	BYTE *buffer;
-
-	if ((size < 1) || (size > REGION_MAX_BITMAP_SIZE)) {
-		g_warning ("Requested %d bytes. Maximum size for region is %d bytes.", 
-			size, REGION_MAX_BITMAP_SIZE);
-		return NULL;
-	}
-
-	buffer = (BYTE*) GdipAlloc (size);
-	if (!buffer)
-		return NULL;
-
-	if (clear)
-		memset (buffer, 0, size);
-
-	return buffer;
-}
-
-
-/*
- * alloc_bitmap_with_buffer:
+ * alloc_bitmap:
  * @x: an integer representing the X coordinate of the bitmap
  * @y: an integer representing the Y coordinate of the bitmap
  * @width: an integer representing the Width of the bitmap
  * @height: an integer representing the Height of the bitmap
- * @buffer: a byte array of the bitmap data
+ * @count: the number of bands
+ * @bands: the bands (@count + 1 entries) or NULL
+ * @spans: the spans of the bands or NULL
  *
  * Allocate and return a new GpRegionBitmap structure using the supplied 
- * @buffer.
+ * @bands and @spans.
  *
- * Notes:
- * - The allocated structure must be freed using gdip_region_bitmap_free.
- * - The bitmap @x and @width MUST BE multiple of 8.
- * - The supplied @buffer MUST match the supplied width and height parameters.
+ * Note: the allocated structure must be freed using gdip_region_bitmap_free.
  */
 static GpRegionBitmap*
-alloc_bitmap_with_buffer (int x, int y, int width, int height, BYTE *buffer)
+alloc_bitmap (int x, int y, int width, int height, int count, GpRegionBand *bands, GpRegionSpan *spans)
 {
 	GpRegionBitmap *result = (GpRegionBitmap*) GdipAlloc (sizeof (GpRegionBitmap));
 	if (!result) {
@@ -207,209 +120,535 @@ alloc_bitmap_with_buffer (int x, int y, int width, int height, BYTE *buffer)
 	result->Y = y;
 	result->Width = width;
 	result->Height = height;
-	result->Mask = buffer;
-	result->reduced = FALSE; /* bitmap size isn't optimal wrt contents */
+	result->BandCount = count;
+	result->Bands = bands;
+	result->Spans = spans;
+	result->surface = NULL;
 
 	return result;
 }
 
 
 /*
- * alloc_bitmap:
- * @x: an integer representing the X coordinate of the bitmap
- * @y: an integer representing the Y coordinate of the bitmap
- * @width: an integer representing the Width of the bitmap
- * @height: an integer representing the Height of the bitmap
- *
- * Allocate and return a new GpRegionBitmap structure.
+ * alloc_empty_bitmap:
  *
- * Notes:
- * - The allocated structure must be freed using gdip_region_bitmap_free.
- * - The bitmap @x and @width will be adjusted to a multiple of 8.
+ * Allocate and return a new, empty, GpRegionBitmap structure.
  */
 static GpRegionBitmap*
-alloc_bitmap (int x, int y, int width, int height)
+alloc_empty_bitmap ()
 {
-	BYTE *buffer;
-	int size;
+	return alloc_bitmap (0, 0, 0, 0, 0, NULL, NULL);
+}
 
-	/* ensure X and Width are multiple of 8 */
-	rect_adjust_horizontal (&x, &width);
 
-	size = (width * height >> 3); /* 1 bit per pixel */
-	buffer = alloc_bitmap_memory (size, TRUE);
+/*
+ * gdip_region_bitmap_clone:
+ * @bitmap: a GpRegionBitmap
+ *
+ * Allocate and return new GpRegionBitmap containing a copy of @bitmap.
+ *
+ * Note: the allocated structure must be freed using gdip_region_bitmap_free.
+ */
+GpRegionBitmap*
+gdip_region_bitmap_clone (GpRegionBitmap *bitmap)
+{
+	GpRegionBand *bands;
+	GpRegionSpan *spans;
+	int bands_size, spans_size;
+	GpRegionBitmap *result;
+
+	if (bitmap->BandCount == 0)
+		return alloc_empty_bitmap ();
 
-	return alloc_bitmap_with_buffer (x, y, width, height, buffer);
+	bands_size = (bitmap->BandCount + 1) * sizeof (GpRegionBand);
+	spans_size = bitmap->Bands [bitmap->BandCount].First * sizeof (GpRegionSpan);
+
+	bands = (GpRegionBand*) GdipAlloc (bands_size);
+	spans = (GpRegionSpan*) GdipAlloc (spans_size);
+	if (!bands || !spans) {
+		if (bands)
+			GdipFree (bands);
+		if (spans)
+			GdipFree (spans);
+		return NULL;
+	}
+
+	memcpy (bands, bitmap->Bands, bands_size);
+	memcpy (spans, bitmap->Spans, spans_size);
+
+	result = alloc_bitmap (bitmap->X, bitmap->Y, bitmap->Width, bitmap->Height, bitmap->BandCount, bands, spans);
+	if (!result) {
+		GdipFree (bands);
+		GdipFree (spans);
+	}
+	return result;
 }
 
 
 /*
- * alloc_merged_bitmap:
- * @bitmap1: a GpRegionBitmap
- * @bitmap2: a GpRegionBitmap
+ * empty_bitmap:
+ * @bitmap: a GpRegionBitmap
  *
- * Allocate and return a new GpRegionBitmap that covers the total area 
- * (single rectangle) of both @bitmap1 and @bitmap2.
+ * Clear and, if required, free the bands and spans of @bitmap. Note that the
+ * allocated GpRegionBitmap structure MUST still be freed using
+ * gdip_region_bitmap_free.
+ */
+static void
+empty_bitmap (GpRegionBitmap *bitmap)
+{
+	bitmap->X = 0;
+	bitmap->Y = 0;
+	bitmap->Width = 0;
+	bitmap->Height = 0;
+	bitmap->BandCount = 0;
+
+	if (bitmap->surface) {
+		cairo_surface_destroy (bitmap->surface);
+		bitmap->surface = NULL;
+	}
+
+	if (bitmap->Bands) {
+		GdipFree (bitmap->Bands);
+		bitmap->Bands = NULL;
+	}
+
+	if (bitmap->Spans) {
+		GdipFree (bitmap->Spans);
+		bitmap->Spans = NULL;
+	}
+}
+
+
+/*
+ * gdip_region_bitmap_free:
+ * @bitmap: a GpRegionBitmap
  *
- * Notes:
- * - The allocated structure must be freed using gdip_region_bitmap_free.
+ * Free the region bitmap @bitmap.
  */
-static GpRegionBitmap*
-alloc_merged_bitmap (GpRegionBitmap *bitmap1, GpRegionBitmap *bitmap2)
+void
+gdip_region_bitmap_free (GpRegionBitmap *bitmap)
 {
-	GpRect rect;
+	empty_bitmap (bitmap);
+	GdipFree (bitmap);
+}
+
 
-	rect_union (bitmap1, bitmap2, &rect);
-	return alloc_bitmap (rect.X, rect.Y, rect.Width, rect.Height);
+/*
+ * Bitmaps are built, from top to bottom, one band at the time. The spans of
+ * a band must be added from left to right.
+ */
+
+typedef struct {
+	GpRegionBand	*bands;
+	int		band_count;
+	int		band_size;
+	GpRegionSpan	*spans;
+	int		span_count;
+	int		span_size;
+	BOOL		failed;		/* out of memory */
+} BitmapBuilder;
+
+
+static void
+builder_init (BitmapBuilder *builder)
+{
+	memset (builder, 0, sizeof (BitmapBuilder));
+}
+
+
+static void
+builder_clear (BitmapBuilder *builder)
+{
+	if (builder->bands)
+		GdipFree (builder->bands);
+	if (builder->spans)
+		GdipFree (builder->spans);
+	builder_init (builder);
 }
 
 
 /*
- * alloc_intersected_bitmap:
- * @bitmap1: a GpRegionBitmap
- * @bitmap2: a GpRegionBitmap
+ * builder_begin_band:
+ * @builder: a BitmapBuilder
+ * @y: the first line of the band
+ * @height: the number of lines of the band
  *
- * Allocate and return a new GpRegionBitmap that covers only the shared 
- * rectangle area of both @bitmap1 and @bitmap2.
+ * Start a new band, below the previous one.
+ */
+static void
+builder_begin_band (BitmapBuilder *builder, int y, int height)
+{
+	GpRegionBand *band;
+
+	if (builder->failed)
+		return;
+
+	/* keep an extra entry for the end of the spans */
+	if (builder->band_count + 1 >= builder->band_size) {
+		int size = (builder->band_size > 0) ? builder->band_size * 2 : 32;
+		GpRegionBand *bands = (GpRegionBand*) gdip_realloc (builder->bands, size * sizeof (GpRegionBand));
+		if (!bands) {
+			builder->failed = TRUE;
+			return;
+		}
+		builder->bands = bands;
+		builder->band_size = size;
+	}
+
+	band = &builder->bands [builder->band_count++];
+	band->Y = y;
+	band->Height = height;
+	band->First = builder->span_count;
+}
+
+
+/*
+ * builder_reserve_spans:
+ * @builder: a BitmapBuilder
+ * @count: the number of spans about to be added
  *
- * Notes:
- * - The allocated structure must be freed using gdip_region_bitmap_free.
- * - The bitmap width will be adjusted to a multiple of 8.
+ * Return FALSE if there's no memory for @count more spans.
  */
-static GpRegionBitmap*
-alloc_intersected_bitmap (GpRegionBitmap *bitmap1, GpRegionBitmap *bitmap2)
+static BOOL
+builder_reserve_spans (BitmapBuilder *builder, int count)
 {
-	GpRect rect;
+	int size = (builder->span_size > 0) ? builder->span_size : 64;
+	GpRegionSpan *spans;
+
+	if (builder->span_count + count <= builder->span_size)
+		return TRUE;
+
+	while (size < builder->span_count + count)
+		size *= 2;
 
-	rect_intersect (bitmap1, bitmap2, &rect);
-	return alloc_bitmap (rect.X, rect.Y, rect.Width, rect.Height);
+	spans = (GpRegionSpan*) gdip_realloc (builder->spans, size * sizeof (GpRegionSpan));
+	if (!spans) {
+		builder->failed = TRUE;
+		return FALSE;
+	}
+	builder->spans = spans;
+	builder->span_size = size;
+	return TRUE;
 }
 
 
 /*
- * gdip_region_bitmap_clone:
- * @bitmap: a GpRegionBitmap
+ * builder_add_span:
+ * @builder: a BitmapBuilder
+ * @x1: the first pixel of the span
+ * @x2: the pixel after the last one
  *
- * Allocate and return new GpRegionBitmap containing a copy of @bitmap.
+ * Add the [@x1, @x2) span to the current band, merging it with the previous
+ * span if they touch.
+ */
+static void
+builder_add_span (BitmapBuilder *builder, int x1, int x2)
+{
+	GpRegionSpan *span;
+
+	if (builder->failed || (x2 <= x1))
+		return;
+
+	if (builder->span_count > builder->bands [builder->band_count - 1].First) {
+		span = &builder->spans [builder->span_count - 1];
+		if (x1 <= span->X2) {
+			if (x2 > span->X2)
+				span->X2 = x2;
+			return;
+		}
+	}
+
+	if (!builder_reserve_spans (builder, 1))
+		return;
+
+	span = &builder->spans [builder->span_count++];
+	span->X1 = x1;
+	span->X2 = x2;
+}
+
+
+/*
+ * builder_add_spans:
+ * @builder: a BitmapBuilder
+ * @spans: the spans of a band
+ * @count: the number of spans in @spans
+ * @offset: the horizontal offset of @spans
+ *
+ * Add all the (valid) spans of another band to the current band.
+ */
+static void
+builder_add_spans (BitmapBuilder *builder, GpRegionSpan *spans, int count, int offset)
+{
+	GpRegionSpan *span;
+	int i;
+
+	if (count == 0)
+		return;
+
+	/* only the first span may touch the previous one */
+	builder_add_span (builder, spans [0].X1 + offset, spans [0].X2 + offset);
+	if (builder->failed || !builder_reserve_spans (builder, count - 1))
+		return;
+
+	span = &builder->spans [builder->span_count];
+	for (i = 1; i < count; i++, span++) {
+		span->X1 = spans [i].X1 + offset;
+		span->X2 = spans [i].X2 + offset;
+	}
+	builder->span_count += count - 1;
+}
+
+
+/*
+ * builder_end_band:
+ * @builder: a BitmapBuilder
+ *
+ * Complete the current band. An empty band is dropped and a band identical
+ * to the previous (touching) one is merged into it.
+ */
+static void
+builder_end_band (BitmapBuilder *builder)
+{
+	GpRegionBand *band, *previous;
+	int count;
+
+	if (builder->failed)
+		return;
+
+	band = &builder->bands [builder->band_count - 1];
+	count = builder->span_count - band->First;
+	if (count == 0) {
+		builder->band_count--;
+		return;
+	}
+
+	if (builder->band_count < 2)
+		return;
+
+	previous = band - 1;
+	if ((previous->Y + previous->Height == band->Y) && (band->First - previous->First == count) &&
+		(memcmp (builder->spans + previous->First, builder->spans + band->First, count * sizeof (GpRegionSpan)) == 0)) {
+		previous->Height += band->Height;
+		builder->span_count = band->First;
+		builder->band_count--;
+	}
+}
+
+
+/*
+ * builder_finish:
+ * @builder: a BitmapBuilder
+ * @x: the horizontal origin of the spans
+ * @y: the vertical origin of the bands
+ *
+ * Return a new GpRegionBitmap, reduced to its content, made of the bands of
+ * @builder. The builder memory is given to the bitmap (or freed).
  *
  * Note: the allocated structure must be freed using gdip_region_bitmap_free.
  */
-GpRegionBitmap*
-gdip_region_bitmap_clone (GpRegionBitmap *bitmap)
+static GpRegionBitmap*
+builder_finish (BitmapBuilder *builder, int x, int y)
 {
-	BYTE *buffer;
-	int size = (bitmap->Width * bitmap->Height >> 3); /* 1 bit per pixel */
+	GpRegionBitmap *result;
+	GpRegionBand *bands, *last;
+	GpRegionSpan *spans;
+	int min_x, max_x, top, height, i;
 
-	if (size > 0) {
-		buffer = alloc_bitmap_memory (size, FALSE);
-		if (buffer)
-			memcpy (buffer, bitmap->Mask, size);
-	} else {
-		buffer = NULL;
+	if (builder->failed) {
+		builder_clear (builder);
+		return NULL;
+	}
+
+	if (builder->band_count == 0) {
+		builder_clear (builder);
+		return alloc_empty_bitmap ();
+	}
+
+	/* the end of the last band is its next band "first" span */
+	builder->bands [builder->band_count].First = builder->span_count;
+	builder->bands [builder->band_count].Height = 0;
+
+	/* the first and last spans of each band are its limits */
+	min_x = G_MAXINT;
+	max_x = G_MININT;
+	for (i = 0; i < builder->band_count; i++) {
+		GpRegionBand *band = &builder->bands [i];
+		if (builder->spans [band->First].X1 < min_x)
+			min_x = builder->spans [band->First].X1;
+		if (builder->spans [band [1].First - 1].X2 > max_x)
+			max_x = builder->spans [band [1].First - 1].X2;
+	}
+
+	/* make everything relative to the bitmap bounds */
+	top = builder->bands [0].Y;
+	for (i = 0; i < builder->band_count; i++)
+		builder->bands [i].Y -= top;
+	for (i = 0; i < builder->span_count; i++) {
+		builder->spans [i].X1 -= min_x;
+		builder->spans [i].X2 -= min_x;
+	}
+
+	last = &builder->bands [builder->band_count - 1];
+	last [1].Y = height = last->Y + last->Height;
+
+	/* release the unused memory */
+	bands = (GpRegionBand*) gdip_realloc (builder->bands, (builder->band_count + 1) * sizeof (GpRegionBand));
+	if (bands)
+		builder->bands = bands;
+	spans = (GpRegionSpan*) gdip_realloc (builder->spans, builder->span_count * sizeof (GpRegionSpan));
+	if (spans)
+		builder->spans = spans;
+
+	result = alloc_bitmap (x + min_x, y + top, max_x - min_x, height, builder->band_count, builder->bands, builder->spans);
+	if (!result) {
+		builder_clear (builder);
+		return NULL;
 	}
-	return alloc_bitmap_with_buffer (bitmap->X, bitmap->Y, bitmap->Width, bitmap->Height, buffer);
+	return result;
 }
 
 
 /*
- * empty_bitmap:
+ * get_band:
  * @bitmap: a GpRegionBitmap
+ * @y: the vertical position
  *
- * Clear and, if required, free the mask of @bitmap. Note that the allocated 
- * GpRegionBitmap structure MUST still be freed using gdip_region_bitmap_free.
+ * Return the index of the first band of @bitmap that ends after the @y
+ * line, or BandCount if there's none.
  */
-static void
-empty_bitmap (GpRegionBitmap *bitmap)
+static int
+get_band (GpRegionBitmap *bitmap, int y)
 {
-	bitmap->X = 0;
-	bitmap->Y = 0;
-	bitmap->Width = 0;
-	bitmap->Height = 0;
+	int low = 0, high = bitmap->BandCount;
 
-	if (bitmap->Mask) {
-		GdipFree (bitmap->Mask);
-		bitmap->Mask = NULL;
+	y -= bitmap->Y;
+	while (low < high) {
+		int middle = (low + high) / 2;
+		GpRegionBand *band = &bitmap->Bands [middle];
+
+		if (band->Y + band->Height <= y)
+			low = middle + 1;
+		else
+			high = middle;
 	}
+	return low;
 }
 
 
 /*
- * gdip_region_bitmap_free:
+ * get_span:
  * @bitmap: a GpRegionBitmap
+ * @band: a GpRegionBand of @bitmap
+ * @x: the horizontal position
  *
- * Free the region bitmap @bitmap.
+ * Return the index of the first span of @band that ends after the @x pixel,
+ * or the index of the next band first span if there's none.
  */
-void
-gdip_region_bitmap_free (GpRegionBitmap *bitmap)
+static int
+get_span (GpRegionBitmap *bitmap, GpRegionBand *band, int x)
 {
-	empty_bitmap (bitmap);
-	GdipFree (bitmap);
+	int low = band->First, high = band [1].First;
+
+	x -= bitmap->X;
+	while (low < high) {
+		int middle = (low + high) / 2;
+
+		if (bitmap->Spans [middle].X2 <= x)
+			low = middle + 1;
+		else
+			high = middle;
+	}
+	return low;
 }
 
 
 /*
- * reduce:
- * @source: a byte array containing the 32bpp bitmap
- * @width: the width of the bitmap
- * @height: the height of the bitmap
- * @dest: a byte array for the reduced (1bpp) bitmap
+ * set_bits:
+ * @row: a row of a cairo A1 surface
+ * @x1: the first pixel
+ * @x2: the pixel after the last one
  *
- * Reduce a 32bpp bitmap @source into a 1bbp bitmap @dest.
+ * Set the bits of the [@x1, @x2) pixels of @row.
  */
 static void
-reduce (BYTE* source, int width, int height, BYTE *dest)
+set_bits (BYTE *row, int x1, int x2)
 {
-	int i, j, n = 0, value = 0;
-
-	for (i = 0; i < height; i++) {
-		for (j = 0; j < width; j++) {
-			int pos = (i * width + j) * 4;
-			BYTE combine = source [pos] | source [pos + 1] | source [pos + 2] | source [pos + 3];
+#if WORDS_BIGENDIAN
+	/* cairo keeps the first pixel in the most significant bit on big endian */
+	#define A1_BIT(x)	(0x80 >> ((x) & 7))
+#else
+	#define A1_BIT(x)	(1 << ((x) & 7))
+#endif
 
-			if (combine != 0)
-				value |= 128;
+	for (; (x1 < x2) && (x1 & 7); x1++)
+		row [x1 >> 3] |= A1_BIT (x1);
 
-			if (++n == 8) {
-				*dest++ = value;
-				n = 0;
-				value = 0;
-			} else {
-				value >>= 1;
-			}
-		}
+	if (x2 - x1 >= 8) {
+		memset (row + (x1 >> 3), 0xFF, (x2 - x1) >> 3);
+		x1 += (x2 - x1) & ~7;
 	}
+
+	for (; x1 < x2; x1++)
+		row [x1 >> 3] |= A1_BIT (x1);
 }
 
 
 /*
- * gdip_region_bitmap_apply_alpha:
- * @bitmap: a GpBitmap (not a GpRegionBitmap!)
- * @mask_bitmap: a GpRegionBitmap
+ * gdip_region_bitmap_get_surface:
+ * @bitmap: a GpRegionBitmap
  *
- * Apply the mask bits (from @mask_bitmap) to a ARGB32/PARGB32 @bitmap using alpha channel.
+ * Return a cairo A1 surface with the pixels of @bitmap, suitable for
+ * cairo_mask_surface. The surface is created on the first call and kept with
+ * @bitmap until it changes. NULL is returned if @bitmap is empty, if the mask
+ * would be larger than REGION_MAX_MASK_SIZE bytes or if the surface couldn't
+ * be created.
+ *
+ * Note: the returned surface is owned by @bitmap and must not be destroyed.
  */
-void 
-gdip_region_bitmap_apply_alpha (GpBitmap *bitmap, GpRegionBitmap *mask_bitmap)
+cairo_surface_t*
+gdip_region_bitmap_get_surface (GpRegionBitmap *bitmap)
 {
-	int x, y, p = 0;
-	ULONG *scan;
-
-	g_assert (bitmap->active_bitmap->pixel_format == PixelFormat32bppARGB || bitmap->active_bitmap->pixel_format == PixelFormat32bppPARGB);
-
-	for (y = 0; y < mask_bitmap->Height; y++) {
-		scan = (ULONG *)(bitmap->active_bitmap->scan0 + (y * bitmap->active_bitmap->stride));
-		for (x = 0; x < mask_bitmap->Width; x += 8) {
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x01) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x02) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x04) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x08) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x10) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x20) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x40) ? 0xFFFFFFFF : 0x00;
-			*(scan++) &= (mask_bitmap->Mask [p] & 0x80) ? 0xFFFFFFFF : 0x00;
-			p++;
-		}
+	cairo_surface_t *surface;
+	BYTE *data;
+	int stride;
+	int i, j, y;
+
+	if (bitmap->surface)
+		return bitmap->surface;
+
+	if (bitmap->BandCount == 0)
+		return NULL;
+
+	/* the mask is kept as long as the region, so its memory follows the area */
+	stride = cairo_format_stride_for_width (CAIRO_FORMAT_A1, bitmap->Width);
+	if ((stride <= 0) || ((gint64) stride * bitmap->Height > REGION_MAX_MASK_SIZE))
+		return NULL;
+
+	surface = cairo_image_surface_create (CAIRO_FORMAT_A1, bitmap->Width, bitmap->Height);
+	if (cairo_surface_status (surface) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy (surface);
+		return NULL;
 	}
+
+	cairo_surface_flush (surface);
+	data = cairo_image_surface_get_data (surface);
+	stride = cairo_image_surface_get_stride (surface);
+
+	/* the surface is cleared, so only the first line of each band is drawn, then copied */
+	for (i = 0; i < bitmap->BandCount; i++) {
+		GpRegionBand *band = &bitmap->Bands [i];
+		BYTE *row = data + band->Y * stride;
+
+		for (j = band->First; j < band [1].First; j++)
+			set_bits (row, bitmap->Spans [j].X1, bitmap->Spans [j].X2);
+
+		for (y = 1; y < band->Height; y++)
+			memcpy (row + y * stride, row, stride);
+	}
+	cairo_surface_mark_dirty (surface);
+
+	bitmap->surface = surface;
+	return surface;
 }
 
 
@@ -484,78 +723,146 @@ gdip_region_bitmap_invalidate (GpRegion *region)
 	if (!region->bitmap)
 		return;
 
-	empty_bitmap (region->bitmap);
+	gdip_region_bitmap_free (region->bitmap);
 	region->bitmap = NULL;
 }
 
 
 /*
- * gdip_region_bitmap_from_path:
+ * path_get_rects:
  * @path: a GpPath
+ * @rects: a pointer to an array of GpRectF
+ * @count: a pointer to the number of rectangles
+ *
+ * Return TRUE if @path is only made of axis-aligned rectangles, with integer
+ * coordinates, all turning in the same direction. Filled (with the winding
+ * rule) these rectangles cover exactly their union, i.e. the pixels inside
+ * @rects, so they don't need to be rasterized.
+ *
+ * Note: the @rects array must be freed using GdipFree.
+ */
+static BOOL
+path_get_rects (GpPath *path, GpRectF **rects, int *count)
+{
+	GpRectF *result;
+	int direction = 0;
+	int i, j, n = 0;
+
+	if ((path->count % 4) != 0)
+		return FALSE;
+
+	result = (GpRectF*) GdipAlloc ((path->count / 4) * sizeof (GpRectF));
+	if (!result)
+		return FALSE;
+
+	for (i = 0; i < path->count; i += 4) {
+		GpPointF *p = &g_array_index (path->points, GpPointF, i);
+		BYTE *types = &g_array_index (path->types, BYTE, i);
+		float cross;
+
+		/* a (possibly closed) figure of 4 points */
+		if (((types [0] & PathPointTypePathTypeMask) != PathPointTypeStart) ||
+			((types [1] & PathPointTypePathTypeMask) != PathPointTypeLine) ||
+			((types [2] & PathPointTypePathTypeMask) != PathPointTypeLine) ||
+			((types [3] & PathPointTypePathTypeMask) != PathPointTypeLine) ||
+			((types [0] | types [1] | types [2]) & PathPointTypeCloseSubpath))
+			goto not_rects;
+
+		for (j = 0; j < 4; j++) {
+			if ((p [j].X != floorf (p [j].X)) || (p [j].Y != floorf (p [j].Y)))
+				goto not_rects;
+		}
+
+		if (!((p [0].Y == p [1].Y) && (p [1].X == p [2].X) && (p [2].Y == p [3].Y) && (p [3].X == p [0].X)) &&
+			!((p [0].X == p [1].X) && (p [1].Y == p [2].Y) && (p [2].X == p [3].X) && (p [3].Y == p [0].Y)))
+			goto not_rects;
+
+		/* empty rectangles don't turn */
+		cross = (p [1].X - p [0].X) * (p [2].Y - p [1].Y) - (p [1].Y - p [0].Y) * (p [2].X - p [1].X);
+		if (cross == 0)
+			continue;
+
+		if (direction == 0)
+			direction = (cross > 0) ? 1 : -1;
+		else if (direction != ((cross > 0) ? 1 : -1))
+			goto not_rects;
+
+		result [n].X = MIN (p [0].X, p [2].X);
+		result [n].Y = MIN (p [0].Y, p [2].Y);
+		result [n].Width = fabsf (p [2].X - p [0].X);
+		result [n].Height = fabsf (p [2].Y - p [0].Y);
+		n++;
+	}
+
+	*rects = result;
+	*count = n;
+	return TRUE;
+
+not_rects:
+	GdipFree (result);
+	return FALSE;
+}
+
+
+/*
+ * bitmap_from_rects:
+ * @rects: an array of GpRectF, with integer coordinates
+ * @count: the number of rectangles in @rects
  *
- * Return a new GpRegionBitmap containing the bitmap representing the @path.
- * NULL will be returned if the bitmap cannot be created (e.g. too big).
+ * Return a new GpRegionBitmap covering the union of @rects.
  *
  * Note: the allocated structure must be freed using gdip_region_bitmap_free.
  */
-GpRegionBitmap*
-gdip_region_bitmap_from_path (GpPath *path)
+static GpRegionBitmap*
+bitmap_from_rects (GpRectF *rects, int count)
 {
-	GpRect bounds;
-	GpRegionBitmap *bitmap;
-	BYTE* buffer;
-	int i, idx, stride;
-	int length = path->count;
-	unsigned long size;
-	cairo_surface_t *surface = NULL;
-	cairo_t *cr = NULL;
-
-	/* empty path == empty bitmap */
-	if (length == 0)
-		return alloc_bitmap_with_buffer (0, 0, 0, 0, NULL);
+	BitmapBuilder builder;
+	GpRectF *bands;
+	int band_count;
+	int i, j;
 
-	/* get the limits of the bitmap we need to allocate */
-	if (GdipGetPathWorldBoundsI (path, &bounds, NULL, NULL) != Ok)
+	if (gdip_region_band_from_rects (rects, count, FALSE, &bands, &band_count) != Ok)
 		return NULL;
 
-	/* ensure X and Width are multiple of 8 */
-	rect_adjust_horizontal (&bounds.X, &bounds.Width);
-
-	/* an empty width or height is valid, even if no bitmap can be produced */
-	if ((bounds.Width == 0) || (bounds.Height == 0))
-		return alloc_bitmap_with_buffer (bounds.X, bounds.Y, bounds.Width, bounds.Height, NULL);
+	builder_init (&builder);
+	for (i = 0; i < band_count; i = j) {
+		builder_begin_band (&builder, bands [i].Y, bands [i].Height);
+		for (j = i; (j < band_count) && (bands [j].Y == bands [i].Y); j++)
+			builder_add_span (&builder, bands [j].X, bands [j].X + bands [j].Width);
+		builder_end_band (&builder);
+	}
 
-	/* replay the path list and the operations to reconstruct the bitmap */
-	stride = bounds.Width * 4;	/* RGBA -> 32 bpp, 4 Bbp */
-	size = stride * bounds.Height;
+	if (bands)
+		GdipFree (bands);
+	return builder_finish (&builder, 0, 0);
+}
 
-	/* here the memory is allocated for a ARGB bitmap - so 32 times bigger than our normal alpha bitmap */
-	if ((size < 1) || (size > REGION_MAX_BITMAP_SIZE << 5)) {
-		g_warning ("Path conversion requested %lu bytes (%d x %d). Maximum size is %d bytes.",
-			size, bounds.Width, bounds.Height, REGION_MAX_BITMAP_SIZE << 5);
-		return NULL;
-	}
-	buffer = (BYTE*) GdipAlloc (size);
-	if (!buffer)
-		return NULL;
-	memset (buffer, 0, size);
 
-	surface = cairo_image_surface_create_for_data (buffer, 
-		CAIRO_FORMAT_ARGB32, bounds.Width, bounds.Height, stride);
-	cr = cairo_create (surface);
+/*
+ * append_path:
+ * @cr: a cairo context
+ * @path: a GpPath
+ * @x: the horizontal origin
+ * @y: the vertical origin
+ *
+ * Add @path, relative to @x and @y, to the current path of @cr.
+ */
+static void
+append_path (cairo_t *cr, GpPath *path, int x, int y)
+{
+	int i, idx = 0;
 
-	idx = 0;
-	for (i = 0; i < length; ++i) {
+	for (i = 0; i < path->count; ++i) {
 		GpPointF pt = g_array_index (path->points, GpPointF, i);
 		BYTE type = g_array_index (path->types, BYTE, i);
 		GpPointF pts [3];
 		/* mask the bits so that we get only the type value not the other flags */
 		switch (type & PathPointTypePathTypeMask) {
 		case PathPointTypeStart:
-			cairo_move_to (cr, pt.X - bounds.X, pt.Y - bounds.Y);
+			cairo_move_to (cr, pt.X - x, pt.Y - y);
 			break;
 		case PathPointTypeLine:
-			cairo_line_to (cr, pt.X - bounds.X, pt.Y - bounds.Y);
+			cairo_line_to (cr, pt.X - x, pt.Y - y);
 			break;
 		case PathPointTypeBezier:
 			/* make sure we only add at most 3 points to pts */
@@ -565,9 +872,9 @@ gdip_region_bitmap_from_path (GpPath *path)
 			}
 			/* once we've added 3 pts, we can draw the curve */
 			if (idx == 3) {
-				cairo_curve_to (cr, pts [0].X - bounds.X, pts [0].Y - bounds.Y, 
-					pts [1].X - bounds.X, pts [1].Y - bounds.Y, 
-					pts [2].X - bounds.X, pts [2].Y - bounds.Y);
+				cairo_curve_to (cr, pts [0].X - x, pts [0].Y - y, 
+					pts [1].X - x, pts [1].Y - y, 
+					pts [2].X - x, pts [2].Y - y);
 				idx = 0;
 			}
 			break;
@@ -577,210 +884,247 @@ gdip_region_bitmap_from_path (GpPath *path)
 		if (type & PathPointTypeCloseSubpath)
 			cairo_close_path (cr);
 	}
-
-	cairo_clip (cr);
-	cairo_set_source_rgba (cr, 1, 1, 1, 1);
-	cairo_paint (cr);
-	cairo_destroy (cr);
-
-	cairo_surface_destroy (surface);
-
-	bitmap = alloc_bitmap (bounds.X, bounds.Y, bounds.Width, bounds.Height);
-	reduce (buffer, bounds.Width, bounds.Height, bitmap->Mask);
-	GdipFree (buffer);
-
-	return bitmap;
 }
 
 
+/* TRUE if any of the 8 bytes of a 64 bits word is zero */
+#define HAS_ZERO_BYTE(w)	((((w) - G_GUINT64_CONSTANT (0x0101010101010101)) & ~(w) & G_GUINT64_CONSTANT (0x8080808080808080)) != 0)
+
 /*
- * gdip_region_bitmap_get_smallest_rect:
- * @bitmap: a GpRegionBitmap
- * @rect: a pointer to a GpRect
+ * add_line_spans:
+ * @builder: a BitmapBuilder
+ * @pixels: a line of A8 pixels, 64 bits aligned
+ * @width: the number of pixels, a multiple of 8
  *
- * Return the minimal used space in the bitmap inside @rect.
+ * Add to the current band of @builder a span for each run of pixels with
+ * any coverage. Empty, or fully covered, runs of 8 pixels are skipped at
+ * once.
  */
-void
-gdip_region_bitmap_get_smallest_rect (GpRegionBitmap *bitmap, GpRect *rect)
+static void
+add_line_spans (BitmapBuilder *builder, BYTE *pixels, int width)
 {
-	int first_y = bitmap->Height + 1;	/* empty (top) lines */
-	int last_y = -1;			/* empty (bottom) lines */
-	int first_x = bitmap->Width + 1;	/* empty (left) columns */
-	int last_x = -1;			/* empty (right) columns */
-	int i = 0;
-	int original_size = SHAPE_SIZE(bitmap);
-	int x = 0, y = 0;
-	int k;
-
-	while (i < original_size) {
-		if (bitmap->Mask [i] != 0) {
-			for (k = 0; k < 8; k++) {
-				if ((bitmap->Mask [i] & (1 << k)) != 0) {
-					if (x < first_x)
-						first_x = x;
-					if (x > last_x)
-						last_x = x;
-					if (y < first_y)
-						first_y = y;
-					if (y > last_y)
-						last_y = y;				
-				}
+	guint64 *words = (guint64*) pixels;
+	int x = 0;
+
+	while (x < width) {
+		int start;
+
+		while (x < width) {
+			if (((x & 7) == 0) && (words [x >> 3] == 0))
+				x += 8;
+			else if (pixels [x] == 0)
 				x++;
-			}
-		} else {
-			x += 8;
+			else
+				break;
 		}
-		i++;		
-		if (x == bitmap->Width) {
-			x = 0;
-			y++;
+
+		start = x;
+		while (x < width) {
+			if (((x & 7) == 0) && !HAS_ZERO_BYTE (words [x >> 3]))
+				x += 8;
+			else if (pixels [x] != 0)
+				x++;
+			else
+				break;
 		}
+		builder_add_span (builder, start, x);
 	}
+}
 
-	/* did we found some bits ? */
-	if ((last_x == -1) && (last_y == -1) && (first_x == bitmap->Width + 1) && (first_y == bitmap->Height + 1)) {
-		rect->X = rect->Y = rect->Width = rect->Height = 0;
-	} else {
-		// convert to pixel values
-		rect->X = bitmap->X + first_x;
-		rect->Y = bitmap->Y + first_y;
-		rect->Width = last_x - first_x + 1;
-		rect->Height = last_y - first_y + 1;
-	}
+
+/*
+ * The strips are drawn inside a per-thread scratch buffer, kept between calls,
+ * unless a single line doesn't fit in REGION_STRIP_SIZE bytes.
+ */
+
+typedef struct {
+	BYTE	*data;
+	int	size;
+} RegionScratch;
+
+
+static void
+scratch_free (gpointer data)
+{
+	RegionScratch *scratch = (RegionScratch*) data;
+
+	GdipFree (scratch->data);
+	GdipFree (scratch);
 }
 
+#if GLIB_CHECK_VERSION(2,32,0)
+static GPrivate scratch_key = G_PRIVATE_INIT (scratch_free);
+#else
+static GStaticPrivate scratch_key = G_STATIC_PRIVATE_INIT;
+#endif
+
 
 /*
- * is_worth_shrinking:
- * @original_size: the original size of a bitmap
- * @new_size: the _potential_ new size of the bitmap (if shrinked)
+ * get_scratch:
+ * @size: the number of bytes needed, at most REGION_STRIP_SIZE
  *
- * Decide if the current bitmap, based on it's current size, is worth 
- * shrinking to a lesser size.
+ * Return the scratch buffer of the current thread, with at least @size bytes,
+ * or NULL if it can't be allocated.
  *
- * Note: Many binary operations (e.g. intersection) can greatly reduce the
- * size of the final bitmap.
+ * Note: the buffer must not be freed.
  */
-static BOOL
-is_worth_shrinking (int original_size, int new_size)
+static BYTE*
+get_scratch (int size)
 {
-	/* FIXME - we can do better than checking if we "save" 4kb */
-	return ((original_size - new_size) > 4096);
+#if GLIB_CHECK_VERSION(2,32,0)
+	RegionScratch *scratch = (RegionScratch*) g_private_get (&scratch_key);
+#else
+	RegionScratch *scratch = (RegionScratch*) g_static_private_get (&scratch_key);
+#endif
+
+	if (!scratch) {
+		scratch = (RegionScratch*) GdipAlloc (sizeof (RegionScratch));
+		if (!scratch)
+			return NULL;
+
+		scratch->data = NULL;
+		scratch->size = 0;
+#if GLIB_CHECK_VERSION(2,32,0)
+		g_private_set (&scratch_key, scratch);
+#else
+		g_static_private_set (&scratch_key, scratch, scratch_free);
+#endif
+	}
+
+	if (scratch->size < size) {
+		/* the buffer always grows to the largest strip, nothing needs to be kept */
+		BYTE *data = (BYTE*) GdipAlloc (REGION_STRIP_SIZE);
+		if (!data)
+			return NULL;
+
+		GdipFree (scratch->data);
+		scratch->data = data;
+		scratch->size = REGION_STRIP_SIZE;
+	}
+	return scratch->data;
 }
 
 
 /*
- * gdip_region_bitmap_shrink:
- * @bitmap: a GpRegionBitmap
- * @always_shrink: a BOOL
- *
- * Shrink the @bitmap if either @always_shrink is TRUE, or if it is decided
- * to be worth the CPU time (see is_worth_shrinking).
+ * gdip_region_bitmap_from_path:
+ * @path: a GpPath
  *
- * Reducing the bitmap size permit (a) to reduce the memory footprint and
- * (b) makes it more likely to apply certain optimizations using rectangle
- * intersections.
+ * Return a new GpRegionBitmap containing the bitmap representing the @path.
+ * NULL will be returned if the bitmap cannot be created (e.g. out of memory).
  *
- * Notes: 
- * 1.	we don't call this after an union (because the result will never be
- *	smaller) but other operations can result in a smaller bitmap.
- * 2.	we keep the bitmap width in multiple of 8 - it's simpler and faster
+ * Note: the allocated structure must be freed using gdip_region_bitmap_free.
  */
-void
-gdip_region_bitmap_shrink (GpRegionBitmap *bitmap, BOOL always_shrink)
+GpRegionBitmap*
+gdip_region_bitmap_from_path (GpPath *path)
 {
-	int original_size, new_size;
-	BOOL can_be_reduced;
-	GpRect rect;
-
-	/* bitmap (a) was already shrinked, or (b) is empty */
-	if (bitmap->reduced || !bitmap->Mask)
-		return;
-
-	gdip_region_bitmap_get_smallest_rect (bitmap, &rect);
+	GpRect bounds;
+	BitmapBuilder builder;
+	cairo_path_t *cairo_path = NULL;
+	GpRectF *rects;
+	BYTE* buffer;
+	BOOL scratch;
+	int x, y, line, count, stride, strip_height;
 
-	if ((rect.Width == 0) || (rect.Height == 0)) {
-		/* no, the the bitmap is empty */
-		empty_bitmap (bitmap);
-		return;
+	/* empty path == empty bitmap */
+	if (path->count == 0)
+		return alloc_empty_bitmap ();
+
+	/* (optimization) rectangles, like all rectangle-based regions, are known without drawing them */
+	if (path_get_rects (path, &rects, &count)) {
+		GpRegionBitmap *bitmap = bitmap_from_rects (rects, count);
+		GdipFree (rects);
+		return bitmap;
 	}
 
-	/* ensure X and Width are multiple of 8 */
-	rect_adjust_horizontal (&rect.X, &rect.Width);
+	/* get the limits of the bitmap we need to draw */
+	if (GdipGetPathWorldBoundsI (path, &bounds, NULL, NULL) != Ok)
+		return NULL;
 
-	original_size = SHAPE_SIZE(bitmap);
-	new_size = (rect.Height * rect.Width) >> 3; /* bits->bytes */
-	can_be_reduced = (new_size < original_size);
+	/* ensure X and Width are multiple of 8 */
+	rect_adjust_horizontal (&bounds.X, &bounds.Width);
 
-	/* shrink if:
-	 * a. the caller asked for it (and there is a size change)
-	 * b. the caller didn't ask for it but "we" decided it's worth it
-	 */
-	if ((always_shrink && can_be_reduced) || is_worth_shrinking (original_size, new_size)) {
-		/* reallocate a new bitmap buffer */
-		BYTE *new_mask = alloc_bitmap_memory (new_size, FALSE);
-		int new_width, new_height;
-		int y;
+	/* an empty width or height is valid, even if no bitmap can be produced */
+	if ((bounds.Width <= 0) || (bounds.Height <= 0))
+		return alloc_empty_bitmap ();
+
+	/* the path is drawn, in a temporary A8 bitmap, by strips of REGION_STRIP_SIZE bytes */
+	stride = bounds.Width;		/* A8 -> 8 bpp, 1 Bbp, and Width is a multiple of 8 */
+	strip_height = REGION_STRIP_SIZE / stride;
+	if (strip_height > bounds.Height)
+		strip_height = bounds.Height;
+
+	scratch = (strip_height > 0);
+	if (scratch) {
+		buffer = get_scratch (stride * strip_height);
+	} else {
+		strip_height = 1;
+		buffer = (BYTE*) GdipAlloc (stride);
+	}
+	if (!buffer)
+		return NULL;
 
-		int old_width_byte, new_width_byte;
+	builder_init (&builder);
+	for (y = 0; (y < bounds.Height) && !builder.failed; y += strip_height) {
+		int height = MIN (strip_height, bounds.Height - y);
 
-		BYTE* newline = NULL;
-		BYTE* oldline = NULL;
+		memset (buffer, 0, stride * height);
 
-		if (!new_mask)
-			return;
+		/* each strip is drawn, in tiles, inside the same buffer */
+		for (x = 0; x < bounds.Width; x += REGION_MAX_TILE_WIDTH) {
+			int width = MIN (REGION_MAX_TILE_WIDTH, bounds.Width - x);
+			cairo_surface_t *surface = cairo_image_surface_create_for_data (buffer + x,
+				CAIRO_FORMAT_A8, width, height, stride);
+			cairo_t *cr = cairo_create (surface);
 
-		new_width = rect.Width;
-		new_height = rect.Height;
+			cairo_translate (cr, -x, -y);
+			if (cairo_path) {
+				cairo_append_path (cr, cairo_path);
+			} else {
+				/* the path is converted only once */
+				append_path (cr, path, bounds.X, bounds.Y);
+				cairo_path = cairo_copy_path (cr);
+			}
 
-		old_width_byte = bitmap->Width >> 3;
-		new_width_byte = new_width >> 3;
+			cairo_clip (cr);
+			cairo_set_source_rgba (cr, 1, 1, 1, 1);
+			cairo_paint (cr);
+			cairo_destroy (cr);
 
-		newline = new_mask;
-		oldline = bitmap->Mask + ((rect.Y - bitmap->Y) * old_width_byte) + ((rect.X - bitmap->X) >> 3);
-		/* copy the interesting portion in the new bitmap */
-		for (y = 0; y < new_height; y++) {
-			memcpy (newline, oldline, new_width_byte);
-			newline += new_width_byte;
-			oldline += old_width_byte;
+			cairo_surface_destroy (surface);
 		}
 
-		/* replace current data */
-		bitmap->X = rect.X;
-		bitmap->Y = rect.Y;
-		bitmap->Width = rect.Width;
-		bitmap->Height = rect.Height;
-		GdipFree (bitmap->Mask);
-		bitmap->Mask = new_mask;
-		bitmap->reduced = TRUE;
+		/* identical lines are merged into a single band */
+		for (line = 0; line < height; line++) {
+			builder_begin_band (&builder, y + line, 1);
+			add_line_spans (&builder, buffer + line * stride, bounds.Width);
+			builder_end_band (&builder);
+		}
 	}
+
+	if (cairo_path)
+		cairo_path_destroy (cairo_path);
+	if (!scratch)
+		GdipFree (buffer);
+
+	return builder_finish (&builder, bounds.X, bounds.Y);
 }
 
 
 /*
- * is_point_visible:
+ * gdip_region_bitmap_get_smallest_rect:
  * @bitmap: a GpRegionBitmap
- * @x: the horizontal position
- * @y: the vertical position
- *
- * Return TRUE if the @x,@y point is set on the bitmap.
+ * @rect: a pointer to a GpRect
  *
- * Note: No bounds check are done this internal shared function.
+ * Return the minimal used space in the bitmap inside @rect.
  */
-static BOOL
-is_point_visible (GpRegionBitmap *bitmap, int x, int y)
+void
+gdip_region_bitmap_get_smallest_rect (GpRegionBitmap *bitmap, GpRect *rect)
 {
-	int pixel, pos, mask;
-
-	/* is the pixel set ? */
-	x -= bitmap->X;
-	y -= bitmap->Y;
-
-	pixel = (y * bitmap->Width + x);
-	pos = (pixel >> 3);
-	mask = (pixel & 7);
-
-	return ((bitmap->Mask [pos] & (1 << mask)) != 0);
+	/* bitmaps are always reduced to their content */
+	rect->X = bitmap->X;
+	rect->Y = bitmap->Y;
+	rect->Width = bitmap->Width;
+	rect->Height = bitmap->Height;
 }
 
 
@@ -797,9 +1141,8 @@ is_point_visible (GpRegionBitmap *bitmap, int x, int y)
 BOOL
 gdip_region_bitmap_is_point_visible (GpRegionBitmap *bitmap, int x, int y)
 {
-	/* is this an empty bitmap ? */
-	if ((bitmap->Width == 0) || (bitmap->Height == 0))
-		return FALSE;
+	GpRegionBand *band;
+	int i;
 
 	/* is the point inside the bitmap ? */
 	if ((x < bitmap->X) || (x >= bitmap->X + bitmap->Width))
@@ -807,12 +1150,21 @@ gdip_region_bitmap_is_point_visible (GpRegionBitmap *bitmap, int x, int y)
 	if ((y < bitmap->Y) || (y >= bitmap->Y + bitmap->Height))
 		return FALSE;
 
-	return is_point_visible (bitmap, x, y);
+	i = get_band (bitmap, y);
+	if (i == bitmap->BandCount)
+		return FALSE;
+
+	band = &bitmap->Bands [i];
+	if (y - bitmap->Y < band->Y)
+		return FALSE;
+
+	i = get_span (bitmap, band, x);
+	return (i < band [1].First) && (bitmap->Spans [i].X1 <= x - bitmap->X);
 }
 
 
 /*
- * gdip_region_bitmap_is_point_visible:
+ * gdip_region_bitmap_is_rect_visible:
  * @bitmap: a GpRegionBitmap
  * @rect: a pointer to a GpRect
  *
@@ -821,106 +1173,38 @@ gdip_region_bitmap_is_point_visible (GpRegionBitmap *bitmap, int x, int y)
 BOOL
 gdip_region_bitmap_is_rect_visible (GpRegionBitmap *bitmap, GpRect *rect)
 {
-	int x, y;
+	int x1 = rect->X, y1 = rect->Y;
+	int x2 = rect->X + rect->Width, y2 = rect->Y + rect->Height;
+	int i;
 
-	/* is this an empty bitmap ? */
-	if ((bitmap->Width == 0) || (bitmap->Height == 0))
-		return FALSE;
+	if (x2 < x1) {
+		x1 = x2;
+		x2 = rect->X;
+	}
+	if (y2 < y1) {
+		y1 = y2;
+		y2 = rect->Y;
+	}
 
 	/* quick intersection checks */
-	if (bitmap->X < rect->X + rect->Width)
+	if ((x1 == x2) || (y1 == y2))
 		return FALSE;
-	if (bitmap->X + bitmap->Width > rect->X)
+	if ((x2 <= bitmap->X) || (x1 >= bitmap->X + bitmap->Width))
 		return FALSE;
-	if (bitmap->Y < rect->Y + rect->Height)
+	if ((y2 <= bitmap->Y) || (y1 >= bitmap->Y + bitmap->Height))
 		return FALSE;
-	if (bitmap->Y + bitmap->Height > rect->Y)
-		return FALSE;
-
-	/* TODO - optimize */
-	for (y = rect->Y; y < rect->Y + rect->Height; y++) {
-		for (x = rect->X; x < rect->X + rect->Width; x++) {
-			if (is_point_visible (bitmap, x, y))
-				return TRUE;
-		}
-	}
-	return FALSE;
-}
-
-
-/*
- * get_buffer_pos:
- * @shape: a GpRegionBitmap
- * @x: the horizontal position
- * @y: the vertical position
- *
- * Return the index, inside the @shape buffer, corresponding to the @x,@y 
- * point.
- */
-static int
-get_buffer_pos (GpRegionBitmap *shape, int x, int y)
-{
-	/* check for out of bounds */
-	if ((x < shape->X) || (x >= shape->X + shape->Width))
-		return -1;
-	if ((y < shape->Y) || (y >= shape->Y + shape->Height))
-		return -1;
-
-	x -= shape->X;
-	y -= shape->Y;
-	return ((y * shape->Width + x) >> 3);
-}
-
-
-/*
- * get_byte:
- * @shape: a GpRegionBitmap
- * @x: the horizontal position
- * @y: the vertical position
- *
- * Return the byte, from the @shape buffer, corresponding to the @x,@y point.
- * Note that this byte contains 8 pixels.
- */
-static int
-get_byte (GpRegionBitmap *shape, int x, int y)
-{
-	/* out of bounds == empty (no pixel) */
-	int pos = get_buffer_pos (shape, x, y);
-	return (pos == -1) ? 0 : shape->Mask [pos];
-}
 
+	for (i = get_band (bitmap, y1); i < bitmap->BandCount; i++) {
+		GpRegionBand *band = &bitmap->Bands [i];
+		int j;
 
-/*
- * Process a single line for gdip_region_bitmap_get_scans.
- */
-static BOOL
-process_line (GpRegionBitmap *bitmap, int y, int *x, int *w)
-{
-	int pos = *x;
-	*x = -1;
-	*w = -1;
-
-	while (pos < bitmap->X + bitmap->Width) {
-		BOOL visible = gdip_region_bitmap_is_point_visible (bitmap, pos, y);
-		if (*x == -1) {
-			if (visible) {
-				*x += pos + 1;
-			}
-		} else {
-			if (!visible) {
-				*w = pos - *x;
-				return TRUE;
-			}
-		}
-		pos++;
-	}
+		if (bitmap->Y + band->Y >= y2)
+			break;
 
-	/* end of line - have we started a rect ? */
-	if (*x != -1) {
-		*w = pos - *x;
-		return TRUE;
+		j = get_span (bitmap, band, x1);
+		if ((j < band [1].First) && (bitmap->X + bitmap->Spans [j].X1 < x2))
+			return TRUE;
 	}
-
 	return FALSE;
 }
 
@@ -930,54 +1214,29 @@ process_line (GpRegionBitmap *bitmap, int y, int *x, int *w)
  * @bitmap: a GpRegionBitmap
  * @rect: a pointer to an array of GpRectF
  *
- * Convert the scan lines of the bitmap into an array of GpRectF. The return
+ * Convert the bands of the bitmap into an array of GpRectF. The return
  * value represents the actual number of GpRectF entries that were generated.
  */
 int
 gdip_region_bitmap_get_scans (GpRegionBitmap *bitmap, GpRectF *rect)
 {
-	if (!bitmap || !bitmap->Mask)
+	int i, j;
+	int n = 0;
+
+	if (!bitmap)
 		return 0;
 
-	GpRect actual;
-	int x, y, w;
-	int n = 0;
-	
-	actual.X = REGION_INFINITE_POSITION;
-	actual.Width = REGION_INFINITE_LENGTH;
-	/* for each line in the bitmap */
-	for (y = bitmap->Y; y < bitmap->Y + bitmap->Height; y++) {
-		/* until we processed the whole line */
-		x = bitmap->X;
-		while (process_line (bitmap, y, &x, &w)) {
-			/* FIXME - we only look at the last rectangle but we could check all
-				rectangles in the previous line (and retain perfect rendering
-				with, possibly, less rectangle. We could also allow non exact
-				match for X and Width (e.g. +/- 1 pixel). MS doesn't seems to
-				return perfect rectangles for all shapes. */
-
-			/* if position (X) and Width are identical to previous rectangle */
-			if ((x == actual.X) && (w == actual.Width)) {
-				/* then augment it's Height by one */
-				if (rect && (n > 0)) {
-					rect [n - 1].Height++;
-				}
-			} else {
-				actual.X = x;
-				actual.Y = y;
-				actual.Width = w;
-				actual.Height = 1;
-
-				if (rect) {
-					rect [n].X = actual.X;
-					rect [n].Y = actual.Y;
-					rect [n].Width = actual.Width;
-					rect [n].Height = actual.Height;
-				}
-				n++;
+	for (i = 0; i < bitmap->BandCount; i++) {
+		GpRegionBand *band = &bitmap->Bands [i];
+
+		for (j = band->First; j < band [1].First; j++) {
+			if (rect) {
+				rect [n].X = bitmap->X + bitmap->Spans [j].X1;
+				rect [n].Y = bitmap->Y + band->Y;
+				rect [n].Width = bitmap->Spans [j].X2 - bitmap->Spans [j].X1;
+				rect [n].Height = band->Height;
 			}
-			/* continue on the same line */
-			x += w + 1;
+			n++;
 		}
 	}
 	return n;
@@ -1001,6 +1260,10 @@ gdip_region_bitmap_get_scans (GpRegionBitmap *bitmap, GpRectF *rect)
 static BOOL
 bitmap_intersect (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
 {
+	/* an empty bitmap has a 0x0 box, at the origin, that intersects nothing */
+	if ((shape1->BandCount == 0) || (shape2->BandCount == 0))
+		return FALSE;
+
 	return ((shape1->X < shape2->X + shape2->Width) &&
 		(shape1->X + shape1->Width > shape2->X) &&
 		(shape1->Y < shape2->Y + shape2->Height) &&
@@ -1014,28 +1277,24 @@ bitmap_intersect (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
  * @shape2: a GpRegionBitmap
  *
  * This function checks if the data inside @shape1 is identical to the data
- * inside @shape2 - even if their respective rectangles are different.
+ * inside @shape2.
  */
 BOOL
 gdip_region_bitmap_compare (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
 {
-	GpRect rect;
-	int x, y;
-
-	/* if the rectangles containing shape1 and shape2 DO NOT
-	   intersect, then there is no possible intersection */
-	if (!bitmap_intersect (shape1, shape2))
+	/* bitmaps are reduced and their bands merged, so identical shapes have identical bitmaps */
+	if ((shape1->X != shape2->X) || (shape1->Y != shape2->Y) ||
+		(shape1->Width != shape2->Width) || (shape1->Height != shape2->Height) ||
+		(shape1->BandCount != shape2->BandCount))
 		return FALSE;
 
-	rect_union (shape1, shape2, &rect);
-	for (y = rect.Y; y < rect.Y + rect.Height; y++) {
-		for (x = rect.X; x < rect.X + rect.Width; x += 8) {
-			if (get_byte (shape1, x, y) != get_byte (shape2, x, y))
-				return FALSE;
-		}
-	}
+	if (shape1->BandCount == 0)
+		return TRUE;
 
-	return TRUE;
+	if (memcmp (shape1->Bands, shape2->Bands, (shape1->BandCount + 1) * sizeof (GpRegionBand)) != 0)
+		return FALSE;
+
+	return (memcmp (shape1->Spans, shape2->Spans, shape1->Bands [shape1->BandCount].First * sizeof (GpRegionSpan)) == 0);
 }
 
 
@@ -1043,177 +1302,50 @@ gdip_region_bitmap_compare (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
  * Binary operators on bitmap regions
  *
  * Notes
- * - All operations requires the bitmap x origin and it's width to be multiple
- *   of 8.
- */
-
-
-/*
- * gdip_region_bitmap_union:
- * @shape1: a GpRegionBitmap
- * @shape2: a GpRegionBitmap
- *
- * Return a new bitmap containing the union of the two specified region 
- * bitmaps.
- */
-static GpRegionBitmap*
-gdip_region_bitmap_union (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
-{
-	GpRegionBitmap *op = alloc_merged_bitmap (shape1, shape2);
-	int x, y;
-
-	for (y = op->Y; y < op->Y + op->Height; y++) {
-		int p = get_buffer_pos (op, op->X, y);
-		for (x = op->X; x < op->X + op->Width; x += 8) {
-			op->Mask [p++] = get_byte (shape1, x, y) | get_byte (shape2, x, y);
-		}
-	}
-
-	/* no need to call reduce_bitmap (it will never shrink, 
-	   unless the original bitmap were oversized) */
-	return op;
-}
-
-
-/*
- * gdip_region_bitmap_intersection:
- * @shape1: a GpRegionBitmap
- * @shape2: a GpRegionBitmap
- *
- * Return a new bitmap containing the intersection of the two specified region
- * bitmaps.
- */
-static GpRegionBitmap*
-gdip_region_bitmap_intersection (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
-{
-	GpRegionBitmap *op;
-	int x, y;
-
-	/* if the rectangles containing shape1 and shape2 DO NOT
-	   intersect, then there is no possible intersection */
-	if (!bitmap_intersect (shape1, shape2))
-		return alloc_bitmap_with_buffer (0, 0, 0, 0, NULL);
-
-	/* the bitmap size cannot be bigger than a rectangle intersection of
-	   both bitmaps */
-	op = alloc_intersected_bitmap (shape1, shape2);
-
-	for (y = op->Y; y < op->Y + op->Height; y++) {
-		int p = get_buffer_pos (op, op->X, y);
-		for (x = op->X; x < op->X + op->Width; x += 8) {
-			op->Mask [p++] = get_byte (shape1, x, y) & get_byte (shape2, x, y);
-		}
-	}
-
-	/* reduce bitmap size - if it make sense */
-	gdip_region_bitmap_shrink (op, FALSE);
-	return op;
-}
-
-
-/*
- * gdip_region_bitmap_exclude:
- * @shape1: a GpRegionBitmap
- * @shape2: a GpRegionBitmap
- *
- * Return a new bitmap containing the first shape minus the second shape.
+ * - Both bitmaps are walked once, from top to bottom, splitting them at
+ *   every top and bottom of their bands. The spans of each part are then
+ *   walked once, from left to right.
  */
-static GpRegionBitmap*
-gdip_region_bitmap_exclude (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
-{
-	GpRegionBitmap *op;
-	int x, y;
-
-	/* if the rectangles containing shape1 and shape2 DO NOT
-	   intersect, then the result is identical shape1 */
-	if (!bitmap_intersect (shape1, shape2))
-		return gdip_region_bitmap_clone (shape1);
-
-	/* the new bitmap size cannot be bigger than shape1 */
-	op = alloc_bitmap (shape1->X, shape1->Y, shape1->Width, shape1->Height);
-
-	for (y = op->Y; y < op->Y + op->Height; y++) {
-		int p = get_buffer_pos (op, op->X, y);
-		for (x = op->X; x < op->X + op->Width; x += 8) {
-			BYTE b1 = get_byte (shape1, x, y);
-			op->Mask [p++] = b1 - (b1 & get_byte (shape2, x, y));
-		}
-	}
 
-	/* reduce bitmap size - if it make sense */
-	gdip_region_bitmap_shrink (op, FALSE);
-	return op;
-}
 
+#define SPAN_LEFT(spans, i)	((spans) [i].X1)
+#define SPAN_RIGHT(spans, i)	((spans) [i].X2)
 
 /*
- * gdip_region_bitmap_complement:
- * @shape1: a GpRegionBitmap
- * @shape2: a GpRegionBitmap
+ * combine_spans:
+ * @builder: a BitmapBuilder
+ * @spans1: the spans of the first shape
+ * @count1: the number of spans in @spans1
+ * @offset1: the horizontal offset of @spans1
+ * @spans2: the spans of the second shape
+ * @count2: the number of spans in @spans2
+ * @offset2: the horizontal offset of @spans2
+ * @combineMode: the binary operator
  *
- * Return a new bitmap containing the second shape minus the first shape.
+ * Add to the current band of @builder the spans resulting from applying
+ * @combineMode to the two (sorted) lists of spans.
  */
-static GpRegionBitmap*
-gdip_region_bitmap_complement (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
+static void
+combine_spans (BitmapBuilder *builder, GpRegionSpan *spans1, int count1, int offset1,
+	GpRegionSpan *spans2, int count2, int offset2, CombineMode combineMode)
 {
-	GpRegionBitmap *op;
-	int x, y;
-
-	/* if the rectangles containing shape1 and shape2 DO NOT
-	   intersect, then the result is identical shape2 */
-	if (!bitmap_intersect (shape1, shape2))
-		return gdip_region_bitmap_clone (shape2);
-
-	/* the new bitmap size cannot be bigger than shape2 */
-	op = alloc_bitmap (shape2->X, shape2->Y, shape2->Width, shape2->Height);
+#define SPAN_ADD(x1, x2)	builder_add_span (builder, x1, x2)
 
-	for (y = op->Y; y < op->Y + op->Height; y++) {
-		int p = get_buffer_pos (op, op->X, y);
-		for (x = op->X; x < op->X + op->Width; x += 8) {
-			BYTE b2 = get_byte (shape2, x, y);
-			op->Mask [p++] = b2 - (b2 & get_byte (shape1, x, y));
-		}
+	/* (optimization) the band of a single shape is either copied or dropped */
+	if (count2 == 0) {
+		if (gdip_region_band_is_covered (combineMode, TRUE, FALSE))
+			builder_add_spans (builder, spans1, count1, offset1);
+		return;
 	}
-
-	/* reduce bitmap size - if it make sense */
-	gdip_region_bitmap_shrink (op, FALSE);
-	return op;
-}
-
-
-/*
- * gdip_region_bitmap_xor:
- * @shape1: a GpRegionBitmap
- * @shape2: a GpRegionBitmap
- *
- * Return a new bitmap containing the exclusive-or of the two specified region
- * bitmaps.
- */
-static GpRegionBitmap*
-gdip_region_bitmap_xor (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
-{
-	GpRegionBitmap *op;
-	int x, y;
-
-	/* if the rectangles containing shape1 and shape2 DO NOT intersect,
-	   then the result is identical an union of shape1 and shape2. Code is
-	   almost similar but no reduction is required for an union. */
-	if (!bitmap_intersect (shape1, shape2))
-		return gdip_region_bitmap_union (shape1, shape2);
-
-	/* the new bitmap is potentially as big as the two merged bitmaps */
-	op = alloc_merged_bitmap (shape1, shape2);
-
-	for (y = op->Y; y < op->Y + op->Height; y++) {
-		int p = get_buffer_pos (op, op->X, y);
-		for (x = op->X; x < op->X + op->Width; x += 8) {
-			op->Mask [p++] = get_byte (shape1, x, y) ^ get_byte (shape2, x, y);
-		}
+	if (count1 == 0) {
+		if (gdip_region_band_is_covered (combineMode, FALSE, TRUE))
+			builder_add_spans (builder, spans2, count2, offset2);
+		return;
 	}
 
-	/* reduce bitmap size - if it make sense */
-	gdip_region_bitmap_shrink (op, FALSE);
-	return op;
+	REGION_BAND_COMBINE_SPANS (int, spans1, count1, offset1, spans2, count2, offset2, SPAN_LEFT, SPAN_RIGHT, G_MAXINT,
+		combineMode, SPAN_ADD);
+#undef SPAN_ADD
 }
 
 
@@ -1229,22 +1361,74 @@ gdip_region_bitmap_xor (GpRegionBitmap *shape1, GpRegionBitmap *shape2)
 GpRegionBitmap*
 gdip_region_bitmap_combine (GpRegionBitmap *bitmap1, GpRegionBitmap* bitmap2, CombineMode combineMode)
 {
+	BitmapBuilder builder;
+	int i1 = 0, i2 = 0;
+	int x, y;
+
 	if (!bitmap1 || !bitmap2)
 		return NULL;
 
 	switch (combineMode) {
 	case CombineModeComplement:
-		return gdip_region_bitmap_complement (bitmap1, bitmap2);
+		/* if the rectangles containing bitmap1 and bitmap2 DO NOT
+		   intersect, then the result is identical bitmap2 */
+		if (!bitmap_intersect (bitmap1, bitmap2))
+			return gdip_region_bitmap_clone (bitmap2);
+		break;
 	case CombineModeExclude:
-		return gdip_region_bitmap_exclude (bitmap1, bitmap2);
+		/* if the rectangles containing bitmap1 and bitmap2 DO NOT
+		   intersect, then the result is identical bitmap1 */
+		if (!bitmap_intersect (bitmap1, bitmap2))
+			return gdip_region_bitmap_clone (bitmap1);
+		break;
 	case CombineModeIntersect:
-		return gdip_region_bitmap_intersection (bitmap1, bitmap2);
+		/* if the rectangles containing bitmap1 and bitmap2 DO NOT
+		   intersect, then there is no possible intersection */
+		if (!bitmap_intersect (bitmap1, bitmap2))
+			return alloc_empty_bitmap ();
+		break;
 	case CombineModeUnion:
-		return gdip_region_bitmap_union (bitmap1, bitmap2);
 	case CombineModeXor:
-		return gdip_region_bitmap_xor (bitmap1, bitmap2);
+		if (bitmap1->BandCount == 0)
+			return gdip_region_bitmap_clone (bitmap2);
+		if (bitmap2->BandCount == 0)
+			return gdip_region_bitmap_clone (bitmap1);
+		break;
 	default:
 		g_warning ("Unkown combine mode specified (%d)", combineMode);
 		return NULL;
 	}
+
+	/* the new spans are relative to the leftmost bitmap */
+	x = MIN (bitmap1->X, bitmap2->X);
+	y = MIN (bitmap1->Y, bitmap2->Y);
+
+	builder_init (&builder);
+	while ((i1 < bitmap1->BandCount) || (i2 < bitmap2->BandCount)) {
+		/* the part of the current bands that is still to be processed starts at y */
+		GpRegionBand *band1 = (i1 < bitmap1->BandCount) ? &bitmap1->Bands [i1] : NULL;
+		GpRegionBand *band2 = (i2 < bitmap2->BandCount) ? &bitmap2->Bands [i2] : NULL;
+		int top1 = band1 ? MAX (bitmap1->Y + band1->Y, y) : G_MAXINT;
+		int top2 = band2 ? MAX (bitmap2->Y + band2->Y, y) : G_MAXINT;
+		int top = MIN (top1, top2);
+		BOOL in1 = band1 && (top1 == top);
+		BOOL in2 = band2 && (top2 == top);
+		int bottom = MIN (in1 ? bitmap1->Y + band1->Y + band1->Height : top1,
+			in2 ? bitmap2->Y + band2->Y + band2->Height : top2);
+
+		builder_begin_band (&builder, top, bottom - top);
+		combine_spans (&builder,
+			in1 ? bitmap1->Spans + band1->First : NULL, in1 ? band1 [1].First - band1->First : 0, bitmap1->X - x,
+			in2 ? bitmap2->Spans + band2->First : NULL, in2 ? band2 [1].First - band2->First : 0, bitmap2->X - x,
+			combineMode);
+		builder_end_band (&builder);
+
+		y = bottom;
+		if (in1 && (bitmap1->Y + band1->Y + band1->Height <= y))
+			i1++;
+		if (in2 && (bitmap2->Y + band2->Y + band2->Height <= y))
+			i2++;
+	}
+
+	return builder_finish (&builder, x, 0);
 }
@@ -31,24 +31,47 @@
 #include "bitmap-private.h"
 
 /*
- * REGION_MAX_BITMAP_SIZE defines the size limit of the region bitmap we keep
- * in memory. The current value is 2 megabits which should be enough for any 
- * on-screen region. Before changing this value remember that a "real", but 
- * temporary, ARGB32 bitmap (32 times bigger, i.e. 8MB) may be allocated when 
- * converting the path into the region bitmap.
+ * REGION_STRIP_SIZE defines the size of the (per-thread) A8 buffer used to
+ * rasterize a path. Larger paths are rasterized in horizontal strips, so the
+ * size of a region isn't limited by the memory needed to draw it.
  */
-#define REGION_MAX_BITMAP_SIZE		(2 * 1024 * 1024 >> 3)
+#define REGION_STRIP_SIZE		(1024 * 1024)
 
-#define SHAPE_SIZE(shape)		(((shape)->Width * (shape)->Height) >> 3)
+/*
+ * REGION_MAX_MASK_SIZE limits the A1 mask kept with a bitmap to fill it, see
+ * gdip_region_bitmap_get_surface. Larger regions are filled span by span.
+ */
+#define REGION_MAX_MASK_SIZE		(4 * 1024 * 1024)
 
+/* a run of visible pixels, [X1, X2), relative to the bitmap X */
+typedef struct {
+	int X1;
+	int X2;
+} GpRegionSpan;
 
+/* a band of identical lines, Y is relative to the bitmap Y */
+typedef struct {
+	int Y;
+	int Height;
+	int First;	/* index of the first span of the band, it ends with the next band first span */
+} GpRegionBand;
+
+/*
+ * The bitmap is kept as runs of pixels (RLE) inside bands of identical lines.
+ * Bands are sorted, never empty, and two touching bands never have the same
+ * spans. Spans of a band are sorted and never touch each other. The bounds are
+ * the smallest rectangle containing all the spans, so equal shapes always have
+ * equal bitmaps. An empty bitmap has no bands.
+ */
 typedef struct {
 	int X;
 	int Y;
 	int Width;
 	int Height;
-	unsigned char *Mask;
-	BOOL reduced;
+	int BandCount;
+	GpRegionBand *Bands;	/* BandCount + 1 entries, the last one only marks the end of the spans */
+	GpRegionSpan *Spans;
+	cairo_surface_t *surface;	/* A1 rendering of the spans, see gdip_region_bitmap_get_surface */
 } GpRegionBitmap;
 
 
@@ -66,9 +89,8 @@ BOOL gdip_region_bitmap_is_rect_visible (GpRegionBitmap *bitmap, GpRect *rect) G
 int gdip_region_bitmap_get_scans (GpRegionBitmap *bitmap, GpRectF *rect) GDIP_INTERNAL;
 
 void gdip_region_bitmap_get_smallest_rect (GpRegionBitmap *bitmap, GpRect *rect) GDIP_INTERNAL;
-void gdip_region_bitmap_shrink (GpRegionBitmap *bitmap, BOOL always_shrink) GDIP_INTERNAL;
 
-void gdip_region_bitmap_apply_alpha (GpBitmap *bitmap, GpRegionBitmap *alpha) GDIP_INTERNAL;
+cairo_surface_t* gdip_region_bitmap_get_surface (GpRegionBitmap *bitmap) GDIP_INTERNAL;
 
 GpRegionBitmap* gdip_region_bitmap_combine (GpRegionBitmap *bitmap1, GpRegionBitmap* bitmap2, CombineMode combineMode) GDIP_INTERNAL;
 
@@ -56,6 +56,8 @@ struct _Region {
     GpRectF*	rects;
     GpPathTree*	tree;
     GpRegionBitmap*	bitmap;
+    GpRectF*	bands;		/* banded copy of rects for hit testing, built on demand */
+    int		band_cnt;
 };
 
 BOOL gdip_is_InfiniteRegion (GpRegion *region) GDIP_INTERNAL;
@@ -24,6 +24,7 @@
  */
 
 #include "region-private.h"
+#include "region-band.h"
 #include "graphics-path-private.h"
 
 /*
@@ -38,6 +39,8 @@ gdip_region_init (GpRegion *result)
 	result->rects = NULL;
 	result->tree = NULL;
 	result->bitmap = NULL;
+	result->bands = NULL;
+	result->band_cnt = 0;
 }
 
 GpRegion *
@@ -76,31 +79,6 @@ gdip_add_rect_to_array (GpRectF** srcarray, int* elements, const GpRectF* rect)
 	return Ok;
 }
 
-static BOOL
-gdip_is_Point_in_RectF_Visible (float x, float y, GpRectF* rect)
-{
-	if ((x >= rect->X && x < (rect->X + rect->Width))
-		&& (y >= rect->Y && y < (rect->Y + rect->Height)))
-		return TRUE;
-	else
-		return FALSE;
-}
-
-static BOOL
-gdip_is_Point_in_RectFs_Visible (float x, float y, GpRectF* r, int cnt)
-{
-	GpRectF* rect = r;
-	int i;
-
-	for (i = 0; i < cnt; i++, rect++) {
-		if (gdip_is_Point_in_RectF_Visible (x, y, rect)) {
-			return TRUE;
-		}
-	}
-
-	return FALSE;
-}
-
 static void
 gdip_get_bounds (GpRectF *allrects, int allcnt, GpRectF *bound)
 {
@@ -197,61 +175,6 @@ gdip_is_InfiniteRegion (GpRegion *region)
 	return FALSE;
 }
 
-static BOOL
-gdip_intersects (GpRectF *rect1, GpRectF *rect2)
-{
-	if (rect1->X + rect1->Width == rect2->X) {
-		return TRUE;
-	}
-
-	return (rect1->X < rect2->X + rect2->Width &&
-		rect1->X + rect1->Width > rect2->X &&
-		rect1->Y < rect2->Y + rect2->Height &&
-		rect1->Y + rect1->Height > rect2->Y);
-}
-
-/* Is source contained in target ? */
-static BOOL
-gdip_contains (GpRectF *rect1, GpRectF *rect2)
-{
-	return (rect1->X >= rect2->X &&
-		rect1->X + rect1->Width <= rect2->X + rect2->Width &&
-		rect1->Y >= rect2->Y &&
-		rect1->Y + rect1->Height <= rect2->Y + rect2->Height);
-}
-
-static BOOL
-gdip_add_rect_to_array_notcontained (GpRectF** srcarray, int* elements,  GpRectF* rect)
-{
-	int i;
-	GpRectF* rectarray = *srcarray;
-
-	if (rect->Height <= 0 || rect->Width <= 0)
-		return FALSE;
-
-	for (i = 0; i < *elements; i++, rectarray++) {
-		if (gdip_contains (rect, rectarray) == TRUE) {
-			return FALSE;
-		}
-	}
-
-	gdip_add_rect_to_array (srcarray, elements, rect);
-	return TRUE;
-}
-
-
-static BOOL
-gdip_equals (GpRectF *rect1, GpRectF *rect2)
-{
-	if (!rect1)
-		return (rect2 == NULL);
-
-	return (rect1->X == rect2->X &&
-		rect1->Width == rect2->Width &&
-		rect1->Y == rect2->Y &&
-		rect1->Height == rect2->Height);
-}
-
 BOOL
 gdip_is_Point_in_RectF_inclusive (float x, float y, GpRectF* rect)
 {
@@ -262,45 +185,31 @@ gdip_is_Point_in_RectF_inclusive (float x, float y, GpRectF* rect)
 		return FALSE;
 }
 
-/* Finds a rect that has the lowest x and y after the src rect provided */
-static BOOL
-gdip_getlowestrect (GpRectF *rects, int cnt, GpRectF* src, GpRectF* rslt)
+/* the banded copy must be dropped each time the rectangles are modified */
+static void
+gdip_region_bands_invalidate (GpRegion *region)
 {
-	int i;
-	GpRectF *current;
-	GpRectF *lowest = NULL;
-
-	for (i = 0, current = rects; i < cnt; i++, current++) {
-		if (current->Width <= 0 || current->Height <= 0)
-			continue;
-
-		if (current->Y > src->Y ||
-			(current->Y == src->Y && current->X > src->X)) {
-			if (lowest == NULL) {
-				lowest = current;
-			}
-			else {
-				if (current->Y < lowest->Y ||
-					(current->Y == lowest->Y && current->X < lowest->X)) {
-						lowest = current;
-				}
-			}
-		}
+	if (region->bands) {
+		GdipFree (region->bands);
+		region->bands = NULL;
 	}
+	region->band_cnt = 0;
+}
 
-	if (lowest == NULL) {
-		return FALSE;
-	}
+static GpStatus
+gdip_region_bands_ensure (GpRegion *region)
+{
+	if (region->bands || (region->cnt == 0))
+		return Ok;
 
-	rslt->X = lowest->X; rslt->Y = lowest->Y;
-	rslt->Width = lowest->Width; rslt->Height = lowest->Height;
-	return TRUE;
+	return gdip_region_band_from_rects (region->rects, region->cnt, FALSE, &region->bands, &region->band_cnt);
 }
 
 void 
 gdip_clear_region (GpRegion *region)
 {
 	region->type = RegionTypeInfinite;
+	gdip_region_bands_invalidate (region);
 
 	if (region->rects) {
 		GdipFree (region->rects);
@@ -327,6 +236,8 @@ gdip_copy_region (GpRegion *source, GpRegion *dest)
 	GpStatus status;
 
 	dest->type = source->type;
+	dest->bands = NULL;
+	dest->band_cnt = 0;
 
 	if (source->rects) {
 		dest->cnt = source->cnt;
@@ -387,6 +298,7 @@ gdip_region_convert_to_path (GpRegion *region)
 		GdipAddPathRectangle (region->tree->path, rect->X, rect->Y, rect->Width, rect->Height);
 	}
 
+	gdip_region_bands_invalidate (region);
 	if (region->rects) {
 		GdipFree (region->rects);
 		region->rects = NULL;
@@ -603,518 +515,28 @@ GdipSetEmpty (GpRegion *region)
 	return Ok;
 }
 
-/* pre-process negative width and height, without modifying the originals, see bug #383878 */
-static void
-gdip_normalize_rectangle (GpRectF *rect, GpRectF *normalized)
-{
-	if (rect->Width < 0) {
-		normalized->X = rect->X + rect->Width;
-		normalized->Width = fabs (rect->Width);
-	} else {
-		normalized->X = rect->X;
-		normalized->Width = rect->Width;
-	}
-
-	if (rect->Height < 0) {
-		normalized->Y = rect->Y + rect->Height;
-		normalized->Height = fabs (rect->Height);
-	} else {
-		normalized->Y = rect->Y;
-		normalized->Height = rect->Height;
-	}
-}
-
-/* Exclude */
-static GpStatus
-gdip_combine_exclude (GpRegion *region, GpRectF *rtrg, int cntt)
-{
-	GpRectF *allsrcrects = NULL, *rects = NULL;
-	GpRectF *alltrgrects = NULL, *rect, *rectop, *recttrg;
-	int allsrccnt = 0, cnt = 0, i, n, alltrgcnt = 0;
-	GpRectF current, rslt, newrect;
-	BOOL storecomplete;
-	GpStatus status;
-
-	/* Create the list of source rectangles to process, it will contain splitted ones later */
-	for (i = 0, rect = region->rects; i < region->cnt; i++, rect++) {
-		status = gdip_add_rect_to_array (&allsrcrects, &allsrccnt, rect);
-		if (status != Ok) {
-			if (allsrcrects) {
-				GdipFree (allsrcrects);
-			}
-
-			return status;
-		}
-	}
-
-	/* Create the list of target rectangles to process, it will contain splitted ones later */
-	for (i = 0, rect = rtrg; i < cntt; i++, rect++) {
-		/* normalize */
-		GpRectF normal;
-		gdip_normalize_rectangle (rect, &normal);
-		status = gdip_add_rect_to_array (&alltrgrects, &alltrgcnt, &normal);
-		if (status != Ok) {
-			if (alltrgrects) {
-				GdipFree (alltrgrects);
-			}
-
-			return status;
-		}
-	}
-
-	/* Init current with the first element in the array */
-	current.X = REGION_INFINITE_POSITION - 1;
-	current.Y = REGION_INFINITE_POSITION - 1;
-	current.Width = 0; current.Height = 0;
-
-	while (gdip_getlowestrect (allsrcrects, allsrccnt, &current, &rslt)) {
-		current.X = rslt.X; current.Y = rslt.Y;
-		current.Width = rslt.Width; current.Height = rslt.Height;
-		storecomplete = TRUE;
-
-		/* Current rect with lowest y and X against the target ones */
-		for (i = 0, recttrg = alltrgrects; i < alltrgcnt; i++, recttrg++) {
-
-			if (gdip_intersects (&current, recttrg) == FALSE
-				|| gdip_equals (&current, recttrg) == TRUE ||
-				recttrg->Height < 0 || recttrg->Width < 0) {
-				continue;
-			}
-
-			/* Once a rect is splitted, we do not want to take into account anymore */
-			for (rectop = allsrcrects, n = 0; n < allsrccnt; n++, rectop++) {
-				if (gdip_equals (&current, rectop)) {
-					rectop->X = 0; rectop->Y = 0;
-					rectop->Width = 0; rectop->Height = 0;
-					break;
-				}
-			}
-
-			/* Result rect */
-			newrect.Y = current.Y;
-			if (current.Y >= recttrg->Y) {  /* Our rect intersects in the upper part with another rect */
-				newrect.Height = MIN (recttrg->Y + recttrg->Height - current.Y, current.Height);
-				if (newrect.Height < 0)
-					newrect.Height = current.Height;
-
-				if (current.X >= recttrg->X) { /* Hit from behind */
-					newrect.X = recttrg->X + recttrg->Width;
-					newrect.Width = MAX (current.X + current.Width - newrect.X, 0);
-				}
-				else {
-					newrect.X = current.X;
-					newrect.Width = MAX (recttrg->X - current.X, 0);
-				}
-			}
-			else {
-				newrect.Height = MIN (recttrg->Y - current.Y, current.Height);
-				newrect.X = current.X;
-				newrect.Width = current.Width;
-			}
-
-			gdip_add_rect_to_array_notcontained (&rects, &cnt, &newrect);
-
-			/* What's left to process from the source region */
-			if (current.Y >= recttrg->Y) {  /* Our rect intersects in the upper part with another rect */
-				/* A whole part from the top has been taken*/
-				if (recttrg->X <= current.X && recttrg->X + recttrg->Width  >= current.X + current.Width)
-					rslt.Y = recttrg->Y + recttrg->Height;
-				else
-					rslt.Y = newrect.Y + newrect.Height;
-
-				rslt.Height = current.Y  + current.Height - rslt.Y;
-			}
-			else {
-				rslt.Y = recttrg->Y;
-				rslt.Height = current.Y + current.Height - recttrg->Y;
-			}
-
-			rslt.X = current.X;
-			rslt.Width = current.Width;
-
-			if (rslt.Height > 0 && rslt.Width > 0) {
-				status = gdip_add_rect_to_array (&allsrcrects, &allsrccnt,  &rslt);
-				if (status != Ok) {
-					GdipFree (allsrcrects);
-					GdipFree (alltrgrects);
-
-					return status;
-				}
-			}
-
-			/* Special case where our rect is hit and split in two parts IIIUIII */
-			if (recttrg->X >= current.X && recttrg->X + recttrg->Width  <= current.X + current.Width) {
-				/* Generate extra right rect, keep previous values of Y and Height */
-				newrect.Width = current.X + current.Width - (recttrg->X + recttrg->Width);
-				newrect.X = recttrg->X + recttrg->Width;
-				gdip_add_rect_to_array_notcontained (&rects, &cnt, &newrect);
-			}
-
-			storecomplete = FALSE;
-			break;
-		}
-
-		/* don't include a rectangle identical to the excluded one! */
-		if (storecomplete && !gdip_equals (rtrg, &current)) {
-			gdip_add_rect_to_array_notcontained (&rects, &cnt,  &current);
-		}
-	}
-
-	GdipFree (allsrcrects);
-	GdipFree (alltrgrects);
-	if (region->rects)
-		GdipFree (region->rects);
-
-	region->rects = rects;
-	region->cnt = cnt;
-
-	return Ok;
-}
-
-
 /*
-	Complement: the part of the second region not shared with the first region.
-	Scans the region to be combined and store the rects not present in the region
-*/
-static GpStatus
-gdip_combine_complement (GpRegion *region, GpRectF *rtrg, int cntt)
-{
-	GpRegion regsrc;
-	GpRectF* trg, *rect;
-	GpRectF* allsrcrects = NULL;
-	int allsrccnt = 0, i,  trgcnt;
-	GpStatus status;
-
-	/* Create the list of source rectangles to process */
-	for (i = 0, rect = rtrg; i < cntt; i++, rect++) {
-		/* normalize */
-		GpRectF normal;
-		gdip_normalize_rectangle (rect, &normal);
-		status = gdip_add_rect_to_array (&allsrcrects, &allsrccnt, &normal);
-		if (status != Ok) {
-			goto error;
-		}
-	}
-
-	regsrc.rects = allsrcrects;
-	regsrc.cnt = allsrccnt;
-	trg = region->rects;
-	trgcnt = region->cnt;
-
-	status = gdip_combine_exclude (&regsrc, trg, trgcnt);
-	if (status != Ok) {
-		goto error;
-	}
-
-	if ((regsrc.rects != allsrcrects) || (regsrc.cnt != allsrccnt)) {
-		if (region->rects)
-			GdipFree (region->rects);
-
-		region->rects = regsrc.rects;
-		region->cnt = regsrc.cnt;
-	}
-
-	return Ok;
-
-error:
-	if (allsrcrects)
-		GdipFree (allsrcrects);
-	
-	return status;
-}
-
-
-/* Union */
-static GpStatus
-gdip_combine_union (GpRegion *region, GpRectF *rtrg, int cnttrg)
-{
-	GpRectF *allrects = NULL, *rects = NULL;
-	GpRectF *recttrg, *rect, *rectop;
-	int allcnt = 0, cnt = 0, i, n;
-	GpRectF current, rslt, newrect;
-	BOOL storecomplete, contained;
-	GpStatus status;
-
-	/* All the src and trg rects in a single array*/
-	for (i = 0, rect = region->rects; i < region->cnt; i++, rect++) {
-		status = gdip_add_rect_to_array (&allrects, &allcnt,  rect);
-		if (status != Ok) {
-			if (allrects)
-				GdipFree (allrects);
-
-			return status;
-		}
-	}
-
-	for (i = 0, rect = rtrg; i < cnttrg; i++, rect++) {
-		/* normalize */
-		GpRectF normal;
-		gdip_normalize_rectangle (rect, &normal);
-		status = gdip_add_rect_to_array (&allrects, &allcnt, &normal);
-		if (status != Ok) {
-			if (allrects)
-				GdipFree (allrects);
-
-			return status;
-		}
-	}
-
-	if (allcnt == 0) {
-		GdipFree (allrects);
-		return Ok;
-	}
-
-	/* Init current with the first element in the array */
-	current.X = REGION_INFINITE_POSITION;
-	current.Y = REGION_INFINITE_POSITION;
-	current.Width = 0; current.Height = 0;
-
-	while (gdip_getlowestrect (allrects, allcnt, &current, &rslt)) {
-
-		current.X = rslt.X; current.Y = rslt.Y;
-		current.Width = rslt.Width; current.Height = rslt.Height;
-		storecomplete = TRUE;
-
-		/* Current rect with lowest y and X againt the stored ones */
-		for (i = 0, recttrg = allrects; i < allcnt; i++, recttrg++) {
-
-			/* If it has lower coordinates it has been already processed */
-			if (current.Y > recttrg->Y ||
-				(current.Y == recttrg->Y && current.X > recttrg->X)) {
-				continue;
-			}
-
-			if (gdip_intersects (&current, recttrg) == FALSE
-				|| gdip_equals (&current, recttrg) == TRUE ||
-				recttrg->Height < 0 || recttrg->Width < 0) {
-				continue;
-			}
-
-			if (gdip_contains  (recttrg, &current) == TRUE) {
-				continue;
-			}
-
-			/* Once a rect is splitted, we do not want to take into account anymore */
-			for (rectop = allrects, n = 0; n < allcnt; n++, rectop++) {
-				if (gdip_equals (&current, rectop)) {
-					rectop->X = 0; rectop->Y = 0;
-					rectop->Width = 0; rectop->Height = 0;
-					break;
-				}
-			}
-
-			/* Our rect intersects in the lower part with another rect */
-			newrect.Y = current.Y;
-			if (current.Y == recttrg->Y) {
-				newrect.X = MIN (current.X, recttrg->X);
-				newrect.Width = MAX (current.X + current.Width, recttrg->X + recttrg->Width) - newrect.X;
-				newrect.Height = MIN (current.Height, recttrg->Height);
-			}
-			else {
-				newrect.X = current.X;
-				newrect.Width = current.Width;
-				newrect.Height = recttrg->Y - current.Y;
-
-				/* If it's contained inside, get the > height */
-				if (recttrg->X >= current.X && recttrg->X + recttrg->Width <= current.X + current.Width)
-					newrect.Height = MAX (current.Height, recttrg->Height);
-			}
-
-			gdip_add_rect_to_array_notcontained (&rects, &cnt, &newrect);
-
-			/* Push what's left from the current the rect in the list of rects to process
-			 if it's already not contained in other rects except the current (we just split from there) */
-			rslt.X = current.X;
-			rslt.Y = newrect.Y + newrect.Height;
-			rslt.Width = current.Width;
-			rslt.Height = current.Height - newrect.Height;
-
-			contained = FALSE;
-			for (rectop = allrects, n = 0; n < allcnt; n++, rectop++) {
-				if (gdip_equals (rectop, &current)) /* If it's contained with the current does not count */
-					continue;
-
-				if (gdip_contains (&rslt, rectop)) {
-					contained = TRUE;
-					break;
-				}
-			}
-
-			if (contained == FALSE && rslt.Height > 0 && rslt.Width > 0) {
-				status = gdip_add_rect_to_array (&allrects, &allcnt,  &rslt);
-				if (status != Ok) {
-					GdipFree (allrects);
-					return status;
-				}
-
-				recttrg = allrects;
-			}
-
-			/* If both we at the same Y when take into account the X also to process the following
-			   that exceeds the X also */
-			if (recttrg->Y == current.Y) {
-				if (recttrg->Height <= current.Height) { /* Takes all part */
-					recttrg->Width = recttrg->X + recttrg->Width - (recttrg->X + recttrg->Width);
-					recttrg->X = newrect.X + newrect.Width;
-					recttrg->Y += newrect.Height;
-					recttrg->Height -= newrect.Height;
-				} else {
-					if (newrect.X + newrect.Width >= recttrg->X + recttrg->Width) {
-						recttrg->Y += newrect.Height;
-						recttrg->Height -= newrect.Height;
-					}
-				}
-			}
-
-			/* If it's contained inside, get the > height  */
-			if (recttrg->X >= current.X && recttrg->X + recttrg->Width <= current.X + current.Width) {
-				recttrg->Height = MAX (recttrg->Y + recttrg->Height - (current.Y + current.Height), 0);
-				recttrg->Y = newrect.Y + newrect.Height;
-			}
-
-			storecomplete = FALSE;
-			break;
-		}
-
-		if (storecomplete) {
-			gdip_add_rect_to_array_notcontained (&rects, &cnt,  &current);
-		}
-
-	}
-
-	GdipFree (allrects);
-	if (region->rects)
-		GdipFree (region->rects);
-
-	region->rects = rects;
-	region->cnt = cnt;
-
-	return Ok;
-}
-
-/* Intersect */
-static GpStatus
-gdip_combine_intersect (GpRegion *region, GpRectF *rtrg, int cnttrg)
-{
-	GpRectF *rectsrc;
-	int src, trg;
-	GpRectF rectcur;
-	GpRegion regunion;
-	GpRectF *recttrg;
-	GpStatus status;
-
-	regunion.rects = NULL;
-	regunion.cnt = 0;
-
-	for (rectsrc = region->rects, src = 0; src < region->cnt; src++, rectsrc++) {
-		for (recttrg = rtrg, trg = 0; trg < cnttrg; trg++, recttrg++) {
-			/* normalize */
-			GpRectF normal;
-			gdip_normalize_rectangle (recttrg, &normal);
-
-			/* Intersects With */
-			if ((rectsrc->X >= normal.X + normal.Width) || (rectsrc->X + rectsrc->Width <= normal.X) ||
-				(rectsrc->Y >= normal.Y + normal.Height) || (rectsrc->Y + rectsrc->Height <= normal.Y)) {
-				continue;
-			}
-			/* Area that intersects */
-			rectcur.X = rectsrc->X > normal.X ? rectsrc->X : normal.X;
-			rectcur.Y = rectsrc->Y > normal.Y ? rectsrc->Y : normal.Y;
-			rectcur.Width = rectsrc->X + rectsrc->Width < normal.X + normal.Width ?
-				rectsrc->X + rectsrc->Width - rectcur.X : normal.X + normal.Width - rectcur.X;
-
-			rectcur.Height = rectsrc->Y + rectsrc->Height < normal.Y + normal.Height ?
-				rectsrc->Y + rectsrc->Height - rectcur.Y : normal.Y + normal.Height - rectcur.Y;
-
-			/* Combine with previous areas that intersect with rect */
-			status = gdip_combine_union (&regunion, &rectcur, 1);
-			if (status != Ok)
-				return status;
-		}
-	}
-
-	if (region->rects)
-		GdipFree (region->rects);
-
-	region->rects = regunion.rects;
-	region->cnt = regunion.cnt;
-
-	return Ok;
-}
-
-/* Xor */
+ * Combine the (rectangle-based) region with the rectangles, the result is banded (see region-band.h)
+ * so GdipGetRegionScans can return it as-is.
+ */
 static GpStatus
-gdip_combine_xor (GpRegion *region, GpRectF *recttrg, int cnttrg)
+gdip_combine_rects (GpRegion *region, GDIPCONST GpRectF *rects, int count, CombineMode combineMode)
 {
-	GpRegion *rgnsrc = NULL;  /* All rectangles of both regions*/
-	GpRegion *rgntrg = NULL;  /* Only the ones that intersect*/
-	GpRectF *allrects = NULL, *rect;
-	int allcnt = 0, i;
-	GpStatus status;
-
-	/* All the src and trg rects in a single array*/
-	for (i = 0, rect = region->rects; i < region->cnt; i++, rect++) {
-		status = gdip_add_rect_to_array (&allrects, &allcnt,  rect);
-		if (status != Ok)
-			goto error;
-	}
-
-	for (i = 0, rect = recttrg; i < cnttrg; i++, rect++) {
-		/* normalize */
-		GpRectF normal;
-		gdip_normalize_rectangle (rect, &normal);
-		status = gdip_add_rect_to_array (&allrects, &allcnt, &normal);
-		if (status != Ok)
-			goto error;
-	}
-
-	rgnsrc = (GpRegion *) GdipAlloc (sizeof (GpRegion));
-	if (!rgnsrc) {
-		status = OutOfMemory;
-		goto error;
-	}
-
-	rgnsrc->type = RegionTypeRect;
-	rgnsrc->cnt = allcnt;
-	rgnsrc->rects = allrects;
-
-	status = GdipCloneRegion (region, &rgntrg);
+	GpRectF *result;
+	int resultCount;
+	GpStatus status = gdip_region_band_combine (region->rects, region->cnt, rects, count, combineMode, &result, &resultCount);
 	if (status != Ok)
-		goto error;
-
-	status = gdip_combine_intersect (rgntrg, recttrg, cnttrg);
-	if (status != Ok)
-		goto error;
-
-	/* exclude the intersecting rectangles (if any) */
-	if (rgntrg->cnt > 0) {
-		status = gdip_combine_exclude (rgnsrc, rgntrg->rects, rgntrg->cnt);
-		if (status != Ok)
-			goto error;
-	}
+		return status;
 
+	gdip_region_bands_invalidate (region);
 	if (region->rects)
 		GdipFree (region->rects);
 
-	region->rects = rgnsrc->rects;
-	region->cnt = rgnsrc->cnt;
-
-	GdipFree (rgnsrc);
-	GdipDeleteRegion (rgntrg);
-
+	region->rects = result;
+	region->cnt = resultCount;
 	return Ok;
-
-error:
-	if (allrects)
-		GdipFree (allrects);
-
-	GdipFree (rgnsrc);
-	GdipDeleteRegion (rgntrg);
-
-	return status;
 }
 
-
 GpStatus WINGDIPAPI
 GdipCombineRegionRect (GpRegion *region, GDIPCONST GpRectF *rect, CombineMode combineMode)
 {
@@ -1133,15 +555,11 @@ GdipCombineRegionRect (GpRegion *region, GDIPCONST GpRectF *rect, CombineMode co
 	case RegionTypeRect: {
 		switch (combineMode) {
 		case CombineModeExclude:
-			return gdip_combine_exclude (region, (GpRectF *) rect, 1);
 		case CombineModeComplement:
-			return gdip_combine_complement (region, (GpRectF *) rect, 1);
 		case CombineModeIntersect:
-			return gdip_combine_intersect (region, (GpRectF *) rect, 1);
 		case CombineModeUnion:
-			return gdip_combine_union (region, (GpRectF *) rect, 1);
 		case CombineModeXor:
-			return gdip_combine_xor (region, (GpRectF *) rect, 1);
+			return gdip_combine_rects (region, rect, 1, combineMode);
 		case CombineModeReplace: /* Used by Graphics clipping */
 			return gdip_add_rect_to_array (&region->rects, &region->cnt, (GpRectF *)rect);
 		default:
@@ -1471,19 +889,15 @@ GdipCombineRegionRegion (GpRegion *region,  GpRegion *region2, CombineMode combi
 	}
 
 	/* at this stage we are sure that BOTH region and region2 are rectangle 
-	 * based, so we can use the old rectangle-based code to combine regions
+	 * based, so we can use the banded rectangle code to combine regions
 	 */
 	switch (combineMode) {
 	case CombineModeExclude:
-		return gdip_combine_exclude (region, region2->rects, region2->cnt);
 	case CombineModeComplement:
-		return gdip_combine_complement (region, region2->rects, region2->cnt);
 	case CombineModeIntersect:
-		return gdip_combine_intersect (region, region2->rects, region2->cnt);
 	case CombineModeUnion:
-		return gdip_combine_union (region, region2->rects, region2->cnt);
 	case CombineModeXor:
-		return gdip_combine_xor (region, region2->rects, region2->cnt);
+		return gdip_combine_rects (region, region2->rects, region2->cnt, combineMode);
 	default:
 		return NotImplemented;
 	}
@@ -1554,12 +968,19 @@ GdipIsInfiniteRegion (GpRegion *region, GpGraphics *graphics, BOOL *result)
 GpStatus WINGDIPAPI
 GdipIsVisibleRegionPoint (GpRegion *region, float x, float y, GpGraphics *graphics, BOOL *result)
 {
+	GpStatus status;
+
 	if (!region || !result)
 		return InvalidParameter;
 
 	switch (region->type) {
 	case RegionTypeRect:
-		*result = gdip_is_Point_in_RectFs_Visible (x, y, region->rects, region->cnt);
+		/* hit testing is repeated on the same region, so its banded copy is kept */
+		status = gdip_region_bands_ensure (region);
+		if (status != Ok)
+			return status;
+
+		*result = gdip_region_band_is_point_visible (region->bands, region->band_cnt, x, y);
 		break;
 	case RegionTypePath:
 		gdip_region_bitmap_ensure (region);
@@ -1586,7 +1007,7 @@ GdipIsVisibleRegionPointI (GpRegion *region, int x, int y, GpGraphics *graphics,
 GpStatus WINGDIPAPI
 GdipIsVisibleRegionRect (GpRegion *region, float x, float y, float width, float height, GpGraphics *graphics, BOOL *result)
 {
-	BOOL found = FALSE;
+	GpStatus status;
 
 	if (!region || !result)
 		return InvalidParameter;
@@ -1598,18 +1019,13 @@ GdipIsVisibleRegionRect (GpRegion *region, float x, float y, float width, float
 
 	switch (region->type) {
 	case RegionTypeRect: {
-		float posy, posx;
 		GpRectF recthit = {x, y, width, height};
 
-		/* Any point of intersection ?*/
-		for (posy = 0; posy < recthit.Height && found == FALSE; posy++) {
-			for (posx = 0; posx < recthit.Width ; posx++) {
-				if (gdip_is_Point_in_RectFs_Visible (recthit.X + posx , recthit.Y + posy, region->rects, region->cnt) == TRUE) {
-					*result = TRUE;
-					break;
-				}
-			}
-		}
+		status = gdip_region_bands_ensure (region);
+		if (status != Ok)
+			return status;
+
+		*result = gdip_region_band_is_rect_visible (region->bands, region->band_cnt, &recthit);
 		break;
 	}
 	case RegionTypePath: {
@@ -1637,6 +1053,31 @@ GdipIsVisibleRegionRectI (GpRegion *region, int x, int y, int width, int height,
 }
 
 
+/* the scans of a rectangle-based region are its rectangles, banded (see region-band.h) */
+static GpStatus
+gdip_region_get_rect_scans (GpRegion *region, GpRectF *rects, int *count)
+{
+	GpStatus status;
+
+	/* regions created from combinations are already banded */
+	if (gdip_region_band_is_valid (region->rects, region->cnt)) {
+		if (rects)
+			memcpy (rects, region->rects, sizeof (GpRectF) * region->cnt);
+		*count = region->cnt;
+		return Ok;
+	}
+
+	/* otherwise the banded copy is kept, like for the visibility tests */
+	status = gdip_region_bands_ensure (region);
+	if (status != Ok)
+		return status;
+
+	if (rects && region->bands)
+		memcpy (rects, region->bands, sizeof (GpRectF) * region->band_cnt);
+	*count = region->band_cnt;
+	return Ok;
+}
+
 GpStatus WINGDIPAPI
 GdipGetRegionScansCount (GpRegion *region, UINT *count, GpMatrix *matrix)
 {
@@ -1681,13 +1122,19 @@ GdipGetRegionScansCount (GpRegion *region, UINT *count, GpMatrix *matrix)
 	}
 
 	switch (work->type) {
-	case RegionTypeRect:
-		*count = work->cnt;
+	case RegionTypeRect: {
+		int scans;
+
+		status = gdip_region_get_rect_scans (work, NULL, &scans);
+		if (status == Ok)
+			*count = scans;
 		break;
+	}
 	case RegionTypePath:
 		/* ensure the bitmap is usable */
 		gdip_region_bitmap_ensure (work);
 		*count = gdip_region_bitmap_get_scans (work->bitmap, NULL);
+		status = Ok;
 		break;
 	default:
 		g_warning ("unknown type 0x%08X", region->type);
@@ -1697,7 +1144,7 @@ GdipGetRegionScansCount (GpRegion *region, UINT *count, GpMatrix *matrix)
 	/* delete the clone */
 	if (work != region)
 		GdipDeleteRegion (work);
-	return Ok;
+	return status;
 }
 
 GpStatus WINGDIPAPI
@@ -1743,16 +1190,15 @@ GdipGetRegionScans (GpRegion *region, GpRectF* rects, int* count, GpMatrix* matr
 		work = region;
 	}
 
-	switch (region->type) {
+	switch (work->type) {
 	case RegionTypeRect:
-		if (rects)
-			memcpy (rects, work->rects, sizeof (GpRectF) * work->cnt);
-		*count = work->cnt;
+		status = gdip_region_get_rect_scans (work, rects, count);
 		break;
 	case RegionTypePath:
 		/* ensure the bitmap is usable */
 		gdip_region_bitmap_ensure (work);
 		*count = gdip_region_bitmap_get_scans (work->bitmap, rects);
+		status = Ok;
 		break;
 	default:
 		g_warning ("unknown type 0x%08X", region->type);
@@ -1762,7 +1208,7 @@ GdipGetRegionScans (GpRegion *region, GpRectF* rects, int* count, GpMatrix* matr
 	/* delete the clone */
 	if (work != region)
 		GdipDeleteRegion (work);
-	return Ok;
+	return status;
 }
 
 GpStatus WINGDIPAPI
@@ -1843,15 +1289,20 @@ GdipTranslateRegion (GpRegion *region, float dx, float dy)
 			rect->X += dx;
 			rect->Y += dy;
 		}
+		gdip_region_bands_invalidate (region);
 
 		break;
 	}
 	case RegionTypePath:
 		gdip_region_translate_tree (region->tree, dx, dy);
-		/* any existing bitmap is still valid _if_ we update it's origin */
+		/* any existing bitmap is still valid _if_ we update it's origin, by whole pixels */
 		if (region->bitmap) {
-			region->bitmap->X += dx;
-			region->bitmap->Y += dy;
+			if ((dx == floorf (dx)) && (dy == floorf (dy))) {
+				region->bitmap->X += (int) dx;
+				region->bitmap->Y += (int) dy;
+			} else {
+				gdip_region_bitmap_invalidate (region);
+			}
 		}
 
 		break;
@@ -1869,25 +1320,49 @@ GdipTranslateRegionI (GpRegion *region, int dx, int dy)
 	return GdipTranslateRegion (region, dx, dy);
 }
 
-/* this call doesn't exists in GDI+ */
-static GpStatus
-ScaleRegion (GpRegion *region, float sx, float sy)
+/*
+ * Rectangles stay rectangles when they are scaled (even mirrored) and translated, or when they are also
+ * rotated by a multiple of 90 degrees, i.e. when the matrix has either no shear/rotation or no scale part.
+ */
+static BOOL
+gdip_matrix_keeps_rectangles (GpMatrix *matrix)
 {
-	if (!region)
-		return InvalidParameter;
+	return ((matrix->xy == 0.0f) && (matrix->yx == 0.0f)) || ((matrix->xx == 0.0f) && (matrix->yy == 0.0f));
+}
 
-	if ((region->type == RegionTypeRect) && region->rects) {
-		int i;
-		GpRectF *rect;
-		for (i = 0, rect = region->rects ; i < region->cnt; i++, rect++) {
-			rect->X *= sx;
-			rect->Y *= sy;
-			rect->Width *= sx;
-			rect->Height *= sy;
+static void
+gdip_region_transform_rects (GpRegion *region, GpMatrix *matrix)
+{
+	/* a quarter turn swaps the horizontal and vertical sides */
+	BOOL swap = (matrix->xx == 0.0f) && (matrix->yy == 0.0f);
+	float sx = swap ? matrix->xy : matrix->xx;
+	float sy = swap ? matrix->yx : matrix->yy;
+	GpRectF *rect;
+	int i;
+
+	for (i = 0, rect = region->rects; i < region->cnt; i++, rect++) {
+		float x = swap ? rect->Y : rect->X;
+		float y = swap ? rect->X : rect->Y;
+		float width = swap ? rect->Height : rect->Width;
+		float height = swap ? rect->Width : rect->Height;
+
+		rect->X = x * sx + matrix->x0;
+		rect->Y = y * sy + matrix->y0;
+		rect->Width = width * sx;
+		rect->Height = height * sy;
+
+		/* mirrored rectangles are flipped back, so the empty ones (negative size) stay empty */
+		if (sx < 0) {
+			rect->X += rect->Width;
+			rect->Width = -rect->Width;
+		}
+		if (sy < 0) {
+			rect->Y += rect->Height;
+			rect->Height = -rect->Height;
 		}
 	}
 
-	return Ok;
+	gdip_region_bands_invalidate (region);
 }
 
 GpStatus WINGDIPAPI
@@ -1914,27 +1389,18 @@ GdipTransformRegion (GpRegion *region, GpMatrix *matrix)
 
 	/* try to avoid heavy stuff (e.g. conversion to path, invalidating 
 	 * bitmap...) if the transform is:
-	 * - a translation + scale operations (for rectangle ebased region)
-	 * - only to do a scale operation (for a rectangle based region)
+	 * - any combination of translation, scale, mirroring and quarter turns (for rectangle based region)
 	 * - only to do a simple translation (for both rectangular and bitmap based regions)
 	 */
-	if ((matrix->xy == 0.0f) && (matrix->yx == 0.0f)) {
-		BOOL s = (((matrix->xx != 1.0f) || (matrix->yy != 1.0f)) && (region->type == RegionTypeRect));
-		BOOL t = ((matrix->x0 != 0.0f) || (matrix->yx != 0.0f));
-		if (s) {
-			status = ScaleRegion (region, 
-				gdip_matrix_get_x_scale (matrix), 
-				gdip_matrix_get_y_scale (matrix));
-		}
-		if (t && (status == Ok)) {
-			status = GdipTranslateRegion (region, 
-				gdip_matrix_get_x_translation (matrix), 
-				gdip_matrix_get_y_translation (matrix));
+	if (region->type == RegionTypeRect) {
+		if (gdip_matrix_keeps_rectangles (matrix)) {
+			gdip_region_transform_rects (region, matrix);
+			return Ok;
 		}
-
-		/* return now if we could optimize the transform (to avoid bitmaps) */
-		if (t || s)
-			return status;
+	} else if ((matrix->xx == 1.0f) && (matrix->yy == 1.0f) && (matrix->xy == 0.0f) && (matrix->yx == 0.0f)) {
+		return GdipTranslateRegion (region,
+			gdip_matrix_get_x_translation (matrix),
+			gdip_matrix_get_y_translation (matrix));
 	}
 
 	/* most matrix operations would change the rectangles into path so we always preempt this */
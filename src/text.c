@@ -34,6 +34,7 @@
 #endif
 
 #include "text-metafile-private.h"
+#include "graphics-deferred-private.h"
 
 /*
  * Text API - validate and delegate
@@ -43,6 +44,7 @@ GpStatus WINGDIPAPI
 GdipDrawString (GpGraphics *graphics, GDIPCONST WCHAR *string, int length, GDIPCONST GpFont *font, GDIPCONST RectF *layoutRect, 
 	GDIPCONST GpStringFormat *stringFormat, GpBrush *brush)
 {
+	GpStatus status;
 	GDIPCONST WCHAR *ptr = NULL;
 
 	if (length == 0) {
@@ -60,6 +62,11 @@ GdipDrawString (GpGraphics *graphics, GDIPCONST WCHAR *string, int length, GDIPC
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
+		status = gdip_deferred_flush (graphics);
+		if (status != Ok)
+			return status;
+		/* fall through */
 	case GraphicsBackEndCairo:
 		return text_DrawString (graphics, string, length, font, layoutRect, stringFormat, brush);
 	case GraphicsBackEndMetafile:
@@ -107,6 +114,7 @@ GdipMeasureString (GpGraphics *graphics, GDIPCONST WCHAR *string, int length, GD
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 	/* a metafile-based graphics returns the correct measures but doesn't record anything */
 	case GraphicsBackEndMetafile:
@@ -136,6 +144,7 @@ GdipMeasureCharacterRanges (GpGraphics *graphics, GDIPCONST WCHAR *string, int l
 		return InvalidParameter;
 
 	switch (graphics->backend) {
+	case GraphicsBackEndDeferred:
 	case GraphicsBackEndCairo:
 	/* a metafile-based graphics returns the correct measures but doesn't record anything */
 	case GraphicsBackEndMetafile:
@@ -156,6 +156,46 @@ gdip_tiff_size (thandle_t clientData)
 	return (toff_t)((gdip_tiff_clientData *) clientData)->sizeFunc ();
 }
 
+/* the client data of the images read from memory is their MemorySource */
+static tsize_t
+gdip_tiff_memread (thandle_t clientData, tdata_t buffer, tsize_t size)
+{
+	return (tsize_t) gdip_memory_source_read ((MemorySource *) clientData, buffer, size);
+}
+
+static toff_t
+gdip_tiff_memseek (thandle_t clientData, toff_t offSet, int whence)
+{
+	MemorySource *ms = (MemorySource *) clientData;
+	toff_t pos;
+
+	switch (whence) {
+	case SEEK_SET:
+		pos = offSet;
+		break;
+	case SEEK_CUR:
+		pos = ms->pos + offSet;
+		break;
+	case SEEK_END:
+		pos = ms->size + offSet;
+		break;
+	default:
+		return -1;
+	}
+
+	if (pos > (toff_t) ms->size)
+		return -1;
+
+	ms->pos = pos;
+	return pos;
+}
+
+static toff_t
+gdip_tiff_memsize (thandle_t clientData)
+{
+	return ((MemorySource *) clientData)->size;
+}
+
 static int
 gdip_tiff_dummy_map (thandle_t clientData, tdata_t *phase, toff_t* size)
 {
@@ -1277,6 +1317,18 @@ gdip_load_tiff_image_from_stream_delegate (GetBytesDelegate getBytesFunc,
 	return gdip_load_tiff_image (tif, image);
 }
 
+GpStatus
+gdip_load_tiff_image_from_memory (MemorySource *memory, GpImage **image)
+{
+	TIFF *tif;
+
+	tif = TIFFClientOpen ("<memory>", "r", (thandle_t) memory, gdip_tiff_memread,
+				gdip_tiff_read_none, gdip_tiff_memseek, gdip_tiff_close,
+				gdip_tiff_memsize, gdip_tiff_dummy_map, gdip_tiff_dummy_unmap);
+
+	return gdip_load_tiff_image (tif, image);
+}
+
 GpStatus
 gdip_save_tiff_image_to_stream_delegate (GetBytesDelegate getBytesFunc,
 					PutBytesDelegate putBytesFunc,
@@ -1335,6 +1387,13 @@ gdip_load_tiff_image_from_stream_delegate (GetBytesDelegate getBytesFunc,
 	return UnknownImageFormat;
 }
 
+GpStatus
+gdip_load_tiff_image_from_memory (MemorySource *memory, GpImage **image)
+{
+	*image = NULL;
+	return UnknownImageFormat;
+}
+
 GpStatus 
 gdip_save_tiff_image_to_file (BYTE *filename, GpImage *image, GDIPCONST EncoderParameters *params)
 {
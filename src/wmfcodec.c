@@ -147,26 +147,27 @@ Polyline (MetafilePlayContext *context, BYTE *data)
 #ifdef DEBUG_WMF
 	printf ("Polyline %d points", num);
 #endif
-	SHORT x1 = GETS(WP2);
-	SHORT y1 = GETS(WP3);
-	int n = 4;
-	for (p = 1; p < num; p++) {
-		SHORT x2 = GETS(WP(n));
+	if (num <= 0)
+		return Ok;
+
+	GpPointF *points = (GpPointF*) GdipAlloc (num * sizeof (GpPointF));
+	if (!points)
+		return OutOfMemory;
+
+	int n = 2;
+	for (p = 0; p < num; p++) {
+		points [p].X = GETS(WP(n));
 		n++;
-		SHORT y2 = GETS(WP(n));
+		points [p].Y = GETS(WP(n));
 		n++;
 #ifdef DEBUG_WMF_2
-		printf ("\n\tdraw from %d,%d to %d,%d", x1, y1, x2, y2);
+		printf ("\n\tline to %g,%g", points [p].X, points [p].Y);
 #endif
-		GpPen *pen = gdip_metafile_GetSelectedPen (context);
-		status = GdipDrawLine (context->graphics, pen, x1, y1, x2, y2);
-		if (status != Ok)
-			return status;
-
-		x1 = x2;
-		y1 = y2;
 	}
-	return Ok;
+
+	status = gdip_metafile_Polyline (context, points, num);
+	GdipFree (points);
+	return status;
 }
 
 /* http://wvware.sourceforge.net/caolan/PolyPolygon.html */
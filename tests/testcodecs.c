@@ -23,6 +23,13 @@ using namespace DllExports;
 #include <stdlib.h>
 #include "testhelpers.h"
 
+#if !defined(USE_WINDOWS_GDIPLUS)
+static CLSID rawEncoderClsid = { 0xd528dae9, 0x5f17, 0x4b1e, { 0xaf, 0x8c, 0x59, 0x98, 0x6a, 0xbc, 0xe9, 0x4d } };
+static GUID rawRawFormat = { 0xfff1322bU, 0x9c89U, 0x4ce1U, { 0x86, 0xcf, 0x79, 0x9c, 0x5f, 0x82, 0xf0, 0xbb } };
+static BYTE rawSigPattern[] = {'G', 'D', 'I', 'P', 'R', 'A', 'W', 0x1A};
+static BYTE rawSigMask[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+#endif
+
 #define verifyImageCodecInfo(codec, expectedClsid, expectedFormatID, expectedCodecName, expectedFormatDescription, expectedFilenameExtension, expectedMimeType, expectedFlags, expectedVersion, expectedSigCount, expectedSigPattern, expectedSigMask) \
 { \
     assertEqualGuid (codec.Clsid, expectedClsid); \
@@ -48,7 +55,12 @@ static void test_getImageDecodersSize ()
 
     status = GdipGetImageDecodersSize (&numDecoders, &size);
     assertEqualInt (status, Ok);
+#if defined(USE_WINDOWS_GDIPLUS)
     assertEqualInt (numDecoders, 8);
+#else
+    // libgdiplus also has the RAW codec.
+    assertEqualInt (numDecoders, 9);
+#endif
     //assertEqualInt (size, 8 * sizeof (ImageCodecInfo));
 
     // Negative tests.
@@ -107,6 +119,10 @@ static void test_getImageDecoders ()
     BYTE icoSigMask[] = {0xFF, 0xFF, 0xFF, 0xFF};
     verifyImageCodecInfo (codecs[7], icoEncoderClsid, icoRawFormat, "Built-in ICO Codec", "ICO", "*.ICO", "image/x-icon", ImageCodecFlagsDecoder | ImageCodecFlagsSupportBitmap | ImageCodecFlagsBuiltin, 1, 1, icoSigPattern, icoSigMask);
 
+#if !defined(USE_WINDOWS_GDIPLUS)
+    verifyImageCodecInfo (codecs[8], rawEncoderClsid, rawRawFormat, "Built-in RAW Codec", "RAW", "*.GDIPRAW", "image/x-gdiplus-raw", ImageCodecFlagsEncoder | ImageCodecFlagsDecoder | ImageCodecFlagsSupportBitmap | ImageCodecFlagsBuiltin, 1, 1, rawSigPattern, rawSigMask);
+#endif
+
     // Negative tests.
     status = GdipGetImageDecoders (0, size, codecs);
     assertEqualInt (status, GenericError);
@@ -140,7 +156,12 @@ static void test_getImageEncodersSize ()
 
     status = GdipGetImageEncodersSize (&numEncoders, &size);
     assertEqualInt (status, Ok);
+#if defined(USE_WINDOWS_GDIPLUS)
     assertEqualInt (numEncoders, 5);
+#else
+    // libgdiplus also has the RAW codec.
+    assertEqualInt (numEncoders, 6);
+#endif
     //assertEqualInt (size, 5 * sizeof (ImageCodecInfo));
 
     // Negative tests.
@@ -187,6 +208,10 @@ static void test_getImageEncoders ()
     BYTE pngSigMask[] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
     verifyImageCodecInfo (codecs[4], pngEncoderClsid, pngRawFormat, "Built-in PNG Codec", "PNG", "*.PNG", "image/png", ImageCodecFlagsEncoder | ImageCodecFlagsDecoder | ImageCodecFlagsSupportBitmap | ImageCodecFlagsBuiltin, 1, 1, pngSigPattern, pngSigMask);
 
+#if !defined(USE_WINDOWS_GDIPLUS)
+    verifyImageCodecInfo (codecs[5], rawEncoderClsid, rawRawFormat, "Built-in RAW Codec", "RAW", "*.GDIPRAW", "image/x-gdiplus-raw", ImageCodecFlagsEncoder | ImageCodecFlagsDecoder | ImageCodecFlagsSupportBitmap | ImageCodecFlagsBuiltin, 1, 1, rawSigPattern, rawSigMask);
+#endif
+
     // Negative tests.
     status = GdipGetImageEncoders (0, size, codecs);
     assertEqualInt (status, GenericError);
@@ -212,6 +237,90 @@ static void test_getImageEncoders ()
     free (codecs);
 }
 
+static void verifyLoadedFormat (const char *fileName, GUID expectedRawFormat)
+{
+    GpStatus status;
+    WCHAR *filePath;
+    GpImage *image;
+    GUID rawFormat;
+
+    filePath = createWchar (fileName);
+    status = GdipLoadImageFromFile (filePath, &image);
+    assertEqualInt (status, Ok);
+    freeWchar (filePath);
+
+    status = GdipGetImageRawFormat (image, &rawFormat);
+    assertEqualInt (status, Ok);
+    assertEqualGuid (rawFormat, expectedRawFormat);
+
+    GdipDisposeImage (image);
+}
+
+static void createSniffFile (const BYTE *data, size_t size)
+{
+    FILE *f = fopen ("temp_sniff.img", "wb");
+    assert (f);
+    fwrite ((void *) data, sizeof (BYTE), size, f);
+    fclose (f);
+}
+
+static void test_signatureSniffing ()
+{
+    GpStatus status;
+    WCHAR *filePath;
+    GpImage *image;
+    FILE *f;
+    BYTE *icon;
+    long iconSize;
+    BYTE unknown[] = {'n', 'o', 't', ' ', 'a', 'n', ' ', 'i', 'm', 'a', 'g', 'e'};
+    BYTE bmpPrefix[] = {0x42};
+    int i;
+
+    // Every format is found from the data, whatever the order they are loaded in.
+    for (i = 0; i < 2; i++) {
+        verifyLoadedFormat ("test.bmp", bmpRawFormat);
+        verifyLoadedFormat ("test.jpg", jpegRawFormat);
+        verifyLoadedFormat ("test.gif", gifRawFormat);
+        verifyLoadedFormat ("test.png", pngRawFormat);
+        verifyLoadedFormat ("test.tif", tifRawFormat);
+        verifyLoadedFormat ("test.ico", icoRawFormat);
+        verifyLoadedFormat ("test.wmf", wmfRawFormat);
+        verifyLoadedFormat ("test.emf", emfRawFormat);
+    }
+    verifyLoadedFormat ("test.emf", emfRawFormat);
+    verifyLoadedFormat ("test.png", pngRawFormat);
+    verifyLoadedFormat ("test.png", pngRawFormat);
+    verifyLoadedFormat ("test.bmp", bmpRawFormat);
+
+    // A cursor matches no codec signature, only the icon fallback one.
+    f = fopen ("test.ico", "rb");
+    assert (f);
+    fseek (f, 0, SEEK_END);
+    iconSize = ftell (f);
+    fseek (f, 0, SEEK_SET);
+    icon = (BYTE *) malloc (iconSize);
+    assertEqualInt (fread (icon, sizeof (BYTE), iconSize, f), iconSize);
+    fclose (f);
+    icon[2] = 0x02;
+    createSniffFile (icon, iconSize);
+    verifyLoadedFormat ("temp_sniff.img", icoRawFormat);
+    free (icon);
+
+    // No signature matches the data.
+    filePath = createWchar ("temp_sniff.img");
+    createSniffFile (unknown, sizeof (unknown));
+    status = GdipLoadImageFromFile (filePath, &image);
+    assertEqualInt (status, OutOfMemory);
+
+    // Only the first byte of a signature matches.
+    createSniffFile (bmpPrefix, sizeof (bmpPrefix));
+    status = GdipLoadImageFromFile (filePath, &image);
+    assertEqualInt (status, OutOfMemory);
+
+    freeWchar (filePath);
+    remove ("temp_sniff.img");
+}
+
 int
 main (int argc, char**argv)
 {
@@ -221,6 +330,7 @@ main (int argc, char**argv)
     test_getImageDecoders ();
     test_getImageEncodersSize ();
     test_getImageEncoders ();
+    test_signatureSniffing ();
 
     SHUTDOWN;
 	return 0;
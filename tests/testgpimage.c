@@ -228,6 +228,125 @@ static void test_cloneImage ()
 	GdipDisposeImage (metafileImage);
 }
 
+static void test_cloneImageIsIndependent ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpImage *clonedImage;
+	GpImage *secondClone;
+	GpGraphics *graphics;
+	GpSolidFill *brush;
+	BitmapData data;
+	Rect rect = {0, 0, 4, 2};
+	ARGB color;
+
+	GdipCreateBitmapFromScan0 (4, 2, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipBitmapSetPixel (bitmap, 0, 0, 0xFF112233);
+
+	// Writing to the clone doesn't change the original.
+	status = GdipCloneImage (bitmap, &clonedImage);
+	assertEqualInt (status, Ok);
+	GdipBitmapSetPixel ((GpBitmap *) clonedImage, 0, 0, 0xFF445566);
+	GdipBitmapGetPixel (bitmap, 0, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+	GdipBitmapGetPixel ((GpBitmap *) clonedImage, 0, 0, &color);
+	assertEqualInt (color, 0xFF445566);
+
+	// Writing to the original doesn't change the clone.
+	status = GdipCloneImage (bitmap, &secondClone);
+	assertEqualInt (status, Ok);
+	GdipBitmapSetPixel (bitmap, 1, 0, 0xFF778899);
+	GdipBitmapGetPixel ((GpBitmap *) secondClone, 1, 0, &color);
+	assertEqualInt (color, 0x00000000);
+
+	// LockBits.
+	status = GdipBitmapLockBits ((GpBitmap *) secondClone, &rect, ImageLockModeWrite, PixelFormat32bppARGB, &data);
+	assertEqualInt (status, Ok);
+	memset (data.Scan0, 0xFF, data.Stride * data.Height);
+	GdipBitmapUnlockBits ((GpBitmap *) secondClone, &data);
+	GdipBitmapGetPixel ((GpBitmap *) secondClone, 0, 1, &color);
+	assertEqualInt (color, 0xFFFFFFFF);
+	GdipBitmapGetPixel (bitmap, 0, 1, &color);
+	assertEqualInt (color, 0x00000000);
+	GdipDisposeImage (secondClone);
+
+	// RotateFlip.
+	status = GdipCloneImage (bitmap, &secondClone);
+	assertEqualInt (status, Ok);
+	GdipImageRotateFlip (secondClone, RotateNoneFlipX);
+	GdipBitmapGetPixel ((GpBitmap *) secondClone, 3, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+	GdipBitmapGetPixel (bitmap, 0, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+	GdipBitmapGetPixel (bitmap, 3, 0, &color);
+	assertEqualInt (color, 0x00000000);
+	GdipDisposeImage (secondClone);
+
+	// Graphics.
+	status = GdipCloneImage (bitmap, &secondClone);
+	assertEqualInt (status, Ok);
+	GdipGetImageGraphicsContext (secondClone, &graphics);
+	GdipCreateSolidFill (0xFF0000FF, &brush);
+	GdipFillRectangleI (graphics, brush, 0, 0, 4, 2);
+	GdipDeleteGraphics (graphics);
+	GdipDeleteBrush (brush);
+	GdipBitmapGetPixel ((GpBitmap *) secondClone, 2, 1, &color);
+	assertEqualInt (color, 0xFF0000FF);
+	GdipBitmapGetPixel (bitmap, 2, 1, &color);
+	assertEqualInt (color, 0x00000000);
+	GdipDisposeImage (secondClone);
+
+	// The clone outlives the original.
+	GdipDisposeImage (bitmap);
+	GdipBitmapGetPixel ((GpBitmap *) clonedImage, 0, 0, &color);
+	assertEqualInt (color, 0xFF445566);
+	GdipDisposeImage (clonedImage);
+}
+
+static void test_cloneImageDrawnWithAttributes ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpBitmap *target;
+	GpImage *clonedImage;
+	GpGraphics *graphics;
+	GpImageAttributes *attributes;
+	ARGB color;
+
+	GdipCreateBitmapFromScan0 (4, 2, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipBitmapSetPixel (bitmap, 0, 0, 0xFF112233);
+	status = GdipCloneImage (bitmap, &clonedImage);
+	assertEqualInt (status, Ok);
+
+	// The attributes are applied to a temporary copy of the pixels, which is flipped while tiling.
+	GdipCreateBitmapFromScan0 (16, 8, 0, PixelFormat32bppARGB, NULL, &target);
+	GdipGetImageGraphicsContext (target, &graphics);
+	GdipCreateImageAttributes (&attributes);
+	GdipSetImageAttributesGamma (attributes, ColorAdjustTypeDefault, TRUE, 2.0f);
+	GdipSetImageAttributesWrapMode (attributes, WrapModeTileFlipXY, 0, FALSE);
+	status = GdipDrawImageRectRectI (graphics, bitmap, 0, 0, 16, 8, 0, 0, 4, 2, UnitPixel, attributes, NULL, NULL);
+	assertEqualInt (status, Ok);
+	GdipDeleteGraphics (graphics);
+	GdipDisposeImageAttributes (attributes);
+	GdipDisposeImage (target);
+
+	// The original and its clone still share the same, unchanged, pixels.
+	GdipBitmapGetPixel (bitmap, 0, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+	GdipBitmapGetPixel ((GpBitmap *) clonedImage, 0, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+
+	// And are still copied before a write.
+	GdipBitmapSetPixel (bitmap, 0, 0, 0xFF445566);
+	GdipBitmapGetPixel ((GpBitmap *) clonedImage, 0, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+
+	GdipDisposeImage (bitmap);
+	GdipBitmapGetPixel ((GpBitmap *) clonedImage, 0, 0, &color);
+	assertEqualInt (color, 0xFF112233);
+	GdipDisposeImage (clonedImage);
+}
+
 static void test_disposeImage ()
 {
 	GpStatus status;
@@ -924,6 +1043,43 @@ static void test_getFrameCount ()
 	GdipDisposeImage (metafileImage);
 }
 
+static void test_getFrameCountForEachDimension ()
+{
+	const char *files[] = {"test.bmp", "test.gif", "test.ico", "test.png", "test.tif", "test.wmf", "test.emf"};
+	int i;
+
+	// Every listed dimension has frames, and its last frame can be selected.
+	for (i = 0; i < sizeof (files) / sizeof (files[0]); i++) {
+		GpStatus status;
+		GpImage *image = getImage (files[i]);
+		GUID *dimensions;
+		UINT dimensionsCount;
+		UINT count;
+		UINT j;
+
+		status = GdipImageGetFrameDimensionsCount (image, &dimensionsCount);
+		assertEqualInt (status, Ok);
+		assert (dimensionsCount >= 1);
+
+		dimensions = (GUID *) malloc (dimensionsCount * sizeof (GUID));
+		status = GdipImageGetFrameDimensionsList (image, dimensions, dimensionsCount);
+		assertEqualInt (status, Ok);
+
+		for (j = 0; j < dimensionsCount; j++) {
+			count = 0;
+			status = GdipImageGetFrameCount (image, &dimensions[j], &count);
+			assertEqualInt (status, Ok);
+			assert (count >= 1);
+
+			status = GdipImageSelectActiveFrame (image, &dimensions[j], count - 1);
+			assertEqualInt (status, Ok);
+		}
+
+		free (dimensions);
+		GdipDisposeImage (image);
+	}
+}
+
 static void test_selectActiveFrame ()
 {
 	GpStatus status;
@@ -964,6 +1120,97 @@ static void test_selectActiveFrame ()
 	GdipDisposeImage (metafileImage);
 }
 
+static void test_selectActiveFrameIconResolution ()
+{
+#if !defined(USE_WINDOWS_GDIPLUS)
+	GpStatus status;
+	GpImage *image = getImage ("test.ico");
+	GpImage *clonedImage;
+	GUID pageDimension = {0x7462dc86, 0x6180, 0x4c7e, {0x8e, 0x3f, 0xee, 0x73, 0x33, 0xa7, 0xa4, 0x83}};
+	GUID resolutionDimension = {0x84236f7b, 0x3bd3, 0x428f, {0x8d, 0xab, 0x4e, 0xa1, 0x43, 0x9c, 0xa3, 0x15}};
+	UINT count;
+	UINT index;
+	ARGB pageColor;
+	ARGB resolutionColor;
+
+	GUID dimensions[1];
+
+	// The icon holds a 256x256 PNG and a 48x48 bitmap, only the last one is a page (like GDI+).
+	status = GdipImageGetFrameDimensionsCount (image, &count);
+	assertEqualInt (status, Ok);
+	assertEqualInt (count, 1);
+
+	status = GdipImageGetFrameDimensionsList (image, dimensions, 1);
+	assertEqualInt (status, Ok);
+	assert (memcmp (&dimensions[0], &pageDimension, sizeof (GUID)) == 0);
+
+	status = GdipImageGetFrameCount (image, &pageDimension, &count);
+	assertEqualInt (status, Ok);
+	assertEqualInt (count, 1);
+
+	// The resolution dimension isn't listed, so it isn't counted either.
+	status = GdipImageGetFrameCount (image, &resolutionDimension, &count);
+	assertEqualInt (status, Win32Error);
+
+	// Both images can still be selected thru it.
+	status = GdipImageGetResolutionCount_linux (image, &count);
+	assertEqualInt (status, Ok);
+	assertEqualInt (count, 2);
+
+	// Resolutions are sorted by size.
+	status = GdipImageGetBestFrameForSize_linux (image, 16, 16, &index);
+	assertEqualInt (status, Ok);
+	assertEqualInt (index, 0);
+
+	status = GdipImageGetBestFrameForSize_linux (image, 48, 64, &index);
+	assertEqualInt (status, Ok);
+	assertEqualInt (index, 1);
+
+	status = GdipImageGetBestFrameForSize_linux (image, 512, 512, &index);
+	assertEqualInt (status, Ok);
+	assertEqualInt (index, 1);
+
+	GdipBitmapGetPixel ((GpBitmap *) image, 24, 24, &pageColor);
+
+	status = GdipCloneImage (image, &clonedImage);
+	assertEqualInt (status, Ok);
+
+	status = GdipImageSelectActiveFrame (image, &resolutionDimension, 1);
+	assertEqualInt (status, Ok);
+	verifyBitmap (image, icoRawFormat, PixelFormat32bppARGB, 256, 256, ImageFlagsColorSpaceRGB | ImageFlagsHasRealPixelSize | ImageFlagsHasAlpha | ImageFlagsReadOnly, 0, TRUE);
+
+	status = GdipImageSelectActiveFrame (image, &resolutionDimension, 0);
+	assertEqualInt (status, Ok);
+	verifyBitmap (image, icoRawFormat, PixelFormat32bppARGB, 48, 48, ImageFlagsColorSpaceRGB | ImageFlagsHasRealPixelSize | ImageFlagsHasAlpha | ImageFlagsReadOnly, 0, TRUE);
+	GdipBitmapGetPixel ((GpBitmap *) image, 24, 24, &resolutionColor);
+	assertEqualInt (resolutionColor, pageColor);
+
+	// Frames of the clone are decoded on their own.
+	status = GdipImageSelectActiveFrame (clonedImage, &resolutionDimension, 1);
+	assertEqualInt (status, Ok);
+	verifyBitmap (clonedImage, icoRawFormat, PixelFormat32bppARGB, 256, 256, ImageFlagsColorSpaceRGB | ImageFlagsHasRealPixelSize | ImageFlagsHasAlpha | ImageFlagsReadOnly, 0, TRUE);
+
+	// Negative tests.
+	status = GdipImageGetBestFrameForSize_linux (NULL, 16, 16, &index);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipImageGetBestFrameForSize_linux (image, 0, 16, &index);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipImageGetBestFrameForSize_linux (image, 16, 16, NULL);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipImageGetResolutionCount_linux (NULL, &count);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipImageGetResolutionCount_linux (image, NULL);
+	assertEqualInt (status, InvalidParameter);
+
+	GdipDisposeImage (clonedImage);
+	GdipDisposeImage (image);
+#endif
+}
+
 static void test_forceValidation ()
 {
 	GpStatus status;
@@ -1612,6 +1859,70 @@ static void test_setPropertyItem()
 	GdipDisposeImage (metafileImage);
 }
 
+static void test_setManyPropertyItems ()
+{
+	GpStatus status;
+	GpImage *bmpImage = getImage ("test.bmp");
+	GpImage *jpgImage = getImage ("test.jpg");
+	PropertyItem propertyItem = {0, 0, PropertyTagTypeShort, NULL};
+	PropertyItem resultPropertyItem;
+	PROPID propertyIds[40];
+	UINT numProperties;
+	UINT jpgProperties;
+	int i;
+
+	for (i = 0; i < 40; i++) {
+		propertyItem.id = 100 + i;
+		status = GdipSetPropertyItem (bmpImage, &propertyItem);
+		assertEqualInt (status, Ok);
+	}
+
+	status = GdipGetPropertyIdList (bmpImage, 40, propertyIds);
+	assertEqualInt (status, Ok);
+	for (i = 0; i < 40; i++)
+		assertEqualInt (propertyIds[i], 100 + i);
+
+	status = GdipRemovePropertyItem (bmpImage, 105);
+	assertEqualInt (status, Ok);
+	status = GdipRemovePropertyItem (bmpImage, 139);
+	assertEqualInt (status, Ok);
+
+	status = GdipGetPropertyCount (bmpImage, &numProperties);
+	assertEqualInt (status, Ok);
+	assertEqualInt (numProperties, 38);
+
+	status = GdipGetPropertyItem (bmpImage, 105, sizeof (PropertyItem), &resultPropertyItem);
+	assertEqualInt (status, PropertyNotFound);
+
+	// The items after a removed one can still be found.
+	propertyItem.id = 120;
+	propertyItem.type = PropertyTagTypeLong;
+	status = GdipSetPropertyItem (bmpImage, &propertyItem);
+	assertEqualInt (status, Ok);
+	status = GdipGetPropertyItem (bmpImage, 120, sizeof (PropertyItem), &resultPropertyItem);
+	assertEqualInt (status, Ok);
+	assertEqualInt (resultPropertyItem.type, PropertyTagTypeLong);
+
+	status = GdipGetPropertyIdList (bmpImage, 38, propertyIds);
+	assertEqualInt (status, Ok);
+	assertEqualInt (propertyIds[4], 104);
+	assertEqualInt (propertyIds[5], 106);
+	assertEqualInt (propertyIds[37], 138);
+
+	// A property set before the metadata is read comes after the metadata of the file.
+	status = GdipSetPropertyItem (jpgImage, &propertyItem);
+	assertEqualInt (status, Ok);
+	status = GdipGetPropertyCount (jpgImage, &jpgProperties);
+	assertEqualInt (status, Ok);
+	assertEqualInt (jpgProperties, 3);
+	status = GdipGetPropertyIdList (jpgImage, jpgProperties, propertyIds);
+	assertEqualInt (status, Ok);
+	assertEqualInt (propertyIds[2], 120);
+
+	GdipDisposeImage (bmpImage);
+	GdipDisposeImage (jpgImage);
+}
+
 int
 main (int argc, char**argv)
 {
@@ -1629,6 +1940,8 @@ main (int argc, char**argv)
 	test_loadImageFromFileWmf ();
 	test_loadImageFromFileEmf ();
 	test_cloneImage ();
+	test_cloneImageIsIndependent ();
+	test_cloneImageDrawnWithAttributes ();
 	test_disposeImage ();
 	test_getImageGraphicsContext ();
 	test_getImageBounds ();
@@ -1647,7 +1960,9 @@ main (int argc, char**argv)
 	test_getFrameDimensionsCount ();
 	test_getFrameDimensionsList ();
 	test_getFrameCount ();
+	test_getFrameCountForEachDimension ();
 	test_selectActiveFrame ();
+	test_selectActiveFrameIconResolution ();
 	test_forceValidation ();
 	test_rotateFlip ();
 	test_getImagePalette ();
@@ -1661,6 +1976,7 @@ main (int argc, char**argv)
 	test_getAllPropertyItems ();
 	test_removePropertyItem ();
 	test_setPropertyItem ();
+	test_setManyPropertyItems ();
 
 	SHUTDOWN;
 	return 0;
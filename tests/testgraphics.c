@@ -1993,6 +1993,290 @@ static void test_translateClipI ()
 	GdipDisposeImage (image);
 }
 
+static void checkVisibleClip (GpGraphics *graphics)
+{
+	BOOL visible;
+
+	GdipIsVisiblePoint (graphics, 15, 25, &visible);
+	assertEqualInt (visible, TRUE);
+	GdipIsVisiblePoint (graphics, 39.5, 59.5, &visible);
+	assertEqualInt (visible, TRUE);
+	GdipIsVisiblePoint (graphics, 5, 25, &visible);
+	assertEqualInt (visible, FALSE);
+	GdipIsVisiblePoint (graphics, 40, 30, &visible);
+	assertEqualInt (visible, FALSE);
+	GdipIsVisiblePoint (graphics, 25, 60, &visible);
+	assertEqualInt (visible, FALSE);
+
+	GdipIsVisibleRect (graphics, 0, 0, 15, 25, &visible);
+	assertEqualInt (visible, TRUE);
+	GdipIsVisibleRect (graphics, 35, 55, 20, 20, &visible);
+	assertEqualInt (visible, TRUE);
+	GdipIsVisibleRect (graphics, 0, 0, 10, 20, &visible);
+	assertEqualInt (visible, FALSE);
+	GdipIsVisibleRect (graphics, 40, 20, 10, 40, &visible);
+	assertEqualInt (visible, FALSE);
+	GdipIsVisibleRect (graphics, 60, 70, 10, 10, &visible);
+	assertEqualInt (visible, FALSE);
+}
+
+static void test_isVisibleClip ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpGraphics *graphics;
+	GpPath *path;
+	BOOL visible;
+
+	GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipGetImageGraphicsContext (bitmap, &graphics);
+
+	// No clip, only the bounds.
+	status = GdipIsVisiblePoint (graphics, 50, 50, &visible);
+	assertEqualInt (status, Ok);
+	assertEqualInt (visible, TRUE);
+	status = GdipIsVisiblePoint (graphics, 150, 50, &visible);
+	assertEqualInt (status, Ok);
+	assertEqualInt (visible, FALSE);
+	status = GdipIsVisibleRect (graphics, 90, 90, 20, 20, &visible);
+	assertEqualInt (status, Ok);
+	assertEqualInt (visible, TRUE);
+
+	// A pixel aligned rectangle and the same area as a path give the same answers.
+	status = GdipSetClipRect (graphics, 10, 20, 30, 40, CombineModeReplace);
+	assertEqualInt (status, Ok);
+	checkVisibleClip (graphics);
+
+	GdipCreatePath (FillModeAlternate, &path);
+	GdipAddPathRectangle (path, 10, 20, 30, 40);
+	status = GdipSetClipPath (graphics, path, CombineModeReplace);
+	assertEqualInt (status, Ok);
+	checkVisibleClip (graphics);
+
+	// The same with a world transform, the clip is set in world coordinates.
+	GdipTranslateWorldTransform (graphics, 5, 7, MatrixOrderAppend);
+	status = GdipSetClipRect (graphics, 10, 20, 30, 40, CombineModeReplace);
+	assertEqualInt (status, Ok);
+	checkVisibleClip (graphics);
+
+	status = GdipSetClipPath (graphics, path, CombineModeReplace);
+	assertEqualInt (status, Ok);
+	checkVisibleClip (graphics);
+
+	// The clip set before the transform moves with it.
+	GdipResetWorldTransform (graphics);
+	status = GdipSetClipRect (graphics, 10, 20, 30, 40, CombineModeReplace);
+	assertEqualInt (status, Ok);
+	GdipTranslateWorldTransform (graphics, 5, 7, MatrixOrderAppend);
+	GdipIsVisiblePoint (graphics, 6, 14, &visible);
+	assertEqualInt (visible, TRUE);
+	GdipIsVisiblePoint (graphics, 36, 25, &visible);
+	assertEqualInt (visible, FALSE);
+
+	// Inside of the bounds of a non rectangular clip, but outside of the clip.
+	GdipResetWorldTransform (graphics);
+	GdipResetPath (path);
+	GdipAddPathEllipse (path, 10, 20, 30, 40);
+	status = GdipSetClipPath (graphics, path, CombineModeReplace);
+	assertEqualInt (status, Ok);
+	GdipIsVisiblePoint (graphics, 25, 40, &visible);
+	assertEqualInt (visible, TRUE);
+	GdipIsVisiblePoint (graphics, 11, 21, &visible);
+	assertEqualInt (visible, FALSE);
+
+	GdipDeletePath (path);
+	GdipDeleteGraphics (graphics);
+	GdipDisposeImage ((GpImage *) bitmap);
+}
+
+#if !defined(USE_WINDOWS_GDIPLUS)
+static void test_deferredRendering ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpGraphics *graphics;
+	GpSolidFill *white;
+	GpSolidFill *red;
+	GpSolidFill *blue;
+	BOOL deferred;
+	ARGB color;
+
+	GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipGetImageGraphicsContext (bitmap, &graphics);
+	GdipCreateSolidFill (0xFFFFFFFF, &white);
+	GdipCreateSolidFill (0xFFFF0000, &red);
+	GdipCreateSolidFill (0xFF0000FF, &blue);
+
+	// Disabled by default.
+	status = GdipGetDeferredRendering_linux (graphics, &deferred);
+	assertEqualInt (status, Ok);
+	assertEqualInt (deferred, FALSE);
+
+	status = GdipSetDeferredRendering_linux (graphics, TRUE);
+	assertEqualInt (status, Ok);
+	status = GdipGetDeferredRendering_linux (graphics, &deferred);
+	assertEqualInt (status, Ok);
+	assertEqualInt (deferred, TRUE);
+
+	// The fills are queued until the graphics is flushed.
+	GdipFillRectangleI (graphics, blue, 0, 0, 100, 100);
+	GdipFillRectangleI (graphics, white, 0, 0, 100, 100);
+	GdipFillRectangleI (graphics, red, 10, 10, 20, 20);
+	GdipFillRectangleI (graphics, red, 40, 10, 20, 20);
+	GdipFillEllipseI (graphics, blue, 10, 60, 30, 30);
+	GdipBitmapGetPixel (bitmap, 50, 50, &color);
+	assertEqualInt (color, 0);
+
+	status = GdipFlush (graphics, FlushIntentionFlush);
+	assertEqualInt (status, Ok);
+	GdipBitmapGetPixel (bitmap, 5, 5, &color);
+	assertEqualInt (color, 0xFFFFFFFF);
+	GdipBitmapGetPixel (bitmap, 20, 20, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 50, 20, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 35, 20, &color);
+	assertEqualInt (color, 0xFFFFFFFF);
+	GdipBitmapGetPixel (bitmap, 25, 75, &color);
+	assertEqualInt (color, 0xFF0000FF);
+	GdipBitmapGetPixel (bitmap, 11, 61, &color);
+	assertEqualInt (color, 0xFFFFFFFF);
+
+	// Queued fills are drawn with the transform current when they were queued.
+	GdipFillRectangleI (graphics, red, 70, 70, 10, 10);
+	GdipTranslateWorldTransform (graphics, -60, -60, MatrixOrderPrepend);
+	GdipFillRectangleI (graphics, blue, 70, 70, 10, 10);
+
+	// Disabling draws the queued fills.
+	status = GdipSetDeferredRendering_linux (graphics, FALSE);
+	assertEqualInt (status, Ok);
+	GdipBitmapGetPixel (bitmap, 75, 75, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 15, 15, &color);
+	assertEqualInt (color, 0xFF0000FF);
+	status = GdipGetDeferredRendering_linux (graphics, &deferred);
+	assertEqualInt (status, Ok);
+	assertEqualInt (deferred, FALSE);
+
+	// Negative tests.
+	status = GdipSetDeferredRendering_linux (NULL, TRUE);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipGetDeferredRendering_linux (NULL, &deferred);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipGetDeferredRendering_linux (graphics, NULL);
+	assertEqualInt (status, InvalidParameter);
+
+	GdipDeleteBrush ((GpBrush *) white);
+	GdipDeleteBrush ((GpBrush *) red);
+	GdipDeleteBrush ((GpBrush *) blue);
+	GdipDeleteGraphics (graphics);
+	GdipDisposeImage ((GpImage *) bitmap);
+}
+
+static BOOL isBitmapEmpty (GpBitmap *bitmap, INT width, INT height)
+{
+	INT x;
+	INT y;
+	ARGB color;
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			GdipBitmapGetPixel (bitmap, x, y, &color);
+			if (color != 0)
+				return FALSE;
+		}
+	}
+	return TRUE;
+}
+
+static void test_culledPrimitives ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpGraphics *graphics;
+	GpSolidFill *red;
+	GpPen *pen;
+	UINT count;
+	ARGB color;
+
+	GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipGetImageGraphicsContext (bitmap, &graphics);
+	GdipCreateSolidFill (0xFFFF0000, &red);
+	GdipCreatePen1 (0xFFFF0000, 10, UnitPixel, &pen);
+
+	status = GdipGetGraphicsCulledPrimitiveCount_linux (graphics, &count);
+	assertEqualInt (status, Ok);
+	assertEqualInt (count, 0);
+
+	// Outside of the image.
+	status = GdipFillRectangleI (graphics, red, 200, 200, 10, 10);
+	assertEqualInt (status, Ok);
+	status = GdipFillEllipseI (graphics, red, -50, 10, 20, 20);
+	assertEqualInt (status, Ok);
+	status = GdipDrawLineI (graphics, pen, 10, 200, 90, 200);
+	assertEqualInt (status, Ok);
+	assert (isBitmapEmpty (bitmap, 100, 100));
+	GdipGetGraphicsCulledPrimitiveCount_linux (graphics, &count);
+	assertEqualInt (count, 3);
+
+	// The pen width is part of the bounds.
+	status = GdipDrawLineI (graphics, pen, 10, 103, 90, 103);
+	assertEqualInt (status, Ok);
+	GdipBitmapGetPixel (bitmap, 50, 99, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 50, 97, &color);
+	assertEqualInt (color, 0);
+	GdipGetGraphicsCulledPrimitiveCount_linux (graphics, &count);
+	assertEqualInt (count, 3);
+
+	// Inside of the image, but outside of the clip.
+	GdipGraphicsClear (graphics, 0);
+	GdipSetClipRectI (graphics, 0, 0, 50, 50, CombineModeReplace);
+	status = GdipFillRectangleI (graphics, red, 60, 60, 10, 10);
+	assertEqualInt (status, Ok);
+	assert (isBitmapEmpty (bitmap, 100, 100));
+	GdipGetGraphicsCulledPrimitiveCount_linux (graphics, &count);
+	assertEqualInt (count, 4);
+
+	// The bounds are transformed before being compared with the clip.
+	GdipTranslateWorldTransform (graphics, 50, 50, MatrixOrderPrepend);
+	status = GdipFillRectangleI (graphics, red, -20, -20, 10, 10);
+	assertEqualInt (status, Ok);
+	status = GdipFillRectangleI (graphics, red, 20, 20, 10, 10);
+	assertEqualInt (status, Ok);
+	GdipBitmapGetPixel (bitmap, 35, 35, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 75, 75, &color);
+	assertEqualInt (color, 0);
+	GdipGetGraphicsCulledPrimitiveCount_linux (graphics, &count);
+	assertEqualInt (count, 5);
+
+	// Partially inside of the clip.
+	status = GdipFillRectangleI (graphics, red, -5, -55, 20, 10);
+	assertEqualInt (status, Ok);
+	GdipBitmapGetPixel (bitmap, 47, 0, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 55, 0, &color);
+	assertEqualInt (color, 0);
+	GdipGetGraphicsCulledPrimitiveCount_linux (graphics, &count);
+	assertEqualInt (count, 5);
+
+	// Negative tests.
+	status = GdipGetGraphicsCulledPrimitiveCount_linux (NULL, &count);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipGetGraphicsCulledPrimitiveCount_linux (graphics, NULL);
+	assertEqualInt (status, InvalidParameter);
+
+	GdipDeletePen (pen);
+	GdipDeleteBrush ((GpBrush *) red);
+	GdipDeleteGraphics (graphics);
+	GdipDisposeImage ((GpImage *) bitmap);
+}
+#endif
+
 int
 main (int argc, char**argv)
 {
@@ -2034,6 +2318,11 @@ main (int argc, char**argv)
 	test_setClipRegion ();
 	test_translateClip ();
 	test_translateClipI ();
+	test_isVisibleClip ();
+#if !defined(USE_WINDOWS_GDIPLUS)
+	test_deferredRendering ();
+	test_culledPrimitives ();
+#endif
 
 	SHUTDOWN;
 	return 0;
@@ -244,6 +244,43 @@ ATTRIBUTE_USED static void verifyMatrixImpl(GpMatrix *matrix, REAL e1, REAL e2,
 
 #define verifyMatrix(matrix, e1, e2, e3, e4, e5, e6) verifyMatrixImpl (matrix, e1, e2, e3, e4, e5, e6, __FILE__, __func__, __LINE__)
 
+// Encoder parameters are variable sized, the returned block (freed with free) holds up to capacity of them.
+ATTRIBUTE_USED static EncoderParameters *createEncoderParameters (UINT capacity)
+{
+    EncoderParameters *params = (EncoderParameters *) malloc (sizeof (EncoderParameters) + (capacity - 1) * sizeof (EncoderParameter));
+    assert (params);
+    params->Count = 0;
+    return params;
+}
+
+ATTRIBUTE_USED static void addEncoderParameterLong (EncoderParameters *params, GUID guid, LONG *value)
+{
+    EncoderParameter *parameter = &params->Parameter[params->Count++];
+
+    parameter->Guid = guid;
+    parameter->NumberOfValues = 1;
+    parameter->Type = EncoderParameterValueTypeLong;
+    parameter->Value = value;
+}
+
+// Returns the content of the file (freed with free), e.g. to check what an encoder wrote.
+ATTRIBUTE_USED static BYTE *readFileBytes (const char *fileName, INT *size)
+{
+    FILE *f = fopen (fileName, "rb");
+    BYTE *data;
+
+    assert (f);
+    fseek (f, 0, SEEK_END);
+    *size = (INT) ftell (f);
+    fseek (f, 0, SEEK_SET);
+
+    data = (BYTE *) malloc (*size);
+    assert (data);
+    assertEqualInt ((INT) fread (data, 1, *size, f), *size);
+    fclose (f);
+    return data;
+}
+
 ATTRIBUTE_USED static CLSID bmpEncoderClsid = { 0x557cf400, 0x1a04, 0x11d3,{ 0x9a, 0x73, 0x0, 0x0, 0xf8, 0x1e, 0xf3, 0x2e } };
 ATTRIBUTE_USED static CLSID tifEncoderClsid = { 0x557cf405, 0x1a04, 0x11d3,{ 0x9a, 0x73, 0x0, 0x0, 0xf8, 0x1e, 0xf3, 0x2e } };
 ATTRIBUTE_USED static CLSID gifEncoderClsid = { 0x557cf402, 0x1a04, 0x11d3,{ 0x9a, 0x73, 0x0, 0x0, 0xf8, 0x1e, 0xf3, 0x2e } };
@@ -79,6 +79,23 @@ static void test_invalidImage ()
 #endif
 }
 
+static void test_validCursor ()
+{
+  GpStatus status;
+  ARGB color;
+  BYTE cursor[] = {0, 0, 2, 0, 1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 56, 0, 0, 0, 22, 0, 0, 0, 40, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 255, 255, 255, 0, 128, 0, 0, 0, 0, 0, 0, 0};
+
+  // Cursors are read as icons, the hotspot is ignored.
+  createFile (cursor, Ok);
+  verifyBitmap (image, icoRawFormat, PixelFormat32bppARGB, 1, 1, ImageFlagsColorSpaceRGB | ImageFlagsHasRealPixelSize | ImageFlagsHasAlpha | ImageFlagsReadOnly, 0, TRUE);
+
+  status = GdipBitmapGetPixel ((GpBitmap *) image, 0, 0, &color);
+  assertEqualInt (status, Ok);
+  assertEqualInt (color, 0xFFFFFFFF);
+
+  GdipDisposeImage (image);
+}
+
 int
 main (int argc, char**argv)
 {
@@ -87,6 +104,9 @@ main (int argc, char**argv)
   test_invalidHeader ();
   test_invalidEntry ();
   test_invalidImage ();
+#if !defined(USE_WINDOWS_GDIPLUS)
+  test_validCursor ();
+#endif
 
   deleteFile (file);
 
@@ -20,6 +20,7 @@ using namespace DllExports;
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #if !defined(USE_WINDOWS_GDIPLUS)
 #include <jpeglib.h>
 #endif
@@ -407,6 +408,155 @@ static void test_units ()
     createFileSuccess (unknownUnit, PixelFormat24bppRGB, 1, 1, ImageFlagsColorSpaceRGB | ImageFlagsHasRealPixelSize | ImageFlagsReadOnly, 2);
 }
 
+#if !defined(USE_WINDOWS_GDIPLUS)
+static GUID qualityGuid = {0x1D5BE4B5U, 0x0FA4AU, 0x452DU, {0x9C, 0x0DD, 0x5D, 0x0B3, 0x51, 0x5, 0x0E7, 0x0EB}};
+static GUID subsamplingGuid = {0x9890C06DU, 0x0D9EU, 0x4EA3U, {0xBA, 0x0C, 0xEE, 0x45, 0x7E, 0x45, 0xC7, 0xF9}};
+static GUID optimizeGuid = {0x48B857B1U, 0xD6DCU, 0x4CD7U, {0x9F, 0x82, 0x52, 0x79, 0x8F, 0x6C, 0x1A, 0x9B}};
+static GUID dctMethodGuid = {0xFF09D8F9U, 0x1A2CU, 0x449FU, {0x8B, 0x77, 0x2C, 0x44, 0xD4, 0xE8, 0xC1, 0xF8}};
+static GUID renderMethodGuid = {0x6D42C53AU, 0x229AU, 0x4825U, {0x8B, 0xB7, 0x5C, 0x99, 0xE2, 0xB9, 0xA8, 0xB8}};
+
+// Saves the bitmap and returns the JPEG data (freed with free).
+static BYTE *saveJpeg (GpBitmap *bitmap, EncoderParameters *params, INT *size)
+{
+    GpStatus status;
+
+    status = GdipSaveImageToFile (bitmap, wFile, &jpegEncoderClsid, params);
+    assertEqualInt (status, Ok);
+    return readFileBytes (file, size);
+}
+
+// Returns the SOFn marker of the frame, the segments are walked up to the first scan.
+static const BYTE *findJpegFrameMarker (const BYTE *data, INT size)
+{
+    INT offset = 2;
+
+    while (offset + 4 <= size && data[offset] == 0xFF) {
+        BYTE marker = data[offset + 1];
+
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+            return data + offset;
+        if (marker == 0xDA)
+            break;
+        offset += 2 + ((data[offset + 2] << 8) | data[offset + 3]);
+    }
+    return NULL;
+}
+
+static void test_saveWithEncoderParameters ()
+{
+    GpStatus status;
+    GpBitmap *bitmap;
+    GpImage *loaded;
+    ARGB color;
+    UINT width;
+    UINT height;
+    INT x;
+    INT y;
+    LONG quality = 90;
+    LONG subsampling = JpegChromaSubsampling444;
+    LONG optimize = 1;
+    LONG dctMethod = JpegDctMethodFastInteger;
+    LONG renderMethod = EncoderValueRenderProgressive;
+    EncoderParameters *params;
+
+    // Use a size that isn't a multiple of the MCU or of the rows written per batch.
+    GdipCreateBitmapFromScan0 (37, 21, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    for (y = 0; y < 21; y++) {
+        for (x = 0; x < 37; x++) {
+            GdipBitmapSetPixel (bitmap, x, y, 0xFF204080);
+        }
+    }
+
+    params = createEncoderParameters (5);
+    addEncoderParameterLong (params, qualityGuid, &quality);
+    addEncoderParameterLong (params, subsamplingGuid, &subsampling);
+    addEncoderParameterLong (params, optimizeGuid, &optimize);
+    addEncoderParameterLong (params, dctMethodGuid, &dctMethod);
+    addEncoderParameterLong (params, renderMethodGuid, &renderMethod);
+
+    status = GdipSaveImageToFile (bitmap, wFile, &jpegEncoderClsid, params);
+    assertEqualInt (status, Ok);
+
+    status = GdipLoadImageFromFile (wFile, &loaded);
+    assertEqualInt (status, Ok);
+
+    GdipGetImageWidth (loaded, &width);
+    GdipGetImageHeight (loaded, &height);
+    assertEqualInt (width, 37);
+    assertEqualInt (height, 21);
+
+    // Lossy, but a flat color must survive within a small tolerance.
+    GdipBitmapGetPixel (loaded, 36, 20, &color);
+    assert (abs ((int) ((color >> 16) & 0xFF) - 0x20) <= 4);
+    assert (abs ((int) ((color >> 8) & 0xFF) - 0x40) <= 4);
+    assert (abs ((int) (color & 0xFF) - 0x80) <= 4);
+    GdipDisposeImage (loaded);
+
+    // Unknown subsampling values are rejected.
+    subsampling = 123;
+    status = GdipSaveImageToFile (bitmap, wFile, &jpegEncoderClsid, params);
+    assertEqualInt (status, InvalidParameter);
+
+    free (params);
+    GdipDisposeImage (bitmap);
+}
+
+static void test_saveEncoderParametersOutput ()
+{
+    GpBitmap *bitmap;
+    BYTE *data;
+    const BYTE *frame;
+    INT size;
+    INT lowQualitySize;
+    INT x;
+    INT y;
+    LONG quality = 20;
+    LONG subsampling = JpegChromaSubsampling444;
+    LONG renderMethod = EncoderValueRenderNonProgressive;
+    EncoderParameters *params;
+
+    // Detailed enough for the quality to matter.
+    GdipCreateBitmapFromScan0 (64, 64, 0, PixelFormat24bppRGB, NULL, &bitmap);
+    for (y = 0; y < 64; y++) {
+        for (x = 0; x < 64; x++) {
+            GdipBitmapSetPixel (bitmap, x, y, 0xFF000000 | (((x * 37) & 0xFF) << 16) | (((y * 91) & 0xFF) << 8) | ((x * y) & 0xFF));
+        }
+    }
+
+    params = createEncoderParameters (3);
+    addEncoderParameterLong (params, qualityGuid, &quality);
+    addEncoderParameterLong (params, subsamplingGuid, &subsampling);
+    addEncoderParameterLong (params, renderMethodGuid, &renderMethod);
+
+    // A baseline frame, with full resolution chroma.
+    data = saveJpeg (bitmap, params, &lowQualitySize);
+    frame = findJpegFrameMarker (data, lowQualitySize);
+    assert (frame);
+    assertEqualInt (frame[1], 0xC0);
+    assertEqualInt (frame[11], 0x11);
+    free (data);
+
+    // A higher quality keeps more details.
+    quality = 95;
+    data = saveJpeg (bitmap, params, &size);
+    assert (size > lowQualitySize);
+    free (data);
+
+    // A progressive frame, with the luma sampled twice as much as the chroma.
+    subsampling = JpegChromaSubsampling420;
+    renderMethod = EncoderValueRenderProgressive;
+    data = saveJpeg (bitmap, params, &size);
+    frame = findJpegFrameMarker (data, size);
+    assert (frame);
+    assertEqualInt (frame[1], 0xC2);
+    assertEqualInt (frame[11], 0x22);
+    free (data);
+
+    free (params);
+    GdipDisposeImage (bitmap);
+}
+#endif
+
 int
 main (int argc, char**argv)
 {
@@ -414,6 +564,10 @@ main (int argc, char**argv)
 
   test_valid ();
   test_units ();
+#if !defined(USE_WINDOWS_GDIPLUS)
+  test_saveWithEncoderParameters ();
+  test_saveEncoderParametersOutput ();
+#endif
 
   deleteFile (file);
 
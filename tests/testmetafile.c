@@ -606,6 +606,557 @@ static void test_recordMetafile ()
     GdipDeleteGraphics (graphics);
 }
 
+#if !defined(USE_WINDOWS_GDIPLUS)
+static void drawMetafileAt (GpMetafile *metafile, GpBitmap *bitmap, REAL scale, REAL offset, TextRenderingHint textRenderingHint)
+{
+    GpGraphics *graphics;
+
+    GdipGetImageGraphicsContext (bitmap, &graphics);
+    GdipGraphicsClear (graphics, 0);
+    GdipSetTextRenderingHint (graphics, textRenderingHint);
+    GdipTranslateWorldTransform (graphics, offset, offset, MatrixOrderPrepend);
+    GdipScaleWorldTransform (graphics, scale, scale, MatrixOrderPrepend);
+    assertEqualInt (GdipDrawImageRect (graphics, metafile, 0, 0, 50, 50), Ok);
+    GdipDeleteGraphics (graphics);
+}
+
+static void drawMetafile (GpMetafile *metafile, GpBitmap *bitmap, REAL scale)
+{
+    drawMetafileAt (metafile, bitmap, scale, 0, TextRenderingHintSystemDefault);
+}
+
+static void assertEqualBitmaps (GpBitmap *expected, GpBitmap *actual)
+{
+    ARGB expectedColor;
+    ARGB actualColor;
+    INT x;
+    INT y;
+
+    for (y = 0; y < 100; y++) {
+        for (x = 0; x < 100; x++) {
+            GdipBitmapGetPixel (expected, x, y, &expectedColor);
+            GdipBitmapGetPixel (actual, x, y, &actualColor);
+            assertEqualInt (actualColor, expectedColor);
+        }
+    }
+}
+
+static void test_metafileRasterCache ()
+{
+    GpStatus status;
+    GpMetafile *metafile;
+    GpBitmap *played;
+    GpBitmap *cached;
+    UINT limit;
+    ARGB playedColor;
+    ARGB cachedColor;
+    INT x;
+    INT y;
+
+    GdipCreateMetafileFromFile (emfFilePath, &metafile);
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &played);
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &cached);
+
+    // Disabled by default.
+    status = GdipGetMetafileRasterCacheLimit_linux (metafile, &limit);
+    assertEqualInt (status, Ok);
+    assertEqualInt (limit, 0);
+    drawMetafile (metafile, played, 2);
+
+    status = GdipSetMetafileRasterCacheLimit_linux (metafile, 1024 * 1024);
+    assertEqualInt (status, Ok);
+    status = GdipGetMetafileRasterCacheLimit_linux (metafile, &limit);
+    assertEqualInt (status, Ok);
+    assertEqualInt (limit, 1024 * 1024);
+
+    // The first draw renders the metafile, the second one reuses the rendering.
+    drawMetafile (metafile, cached, 2);
+    drawMetafile (metafile, cached, 2);
+    for (y = 0; y < 100; y += 7) {
+        for (x = 0; x < 100; x += 7) {
+            GdipBitmapGetPixel (played, x, y, &playedColor);
+            GdipBitmapGetPixel (cached, x, y, &cachedColor);
+            assertEqualInt (cachedColor, playedColor);
+        }
+    }
+
+    // Another scale gets its own rendering.
+    drawMetafile (metafile, played, 1);
+    drawMetafile (metafile, cached, 1);
+    GdipBitmapGetPixel (played, 25, 25, &playedColor);
+    GdipBitmapGetPixel (cached, 25, 25, &cachedColor);
+    assertEqualInt (cachedColor, playedColor);
+
+    // A rendering is only reused at the same fractional device position...
+    status = GdipInvalidateMetafileRasterCache_linux (metafile);
+    assertEqualInt (status, Ok);
+    drawMetafileAt (metafile, played, 2, 10.5, TextRenderingHintSystemDefault);
+    status = GdipInvalidateMetafileRasterCache_linux (metafile);
+    assertEqualInt (status, Ok);
+    drawMetafileAt (metafile, cached, 2, 10, TextRenderingHintSystemDefault);
+    drawMetafileAt (metafile, cached, 2, 10.5, TextRenderingHintSystemDefault);
+    assertEqualBitmaps (played, cached);
+
+    // ... and with the same text rendering hint.
+    status = GdipInvalidateMetafileRasterCache_linux (metafile);
+    assertEqualInt (status, Ok);
+    drawMetafileAt (metafile, played, 2, 0, TextRenderingHintSingleBitPerPixel);
+    status = GdipInvalidateMetafileRasterCache_linux (metafile);
+    assertEqualInt (status, Ok);
+    drawMetafileAt (metafile, cached, 2, 0, TextRenderingHintAntiAlias);
+    drawMetafileAt (metafile, cached, 2, 0, TextRenderingHintSingleBitPerPixel);
+    assertEqualBitmaps (played, cached);
+
+    status = GdipInvalidateMetafileRasterCache_linux (metafile);
+    assertEqualInt (status, Ok);
+
+    // Renderings larger than the limit are never cached.
+    status = GdipSetMetafileRasterCacheLimit_linux (metafile, 16);
+    assertEqualInt (status, Ok);
+    drawMetafile (metafile, played, 2);
+    drawMetafile (metafile, cached, 2);
+    GdipBitmapGetPixel (played, 25, 25, &playedColor);
+    GdipBitmapGetPixel (cached, 25, 25, &cachedColor);
+    assertEqualInt (cachedColor, playedColor);
+
+    // Negative tests.
+    status = GdipSetMetafileRasterCacheLimit_linux (NULL, 0);
+    assertEqualInt (status, InvalidParameter);
+
+    status = GdipGetMetafileRasterCacheLimit_linux (NULL, &limit);
+    assertEqualInt (status, InvalidParameter);
+
+    status = GdipGetMetafileRasterCacheLimit_linux (metafile, NULL);
+    assertEqualInt (status, InvalidParameter);
+
+    status = GdipInvalidateMetafileRasterCache_linux (NULL);
+    assertEqualInt (status, InvalidParameter);
+
+    GdipDisposeImage (played);
+    GdipDisposeImage (cached);
+    GdipDisposeImage (metafile);
+}
+
+static void verifyReplay (WCHAR *filePath)
+{
+    GpMetafile *metafile;
+    GpBitmap *first;
+    GpBitmap *second;
+    ARGB firstColor;
+    ARGB secondColor;
+    INT x;
+    INT y;
+
+    GdipCreateMetafileFromFile (filePath, &metafile);
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &first);
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &second);
+
+    // The first draw parses the records, the next ones replay what was kept from them.
+    drawMetafile (metafile, first, 2);
+    drawMetafile (metafile, second, 2);
+    drawMetafile (metafile, second, 2);
+    for (y = 0; y < 100; y++) {
+        for (x = 0; x < 100; x++) {
+            GdipBitmapGetPixel (first, x, y, &firstColor);
+            GdipBitmapGetPixel (second, x, y, &secondColor);
+            assertEqualInt (secondColor, firstColor);
+        }
+    }
+
+    GdipDisposeImage (first);
+    GdipDisposeImage (second);
+    GdipDisposeImage (metafile);
+}
+
+static void test_metafileReplay ()
+{
+    verifyReplay (wmfFilePath);
+    verifyReplay (emfFilePath);
+}
+
+static void test_metafileCulling ()
+{
+    GpStatus status;
+    GpMetafile *metafile;
+    GpBitmap *expected;
+    GpBitmap *bitmap;
+    GpGraphics *graphics;
+    UINT visibleCount;
+    UINT culledCount;
+    ARGB expectedColor;
+    ARGB color;
+    INT x;
+    INT y;
+
+    GdipCreateMetafileFromFile (wmfFilePath, &metafile);
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &expected);
+    GdipGetImageGraphicsContext (expected, &graphics);
+
+    status = GdipGetMetafileCulledOperationCount_linux (metafile, &visibleCount);
+    assertEqualInt (status, Ok);
+    assertEqualInt (visibleCount, 0);
+
+    status = GdipDrawImageRect (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    status = GdipGetMetafileCulledOperationCount_linux (metafile, &visibleCount);
+    assertEqualInt (status, Ok);
+    GdipDeleteGraphics (graphics);
+
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    GdipGetImageGraphicsContext (bitmap, &graphics);
+
+    // Nothing of the metafile is drawn within the bitmap.
+    status = GdipDrawImageRect (graphics, metafile, 200, 200, 100, 100);
+    assertEqualInt (status, Ok);
+    status = GdipGetMetafileCulledOperationCount_linux (metafile, &culledCount);
+    assertEqualInt (status, Ok);
+    assert (culledCount > visibleCount);
+    for (y = 0; y < 100; y++) {
+        for (x = 0; x < 100; x++) {
+            GdipBitmapGetPixel (bitmap, x, y, &color);
+            assertEqualInt (color, 0);
+        }
+    }
+
+    // Nor outside of the clip, while everything within it is still drawn.
+    GdipSetClipRectI (graphics, 0, 0, 50, 100, CombineModeReplace);
+    status = GdipDrawImageRect (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    for (y = 0; y < 100; y++) {
+        for (x = 0; x < 100; x++) {
+            GdipBitmapGetPixel (expected, x, y, &expectedColor);
+            GdipBitmapGetPixel (bitmap, x, y, &color);
+            if (x < 50)
+                assertEqualInt (color, expectedColor);
+            else
+                assertEqualInt (color, 0);
+        }
+    }
+
+    // Nor within a clip outside of the bitmap.
+    GdipGetMetafileCulledOperationCount_linux (metafile, &visibleCount);
+    GdipSetClipRectI (graphics, 200, 200, 10, 10, CombineModeReplace);
+    status = GdipDrawImageRect (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    status = GdipGetMetafileCulledOperationCount_linux (metafile, &culledCount);
+    assertEqualInt (status, Ok);
+    assert (culledCount > visibleCount);
+
+    // Negative tests.
+    status = GdipGetMetafileCulledOperationCount_linux (NULL, &culledCount);
+    assertEqualInt (status, InvalidParameter);
+
+    status = GdipGetMetafileCulledOperationCount_linux (metafile, NULL);
+    assertEqualInt (status, InvalidParameter);
+
+    GdipDeleteGraphics (graphics);
+    GdipDisposeImage (bitmap);
+    GdipDisposeImage (expected);
+    GdipDisposeImage (metafile);
+}
+
+static UINT getRecordedSize (HDC hdc, GpPen *firstPen, GpPen *secondPen)
+{
+    GpMetafile *metafile;
+    GpGraphics *graphics;
+    MetafileHeader header;
+    GpRectF frame = {0, 0, 100, 100};
+
+    GdipRecordMetafile (hdc, EmfTypeEmfPlusOnly, &frame, MetafileFrameUnitPixel, NULL, &metafile);
+    GdipGetImageGraphicsContext (metafile, &graphics);
+    assertEqualInt (GdipDrawLineI (graphics, firstPen, 0, 0, 10, 10), Ok);
+    assertEqualInt (GdipDrawLineI (graphics, secondPen, 0, 10, 10, 0), Ok);
+    GdipDeleteGraphics (graphics);
+
+    GdipGetMetafileHeaderFromMetafile (metafile, &header);
+    assertEqualInt (header.Type, MetafileTypeEmfPlusOnly);
+    GdipDisposeImage (metafile);
+    return header.Size;
+}
+
+static void test_metafileRecording ()
+{
+    GpStatus status;
+    GpMetafile *metafile;
+    GpBitmap *bitmap;
+    GpGraphics *graphics;
+    GpGraphics *metafileGraphics;
+    GpSolidFill *brush;
+    GpPen *pen;
+    GpPen *samePen;
+    GpPen *widerPen;
+    MetafileHeader header;
+    HDC hdc;
+    GpRectF frame = {0, 0, 100, 100};
+    UINT sharedSize;
+    UINT distinctSize;
+    ARGB color;
+
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    GdipGetImageGraphicsContext (bitmap, &graphics);
+    GdipGetDC (graphics, &hdc);
+
+    status = GdipRecordMetafile (hdc, EmfTypeEmfPlusDual, &frame, MetafileFrameUnitPixel, NULL, &metafile);
+    assertEqualInt (status, Ok);
+    status = GdipGetImageGraphicsContext (metafile, &metafileGraphics);
+    assertEqualInt (status, Ok);
+    GdipCreateSolidFill (0xFF0000FF, &brush);
+    status = GdipFillRectangleI (metafileGraphics, brush, 20, 20, 40, 40);
+    assertEqualInt (status, Ok);
+    GdipDeleteGraphics (metafileGraphics);
+
+    GdipGetMetafileHeaderFromMetafile (metafile, &header);
+    assertEqualInt (header.Type, MetafileTypeEmfPlusDual);
+    assertEqualInt (header.Width, 100);
+    assertEqualInt (header.Height, 100);
+
+    // Identical pens are recorded once, in the object table.
+    GdipCreatePen1 (0xFF000000, 1, UnitPixel, &pen);
+    GdipCreatePen1 (0xFF000000, 1, UnitPixel, &samePen);
+    GdipCreatePen1 (0xFF000000, 2, UnitPixel, &widerPen);
+    sharedSize = getRecordedSize (hdc, pen, samePen);
+    distinctSize = getRecordedSize (hdc, pen, widerPen);
+    assert (distinctSize > sharedSize);
+    GdipReleaseDC (graphics, hdc);
+
+    // The recorded records are played back.
+    GdipGraphicsClear (graphics, 0);
+    status = GdipDrawImageRectI (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    GdipBitmapGetPixel (bitmap, 40, 40, &color);
+    assertEqualInt (color, 0xFF0000FF);
+    GdipBitmapGetPixel (bitmap, 10, 10, &color);
+    assertEqualInt (color, 0);
+
+    GdipDeletePen (pen);
+    GdipDeletePen (samePen);
+    GdipDeletePen (widerPen);
+    GdipDeleteBrush (brush);
+    GdipDeleteGraphics (graphics);
+    GdipDisposeImage (bitmap);
+    GdipDisposeImage (metafile);
+}
+
+static void drawTextureAndPathGradient (GpGraphics *graphics, GpTexture *texture, GpPathGradient *gradient, GpPen *pen)
+{
+    GpStatus status;
+
+    status = GdipFillRectangleI (graphics, texture, 10, 10, 30, 30);
+    assertEqualInt (status, Ok);
+    status = GdipFillRectangleI (graphics, gradient, 60, 60, 40, 40);
+    assertEqualInt (status, Ok);
+    status = GdipDrawLineI (graphics, pen, 10, 80, 40, 80);
+    assertEqualInt (status, Ok);
+}
+
+static void test_metafileRecordingTextureAndPathGradient ()
+{
+    GpStatus status;
+    GpMetafile *metafile;
+    GpBitmap *bitmap;
+    GpBitmap *expected;
+    GpBitmap *textureBitmap;
+    GpGraphics *graphics;
+    GpGraphics *metafileGraphics;
+    GpPathGradient *gradient;
+    GpTexture *texture;
+    GpPen *pen;
+    HDC hdc;
+    GpRectF frame = {0, 0, 100, 100};
+    GpPoint points[4] = { {60, 60}, {100, 60}, {100, 100}, {60, 100} };
+    GpPoint checked[] = { {12, 12}, {13, 12}, {25, 25}, {26, 25}, {38, 30}, {80, 80}, {70, 75}, {95, 65}, {25, 80}, {80, 25} };
+    ARGB surround = 0xFF0000FF;
+    INT surroundCount = 1;
+    ARGB expectedColor;
+    ARGB color;
+    INT x;
+    INT y;
+
+    // A texture with stripes and a gradient with distinct colors, so a single color can't match.
+    GdipCreateBitmapFromScan0 (4, 4, 0, PixelFormat32bppARGB, NULL, &textureBitmap);
+    for (y = 0; y < 4; y++) {
+        for (x = 0; x < 4; x++)
+            GdipBitmapSetPixel (textureBitmap, x, y, (x < 2) ? 0xFF00FF00 : 0xFFFFFF00);
+    }
+    GdipCreateTexture (textureBitmap, WrapModeTile, &texture);
+    GdipCreatePathGradientI (points, 4, WrapModeClamp, &gradient);
+    GdipSetPathGradientCenterColor (gradient, 0xFFFF0000);
+    GdipSetPathGradientSurroundColorsWithCount (gradient, &surround, &surroundCount);
+    GdipCreatePen2 ((GpBrush *) gradient, 4, UnitPixel, &pen);
+
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &expected);
+    GdipGetImageGraphicsContext (expected, &graphics);
+    drawTextureAndPathGradient (graphics, texture, gradient, pen);
+    GdipDeleteGraphics (graphics);
+
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    GdipGetImageGraphicsContext (bitmap, &graphics);
+    GdipGetDC (graphics, &hdc);
+    status = GdipRecordMetafile (hdc, EmfTypeEmfPlusDual, &frame, MetafileFrameUnitPixel, NULL, &metafile);
+    assertEqualInt (status, Ok);
+    GdipReleaseDC (graphics, hdc);
+    status = GdipGetImageGraphicsContext (metafile, &metafileGraphics);
+    assertEqualInt (status, Ok);
+    drawTextureAndPathGradient (metafileGraphics, texture, gradient, pen);
+    GdipDeleteGraphics (metafileGraphics);
+
+    // The brushes are recorded as texture and path gradient objects, and play back like the direct drawing.
+    GdipGraphicsClear (graphics, 0);
+    status = GdipDrawImageRectI (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    for (x = 0; x < sizeof (checked) / sizeof (checked[0]); x++) {
+        GdipBitmapGetPixel (expected, checked[x].X, checked[x].Y, &expectedColor);
+        GdipBitmapGetPixel (bitmap, checked[x].X, checked[x].Y, &color);
+        assertEqualInt (color, expectedColor);
+    }
+    GdipBitmapGetPixel (bitmap, 12, 12, &expectedColor);
+    GdipBitmapGetPixel (bitmap, 26, 25, &color);
+    assert (color != expectedColor);
+
+    GdipDeletePen (pen);
+    GdipDeleteBrush ((GpBrush *) gradient);
+    GdipDeleteBrush ((GpBrush *) texture);
+    GdipDeleteGraphics (graphics);
+    GdipDisposeImage ((GpImage *) textureBitmap);
+    GdipDisposeImage ((GpImage *) expected);
+    GdipDisposeImage ((GpImage *) bitmap);
+    GdipDisposeImage ((GpImage *) metafile);
+}
+
+static void test_metafileEmfPlusPlayback ()
+{
+    GpStatus status;
+    GpMetafile *metafile;
+    GpBitmap *bitmap;
+    GpGraphics *graphics;
+    GpGraphics *metafileGraphics;
+    GpSolidFill *brush;
+    GpPen *pen;
+    HDC hdc;
+    GpRectF frame = {0, 0, 100, 100};
+    GpPointF line[2] = { {60, 80}, {90, 80} };
+    ARGB color;
+
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    GdipGetImageGraphicsContext (bitmap, &graphics);
+    GdipGetDC (graphics, &hdc);
+
+    status = GdipRecordMetafile (hdc, EmfTypeEmfPlusDual, &frame, MetafileFrameUnitPixel, NULL, &metafile);
+    assertEqualInt (status, Ok);
+    GdipReleaseDC (graphics, hdc);
+    status = GdipGetImageGraphicsContext (metafile, &metafileGraphics);
+    assertEqualInt (status, Ok);
+
+    // A transformed and clipped fill.
+    GdipTranslateWorldTransform (metafileGraphics, 50, 0, MatrixOrderPrepend);
+    GdipSetClipRect (metafileGraphics, 0, 0, 50, 50, CombineModeReplace);
+    GdipCreateSolidFill (0xFFFF0000, &brush);
+    status = GdipFillRectangle (metafileGraphics, brush, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    GdipDeleteBrush (brush);
+    GdipResetClip (metafileGraphics);
+    GdipResetWorldTransform (metafileGraphics);
+
+    GdipCreateSolidFill (0xFF00FF00, &brush);
+    status = GdipFillEllipse (metafileGraphics, brush, 10, 60, 30, 30);
+    assertEqualInt (status, Ok);
+    GdipCreatePen1 (0xFF0000FF, 3, UnitPixel, &pen);
+    status = GdipDrawLines (metafileGraphics, pen, line, 2);
+    assertEqualInt (status, Ok);
+    GdipDeleteGraphics (metafileGraphics);
+
+    GdipGraphicsClear (graphics, 0);
+    status = GdipDrawImageRectI (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    GdipBitmapGetPixel (bitmap, 75, 25, &color);
+    assertEqualInt (color, 0xFFFF0000);
+    GdipBitmapGetPixel (bitmap, 25, 25, &color);
+    assertEqualInt (color, 0);
+    GdipBitmapGetPixel (bitmap, 75, 60, &color);
+    assertEqualInt (color, 0);
+    GdipBitmapGetPixel (bitmap, 25, 75, &color);
+    assertEqualInt (color, 0xFF00FF00);
+    GdipBitmapGetPixel (bitmap, 75, 80, &color);
+    assertEqualInt (color, 0xFF0000FF);
+
+    GdipDeletePen (pen);
+    GdipDeleteBrush (brush);
+    GdipDeleteGraphics (graphics);
+    GdipDisposeImage (bitmap);
+    GdipDisposeImage (metafile);
+}
+
+static void test_metafileFromLargeFile ()
+{
+    GpStatus status;
+    GpMetafile *metafile;
+    GpMetafile *clone;
+    GpBitmap *bitmap;
+    GpGraphics *graphics;
+    GpGraphics *metafileGraphics;
+    GpSolidFill *brush;
+    HDC hdc;
+    GpRectF frame = {0, 0, 100, 100};
+    GpRect *rects;
+    MetafileHeader header;
+    WCHAR *largeFilePath = createWchar ("temp_large.emf");
+    ARGB color;
+    INT i;
+
+    // Enough records for the file to be mapped instead of read.
+    rects = (GpRect *) malloc (20000 * sizeof (GpRect));
+    for (i = 0; i < 20000; i++) {
+        rects[i].X = 10;
+        rects[i].Y = 10;
+        rects[i].Width = 20;
+        rects[i].Height = 20;
+    }
+
+    GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+    GdipGetImageGraphicsContext (bitmap, &graphics);
+    GdipGetDC (graphics, &hdc);
+    status = GdipRecordMetafileFileName (largeFilePath, hdc, EmfTypeEmfPlusDual, &frame, MetafileFrameUnitPixel, NULL, &metafile);
+    assertEqualInt (status, Ok);
+    GdipReleaseDC (graphics, hdc);
+
+    GdipGetImageGraphicsContext (metafile, &metafileGraphics);
+    GdipCreateSolidFill (0xFF00FF00, &brush);
+    for (i = 0; i < 8; i++)
+        assertEqualInt (GdipFillRectanglesI (metafileGraphics, brush, rects, 20000), Ok);
+    GdipDeleteGraphics (metafileGraphics);
+    GdipDisposeImage (metafile);
+
+    status = GdipCreateMetafileFromFile (largeFilePath, &metafile);
+    assertEqualInt (status, Ok);
+    GdipGetMetafileHeaderFromMetafile (metafile, &header);
+    assertEqualInt (header.Type, MetafileTypeEmfPlusDual);
+    assert (header.Size > 1024 * 1024);
+
+    status = GdipDrawImageRectI (graphics, metafile, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    GdipBitmapGetPixel (bitmap, 20, 20, &color);
+    assertEqualInt (color, 0xFF00FF00);
+
+    // Clones share the mapped records.
+    GdipGraphicsClear (graphics, 0);
+    status = GdipCloneImage (metafile, (GpImage **) &clone);
+    assertEqualInt (status, Ok);
+    GdipDisposeImage (metafile);
+    status = GdipDrawImageRectI (graphics, clone, 0, 0, 100, 100);
+    assertEqualInt (status, Ok);
+    GdipBitmapGetPixel (bitmap, 20, 20, &color);
+    assertEqualInt (color, 0xFF00FF00);
+
+    GdipDisposeImage (clone);
+    GdipDeleteBrush (brush);
+    GdipDeleteGraphics (graphics);
+    GdipDisposeImage (bitmap);
+    free (rects);
+    freeWchar (largeFilePath);
+    deleteFile ("temp_large.emf");
+}
+#endif
+
 int
 main (int argc, char**argv)
 {
@@ -625,6 +1176,15 @@ main (int argc, char**argv)
     test_setMetafileDownLevelRasterizationLimit ();
     test_playMetafileRecord ();
     test_recordMetafile ();
+#if !defined(USE_WINDOWS_GDIPLUS)
+    test_metafileRasterCache ();
+    test_metafileReplay ();
+    test_metafileCulling ();
+    test_metafileRecording ();
+    test_metafileRecordingTextureAndPathGradient ();
+    test_metafileEmfPlusPlayback ();
+    test_metafileFromLargeFile ();
+#endif
 
     SHUTDOWN;
     return 0;
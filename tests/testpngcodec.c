@@ -836,6 +836,230 @@ static void test_invalidImageFormat()
 	createFile (indexed16bpp, OutOfMemory);
 }
 
+#if !defined(USE_WINDOWS_GDIPLUS)
+static GUID levelGuid = {0x8F4FF533U, 0xF92FU, 0x41BDU, {0xB4, 0x0C, 0xE0, 0x29, 0x01, 0x71, 0x17, 0xD0}};
+static GUID strategyGuid = {0x0A973E15U, 0x10DFU, 0x4D31U, {0xA6, 0x92, 0xE2, 0x36, 0x3B, 0xB8, 0x66, 0x8C}};
+static GUID filtersGuid = {0x0FC82FFAU, 0x7FB0U, 0x49F1U, {0x8F, 0x10, 0x47, 0x6D, 0x4C, 0x3B, 0x62, 0xCE}};
+static GUID threadsGuid = {0xDB0B2E30U, 0x528DU, 0x461EU, {0x9F, 0x0B, 0x6F, 0xBD, 0xAB, 0x10, 0x6B, 0xA9}};
+
+static GpBitmap *createEncoderParametersBitmap (PixelFormat format, INT width, INT height)
+{
+	GpBitmap *bitmap;
+	INT x;
+	INT y;
+
+	GdipCreateBitmapFromScan0 (width, height, 0, format, NULL, &bitmap);
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			GdipBitmapSetPixel (bitmap, x, y, 0xFF000000 | ((x & 0xFF) << 16) | ((y & 0xFF) << 8) | ((x ^ y) & 0xFF));
+		}
+	}
+	return bitmap;
+}
+
+// Saves the bitmap and returns the PNG data (freed with free).
+static BYTE *savePng (GpBitmap *bitmap, EncoderParameters *params, INT *size)
+{
+	GpStatus status;
+
+	status = GdipSaveImageToFile (bitmap, wFile, &pngEncoderClsid, params);
+	assertEqualInt (status, Ok);
+	return readFileBytes (file, size);
+}
+
+// Checks the filter type of every row. The image data must be stored, i.e. saved with PngCompressionLevelNone.
+static void verifyRowFilters (const BYTE *data, INT size, INT rowBytes, INT height, BYTE expectedFilter)
+{
+	BYTE *idat = (BYTE *) malloc (size);
+	INT idatSize = 0;
+	INT offset = 8;
+	INT position = 0;
+	INT rows = 0;
+	BOOL last = FALSE;
+
+	// Concatenate the IDAT chunks.
+	while (offset + 12 <= size) {
+		INT length = (data[offset] << 24) | (data[offset + 1] << 16) | (data[offset + 2] << 8) | data[offset + 3];
+
+		if (memcmp (data + offset + 4, "IDAT", 4) == 0) {
+			memcpy (idat + idatSize, data + offset + 8, length);
+			idatSize += length;
+		}
+		offset += 12 + length;
+	}
+
+	// Skip the zlib header, then read the stored deflate blocks: a row starts every rowBytes + 1 bytes.
+	offset = 2;
+	while (!last) {
+		INT length;
+		INT i;
+
+		assert (offset + 5 <= idatSize);
+		assertEqualInt (idat[offset] & 0x06, 0);
+		last = idat[offset] & 0x01;
+		length = idat[offset + 1] | (idat[offset + 2] << 8);
+		offset += 5;
+		assert (offset + length <= idatSize);
+
+		for (i = 0; i < length; i++, position++) {
+			if (position % (rowBytes + 1) == 0) {
+				assertEqualInt (idat[offset + i], expectedFilter);
+				rows++;
+			}
+		}
+		offset += length;
+	}
+	assertEqualInt (rows, height);
+	assertEqualInt (position, (rowBytes + 1) * height);
+
+	free (idat);
+}
+
+static void verifyEncoderParametersRoundTrip (PixelFormat format, INT width, INT height, EncoderParameters *params)
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpBitmap *loaded;
+	ARGB expected;
+	ARGB color;
+	INT x;
+	INT y;
+
+	bitmap = createEncoderParametersBitmap (format, width, height);
+
+	status = GdipSaveImageToFile (bitmap, wFile, &pngEncoderClsid, params);
+	assertEqualInt (status, Ok);
+
+	status = GdipCreateBitmapFromFile (wFile, &loaded);
+	assertEqualInt (status, Ok);
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			GdipBitmapGetPixel (bitmap, x, y, &expected);
+			GdipBitmapGetPixel (loaded, x, y, &color);
+			assertEqualInt (color, expected);
+		}
+	}
+
+	GdipDisposeImage (loaded);
+	GdipDisposeImage (bitmap);
+}
+
+static void test_saveWithEncoderParameters ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	LONG level = PngCompressionLevelFast;
+	LONG strategy = PngCompressionStrategyRle;
+	LONG filters = PngFilterNone;
+	LONG threads = 4;
+	EncoderParameters *params;
+
+	params = createEncoderParameters (4);
+	addEncoderParameterLong (params, levelGuid, &level);
+	addEncoderParameterLong (params, strategyGuid, &strategy);
+	addEncoderParameterLong (params, filtersGuid, &filters);
+
+	// More rows than are written per batch, and an odd width.
+	verifyEncoderParametersRoundTrip (PixelFormat32bppARGB, 13, 150, params);
+	verifyEncoderParametersRoundTrip (PixelFormat24bppRGB, 13, 150, params);
+
+	level = PngCompressionLevelBest;
+	strategy = PngCompressionStrategyDefault;
+	filters = PngFilterAll;
+	verifyEncoderParametersRoundTrip (PixelFormat32bppARGB, 13, 150, params);
+	verifyEncoderParametersRoundTrip (PixelFormat24bppRGB, 13, 150, params);
+
+	// Large enough to be deflated on several threads.
+	addEncoderParameterLong (params, threadsGuid, &threads);
+	verifyEncoderParametersRoundTrip (PixelFormat32bppARGB, 700, 500, params);
+	verifyEncoderParametersRoundTrip (PixelFormat24bppRGB, 700, 500, params);
+
+	threads = PngThreadsAuto;
+	filters = PngFilterNone;
+	level = PngCompressionLevelFast;
+	verifyEncoderParametersRoundTrip (PixelFormat32bppARGB, 1024, 300, params);
+
+	// Invalid values.
+	GdipCreateBitmapFromScan0 (1, 1, 0, PixelFormat32bppARGB, NULL, &bitmap);
+
+	level = 10;
+	status = GdipSaveImageToFile (bitmap, wFile, &pngEncoderClsid, params);
+	assertEqualInt (status, InvalidParameter);
+
+	level = PngCompressionLevelDefault;
+	strategy = 5;
+	status = GdipSaveImageToFile (bitmap, wFile, &pngEncoderClsid, params);
+	assertEqualInt (status, InvalidParameter);
+
+	strategy = PngCompressionStrategyDefault;
+	filters = 0x01;
+	status = GdipSaveImageToFile (bitmap, wFile, &pngEncoderClsid, params);
+	assertEqualInt (status, InvalidParameter);
+
+	filters = PngFilterNone;
+	threads = -2;
+	status = GdipSaveImageToFile (bitmap, wFile, &pngEncoderClsid, params);
+	assertEqualInt (status, InvalidParameter);
+
+	GdipDisposeImage (bitmap);
+	free (params);
+}
+
+static void test_saveEncoderParametersOutput ()
+{
+	GpBitmap *bitmap;
+	BYTE *data;
+	INT size;
+	INT bestSize;
+	LONG level = PngCompressionLevelBest;
+	LONG filters = PngFilterNone;
+	LONG threads = 4;
+	EncoderParameters *params;
+
+	params = createEncoderParameters (3);
+	addEncoderParameterLong (params, levelGuid, &level);
+	addEncoderParameterLong (params, filtersGuid, &filters);
+
+	bitmap = createEncoderParametersBitmap (PixelFormat32bppARGB, 13, 150);
+	data = savePng (bitmap, params, &bestSize);
+	free (data);
+
+	// Stored, so larger, and every row keeps the only allowed filter.
+	level = PngCompressionLevelNone;
+	data = savePng (bitmap, params, &size);
+	assert (size > bestSize);
+	verifyRowFilters (data, size, 13 * 4, 150, 0);
+	free (data);
+
+	filters = PngFilterSub;
+	data = savePng (bitmap, params, &size);
+	verifyRowFilters (data, size, 13 * 4, 150, 1);
+	free (data);
+	GdipDisposeImage (bitmap);
+
+	bitmap = createEncoderParametersBitmap (PixelFormat24bppRGB, 13, 150);
+	data = savePng (bitmap, params, &size);
+	verifyRowFilters (data, size, 13 * 3, 150, 1);
+	free (data);
+	GdipDisposeImage (bitmap);
+
+	// The same when deflated on several threads.
+	addEncoderParameterLong (params, threadsGuid, &threads);
+	bitmap = createEncoderParametersBitmap (PixelFormat32bppARGB, 700, 500);
+	data = savePng (bitmap, params, &size);
+	verifyRowFilters (data, size, 700 * 4, 500, 1);
+	free (data);
+
+	filters = PngFilterUp;
+	data = savePng (bitmap, params, &size);
+	verifyRowFilters (data, size, 700 * 4, 500, 2);
+	free (data);
+	GdipDisposeImage (bitmap);
+
+	free (params);
+}
+#endif
+
 int
 main (int argc, char**argv)
 {
@@ -851,6 +1075,10 @@ main (int argc, char**argv)
 	test_invalidHeaderChunk ();
 	test_invalidImageData ();
 	test_invalidImageFormat ();
+#if !defined(USE_WINDOWS_GDIPLUS)
+	test_saveWithEncoderParameters ();
+	test_saveEncoderParametersOutput ();
+#endif
 
 	deleteFile (file);
 
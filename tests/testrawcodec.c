@@ -0,0 +1,242 @@
+#ifdef WIN32
+#ifndef __cplusplus
+#error Please compile with a C++ compiler.
+#endif
+#endif
+
+#if defined(USE_WINDOWS_GDIPLUS)
+#include <Windows.h>
+#include <GdiPlus.h>
+
+#pragma comment(lib, "gdiplus.lib")
+#else
+#include <GdiPlusFlat.h>
+#endif
+
+#if defined(USE_WINDOWS_GDIPLUS)
+using namespace Gdiplus;
+using namespace DllExports;
+#endif
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include "testhelpers.h"
+
+static const char *file = "temp_asset.gdipraw";
+static WCHAR wFile[] = {'t', 'e', 'm', 'p', '_', 'a', 's', 's', 'e', 't', '.', 'g', 'd', 'i', 'p', 'r', 'a', 'w', 0};
+GpImage *image;
+
+#if !defined(USE_WINDOWS_GDIPLUS)
+static CLSID rawEncoderClsid = { 0xd528dae9, 0x5f17, 0x4b1e, { 0xaf, 0x8c, 0x59, 0x98, 0x6a, 0xbc, 0xe9, 0x4d } };
+static GUID rawRawFormat = { 0xfff1322bU, 0x9c89U, 0x4ce1U, { 0x86, 0xcf, 0x79, 0x9c, 0x5f, 0x82, 0xf0, 0xbb } };
+
+#define createFile(buffer, expectedStatus) \
+{ \
+	GpStatus status; \
+	FILE *f = fopen (file, "wb+"); \
+	assert (f); \
+	fwrite ((void *) buffer, sizeof (BYTE), sizeof (buffer), f); \
+	fclose (f); \
+ \
+	status = GdipLoadImageFromFile (wFile, &image); \
+	assertEqualInt (status, expectedStatus); \
+}
+
+static void verifyRoundTrip (PixelFormat format, INT width, INT height)
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpBitmap *loaded;
+	PixelFormat loadedFormat;
+	GUID rawFormat;
+	ARGB expected;
+	ARGB color;
+	INT x;
+	INT y;
+
+	GdipCreateBitmapFromScan0 (width, height, 0, format, NULL, &bitmap);
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			GdipBitmapSetPixel (bitmap, x, y, ((ARGB) ((x * 17) & 0xFF) << 24) | ((x & 0xFF) << 16) | ((y & 0xFF) << 8) | ((x ^ y) & 0xFF));
+		}
+	}
+
+	status = GdipSaveImageToFile (bitmap, wFile, &rawEncoderClsid, NULL);
+	assertEqualInt (status, Ok);
+
+	status = GdipCreateBitmapFromFile (wFile, &loaded);
+	assertEqualInt (status, Ok);
+
+	GdipGetImageRawFormat (loaded, &rawFormat);
+	assertEqualGuid (rawFormat, rawRawFormat);
+	GdipGetImagePixelFormat (loaded, &loadedFormat);
+	assertEqualInt (loadedFormat, format);
+
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			GdipBitmapGetPixel (bitmap, x, y, &expected);
+			GdipBitmapGetPixel (loaded, x, y, &color);
+			assertEqualInt (color, expected);
+		}
+	}
+
+	GdipDisposeImage (loaded);
+	GdipDisposeImage (bitmap);
+}
+
+static void test_roundTrip ()
+{
+	verifyRoundTrip (PixelFormat32bppARGB, 13, 7);
+	verifyRoundTrip (PixelFormat32bppPARGB, 13, 7);
+	verifyRoundTrip (PixelFormat32bppRGB, 1, 1);
+	verifyRoundTrip (PixelFormat24bppRGB, 300, 200);
+}
+
+static void test_roundTripIndexed ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpBitmap *loaded;
+	BYTE scan0[8 * 3];
+	BitmapData data;
+	GpRect rect = {0, 0, 5, 3};
+	INT size;
+	INT y;
+	ColorPalette *palette = (ColorPalette *) malloc (sizeof (ColorPalette) + 3 * sizeof (ARGB));
+	ColorPalette *loadedPalette;
+
+	for (y = 0; y < (INT) sizeof (scan0); y++)
+		scan0[y] = (BYTE) (y % 4);
+
+	palette->Flags = PaletteFlagsHasAlpha;
+	palette->Count = 4;
+	palette->Entries[0] = 0x00000000;
+	palette->Entries[1] = 0xFFFF0000;
+	palette->Entries[2] = 0x8000FF00;
+	palette->Entries[3] = 0xFF0000FF;
+
+	GdipCreateBitmapFromScan0 (5, 3, 8, PixelFormat8bppIndexed, scan0, &bitmap);
+	GdipSetImagePalette (bitmap, palette);
+
+	status = GdipSaveImageToFile (bitmap, wFile, &rawEncoderClsid, NULL);
+	assertEqualInt (status, Ok);
+
+	status = GdipCreateBitmapFromFile (wFile, &loaded);
+	assertEqualInt (status, Ok);
+
+	GdipGetImagePaletteSize (loaded, &size);
+	assertEqualInt (size, sizeof (ColorPalette) + 3 * sizeof (ARGB));
+	loadedPalette = (ColorPalette *) malloc (size);
+	GdipGetImagePalette (loaded, loadedPalette, size);
+	assertEqualInt (loadedPalette->Flags, palette->Flags);
+	assertEqualInt (loadedPalette->Count, 4);
+	assertEqualBytes ((BYTE *) loadedPalette->Entries, (BYTE *) palette->Entries, 4 * sizeof (ARGB));
+
+	status = GdipBitmapLockBits (loaded, &rect, ImageLockModeRead, PixelFormat8bppIndexed, &data);
+	assertEqualInt (status, Ok);
+	for (y = 0; y < 3; y++)
+		assertEqualBytes ((BYTE *) data.Scan0 + y * data.Stride, scan0 + y * 8, 5);
+	GdipBitmapUnlockBits (loaded, &data);
+
+	GdipDisposeImage (loaded);
+	GdipDisposeImage (bitmap);
+	free (loadedPalette);
+	free (palette);
+}
+
+static void test_roundTripProperties ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpImage *loaded;
+	PropertyItem item;
+	PropertyItem *loadedItem;
+	BYTE value[] = {'l', 'i', 'b', 'g', 'd', 'i', 'p', 'l', 'u', 's', 0};
+	UINT count;
+	UINT size;
+
+	GdipCreateBitmapFromScan0 (2, 2, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	status = GdipSaveImageToFile (bitmap, wFile, &rawEncoderClsid, NULL);
+	assertEqualInt (status, Ok);
+	GdipDisposeImage (bitmap);
+
+	// Properties can be set once the image comes from the RAW codec.
+	status = GdipLoadImageFromFile (wFile, &image);
+	assertEqualInt (status, Ok);
+
+	item.id = PropertyTagSoftwareUsed;
+	item.length = sizeof (value);
+	item.type = PropertyTagTypeASCII;
+	item.value = value;
+	status = GdipSetPropertyItem (image, &item);
+	assertEqualInt (status, Ok);
+
+	status = GdipSaveImageToFile (image, wFile, &rawEncoderClsid, NULL);
+	assertEqualInt (status, Ok);
+	GdipDisposeImage (image);
+
+	status = GdipLoadImageFromFile (wFile, &loaded);
+	assertEqualInt (status, Ok);
+
+	GdipGetPropertyCount (loaded, &count);
+	assertEqualInt (count, 1);
+	GdipGetPropertyItemSize (loaded, PropertyTagSoftwareUsed, &size);
+	loadedItem = (PropertyItem *) malloc (size);
+	status = GdipGetPropertyItem (loaded, PropertyTagSoftwareUsed, size, loadedItem);
+	assertEqualInt (status, Ok);
+	assertEqualInt (loadedItem->type, PropertyTagTypeASCII);
+	assertEqualInt (loadedItem->length, sizeof (value));
+	assertEqualBytes ((BYTE *) loadedItem->value, value, sizeof (value));
+
+	free (loadedItem);
+	GdipDisposeImage (loaded);
+}
+
+static void test_invalidHeader ()
+{
+	BYTE noHeader[] = {'G', 'D', 'I', 'P', 'R', 'A', 'W', 0x1A, 0x40, 0x00, 0x00, 0x00};
+	BYTE badVersion[64] = {'G', 'D', 'I', 'P', 'R', 'A', 'W', 0x1A, 0x41};
+	BYTE noPixels[64] = {
+		/* Signature */     'G', 'D', 'I', 'P', 'R', 'A', 'W', 0x1A,
+		/* Header size */   0x40, 0x00, 0x00, 0x00,
+		/* Flags */         0x00, 0x00, 0x00, 0x00,
+		/* Pixel format */  0x0a, 0x20, 0x26, 0x00,
+		/* Width */         0x01, 0x00, 0x00, 0x00,
+		/* Height */        0x01, 0x00, 0x00, 0x00,
+		/* Stride */        0x04, 0x00, 0x00, 0x00
+	};
+	BYTE badStride[64] = {
+		/* Signature */     'G', 'D', 'I', 'P', 'R', 'A', 'W', 0x1A,
+		/* Header size */   0x40, 0x00, 0x00, 0x00,
+		/* Flags */         0x00, 0x00, 0x00, 0x00,
+		/* Pixel format */  0x0a, 0x20, 0x26, 0x00,
+		/* Width */         0x02, 0x00, 0x00, 0x00,
+		/* Height */        0x01, 0x00, 0x00, 0x00,
+		/* Stride */        0x04, 0x00, 0x00, 0x00
+	};
+
+	createFile (noHeader, OutOfMemory);
+	createFile (badVersion, UnknownImageFormat);
+	createFile (noPixels, OutOfMemory);
+	createFile (badStride, OutOfMemory);
+}
+#endif
+
+int
+main (int argc, char**argv)
+{
+	STARTUP;
+
+#if !defined(USE_WINDOWS_GDIPLUS)
+	test_roundTrip ();
+	test_roundTripIndexed ();
+	test_roundTripProperties ();
+	test_invalidHeader ();
+#endif
+
+	deleteFile (file);
+
+	SHUTDOWN;
+	return 0;
+}
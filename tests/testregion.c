@@ -1434,13 +1434,8 @@ static void test_combineUnion ()
 	verifyCombineRectWithRect (&rect, &intersectLeftRect, CombineModeUnion, 0, 20, 40, 40, FALSE, FALSE, &intersectLeftScan, sizeof (intersectLeftScan));
 
 	// Rect + Intersect Top = Calculation.
-	// FIXME: should be combined into a single rect: https://github.com/mono/libgdiplus/issues/340
 	RectF intersectTopScan = {10, 10, 30, 50};
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF intersectTopScansRect[] = {intersectTopScan};
-#else
-	RectF intersectTopScansRect[] = {{10, 10, 30, 40}, {10, 50, 30, 10}};
-#endif
 	verifyCombineRectWithRect (&rect, &intersectTopRect, CombineModeUnion, 10, 10, 30, 50, FALSE, FALSE, intersectTopScansRect, sizeof (intersectTopScansRect));
 	
 	// Rect + Intersect Right = Calculation.
@@ -1448,13 +1443,8 @@ static void test_combineUnion ()
 	verifyCombineRectWithRect (&rect, &intersectRightRect, CombineModeUnion, 10, 20, 40, 40, FALSE, FALSE, &intersectRightScan, sizeof (intersectRightScan));
 
 	// Rect + Intersect Bottom = Calculation.
-	// FIXME: should be combined into a single rect: https://github.com/mono/libgdiplus/issues/340
 	RectF intersectBottomScan = {10, 20, 30, 50};
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF intersectBottomScansRect[] = {intersectBottomScan};
-#else
-	RectF intersectBottomScansRect[] = {{10, 20, 30, 40}, {10, 60, 30, 10}};
-#endif
 	verifyCombineRectWithRect (&rect, &intersectBottomRect, CombineModeUnion, 10, 20, 30, 50, FALSE, FALSE, intersectBottomScansRect, sizeof (intersectBottomScansRect));
 
 	// Rect + Intersect Top Left = Calculation.
@@ -1494,13 +1484,8 @@ static void test_combineUnion ()
 	verifyCombineRectWithRect (&rect, &noIntersectLeftRect, CombineModeUnion, -20, 20, 60, 40, FALSE, FALSE, &noIntersectLeftScan, sizeof (noIntersectLeftScan));
 
 	// Rect + No Intersect Top = Calculation.
-	// FIXME: should be combined into a single rect: https://github.com/mono/libgdiplus/issues/340
 	RectF noIntersectTopScan = {10, -20, 30, 80};
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectTopScansRect[] = {noIntersectTopScan};
-#else
-	RectF noIntersectTopScansRect[] = {{10, -20, 30, 40}, {10, 20, 30, 40}};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectTopRect, CombineModeUnion, 10, -20, 30, 80, FALSE, FALSE, noIntersectTopScansRect, sizeof (noIntersectTopScansRect));
 
 	// Rect + No Intersect Right = Calculation.
@@ -1508,13 +1493,8 @@ static void test_combineUnion ()
 	verifyCombineRectWithRect (&rect, &noIntersectRightRect, CombineModeUnion, 10, 20, 60, 40, FALSE, FALSE, &noIntersectRightScan, sizeof (noIntersectRightScan));
 
 	// Rect + No Intersect Bottom = Calculation.
-	// FIXME: should be combined into a single rect: https://github.com/mono/libgdiplus/issues/340
 	RectF noIntersectBottomScan = {10, 20, 30, 80};
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectBottomScansRect[] = {noIntersectBottomScan};
-#else
-	RectF noIntersectBottomScansRect[] = {{10, 20, 30, 40}, {10, 60, 30, 40}};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectBottomRect, CombineModeUnion, 10, 20, 30, 80, FALSE, FALSE, noIntersectBottomScansRect, sizeof (noIntersectBottomScansRect));
 
 	// Rect + No Intersect Top Left = Both.
@@ -1925,31 +1905,19 @@ static void test_combineXor ()
 #endif
 
 	// Infinite Rect + Empty Rect = Infinite Rect.
-	// FIXME: this should be infinite: https://github.com/mono/libgdiplus/issues/343
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombineRectWithRect (&infiniteRect, &emptyRect, CombineModeXor, -4194304, -4194304, 8388608, 8388608, FALSE, TRUE, infiniteScans, sizeof (infiniteScans));
-#endif
 
 	// Infinite Rect + Rect = Not Rect.
 	verifyCombineRectWithRect (&infiniteRect, &rect, CombineModeXor, -4194304, -4194304, 8388608, 8388608, FALSE, FALSE, infiniteWithRectScans, sizeof (infiniteWithRectScans));
 
 	// Empty Rect + Infinite Rect = Infinite Rect.
-	// FIXME: this should be infinite: https://github.com/mono/libgdiplus/issues/343
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombineRectWithRect (&emptyRect, &infiniteRect, CombineModeXor, -4194304, -4194304, 8388608, 8388608, FALSE, TRUE, infiniteScans, sizeof (infiniteScans));
-#endif
 
 	// Empty Rect + Empty Rect = Empty.
-	// FIXME: incorrect scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombineRectWithRect (&emptyRect, &emptyRect, CombineModeXor, 0, 0, 0, 0, TRUE, FALSE, emptyScans, 0);
-#endif
 
 	// Empty Rect + Rect = Rect.
-	// FIXME: incorrect bounds/scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombineRectWithRect (&emptyRect, &rect, CombineModeXor, 10, 20, 30, 40, FALSE, FALSE, &rect, sizeof (rect));
-#endif
 
 	// Rect + Infinite = Not Rect.
 	verifyCombineRectWithRegion (&rect, infiniteRegion, CombineModeXor, -4194304, -4194304, 8388608, 8388608, FALSE, FALSE, infiniteWithRectScans, sizeof (infiniteWithRectScans));
@@ -1961,10 +1929,7 @@ static void test_combineXor ()
 	verifyCombineRectWithRect (&rect, &infiniteRect, CombineModeXor, -4194304, -4194304, 8388608, 8388608, FALSE, FALSE, infiniteWithRectScans, sizeof (infiniteWithRectScans));
 
 	// Rect + Empty Rect = Rect.
-	// FIXME: incorrect bounds/scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombineRectWithRect (&rect, &emptyRect, CombineModeXor, 10, 20, 30, 40, FALSE, FALSE, &rect, sizeof (rect));
-#endif
 
 	// Rect + Negative Rect = Empty.
 	// FIXME: this should set to empty: https://github.com/mono/libgdiplus/issues/336
@@ -2059,78 +2024,33 @@ static void test_combineXor ()
 	verifyCombineRectWithRect (&rect, &intersectBottomLeftRect, CombineModeXor, 0, 20, 40, 50, FALSE, FALSE, intersectBottomLeftScans, sizeof (intersectBottomLeftScans));
 
 	// Rect + No Intersect Left = Both.
-	// FIXME: combine adjacent regions: https://github.com/mono/libgdiplus/issues/345
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectLeftScans[] = {{-20, 20, 60, 40}};
-#else
-	RectF noIntersectLeftScans[] = {
-		rect,
-		noIntersectLeftRect
-	};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectLeftRect, CombineModeXor, -20, 20, 60, 40, FALSE, FALSE, noIntersectLeftScans, sizeof (noIntersectLeftScans));
 
 	// Rect + No Intersect Top = Both.
-	// FIXME: combine adjacent regions: https://github.com/mono/libgdiplus/issues/345
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectTopScans[] = {{10, -20, 30, 80}};
-#else
-	RectF noIntersectTopScans[] = {
-		rect,
-		noIntersectTopRect
-	};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectTopRect, CombineModeXor, 10, -20, 30, 80, FALSE, FALSE, noIntersectTopScans, sizeof (noIntersectTopScans));
 
 	// Rect + No Intersect Right = Both.
-	// FIXME: combine adjacent regions: https://github.com/mono/libgdiplus/issues/345
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectRightScans[] = {{10, 20, 60, 40}};
-#else
-	RectF noIntersectRightScans[] = {
-		rect,
-		noIntersectRightRect
-	};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectRightRect, CombineModeXor, 10, 20, 60, 40, FALSE, FALSE, noIntersectRightScans, sizeof (noIntersectRightScans));
 
 	// Rect + No Intersect Bottom = Both.
-	// FIXME: combine adjacent regions: https://github.com/mono/libgdiplus/issues/345
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectBottomScans[] = {{10, 20, 30, 80}};
-#else
-	RectF noIntersectBottomScans[] = {{10, 20, 30, 40}, {10, 60, 30, 40}};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectBottomRect, CombineModeXor, 10, 20, 30, 80, FALSE, FALSE, noIntersectBottomScans, sizeof (noIntersectBottomScans));
 
 	// Rect + No Intersect Top Left = Both.
-	// FIXME: different ordering: https://github.com/mono/libgdiplus/issues/346
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectTopLeftScans[] = {
 		noIntersectTopLeftRect,
 		rect
 	};
-#else
-	RectF noIntersectTopLeftScans[] = {
-		rect,
-		noIntersectTopLeftRect
-	};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectTopLeftRect, CombineModeXor, -20, -20, 60, 80, FALSE, FALSE, noIntersectTopLeftScans, sizeof (noIntersectTopLeftScans));
 
 	// Rect + No Intersect Top Right = Both.
-	// FIXME: different ordering: https://github.com/mono/libgdiplus/issues/346
-#if defined(USE_WINDOWS_GDIPLUS)
 	RectF noIntersectTopRightScans[] = {
 		noIntersectTopRightRect,
 		rect
 	};
-#else
-	RectF noIntersectTopRightScans[] = {
-		rect,
-		noIntersectTopRightRect
-	};
-#endif
 	verifyCombineRectWithRect (&rect, &noIntersectTopRightRect, CombineModeXor, 10, -20, 60, 80, FALSE, FALSE, noIntersectTopRightScans, sizeof (noIntersectTopRightScans));
 
 	// Rect + No Intersect Bottom Right = Both.
@@ -2166,10 +2086,7 @@ static void test_combineXor ()
 #endif
 
 	// Empty Rect + Empty Path = Empty.
-	// FIXME: incorrect scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombineRectWithPath (&emptyRect, emptyPath, CombineModeXor, 0, 0, 0, 0, TRUE, FALSE, emptyScans, 0);
-#endif
 
 	// Empty Rect + Path = Path.
 	verifyCombineRectWithPath (&emptyRect, path, CombineModeXor, 10, 20, 30, 40, FALSE, FALSE, &rect, sizeof (rect));
@@ -2272,10 +2189,7 @@ static void test_combineXor ()
 #endif
 
 	// Empty Path + Empty Rect = Empty.
-	// FIXME: incorrect scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombinePathWithRect (emptyPath, &emptyRect, CombineModeXor, 0, 0, 0, 0, TRUE, FALSE, emptyScans, 0);
-#endif
 
 	// Empty Path + Rect = Rect.
 	verifyCombinePathWithRect (emptyPath, &rect, CombineModeXor, 10, 20, 30, 40, FALSE, FALSE, &rect, sizeof (rect));
@@ -2296,10 +2210,7 @@ static void test_combineXor ()
 #endif
 
 	// Path + Empty Rect = Path.
-	// FIXME: incorrect bounds/scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombinePathWithRect (path, &emptyRect, CombineModeXor, 10, 20, 30, 40, FALSE, FALSE, &rect, sizeof (rect));
-#endif
 
 	// Path + Negative Rect = Empty.
 	// FIXME: this should set to empty: https://github.com/mono/libgdiplus/issues/336
@@ -2386,10 +2297,7 @@ static void test_combineXor ()
 #endif
 
 	// Empty Path + Empty Path = Empty.
-	// FIXME: incorrect scans: https://github.com/mono/libgdiplus/issues/344
-#if defined(USE_WINDOWS_GDIPLUS)
 	verifyCombinePathWithPath (emptyPath, emptyPath, CombineModeXor, 0, 0, 0, 0, TRUE, FALSE, emptyScans, 0);
-#endif
 
 	// Empty Path + Path = Path.
 	verifyCombinePathWithPath (emptyPath, path, CombineModeXor, 10, 20, 30, 40, FALSE, FALSE, &rect, sizeof (rect));
@@ -3663,6 +3571,509 @@ static void test_combineComplement ()
 	GdipDeletePath (negativePath);
 }
 
+static void test_fillRegion ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpGraphics *bitmapGraphics;
+	GpSolidFill *brush;
+	GpRegion *region;
+	ARGB color;
+
+	RectF rect1 = {10, 10, 40, 40};
+	RectF rect2 = {30, 30, 40, 40};
+	GpPath *path1 = createPathFromRect (&rect1);
+	GpPath *path2 = createPathFromRect (&rect2);
+
+	GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipGetImageGraphicsContext (bitmap, &bitmapGraphics);
+	GdipCreateSolidFill (0xFFFF0000, &brush);
+
+	GdipCreateRegionPath (path1, &region);
+	GdipCombineRegionPath (region, path2, CombineModeXor);
+
+	status = GdipFillRegion (bitmapGraphics, brush, region);
+	assertEqualInt (status, Ok);
+
+	GdipBitmapGetPixel (bitmap, 5, 5, &color);
+	assertEqualInt (color, 0);
+	GdipBitmapGetPixel (bitmap, 20, 20, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 40, 40, &color);
+	assertEqualInt (color, 0);
+	GdipBitmapGetPixel (bitmap, 60, 60, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 80, 80, &color);
+	assertEqualInt (color, 0);
+
+	// The region is filled in world coordinates.
+	GdipSetSolidFillColor (brush, 0xFF0000FF);
+	GdipTranslateWorldTransform (bitmapGraphics, 20, 0, MatrixOrderAppend);
+	status = GdipFillRegion (bitmapGraphics, brush, region);
+	assertEqualInt (status, Ok);
+
+	GdipBitmapGetPixel (bitmap, 20, 20, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 35, 20, &color);
+	assertEqualInt (color, 0xFF0000FF);
+	GdipBitmapGetPixel (bitmap, 80, 60, &color);
+	assertEqualInt (color, 0xFF0000FF);
+
+	GdipDeleteRegion (region);
+	GdipDeleteBrush ((GpBrush *) brush);
+	GdipDeleteGraphics (bitmapGraphics);
+	GdipDisposeImage ((GpImage *) bitmap);
+	GdipDeletePath (path1);
+	GdipDeletePath (path2);
+}
+
+static void test_fillLargeRegion ()
+{
+	GpStatus status;
+	GpBitmap *bitmap;
+	GpGraphics *bitmapGraphics;
+	GpSolidFill *brush;
+	GpRegion *region;
+	GpPath *ellipse;
+	GpPath *wide;
+	RectF hole = {35, 35, 30, 30};
+	ARGB color;
+
+	GdipCreateBitmapFromScan0 (100, 100, 0, PixelFormat32bppARGB, NULL, &bitmap);
+	GdipGetImageGraphicsContext (bitmap, &bitmapGraphics);
+	GdipCreateSolidFill (0xFFFF0000, &brush);
+	GdipCreatePath (FillModeAlternate, &ellipse);
+	GdipAddPathEllipse (ellipse, 40, 40, 20, 20);
+
+	// An infinite region with a hole, around an ellipse.
+	GdipCreateRegion (&region);
+	GdipCombineRegionRect (region, &hole, CombineModeExclude);
+	GdipCombineRegionPath (region, ellipse, CombineModeUnion);
+
+	status = GdipFillRegion (bitmapGraphics, brush, region);
+	assertEqualInt (status, Ok);
+
+	GdipBitmapGetPixel (bitmap, 5, 5, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 95, 95, &color);
+	assertEqualInt (color, 0xFFFF0000);
+	GdipBitmapGetPixel (bitmap, 37, 37, &color);
+	assertEqualInt (color, 0);
+	GdipBitmapGetPixel (bitmap, 50, 50, &color);
+	assertEqualInt (color, 0xFFFF0000);
+
+	GdipDeleteRegion (region);
+
+	// Wider than a cairo surface.
+	GdipCreatePath (FillModeAlternate, &wide);
+	GdipAddPathRectangle (wide, -20000, 0, 40000, 30);
+	GdipCreateRegionPath (wide, &region);
+	GdipCombineRegionPath (region, ellipse, CombineModeUnion);
+	GdipSetSolidFillColor (brush, 0xFF0000FF);
+
+	status = GdipFillRegion (bitmapGraphics, brush, region);
+	assertEqualInt (status, Ok);
+
+	GdipBitmapGetPixel (bitmap, 5, 5, &color);
+	assertEqualInt (color, 0xFF0000FF);
+	GdipBitmapGetPixel (bitmap, 50, 50, &color);
+	assertEqualInt (color, 0xFF0000FF);
+	GdipBitmapGetPixel (bitmap, 37, 37, &color);
+	assertEqualInt (color, 0);
+	GdipBitmapGetPixel (bitmap, 5, 95, &color);
+	assertEqualInt (color, 0xFFFF0000);
+
+	GdipDeleteRegion (region);
+	GdipDeletePath (ellipse);
+	GdipDeletePath (wide);
+	GdipDeleteBrush ((GpBrush *) brush);
+	GdipDeleteGraphics (bitmapGraphics);
+	GdipDisposeImage ((GpImage *) bitmap);
+}
+
+static void test_isVisiblePathRegionRect ()
+{
+	GpStatus status;
+	GpRegion *region;
+	GpPath *path;
+	BOOL result;
+
+	GdipCreatePath (FillModeAlternate, &path);
+	GdipAddPathEllipse (path, 10, 10, 20, 20);
+	GdipCreateRegionPath (path, &region);
+
+	status = GdipIsVisibleRegionRect (region, 15, 15, 10, 10, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, TRUE);
+
+	// Negative sizes are measured from the other side (GDI+ treats them as empty).
+	status = GdipIsVisibleRegionRect (region, 25, 25, -10, -10, graphics, &result);
+	assertEqualInt (status, Ok);
+#if defined(USE_WINDOWS_GDIPLUS)
+	assertEqualInt (result, FALSE);
+#else
+	assertEqualInt (result, TRUE);
+#endif
+
+	status = GdipIsVisibleRegionRect (region, 5, 5, -10, -10, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionRect (region, 45, 20, -10, 5, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	GdipDeleteRegion (region);
+	GdipDeletePath (path);
+}
+
+static void test_getRegionScansWidePath ()
+{
+	GpStatus status;
+	GpRegion *region;
+	GpPath *path;
+	GpPoint points[] = { {0, 0}, {40000, 0}, {40000, 10}, {10, 10}, {10, 600}, {0, 600} };
+
+	// Wider than a single strip, and than a single tile.
+	GdipCreatePath (FillModeAlternate, &path);
+	GdipAddPathPolygonI (path, points, sizeof (points) / sizeof (points[0]));
+	status = GdipCreateRegionPath (path, &region);
+	assertEqualInt (status, Ok);
+
+	RectF expectedScans[] = {
+		{0, 0, 40000, 10},
+		{0, 10, 10, 590}
+	};
+	verifyRegionScans (region, expectedScans, sizeof (expectedScans));
+
+	GdipDeleteRegion (region);
+	GdipDeletePath (path);
+}
+
+static void test_getRegionScansUnalignedEdges ()
+{
+	GpStatus status;
+	GpRegion *region;
+	GpPath *path;
+	INT widths[] = { 63, 64, 65 };
+
+	// Edges on either side of a 64 pixels word boundary.
+	for (int i = 0; i < sizeof (widths) / sizeof (widths[0]); i++) {
+		INT right = 3 + widths[i];
+		GpPoint points[] = { {3, 0}, {right, 0}, {right, 2}, {4, 2}, {4, 4}, {3, 4} };
+
+		GdipCreatePath (FillModeAlternate, &path);
+		GdipAddPathPolygonI (path, points, sizeof (points) / sizeof (points[0]));
+		status = GdipCreateRegionPath (path, &region);
+		assertEqualInt (status, Ok);
+
+		RectF expectedScans[] = {
+			{3, 0, (REAL) widths[i], 2},
+			{3, 2, 1, 2}
+		};
+		verifyRegionScans (region, expectedScans, sizeof (expectedScans));
+
+		GdipDeleteRegion (region);
+		GdipDeletePath (path);
+	}
+}
+
+static void test_combineEmptyPathAroundOrigin ()
+{
+	GpStatus status;
+	GpRegion *region;
+	GpPath *ellipse;
+	GpPath *empty;
+
+	// The bounds of an empty path, 0x0 at the origin, are inside the ellipse bounds.
+	GdipCreatePath (FillModeAlternate, &ellipse);
+	GdipAddPathEllipse (ellipse, -10, -10, 20, 20);
+	GdipCreatePath (FillModeAlternate, &empty);
+
+	GdipCreateRegionPath (ellipse, &region);
+	status = GdipCombineRegionPath (region, empty, CombineModeIntersect);
+	assertEqualInt (status, Ok);
+	verifyRegion (region, 0, 0, 0, 0, TRUE, FALSE);
+	GdipDeleteRegion (region);
+
+	GdipCreateRegionPath (ellipse, &region);
+	status = GdipCombineRegionPath (region, empty, CombineModeExclude);
+	assertEqualInt (status, Ok);
+	verifyRegion (region, -10, -10, 20, 20, FALSE, FALSE);
+	GdipDeleteRegion (region);
+
+	GdipCreateRegionPath (ellipse, &region);
+	status = GdipCombineRegionPath (region, empty, CombineModeComplement);
+	assertEqualInt (status, Ok);
+	verifyRegion (region, 0, 0, 0, 0, TRUE, FALSE);
+	GdipDeleteRegion (region);
+
+	GdipDeletePath (ellipse);
+	GdipDeletePath (empty);
+}
+
+static void test_combineManyRects ()
+{
+	GpStatus status;
+	GpRegion *region;
+	GpRectF rect = {40, 0, 20, 20};
+	// Overlapping, touching and out of order rectangles.
+	GpRectF unionRects[] = {
+		{0, 10, 20, 20},
+		{10, 0, 40, 10},
+		{0, 40, 10, 10},
+		{50, 40, 10, 10},
+		{10, 40, 40, 10}
+	};
+	GpRectF excludeRect = {15, 5, 30, 40};
+	int i;
+
+	GdipCreateRegionRect (&rect, &region);
+	for (i = 0; i < sizeof (unionRects) / sizeof (unionRects[0]); i++) {
+		status = GdipCombineRegionRect (region, &unionRects[i], CombineModeUnion);
+		assertEqualInt (status, Ok);
+	}
+
+	RectF unionScans[] = {
+		{10, 0, 50, 10},
+		{0, 10, 20, 10},
+		{40, 10, 20, 10},
+		{0, 20, 20, 10},
+		{0, 40, 60, 10}
+	};
+	verifyRegion (region, 0, 0, 60, 50, FALSE, FALSE);
+	verifyRegionScans (region, unionScans, sizeof (unionScans));
+
+	// Holes split the bands, which are merged back where they become identical.
+	status = GdipCombineRegionRect (region, &excludeRect, CombineModeExclude);
+	assertEqualInt (status, Ok);
+
+	RectF excludeScans[] = {
+		{10, 0, 50, 5},
+		{10, 5, 5, 5},
+		{45, 5, 15, 5},
+		{0, 10, 15, 10},
+		{45, 10, 15, 10},
+		{0, 20, 15, 10},
+		{0, 40, 15, 5},
+		{45, 40, 15, 5},
+		{0, 45, 60, 5}
+	};
+	verifyRegion (region, 0, 0, 60, 50, FALSE, FALSE);
+	verifyRegionScans (region, excludeScans, sizeof (excludeScans));
+
+	GdipDeleteRegion (region);
+}
+
+static void test_combineUnorderedRgnData ()
+{
+#if !defined(USE_WINDOWS_GDIPLUS)
+	GpStatus status;
+	GpRegion *region;
+	// Neither sorted by Y then X, nor banded, and with a duplicate.
+	GpRectF rects[] = {
+		{30, 30, 10, 10},
+		{0, 0, 20, 20},
+		{10, 10, 20, 10},
+		{0, 30, 10, 10},
+		{0, 0, 20, 20}
+	};
+	GpRectF xorRect = {5, 5, 10, 30};
+	UINT header[2] = {0x10000000 /* RegionTypeRect */, sizeof (rects) / sizeof (rects[0])};
+	BYTE data[sizeof (header) + sizeof (rects)];
+
+	memcpy (data, header, sizeof (header));
+	memcpy (data + sizeof (header), rects, sizeof (rects));
+
+	status = GdipCreateRegionRgnData (data, sizeof (data), &region);
+	assertEqualInt (status, Ok);
+
+	RectF rgnDataScans[] = {
+		{0, 0, 20, 10},
+		{0, 10, 30, 10},
+		{0, 30, 10, 10},
+		{30, 30, 10, 10}
+	};
+	verifyRegion (region, 0, 0, 40, 40, FALSE, FALSE);
+	verifyRegionScans (region, rgnDataScans, sizeof (rgnDataScans));
+
+	status = GdipCombineRegionRect (region, &xorRect, CombineModeXor);
+	assertEqualInt (status, Ok);
+
+	RectF xorScans[] = {
+		{0, 0, 20, 5},
+		{0, 5, 5, 5},
+		{15, 5, 5, 5},
+		{0, 10, 5, 10},
+		{15, 10, 15, 10},
+		{5, 20, 10, 10},
+		{0, 30, 5, 5},
+		{10, 30, 5, 5},
+		{30, 30, 10, 5},
+		{0, 35, 10, 5},
+		{30, 35, 10, 5}
+	};
+	verifyRegion (region, 0, 0, 40, 40, FALSE, FALSE);
+	verifyRegionScans (region, xorScans, sizeof (xorScans));
+
+	GdipDeleteRegion (region);
+#endif
+}
+
+static void test_isVisibleRegion ()
+{
+	GpStatus status;
+	GpRegion *region;
+	BOOL result;
+	int x, y;
+
+	// A checkerboard of 5x5 squares, every 10 pixels.
+	RectF first = {0, 0, 5, 5};
+	GdipCreateRegionRect (&first, &region);
+	for (y = 0; y < 100; y += 10) {
+		for (x = 0; x < 100; x += 10) {
+			RectF square = {x, y, 5, 5};
+			GdipCombineRegionRect (region, &square, CombineModeUnion);
+		}
+	}
+
+	status = GdipIsVisibleRegionPoint (region, 42, 42, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, TRUE);
+
+	status = GdipIsVisibleRegionPoint (region, 45, 42, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionPoint (region, 40, 39.5, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionPoint (region, 99, 99, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionRect (region, 45, 45, 5, 5, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionRect (region, 45, 45, 5.5, 5.5, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, TRUE);
+
+	status = GdipIsVisibleRegionRect (region, 50, 50, -5.5, -5.5, graphics, &result);
+	assertEqualInt (status, Ok);
+#if defined(USE_WINDOWS_GDIPLUS)
+	assertEqualInt (result, FALSE);
+#else
+	assertEqualInt (result, TRUE);
+#endif
+
+	status = GdipIsVisibleRegionRect (region, 5, 0, 5, 100, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	// The region is hit tested after being modified.
+	GdipTranslateRegion (region, 5, 0);
+	status = GdipIsVisibleRegionPoint (region, 42, 42, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionPoint (region, 45, 42, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, TRUE);
+
+	RectF hole = {40, 40, 20, 20};
+	GdipCombineRegionRect (region, &hole, CombineModeExclude);
+	status = GdipIsVisibleRegionPoint (region, 45, 42, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionRect (region, 40, 40, 20, 20, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	// Negative tests.
+	status = GdipIsVisibleRegionPoint (NULL, 0, 0, graphics, &result);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipIsVisibleRegionPoint (region, 0, 0, graphics, NULL);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipIsVisibleRegionRect (NULL, 0, 0, 1, 1, graphics, &result);
+	assertEqualInt (status, InvalidParameter);
+
+	status = GdipIsVisibleRegionRect (region, 0, 0, 1, 1, graphics, NULL);
+	assertEqualInt (status, InvalidParameter);
+
+	GdipDeleteRegion (region);
+}
+
+static void test_transformRegion ()
+{
+	GpStatus status;
+	GpRegion *region;
+	GpMatrix *matrix;
+	GpPath *path;
+	BOOL result;
+
+	RectF rect1 = {10, 20, 30, 40};
+	RectF rect2 = {50, 20, 10, 10};
+
+	// Scaled and mirrored.
+	GdipCreateRegionRect (&rect1, &region);
+	GdipCombineRegionRect (region, &rect2, CombineModeUnion);
+	GdipCreateMatrix2 (2, 0, 0, -1, 0, 0, &matrix);
+
+	status = GdipTransformRegion (region, matrix);
+	assertEqualInt (status, Ok);
+	verifyRegion (region, 20, -60, 100, 40, FALSE, FALSE);
+
+	RectF mirroredScans[] = {
+		{20, -60, 60, 30},
+		{20, -30, 60, 10},
+		{100, -30, 20, 10}
+	};
+	verifyRegionScans (region, mirroredScans, sizeof (mirroredScans));
+
+	GdipDeleteMatrix (matrix);
+	GdipDeleteRegion (region);
+
+	// Rotated by 90 degrees and translated.
+	GdipCreateRegionRect (&rect1, &region);
+	GdipCreateMatrix2 (0, 1, -1, 0, 100, 0, &matrix);
+
+	status = GdipTransformRegion (region, matrix);
+	assertEqualInt (status, Ok);
+	verifyRegion (region, 40, 10, 40, 30, FALSE, FALSE);
+
+	GdipDeleteMatrix (matrix);
+	GdipDeleteRegion (region);
+
+	// Only translated vertically.
+	GdipCreatePath (FillModeAlternate, &path);
+	GdipAddPathRectangle (path, 10, 10, 20, 20);
+	GdipCreateRegionPath (path, &region);
+	GdipIsVisibleRegionPoint (region, 15, 15, graphics, &result);
+	GdipCreateMatrix2 (1, 0, 0, 1, 0, 10, &matrix);
+
+	status = GdipTransformRegion (region, matrix);
+	assertEqualInt (status, Ok);
+	verifyRegion (region, 10, 20, 20, 20, FALSE, FALSE);
+
+	status = GdipIsVisibleRegionPoint (region, 15, 15, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, FALSE);
+
+	status = GdipIsVisibleRegionPoint (region, 15, 35, graphics, &result);
+	assertEqualInt (status, Ok);
+	assertEqualInt (result, TRUE);
+
+	GdipDeleteMatrix (matrix);
+	GdipDeleteRegion (region);
+	GdipDeletePath (path);
+}
+
 int
 main (int argc, char**argv)
 {
@@ -3687,6 +4098,16 @@ main (int argc, char**argv)
 	test_combineXor ();
 	test_combineExclude ();
 	test_combineComplement ();
+	test_fillRegion ();
+	test_fillLargeRegion ();
+	test_isVisiblePathRegionRect ();
+	test_getRegionScansWidePath ();
+	test_getRegionScansUnalignedEdges ();
+	test_combineEmptyPathAroundOrigin ();
+	test_combineManyRects ();
+	test_combineUnorderedRgnData ();
+	test_isVisibleRegion ();
+	test_transformRegion ();
 
 	GdipDisposeImage (image);
 	GdipDeleteGraphics (graphics);